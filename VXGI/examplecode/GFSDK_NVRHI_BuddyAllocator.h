@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <map>
+
+namespace NVRHI
+{
+    // Binary buddy allocator over an abstract address range of (minBlockSize << numOrders) bytes.
+    // It never touches the memory it manages, so it can be used for GPU heaps or anything else.
+    // Every block is aligned to its own size, so any alignment up to the block size is satisfied.
+    class BuddyAllocator
+    {
+    public:
+        static const uint64_t INVALID_OFFSET = ~0ull;
+
+        BuddyAllocator(uint64_t minBlockSize, uint32_t numOrders)
+            : m_MinBlockSize(minBlockSize)
+            , m_NumOrders(numOrders)
+            , m_FreeBlocks(numOrders + 1)
+            , m_AllocatedSize(0)
+        {
+            m_FreeBlocks[numOrders].insert(0);
+        }
+
+        uint64_t Allocate(uint64_t size, uint64_t alignment)
+        {
+            uint32_t order = GetOrder(std::max(size, alignment));
+            if (order > m_NumOrders)
+                return INVALID_OFFSET;
+
+            // Find the smallest free block that fits, preferring lower addresses
+            uint32_t freeOrder = order;
+            while (freeOrder <= m_NumOrders && m_FreeBlocks[freeOrder].empty())
+                freeOrder++;
+
+            if (freeOrder > m_NumOrders)
+                return INVALID_OFFSET;
+
+            uint64_t offset = *m_FreeBlocks[freeOrder].begin();
+            m_FreeBlocks[freeOrder].erase(m_FreeBlocks[freeOrder].begin());
+
+            // Split it down to the requested order, returning the upper halves to the free lists
+            while (freeOrder > order)
+            {
+                freeOrder--;
+                m_FreeBlocks[freeOrder].insert(offset + GetBlockSize(freeOrder));
+            }
+
+            m_Allocations[offset] = order;
+            m_AllocatedSize += GetBlockSize(order);
+            return offset;
+        }
+
+        void Free(uint64_t offset)
+        {
+            auto it = m_Allocations.find(offset);
+            if (it == m_Allocations.end())
+                return;
+
+            uint32_t order = it->second;
+            m_Allocations.erase(it);
+            m_AllocatedSize -= GetBlockSize(order);
+
+            // Merge with the buddy for as long as it is free
+            while (order < m_NumOrders)
+            {
+                uint64_t buddy = offset ^ GetBlockSize(order);
+                auto buddyIt = m_FreeBlocks[order].find(buddy);
+                if (buddyIt == m_FreeBlocks[order].end())
+                    break;
+
+                m_FreeBlocks[order].erase(buddyIt);
+                offset = std::min(offset, buddy);
+                order++;
+            }
+
+            m_FreeBlocks[order].insert(offset);
+        }
+
+        uint64_t GetSize() const { return GetBlockSize(m_NumOrders); }
+        uint64_t GetAllocatedSize() const { return m_AllocatedSize; }
+        uint32_t GetNumAllocations() const { return uint32_t(m_Allocations.size()); }
+        bool IsEmpty() const { return m_Allocations.empty(); }
+
+        uint64_t GetLargestFreeBlock() const
+        {
+            for (uint32_t order = m_NumOrders + 1; order > 0; order--)
+                if (!m_FreeBlocks[order - 1].empty())
+                    return GetBlockSize(order - 1);
+
+            return 0;
+        }
+
+        uint32_t GetNumFreeBlocks() const
+        {
+            size_t count = 0;
+            for (const auto& blocks : m_FreeBlocks)
+                count += blocks.size();
+
+            return uint32_t(count);
+        }
+
+    private:
+        uint64_t m_MinBlockSize;
+        uint32_t m_NumOrders;
+        std::vector<std::set<uint64_t>> m_FreeBlocks;  // free block offsets, per order
+        std::map<uint64_t, uint32_t> m_Allocations;    // offset -> order
+        uint64_t m_AllocatedSize;
+
+        uint64_t GetBlockSize(uint32_t order) const
+        {
+            return m_MinBlockSize << order;
+        }
+
+        uint32_t GetOrder(uint64_t size) const
+        {
+            uint32_t order = 0;
+            while (GetBlockSize(order) < size && order <= m_NumOrders)
+                order++;
+
+            return order;
+        }
+    };
+}
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace NVRHI
+{
+    // Linear suballocator for constant buffer versions in one large dynamic buffer.
+    // Versions are appended and written without overwriting anything the GPU may still read;
+    // when the buffer is full, allocation restarts at offset 0 in a new generation, which requires
+    // the buffer to be discarded (renamed) first. A version stays readable for new draws
+    // only while its generation is current.
+    class ConstantBufferRing
+    {
+    public:
+        enum { ALIGNMENT = 256 };   // 16 constants of 16 bytes, the granularity of offset binding
+
+        struct Allocation
+        {
+            uint32_t offset;
+            uint32_t size;
+            uint64_t generation;
+            bool discard;           // the buffer has to be mapped with discard for this allocation
+        };
+
+        ConstantBufferRing(uint32_t size)
+            : m_Size(size)
+            , m_WritePointer(0)
+            , m_Generation(0)
+            , m_NeedsDiscard(true)
+            , m_NumAllocations(0)
+            , m_NumDiscards(0)
+            , m_AllocatedBytes(0)
+        { }
+
+        bool Allocate(uint32_t size, Allocation& result)
+        {
+            uint32_t alignedSize = (size + ALIGNMENT - 1) & ~uint32_t(ALIGNMENT - 1);
+            if (alignedSize > m_Size)
+                return false;
+
+            if (m_WritePointer + alignedSize > m_Size)
+            {
+                m_Generation++;
+                m_WritePointer = 0;
+                m_NeedsDiscard = true;
+            }
+
+            result.offset = m_WritePointer;
+            result.size = alignedSize;
+            result.generation = m_Generation;
+            result.discard = m_NeedsDiscard;
+
+            if (m_NeedsDiscard)
+                m_NumDiscards++;
+
+            m_NeedsDiscard = false;
+            m_WritePointer += alignedSize;
+            m_NumAllocations++;
+            m_AllocatedBytes += alignedSize;
+            return true;
+        }
+
+        // Starts a new generation, e.g. at the beginning of a deferred command list where the first map must discard
+        void Reset()
+        {
+            m_Generation++;
+            m_WritePointer = 0;
+            m_NeedsDiscard = true;
+        }
+
+        bool IsCurrent(uint64_t generation) const { return generation == m_Generation && !m_NeedsDiscard; }
+        uint64_t GetGeneration() const { return m_Generation; }
+
+        uint32_t GetSize() const { return m_Size; }
+        uint64_t GetNumAllocations() const { return m_NumAllocations; }
+        uint64_t GetNumDiscards() const { return m_NumDiscards; }
+        uint64_t GetAllocatedBytes() const { return m_AllocatedBytes; }
+
+    private:
+        uint32_t m_Size;
+        uint32_t m_WritePointer;
+        uint64_t m_Generation;
+        bool m_NeedsDiscard;
+        uint64_t m_NumAllocations;
+        uint64_t m_NumDiscards;
+        uint64_t m_AllocatedBytes;
+    };
+}
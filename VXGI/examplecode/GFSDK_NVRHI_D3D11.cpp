@@ -10,6 +10,7 @@
 
 #include "GFSDK_NVRHI_D3D11.h"
 #include <algorithm>
+#include <atomic>
 
 #define NVRHI_D3D11_WITH_NVAPI 1
 
@@ -23,6 +24,9 @@
 
 #define CHECK_ERROR(expr, msg) if (!(expr)) this->signalError(__FILE__, __LINE__, msg)
 
+#define CONSTANT_BUFFER_RING_SIZE (4 * 1024 * 1024)
+#define DEFERRED_CONSTANT_BUFFER_RING_SIZE (1024 * 1024)
+
 #pragma warning(disable:4127) // conditional expression is constant
 
 namespace NVRHI
@@ -47,6 +51,26 @@ namespace NVRHI
         { }
     };
 
+    //Immutable after creation, so that any context can use it; the written data lives in the per-context versions
+    class ConstantBuffer
+    {
+    public:
+        ComPtr<ID3D11Buffer> buffer;                //used by the immediate context without offset binding, or when the data doesn't fit into the ring
+        uint32_t byteSize;
+        uint64_t id;
+        std::vector<char> initialContents;          //the data passed to createConstantBuffer, for contexts that bind the buffer without writing it
+
+        ConstantBuffer()
+            : byteSize(0)
+            , id(0)
+        { }
+    };
+
+    static std::atomic<uint64_t> g_ConstantBufferCounter(0);
+
+    //Private data of the command lists finished by deferred contexts: the RendererStatistics recorded into them
+    static const GUID g_CommandListStatisticsGuid = { 0xa64fe5b3, 0xfee9, 0x4944, { 0xb2, 0x16, 0x29, 0x3a, 0x6c, 0xaa, 0xcd, 0xc7 } };
+
     //convert the format to a DXGI format
     static DXGI_FORMAT getUntypedTextureFormat(Format::Enum format, UINT& outPixelSizeBytes)
     {
@@ -262,104 +286,6 @@ namespace NVRHI
         return allocFormat;
     }
 
-    bool GetSSE42Support()
-    {
-        int cpui[4];
-        __cpuidex(cpui, 1, 0);
-        return !!(cpui[2] & 0x100000);
-    }
-
-    static const bool CpuSupportsSSE42 = GetSSE42Support();
-
-    static const uint32_t CrcTable[] = {
-        0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-        0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-        0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-        0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-        0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-        0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-        0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-        0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-        0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-        0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-        0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-        0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-        0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-        0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-        0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-        0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-        0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-        0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-        0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-        0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-        0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-        0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-        0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-        0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-        0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-        0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-        0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-        0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-        0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-        0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-        0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-        0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-        0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-        0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-        0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-        0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-        0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-        0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-        0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-        0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-        0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-        0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-        0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-    };
-
-    class CrcHash
-    {
-    private:
-        uint32_t crc;
-    public:
-        CrcHash() 
-            : crc(0) 
-        { 
-        }
-
-        uint32_t Get() 
-        {
-            return crc;
-        }
-
-        template<size_t size> __forceinline void AddBytesSSE42(void* p)
-        {
-            static_assert(size % 4 == 0, "Size of hashable types must be multiple of 4");
-
-            uint32_t* data = (uint32_t*)p;
-
-            const size_t numIterations = size / sizeof(uint32_t);
-            for (size_t i = 0; i < numIterations; i++)
-            {
-                crc = _mm_crc32_u32(crc, data[i]);
-            }
-        }
-
-        __forceinline void AddBytes(char* p, uint32_t size)
-        {
-            for (uint32_t idx = 0; idx < size; idx++)
-                crc = CrcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
-        }
-
-        template<typename T> void Add(const T& value)
-        {
-            if (CpuSupportsSSE42)
-                AddBytesSSE42<sizeof(value)>((void*)&value);
-            else
-                AddBytes((char*)&value, sizeof(value));
-        }
-    };
-
     RendererInterfaceD3D11::~RendererInterfaceD3D11()
     {
 #if NVRHI_D3D11_WITH_NVAPI
@@ -367,7 +293,9 @@ namespace NVRHI
             NvAPI_Unload();
 #endif
 
-        clearCachedData();
+        //the caches of a deferred context are never used
+        if (!sharedOwner)
+            clearCachedData();
     }
 
 
@@ -375,9 +303,35 @@ namespace NVRHI
         : context(context)
         , errorCB(errorCB)
         , nvapiIsInitalized(false)
+        , sharedOwner(NULL)
+        , numDeferredContexts(0)
+        , cbufferRing(CONSTANT_BUFFER_RING_SIZE)
+        , commandListCounter(0)
+        , hasDestroyedConstantBuffers(false)
+        , statisticsEnabled(false)
     {
         this->context->GetDevice(&device);
 
+        //Use the constant buffer ring with offset binding if the runtime and the driver support it (D3D11.1)
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        if (SUCCEEDED(context->QueryInterface(IID_PPV_ARGS(&context1))) &&
+            SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+            options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer)
+        {
+            D3D11_BUFFER_DESC desc11;
+            desc11.ByteWidth = CONSTANT_BUFFER_RING_SIZE;
+            desc11.Usage = D3D11_USAGE_DYNAMIC;
+            desc11.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            desc11.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            desc11.MiscFlags = 0;
+            desc11.StructureByteStride = 0;
+
+            device->CreateBuffer(&desc11, NULL, &cbufferRingBuffer);
+        }
+
+        if (!cbufferRingBuffer)
+            context1 = NULL;
+
 #if NVRHI_D3D11_WITH_NVAPI
         //We need to use NVAPI to set resource hints for SLI
         nvapiIsInitalized = NvAPI_Initialize() == NVAPI_OK;
@@ -386,6 +340,204 @@ namespace NVRHI
         context->QueryInterface(IID_PPV_ARGS(&userDefinedAnnotation));
     }
 
+    RendererInterfaceD3D11::RendererInterfaceD3D11(RendererInterfaceD3D11& owner, ID3D11DeviceContext* deferredContext)
+        : context(deferredContext)
+        , device(owner.device)
+        , errorCB(owner.errorCB)
+        , nvapiIsInitalized(false)
+        , sharedOwner(&owner)
+        , numDeferredContexts(0)
+        , cbufferRing(DEFERRED_CONSTANT_BUFFER_RING_SIZE)
+        , commandListCounter(0)
+        , hasDestroyedConstantBuffers(false)
+        , statisticsEnabled(false)
+    {
+        statistics.SetEnabled(owner.statisticsEnabled.load(std::memory_order_acquire));
+
+        //offset binding is supported if the owner has created its ring; this ring is created by uploadConstantBuffer
+        if (owner.cbufferRingBuffer)
+            context->QueryInterface(IID_PPV_ARGS(&context1));
+
+        context->QueryInterface(IID_PPV_ARGS(&userDefinedAnnotation));
+    }
+
+    DeferredContextD3D11* RendererInterfaceD3D11::createDeferredContext()
+    {
+        CHECK_ERROR(!sharedOwner, "Deferred contexts can only be created by the immediate context interface");
+
+        ComPtr<ID3D11DeviceContext> deferredContext;
+        if (FAILED(device->CreateDeferredContext(0, &deferredContext)))
+        {
+            CHECK_ERROR(0, "Failed to create a deferred context");
+            return NULL;
+        }
+
+        DeferredContextD3D11* result = new DeferredContextD3D11(this, deferredContext.Get());
+
+        std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+        deferredContexts.push_back(result);
+        numDeferredContexts.store(uint32_t(deferredContexts.size()), std::memory_order_release);
+        return result;
+    }
+
+    void RendererInterfaceD3D11::destroyDeferredContext(DeferredContextD3D11* deferredContext)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+            deferredContexts.erase(std::remove(deferredContexts.begin(), deferredContexts.end(), deferredContext), deferredContexts.end());
+            numDeferredContexts.store(uint32_t(deferredContexts.size()), std::memory_order_release);
+        }
+
+        delete deferredContext;
+    }
+
+    std::unique_lock<std::recursive_mutex> RendererInterfaceD3D11::lockCaches()
+    {
+        //Without deferred contexts, the immediate context is the only user of the caches. Deferred contexts are created
+        //and destroyed on the thread of the immediate context, so the count can't change during a lookup on that thread.
+        if (numDeferredContexts.load(std::memory_order_acquire) == 0)
+            return std::unique_lock<std::recursive_mutex>();
+
+        return std::unique_lock<std::recursive_mutex>(cacheMutex);
+    }
+
+    template<typename T>
+    T* RendererInterfaceD3D11::referenceView(ComPtr<T> view)
+    {
+        T* result = view.Get();
+        if (result)
+            viewReferences.push_back(std::move(view));
+        return result;
+    }
+
+    void RendererInterfaceD3D11::executeCommandList(ID3D11CommandList* commandList)
+    {
+        CHECK_ERROR(!sharedOwner, "Command lists can only be executed by the immediate context interface");
+
+        if (!commandList)
+            return;
+
+        //restore the immediate context state afterwards so that the application state (see UserState) is preserved
+        context->ExecuteCommandList(commandList, TRUE);
+
+        if (statistics.IsEnabled())
+        {
+            RendererStatistics recorded;
+            UINT size = sizeof(recorded);
+            auto lock = lockCaches();
+
+            if (SUCCEEDED(commandList->GetPrivateData(g_CommandListStatisticsGuid, &size, &recorded)) && size == sizeof(recorded))
+                statistics.Merge(recorded);
+
+            NVRHI_STAT_ADD(statistics, commandListFlushes, 1);
+        }
+    }
+
+    bool RendererInterfaceD3D11::setEnableStatistics(bool enable)
+    {
+        //the forwarded cache lookups of deferred contexts count state object creation here
+        auto lock = lockCaches();
+
+        bool result = statistics.SetEnabled(enable);
+        statisticsEnabled.store(statistics.IsEnabled(), std::memory_order_release);
+        return result;
+    }
+
+    void RendererInterfaceD3D11::endStatisticsFrame()
+    {
+        auto lock = lockCaches();
+        statistics.EndFrame();
+    }
+
+    bool RendererInterfaceD3D11::getFrameStatistics(RendererStatistics& stats)
+    {
+        return statistics.GetLastFrame(stats);
+    }
+
+    DeferredContextD3D11::DeferredContextD3D11(RendererInterfaceD3D11* owner, ID3D11DeviceContext* deferredContext)
+        : RendererInterfaceD3D11(*owner, deferredContext)
+    { }
+
+    ComPtr<ID3D11CommandList> DeferredContextD3D11::finishCommandList()
+    {
+        //every draw and dispatch leaves the context in the cleared state, so there is nothing to restore
+        ComPtr<ID3D11CommandList> commandList;
+        CHECK_ERROR(SUCCEEDED(context->FinishCommandList(FALSE, &commandList)), "FinishCommandList failed");
+
+        //the owner adds the counters to its frame when it executes the command list
+        if (statistics.IsEnabled() && commandList)
+            commandList->SetPrivateData(g_CommandListStatisticsGuid, sizeof(RendererStatistics), &statistics.Current());
+
+        statistics.Current() = RendererStatistics();
+        statistics.SetEnabled(sharedOwner->statisticsEnabled.load(std::memory_order_acquire));
+
+        //the first map of the ring and of every other dynamic buffer in a command list has to discard
+        cbufferRing.Reset();
+        commandListCounter++;
+
+        //don't wait for the next write to release the buffers of destroyed constant buffers
+        purgeDestroyedConstantBuffers();
+
+        return commandList;
+    }
+
+    //Resources and queries are owned by the immediate context interface
+
+    void DeferredContextD3D11::destroyTexture(TextureHandle t)
+    {
+        sharedOwner->destroyTexture(t);
+    }
+
+    void DeferredContextD3D11::destroyBuffer(BufferHandle b)
+    {
+        sharedOwner->destroyBuffer(b);
+    }
+
+    PerformanceQueryHandle DeferredContextD3D11::createPerformanceQuery(const char* name)
+    {
+        return sharedOwner->createPerformanceQuery(name);
+    }
+
+    void DeferredContextD3D11::destroyPerformanceQuery(PerformanceQueryHandle query)
+    {
+        sharedOwner->destroyPerformanceQuery(query);
+    }
+
+    //Deferred contexts cannot read data back from the GPU
+
+    void DeferredContextD3D11::readBuffer(BufferHandle, void*, size_t* dataSize)
+    {
+        if (dataSize)
+            *dataSize = 0;
+
+        CHECK_ERROR(0, "readBuffer is not supported on deferred contexts");
+    }
+
+    float DeferredContextD3D11::getPerformanceQueryTimeMS(PerformanceQueryHandle)
+    {
+        CHECK_ERROR(0, "getPerformanceQueryTimeMS is not supported on deferred contexts");
+        return 0.f;
+    }
+
+    //Statistics are enabled and read on the immediate context interface; deferred contexts follow it
+
+    bool DeferredContextD3D11::setEnableStatistics(bool)
+    {
+        CHECK_ERROR(0, "setEnableStatistics is not supported on deferred contexts");
+        return false;
+    }
+
+    void DeferredContextD3D11::endStatisticsFrame()
+    {
+        CHECK_ERROR(0, "endStatisticsFrame is not supported on deferred contexts");
+    }
+
+    bool DeferredContextD3D11::getFrameStatistics(RendererStatistics&)
+    {
+        CHECK_ERROR(0, "getFrameStatistics is not supported on deferred contexts");
+        return false;
+    }
+
     TextureHandle RendererInterfaceD3D11::createTexture(const TextureDesc& d, const void* data)
     {
         D3D11_USAGE usage = D3D11_USAGE_DEFAULT;
@@ -469,7 +621,7 @@ namespace NVRHI
 				delete[] initialData;
 
             //add it to the map (passing texture desc to store a copy of it)
-            return (TextureHandle)getHandleForTexture(newTexture.Get(), &d);
+            return getHandleForTexture(newTexture.Get(), &d);
         }
         else
         {
@@ -496,22 +648,22 @@ namespace NVRHI
 				delete[] initialData;
 
             //add it to the map  (passing texture desc to store a copy of it)
-            return (TextureHandle)getHandleForTexture(newTexture.Get(), &d);
+            return getHandleForTexture(newTexture.Get(), &d);
         }
     }
 
     TextureDesc RendererInterfaceD3D11::describeTexture(TextureHandle t)
     {
-        TextureObjectMap::value_type* handle = (TextureObjectMap::value_type*)t;
-        return handle->second.textureDesc;
+        TextureViewSet* handle = getTextureViewSet(t);
+        return handle->textureDesc;
     }
 
     void RendererInterfaceD3D11::clearTextureFloat(TextureHandle t, const Color& clearColor)
     {
-        TextureObjectMap::value_type* handle = (TextureObjectMap::value_type*)t;
-        ID3D11UnorderedAccessView* uav = NULL;
-        ID3D11RenderTargetView* rtv = NULL;
-        ID3D11DepthStencilView* dsv = NULL;
+        TextureViewSet* handle = getTextureViewSet(t);
+        ComPtr<ID3D11UnorderedAccessView> uav;
+        ComPtr<ID3D11RenderTargetView> rtv;
+        ComPtr<ID3D11DepthStencilView> dsv;
         uint32_t index = 0;
 
         while (true)
@@ -519,16 +671,16 @@ namespace NVRHI
             getClearViewForTexture(handle, index++, false, uav, rtv, dsv);
             if (uav)
             {
-                context->ClearUnorderedAccessViewFloat(uav, &clearColor.r);
+                context->ClearUnorderedAccessViewFloat(uav.Get(), &clearColor.r);
             }
             else if (rtv)
             {
-                context->ClearRenderTargetView(rtv, &clearColor.r);
+                context->ClearRenderTargetView(rtv.Get(), &clearColor.r);
             }
             else if (dsv)
             {
                 //re-interpret .y as stencil. Maybe you don't want to do this, but we should do something.
-                context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, clearColor.r, *((UINT8*)&clearColor.g));
+                context->ClearDepthStencilView(dsv.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, clearColor.r, *((UINT8*)&clearColor.g));
             }
             else
             {
@@ -539,10 +691,10 @@ namespace NVRHI
 
     void RendererInterfaceD3D11::clearTextureUInt(TextureHandle t, uint32_t clearColor)
     {
-        TextureObjectMap::value_type* handle = (TextureObjectMap::value_type*)t;
-        ID3D11UnorderedAccessView* uav = NULL;
-        ID3D11RenderTargetView* rtv = NULL;
-        ID3D11DepthStencilView* dsv = NULL;
+        TextureViewSet* handle = getTextureViewSet(t);
+        ComPtr<ID3D11UnorderedAccessView> uav;
+        ComPtr<ID3D11RenderTargetView> rtv;
+        ComPtr<ID3D11DepthStencilView> dsv;
         uint32_t index = 0;
 
 
@@ -552,16 +704,16 @@ namespace NVRHI
             if (uav)
             {
                 UINT clearValues[4] = { clearColor, clearColor, clearColor, clearColor };
-                context->ClearUnorderedAccessViewUint(uav, clearValues);
+                context->ClearUnorderedAccessViewUint(uav.Get(), clearValues);
             }
             else if (rtv)
             {
                 float clearValues[4] = { float(clearColor), float(clearColor), float(clearColor), float(clearColor) };
-                context->ClearRenderTargetView(rtv, clearValues);
+                context->ClearRenderTargetView(rtv.Get(), clearValues);
             }
             else if (dsv)
             {
-                context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, float(clearColor), UINT8(clearColor));
+                context->ClearDepthStencilView(dsv.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, float(clearColor), UINT8(clearColor));
             }
             else
             {
@@ -572,20 +724,34 @@ namespace NVRHI
 
     void RendererInterfaceD3D11::writeTexture(TextureHandle t, uint32_t subresource, const void* data, uint32_t rowPitch, uint32_t depthPitch)
     {
-        TextureObjectMap::value_type* handle = (TextureObjectMap::value_type*)t;
+        TextureViewSet* handle = getTextureViewSet(t);
 
-        ID3D11Resource* resource = handle->first.Get();
+        ID3D11Resource* resource = handle->resource.Get();
 
         context->UpdateSubresource(resource, subresource, NULL, data, rowPitch, depthPitch);
+
+        if (statistics.IsEnabled())
+        {
+            //count the bytes covered by the pitches; block-compressed rows are overestimated
+            const TextureDesc& desc = handle->textureDesc;
+            uint32_t mipLevel = subresource % std::max(desc.mipLevels, 1U);
+            uint32_t rows = std::max(desc.height >> mipLevel, 1U);
+            uint32_t slices = (desc.isArray || desc.isCubeMap) ? 1 : std::max(desc.depthOrArraySize >> mipLevel, 1U);
+            NVRHI_STAT_UPLOAD(statistics, uint64_t(depthPitch ? depthPitch : rowPitch * rows) * slices);
+        }
     }
 
     void RendererInterfaceD3D11::destroyTexture(TextureHandle t)
     {
-        TextureObjectMap::value_type* handle = (TextureObjectMap::value_type*)t;
+        auto lock = lockCaches();
+
+        TextureViewSet* handle = getTextureViewSet(t);
         if (!handle)
             return;
+
         //the smart pointer class will release the texture if we are the last owner
-        textures.erase(handle->first);
+        textureLookup.erase(handle->resource.Get());
+        textures.Remove((TextureObjectMap::Id)t);
     }
 
     BufferHandle RendererInterfaceD3D11::createBuffer(const BufferDesc& d, const void* data)
@@ -636,41 +802,43 @@ namespace NVRHI
             disableSLIResouceSync(newBuffer.Get());
 
         //add to our map
-        return (BufferHandle)getHandleForBuffer(newBuffer.Get(), &d);
+        return getHandleForBuffer(newBuffer.Get(), &d);
     }
 
     void RendererInterfaceD3D11::writeBuffer(BufferHandle b, const void* data, size_t dataSize)
     {
-        BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)b;
+        BufferViewSet* handle = getBufferViewSet(b);
 
-        if (handle->second.bufferDesc.isCPUWritable)
+        if (handle->bufferDesc.isCPUWritable)
         {
             //we can map if it it's D3D11_USAGE_DYNAMIC, but not UpdateSubresource
             D3D11_MAPPED_SUBRESOURCE mappedData;
-            CHECK_ERROR(SUCCEEDED(context->Map(handle->first.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData)), "Map failed");
+            CHECK_ERROR(SUCCEEDED(context->Map(handle->resource.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData)), "Map failed");
             memcpy(mappedData.pData, data, dataSize);
-            context->Unmap(handle->first.Get(), 0);
+            context->Unmap(handle->resource.Get(), 0);
         }
         else
         {
-            context->UpdateSubresource(handle->first.Get(), 0, NULL, data, (UINT)dataSize, 0);
+            context->UpdateSubresource(handle->resource.Get(), 0, NULL, data, (UINT)dataSize, 0);
         }
 
+        NVRHI_STAT_UPLOAD(statistics, dataSize);
+
     }
 
     void RendererInterfaceD3D11::clearBufferUInt(BufferHandle b, uint32_t clearValue)
     {
-        BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)b;
-        ID3D11UnorderedAccessView* uav = getUAVForBuffer(handle);
+        BufferViewSet* handle = getBufferViewSet(b);
+        ComPtr<ID3D11UnorderedAccessView> uav = getUAVForBuffer(handle);
 
         UINT clearValues[4] = { clearValue, clearValue, clearValue, clearValue };
-        context->ClearUnorderedAccessViewUint(uav, clearValues);
+        context->ClearUnorderedAccessViewUint(uav.Get(), clearValues);
     }
 
     void RendererInterfaceD3D11::copyToBuffer(BufferHandle dest, uint32_t destOffsetBytes, BufferHandle src, uint32_t srcOffsetBytes, size_t dataSizeBytes)
     {
-        BufferObjectMap::value_type* handleDest = (BufferObjectMap::value_type*)dest;
-        BufferObjectMap::value_type* handleSrc = (BufferObjectMap::value_type*)src;
+        BufferViewSet* handleDest = getBufferViewSet(dest);
+        BufferViewSet* handleSrc = getBufferViewSet(src);
 
         //Do a 1D copy
         D3D11_BOX srcBox;
@@ -680,7 +848,7 @@ namespace NVRHI
         srcBox.top = 0;
         srcBox.front = 0;
         srcBox.back = 1;
-        context->CopySubresourceRegion(handleDest->first.Get(), 0, (UINT)destOffsetBytes, 0, 0, handleSrc->first.Get(), 0, &srcBox);
+        context->CopySubresourceRegion(handleDest->resource.Get(), 0, (UINT)destOffsetBytes, 0, 0, handleSrc->resource.Get(), 0, &srcBox);
     }
 
     void RendererInterfaceD3D11::readBuffer(BufferHandle b, void* data, size_t* dataSize)
@@ -694,10 +862,10 @@ namespace NVRHI
         if (!data)
             return;
 
-        BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)b;
+        BufferViewSet* handle = getBufferViewSet(b);
 
         D3D11_BUFFER_DESC desc;
-        handle->first->GetDesc(&desc);
+        handle->resource->GetDesc(&desc);
         desc.BindFlags = 0;
         desc.MiscFlags = 0;
         desc.Usage = D3D11_USAGE_STAGING;
@@ -707,7 +875,7 @@ namespace NVRHI
         if (FAILED(device->CreateBuffer(&desc, NULL, &staging)))
             return;
 
-        context->CopyResource(staging.Get(), handle->first.Get());
+        context->CopyResource(staging.Get(), handle->resource.Get());
 
         D3D11_MAPPED_SUBRESOURCE subresource;
         if (SUCCEEDED(context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &subresource)))
@@ -722,17 +890,24 @@ namespace NVRHI
 
     void RendererInterfaceD3D11::destroyBuffer(BufferHandle b)
     {
-        BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)b;
+        auto lock = lockCaches();
+
+        BufferViewSet* handle = getBufferViewSet(b);
         if (!handle)
             return;
 
         //smart pointers will clean up for us
-        buffers.erase(handle->first);
+        bufferLookup.erase(handle->resource.Get());
+        buffers.Remove((BufferObjectMap::Id)b);
     }
 
     ConstantBufferHandle RendererInterfaceD3D11::createConstantBuffer(const ConstantBufferDesc& d, const void* data)
     {
-        //create our staging buffer if we don't have one
+        ConstantBuffer* cbuffer = new ConstantBuffer();
+        cbuffer->byteSize = d.byteSize;
+        cbuffer->id = ++g_ConstantBufferCounter;
+
+        //create our own buffer; it is still needed when the ring is not available or the buffer is too large for offset binding
         D3D11_BUFFER_DESC desc11;
         desc11.ByteWidth = (UINT)d.byteSize;
         desc11.Usage = D3D11_USAGE_DYNAMIC;
@@ -746,35 +921,265 @@ namespace NVRHI
         initialData.SysMemPitch = 0;
         initialData.SysMemSlicePitch = 0;
 
-        ID3D11Buffer* constantBuffer = NULL;
-        CHECK_ERROR(SUCCEEDED(device->CreateBuffer(&desc11, data ? &initialData : NULL, &constantBuffer)), "Creation of constant buffer failed");
+        CHECK_ERROR(SUCCEEDED(device->CreateBuffer(&desc11, data ? &initialData : NULL, &cbuffer->buffer)), "Creation of constant buffer failed");
+
+        if (data)
+            cbuffer->initialContents.assign((const char*)data, (const char*)data + d.byteSize);
+
+        return (ConstantBufferHandle)cbuffer;
+    }
+
+    RendererInterfaceD3D11::ConstantBufferVersion& RendererInterfaceD3D11::getConstantBufferVersion(const ConstantBuffer* cbuffer)
+    {
+        ConstantBufferVersion& version = cbufferVersions[cbuffer];
+
+        if (version.bufferId != cbuffer->id)
+        {
+            version = ConstantBufferVersion();
+            version.bufferId = cbuffer->id;
+        }
 
-        //we don't need to store any additional stuff so just use the D3D pointer as the handle
-        return (ConstantBufferHandle)constantBuffer;
+        return version;
+    }
+
+    void RendererInterfaceD3D11::purgeDestroyedConstantBuffers()
+    {
+        if (!hasDestroyedConstantBuffers.load(std::memory_order_acquire))
+            return;
+
+        std::vector<std::pair<const ConstantBuffer*, uint64_t>> destroyed;
+        {
+            std::lock_guard<std::recursive_mutex> lock(sharedOwner ? sharedOwner->cacheMutex : cacheMutex);
+            destroyed.swap(destroyedConstantBuffers);
+            hasDestroyedConstantBuffers.store(false, std::memory_order_relaxed);
+        }
+
+        //a new buffer at the same address has a different id; its version, if any, is kept
+        for (const auto& buffer : destroyed)
+        {
+            auto it = cbufferVersions.find(buffer.first);
+            if (it != cbufferVersions.end() && it->second.bufferId == buffer.second)
+                cbufferVersions.erase(it);
+        }
+    }
+
+    bool RendererInterfaceD3D11::isConstantBufferVersionCurrent(const ConstantBufferVersion& version)
+    {
+        if (!version.hasContents)
+            return false;
+
+        if (version.inRing)
+            return cbufferRing.IsCurrent(version.ringGeneration);
+
+        return version.ownBufferCommandList == commandListCounter;
     }
 
     void RendererInterfaceD3D11::writeConstantBuffer(ConstantBufferHandle b, const void* data, size_t dataSize)
     {
-        ID3D11Buffer* constantBuffer = (ID3D11Buffer*)b;
+        ConstantBuffer* cbuffer = (ConstantBuffer*)b;
+        NVRHI_STAT_ADD(statistics, constantBufferWrites, 1);
+
+        purgeDestroyedConstantBuffers();
+        ConstantBufferVersion& version = getConstantBufferVersion(cbuffer);
+
+        //skip the write if the data is the same and this context can still bind its current version
+        if (isConstantBufferVersionCurrent(version) && version.contents.size() == dataSize && memcmp(version.contents.data(), data, dataSize) == 0)
+        {
+            NVRHI_STAT_ADD(statistics, identicalConstantBufferWrites, 1);
+            return;
+        }
+
+        NVRHI_STAT_UPLOAD(statistics, dataSize);
+
+        version.contents.assign((const char*)data, (const char*)data + dataSize);
+        version.hasContents = true;
+
+        uploadConstantBuffer(cbuffer, version);
+    }
 
+    void RendererInterfaceD3D11::uploadConstantBuffer(const ConstantBuffer* cbuffer, ConstantBufferVersion& version)
+    {
         D3D11_MAPPED_SUBRESOURCE mappedData;
-        CHECK_ERROR(SUCCEEDED(context->Map(constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData)), "Map failed");
-        memcpy(mappedData.pData, data, dataSize);
-        context->Unmap(constantBuffer, 0);
+        ConstantBufferRing::Allocation allocation;
+
+        if (context1 && !cbufferRingBuffer)
+        {
+            D3D11_BUFFER_DESC desc11;
+            desc11.ByteWidth = cbufferRing.GetSize();
+            desc11.Usage = D3D11_USAGE_DYNAMIC;
+            desc11.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            desc11.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            desc11.MiscFlags = 0;
+            desc11.StructureByteStride = 0;
+
+            //nothing has been bound with offsets yet, so falling back to separate buffers is still possible
+            if (FAILED(device->CreateBuffer(&desc11, NULL, &cbufferRingBuffer)))
+                context1 = NULL;
+        }
+
+        if (context1 && cbuffer->byteSize <= D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16 && cbufferRing.Allocate(cbuffer->byteSize, allocation))
+        {
+            CHECK_ERROR(SUCCEEDED(context->Map(cbufferRingBuffer.Get(), 0, allocation.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedData)), "Map failed");
+            memcpy((char*)mappedData.pData + allocation.offset, version.contents.data(), version.contents.size());
+            context->Unmap(cbufferRingBuffer.Get(), 0);
+
+            version.inRing = true;
+            version.ringOffset = allocation.offset;
+            version.ringGeneration = allocation.generation;
+            return;
+        }
+
+        version.inRing = false;
+
+        //deferred contexts get their own buffer, because a discard recorded in one command list replaces the data for every later user
+        ID3D11Buffer* buffer = cbuffer->buffer.Get();
+        if (sharedOwner)
+        {
+            if (!version.ownBuffer)
+            {
+                D3D11_BUFFER_DESC desc11;
+                cbuffer->buffer->GetDesc(&desc11);
+                CHECK_ERROR(SUCCEEDED(device->CreateBuffer(&desc11, NULL, &version.ownBuffer)), "Creation of constant buffer failed");
+            }
+
+            buffer = version.ownBuffer.Get();
+        }
+
+        if (!buffer)
+            return;
+
+        CHECK_ERROR(SUCCEEDED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData)), "Map failed");
+        memcpy(mappedData.pData, version.contents.data(), version.contents.size());
+        context->Unmap(buffer, 0);
+
+        version.ownBufferCommandList = commandListCounter;
+    }
+
+    void RendererInterfaceD3D11::prepareConstantBuffers(const PipelineStageBindings* const* stages, uint32_t numStages)
+    {
+        purgeDestroyedConstantBuffers();
+
+        //Bring every version used by the draw or dispatch up to date before any of them is bound. An upload can wrap the ring,
+        //which discards it and invalidates the versions prepared earlier in the pass, so repeat the pass until it completes
+        //without a wrap. The second pass starts with an almost empty ring, so it only wraps if the buffers don't fit at all.
+        for (uint32_t pass = 0; pass < 3; pass++)
+        {
+            uint64_t generation = cbufferRing.GetGeneration();
+
+            for (uint32_t stage = 0; stage < numStages; stage++)
+            {
+                for (uint32_t i = 0; i < stages[stage]->constantBufferBindingCount; i++)
+                {
+                    const ConstantBuffer* cbuffer = (const ConstantBuffer*)stages[stage]->constantBuffers[i].buffer;
+                    if (!cbuffer)
+                        continue;
+
+                    ConstantBufferVersion& version = getConstantBufferVersion(cbuffer);
+
+                    if (!version.hasContents && !cbuffer->initialContents.empty())
+                    {
+                        version.contents = cbuffer->initialContents;
+                        version.hasContents = true;
+                    }
+
+                    if (version.hasContents && !isConstantBufferVersionCurrent(version))
+                        uploadConstantBuffer(cbuffer, version);
+                }
+            }
+
+            if (cbufferRing.GetGeneration() == generation)
+                return;
+        }
+
+        CHECK_ERROR(0, "The constant buffers of one draw call do not fit into the constant buffer ring");
+    }
+
+    void RendererInterfaceD3D11::getConstantBufferBinding(ConstantBufferHandle b, ID3D11Buffer*& outBuffer, UINT& outFirstConstant, UINT& outNumConstants)
+    {
+        ConstantBuffer* cbuffer = (ConstantBuffer*)b;
+
+        outBuffer = NULL;
+        outFirstConstant = 0;
+        outNumConstants = 0;
+
+        if (!cbuffer)
+            return;
+
+        //prepareConstantBuffers has made the version current; nothing is uploaded here, so the bindings of other slots stay valid
+        const ConstantBufferVersion& version = getConstantBufferVersion(cbuffer);
+
+        if (!isConstantBufferVersionCurrent(version))
+        {
+            CHECK_ERROR(version.hasContents, "Constant buffer is bound on a context that has not written it");
+            return;
+        }
+
+        if (version.inRing)
+        {
+            outBuffer = cbufferRingBuffer.Get();
+            outFirstConstant = version.ringOffset / 16;
+        }
+        else
+        {
+            outBuffer = sharedOwner ? version.ownBuffer.Get() : cbuffer->buffer.Get();
+        }
+
+        //offset binding works in blocks of 16 constants
+        UINT alignedSize = (cbuffer->byteSize + ConstantBufferRing::ALIGNMENT - 1) & ~UINT(ConstantBufferRing::ALIGNMENT - 1);
+        outNumConstants = std::min(alignedSize / 16, UINT(D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT));
     }
 
     void RendererInterfaceD3D11::destroyConstantBuffer(ConstantBufferHandle b)
     {
-        ID3D11Buffer* constantBuffer = (ID3D11Buffer*)b;
-        if (!constantBuffer)
+        ConstantBuffer* cbuffer = (ConstantBuffer*)b;
+        if (!cbuffer)
             return;
-        //this should be all it takes
-        constantBuffer->Release();
+
+        cbufferVersions.erase(cbuffer);
+
+        //the other contexts may be recording on their threads, so they are only told to drop their versions
+        RendererInterfaceD3D11* owner = sharedOwner ? sharedOwner : this;
+        {
+            std::lock_guard<std::recursive_mutex> lock(owner->cacheMutex);
+
+            auto notify = [this, cbuffer](RendererInterfaceD3D11* other)
+            {
+                if (other == this)
+                    return;
+
+                other->destroyedConstantBuffers.push_back(std::make_pair((const ConstantBuffer*)cbuffer, cbuffer->id));
+                other->hasDestroyedConstantBuffers.store(true, std::memory_order_release);
+            };
+
+            notify(owner);
+            for (DeferredContextD3D11* deferredContext : owner->deferredContexts)
+                notify(deferredContext);
+        }
+
+        delete cbuffer;
     }
 
 
     ShaderHandle RendererInterfaceD3D11::createShader(const ShaderDesc& d, const void* binary, const size_t binarySize)
     {
+        //deferred contexts share the shader cache of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->createShader(d, binary, binarySize);
+
+        auto lock = lockCaches();
+
+        //the creation commands set up driver state for the creation, so shaders created with them are only shared with each other
+        uint64_t variant = (d.preCreationCommand ? 1 : 0) | (d.postCreationCommand ? 2 : 0);
+        ShaderHandle cached = shaderCache.Acquire(d.shaderType, variant, binary, binarySize);
+        if (cached)
+        {
+            if (d.preCreationCommand)
+                d.preCreationCommand->dispose();
+            if (d.postCreationCommand)
+                d.postCreationCommand->dispose();
+            return cached;
+        }
+
         if (d.preCreationCommand)
             d.preCreationCommand->executeAndDispose();
 
@@ -828,6 +1233,9 @@ namespace NVRHI
         if (d.postCreationCommand)
             d.postCreationCommand->executeAndDispose();
 
+        if (ret)
+            shaderCache.Insert(d.shaderType, variant, binary, binarySize, (ShaderHandle)ret);
+
         return (ShaderHandle)ret;
     }
 
@@ -839,10 +1247,24 @@ namespace NVRHI
 
     void RendererInterfaceD3D11::destroyShader(ShaderHandle s)
     {
+        if (sharedOwner)
+        {
+            sharedOwner->destroyShader(s);
+            return;
+        }
+
         ID3D11DeviceChild* shader = (ID3D11DeviceChild*)s;
         if (!shader)
             return;
 
+        {
+            auto lock = lockCaches();
+
+            //other handles still use the object
+            if (!shaderCache.Release(s))
+                return;
+        }
+
         shader->Release();
     }
 
@@ -967,6 +1389,7 @@ namespace NVRHI
 
         for (uint32_t i = 0; i < numDrawCalls; i++)
             context->DrawInstanced(args[i].vertexCount, args[i].instanceCount, args[i].startVertexLocation, args[i].startInstanceLocation);
+        NVRHI_STAT_DRAWS(statistics, args, numDrawCalls);
 
         clearState();
     }
@@ -978,6 +1401,7 @@ namespace NVRHI
 
         for (uint32_t i = 0; i < numDrawCalls; i++)
             context->DrawIndexedInstanced(args[i].vertexCount, args[i].instanceCount, args[i].startIndexLocation, args[i].startVertexLocation, args[i].startInstanceLocation);
+        NVRHI_STAT_DRAWS(statistics, args, numDrawCalls);
 
         clearState();
     }
@@ -987,8 +1411,9 @@ namespace NVRHI
         clearState();
         applyState(state);
 
-        BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)indirectParams;
-        context->DrawInstancedIndirect(handle->first.Get(), offsetBytes);
+        BufferViewSet* handle = getBufferViewSet(indirectParams);
+        context->DrawInstancedIndirect(handle->resource.Get(), offsetBytes);
+        NVRHI_STAT_ADD(statistics, indirectDrawCalls, 1);
 
         clearState();
     }
@@ -999,6 +1424,7 @@ namespace NVRHI
         applyState(state);
 
         context->Dispatch(groupsX, groupsY, groupsZ);
+        NVRHI_STAT_ADD(statistics, dispatches, 1);
 
         clearState();
     }
@@ -1008,40 +1434,83 @@ namespace NVRHI
         clearState();
         applyState(state);
 
-        BufferObjectMap::value_type* handleArgs = (BufferObjectMap::value_type*)indirectParams;
-        context->DispatchIndirect(handleArgs->first.Get(), (UINT)offsetBytes);
+        BufferViewSet* handleArgs = getBufferViewSet(indirectParams);
+        context->DispatchIndirect(handleArgs->resource.Get(), (UINT)offsetBytes);
+        NVRHI_STAT_ADD(statistics, indirectDispatches, 1);
 
         clearState();
     }
 
-    RendererInterfaceD3D11::TextureObjectMap::value_type* RendererInterfaceD3D11::getHandleForTexture(ID3D11Resource* resource, const TextureDesc* textureDesc)
+    TextureHandle RendererInterfaceD3D11::getHandleForTexture(ID3D11Resource* resource, const TextureDesc* textureDesc)
     {
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getHandleForTexture(resource, textureDesc);
+
+        auto lock = lockCaches();
+
         if (!resource) //if it's null, we want a null handle
             return NULL;
 
-        TextureObjectMap::iterator it = textures.find(resource);
-        if (it == textures.end())
-        {
-            it = textures.insert(TextureObjectMap::value_type(resource, TextureViewSet())).first; //we haven't seen this one before
+        auto it = textureLookup.find(resource);
+        if (it != textureLookup.end())
+            return it->second;
 
-            //use our provided one or make one from the D3D data
-            it->second.textureDesc = textureDesc ? *textureDesc : getTextureDescFromD3D11Resource(resource);
+        //we haven't seen this one before
+        TextureViewSet viewSet;
+        viewSet.resource = resource;
 
-            //Resize these withe empty views to the right sizes for simplicity later
-            it->second.unorderedAccessViewsPerMip.resize(it->second.textureDesc.mipLevels);
-        }
+        //use our provided one or make one from the D3D data
+        viewSet.textureDesc = textureDesc ? *textureDesc : getTextureDescFromD3D11Resource(resource);
+
+        TextureHandle handle = (TextureHandle)textures.Insert(viewSet);
+        CHECK_ERROR(handle != NULL, "Too many textures");
+        if (handle)
+            textureLookup[resource] = handle;
+
+        return handle;
+    }
+
+    RendererInterfaceD3D11::TextureViewSet* RendererInterfaceD3D11::getTextureViewSet(TextureHandle handle)
+    {
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getTextureViewSet(handle);
+
+        if (!handle)
+            return NULL;
+
+        auto lock = lockCaches();
+
+        TextureViewSet* viewSet = textures.Get((TextureObjectMap::Id)handle);
+#ifdef _DEBUG
+        CHECK_ERROR(viewSet != NULL, "Stale texture handle: the texture has been destroyed");
+#endif
+        return viewSet;
+    }
+
+    //Views are cached per texture in one table; the key packs the view type, format, array slice and mip level.
+    //The type is never 0, so neither is the key.
+    enum TextureViewType
+    {
+        VIEW_SRV = 1,
+        VIEW_RTV,
+        VIEW_DSV,
+        VIEW_UAV
+    };
 
-        TextureObjectMap::value_type& mapValue = *it;
-        return &mapValue;
+    static uint64_t makeTextureViewKey(TextureViewType type, DXGI_FORMAT format, uint32_t arrayItem, uint32_t mipLevel)
+    {
+        return (uint64_t(type) << 60) | (uint64_t(format & 0xffff) << 44) | (uint64_t(arrayItem & 0xfffff) << 24) | uint64_t(mipLevel & 0xffffff);
     }
 
-    void RendererInterfaceD3D11::getClearViewForTexture(TextureObjectMap::value_type* resource, uint32_t index, bool asUINT, ID3D11UnorderedAccessView*& outUAV, ID3D11RenderTargetView*& outRTV, ID3D11DepthStencilView*& outDSV)
+    void RendererInterfaceD3D11::getClearViewForTexture(TextureViewSet* resource, uint32_t index, bool asUINT, ComPtr<ID3D11UnorderedAccessView>& outUAV, ComPtr<ID3D11RenderTargetView>& outRTV, ComPtr<ID3D11DepthStencilView>& outDSV)
     {
-        outUAV = NULL;
-        outRTV = NULL;
-        outDSV = NULL;
+        outUAV = nullptr;
+        outRTV = nullptr;
+        outDSV = nullptr;
 
-        const TextureDesc& textureDesc = resource->second.textureDesc;
+        const TextureDesc& textureDesc = resource->textureDesc;
         //Try UAVs first since they are more flexible
         if (textureDesc.isUAV)
         {
@@ -1078,13 +1547,19 @@ namespace NVRHI
         }
     }
 
-    ID3D11ShaderResourceView* RendererInterfaceD3D11::getSRVForTexture(TextureObjectMap::value_type* resource, DXGI_FORMAT format, uint32_t mipLevel)
+    ComPtr<ID3D11ShaderResourceView> RendererInterfaceD3D11::getSRVForTexture(TextureViewSet* resource, DXGI_FORMAT format, uint32_t mipLevel)
     {
-        ComPtr<ID3D11ShaderResourceView>& srvPtr = resource->second.shaderResourceViews[std::make_pair(format, mipLevel)];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getSRVForTexture(resource, format, mipLevel);
+
+        auto lock = lockCaches();
+
+        ComPtr<ID3D11View>& srvPtr = resource->views[makeTextureViewKey(VIEW_SRV, format, 0, mipLevel)];
         if (srvPtr == NULL)
         {
             //we haven't seen this one before
-            const TextureDesc& textureDesc = resource->second.textureDesc;
+            const TextureDesc& textureDesc = resource->textureDesc;
             D3D11_SHADER_RESOURCE_VIEW_DESC desc11;
             desc11.Format = format;
             if (textureDesc.isCubeMap)
@@ -1170,18 +1645,26 @@ namespace NVRHI
                     }
                 }
             }
-            CHECK_ERROR(SUCCEEDED(device->CreateShaderResourceView(resource->first.Get(), &desc11, &srvPtr)), "Creating the view failed");
+            ComPtr<ID3D11ShaderResourceView> view;
+            CHECK_ERROR(SUCCEEDED(device->CreateShaderResourceView(resource->resource.Get(), &desc11, &view)), "Creating the view failed");
+            srvPtr = view;
         }
-        return srvPtr.Get();
+        return static_cast<ID3D11ShaderResourceView*>(srvPtr.Get());
     }
 
-    ID3D11RenderTargetView* RendererInterfaceD3D11::getRTVForTexture(TextureObjectMap::value_type* resource, uint32_t arrayItem, uint32_t mipLevel)
+    ComPtr<ID3D11RenderTargetView> RendererInterfaceD3D11::getRTVForTexture(TextureViewSet* resource, uint32_t arrayItem, uint32_t mipLevel)
     {
-        ComPtr<ID3D11RenderTargetView>& rtvPtr = resource->second.renderTargetViews[std::make_pair(arrayItem, mipLevel)];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getRTVForTexture(resource, arrayItem, mipLevel);
+
+        auto lock = lockCaches();
+
+        ComPtr<ID3D11View>& rtvPtr = resource->views[makeTextureViewKey(VIEW_RTV, DXGI_FORMAT_UNKNOWN, arrayItem, mipLevel)];
         if (rtvPtr == NULL)
         {
             //we haven't seen this one before
-            const TextureDesc& textureDesc = resource->second.textureDesc;
+            const TextureDesc& textureDesc = resource->textureDesc;
             D3D11_RENDER_TARGET_VIEW_DESC desc11;
             UINT dontCare;
             desc11.Format = getTypedTextureFormat(textureDesc.format, dontCare, false);
@@ -1220,18 +1703,26 @@ namespace NVRHI
                     desc11.Texture2D.MipSlice = mipLevel;
                 }
             }
-            CHECK_ERROR(SUCCEEDED(device->CreateRenderTargetView(resource->first.Get(), &desc11, &rtvPtr)), "Creating the view failed");
+            ComPtr<ID3D11RenderTargetView> view;
+            CHECK_ERROR(SUCCEEDED(device->CreateRenderTargetView(resource->resource.Get(), &desc11, &view)), "Creating the view failed");
+            rtvPtr = view;
         }
-        return rtvPtr.Get();
+        return static_cast<ID3D11RenderTargetView*>(rtvPtr.Get());
     }
 
-    ID3D11DepthStencilView* RendererInterfaceD3D11::getDSVForTexture(TextureObjectMap::value_type* resource, uint32_t arrayItem, uint32_t mipLevel)
+    ComPtr<ID3D11DepthStencilView> RendererInterfaceD3D11::getDSVForTexture(TextureViewSet* resource, uint32_t arrayItem, uint32_t mipLevel)
     {
-        ComPtr<ID3D11DepthStencilView>& dsvPtr = resource->second.depthStencilViews[std::make_pair(arrayItem, mipLevel)];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getDSVForTexture(resource, arrayItem, mipLevel);
+
+        auto lock = lockCaches();
+
+        ComPtr<ID3D11View>& dsvPtr = resource->views[makeTextureViewKey(VIEW_DSV, DXGI_FORMAT_UNKNOWN, arrayItem, mipLevel)];
         if (dsvPtr == NULL)
         {
             //we haven't seen this one before
-            const TextureDesc& textureDesc = resource->second.textureDesc;
+            const TextureDesc& textureDesc = resource->textureDesc;
             D3D11_DEPTH_STENCIL_VIEW_DESC desc11;
             UINT dontCare;
             desc11.Format = getTypedTextureFormat(textureDesc.format, dontCare, false);
@@ -1268,18 +1759,26 @@ namespace NVRHI
                     desc11.Texture2D.MipSlice = mipLevel;
                 }
             }
-            CHECK_ERROR(SUCCEEDED(device->CreateDepthStencilView(resource->first.Get(), &desc11, &dsvPtr)), "Creating the view failed");
+            ComPtr<ID3D11DepthStencilView> view;
+            CHECK_ERROR(SUCCEEDED(device->CreateDepthStencilView(resource->resource.Get(), &desc11, &view)), "Creating the view failed");
+            dsvPtr = view;
         }
-        return dsvPtr.Get();
+        return static_cast<ID3D11DepthStencilView*>(dsvPtr.Get());
     }
 
-    ID3D11UnorderedAccessView* RendererInterfaceD3D11::getUAVForTexture(TextureObjectMap::value_type* resource, DXGI_FORMAT format, uint32_t mipLevel /*= 0*/)
+    ComPtr<ID3D11UnorderedAccessView> RendererInterfaceD3D11::getUAVForTexture(TextureViewSet* resource, DXGI_FORMAT format, uint32_t mipLevel /*= 0*/)
     {
-        ComPtr<ID3D11UnorderedAccessView>& uavPtr = resource->second.unorderedAccessViewsPerMip[mipLevel][format];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getUAVForTexture(resource, format, mipLevel);
+
+        auto lock = lockCaches();
+
+        ComPtr<ID3D11View>& uavPtr = resource->views[makeTextureViewKey(VIEW_UAV, format, 0, mipLevel)];
         if (uavPtr == NULL)
         {
             //we haven't seen this one before
-            const TextureDesc& textureDesc = resource->second.textureDesc;
+            const TextureDesc& textureDesc = resource->textureDesc;
 
             CHECK_ERROR(textureDesc.sampleCount <= 1, "You cannot access a multisample UAV");
 
@@ -1304,35 +1803,37 @@ namespace NVRHI
                 desc11.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
                 desc11.Texture2D.MipSlice = (UINT)mipLevel;
             }
-            CHECK_ERROR(SUCCEEDED(device->CreateUnorderedAccessView(resource->first.Get(), &desc11, &uavPtr)), "Creating the view failed");
+            ComPtr<ID3D11UnorderedAccessView> view;
+            CHECK_ERROR(SUCCEEDED(device->CreateUnorderedAccessView(resource->resource.Get(), &desc11, &view)), "Creating the view failed");
+            uavPtr = view;
         }
-        return uavPtr.Get();
+        return static_cast<ID3D11UnorderedAccessView*>(uavPtr.Get());
     }
 
     ID3D11ShaderResourceView* RendererInterfaceD3D11::getSRVForTexture(TextureHandle handle, uint32_t mipLevel)
     {
-        TextureObjectMap::value_type* resource = (TextureObjectMap::value_type*)handle;
+        TextureViewSet* resource = getTextureViewSet(handle);
         UINT dontCare;
-        return getSRVForTexture(resource, getTypedTextureFormat(resource->second.textureDesc.format, dontCare, true), mipLevel);
+        return getSRVForTexture(resource, getTypedTextureFormat(resource->textureDesc.format, dontCare, true), mipLevel).Get();
     }
         
     ID3D11RenderTargetView* RendererInterfaceD3D11::getRTVForTexture(TextureHandle handle, uint32_t arrayItem)
     {
-        TextureObjectMap::value_type* resource = (TextureObjectMap::value_type*)handle;
-        return getRTVForTexture(resource, arrayItem);
+        TextureViewSet* resource = getTextureViewSet(handle);
+        return getRTVForTexture(resource, arrayItem).Get();
     }
 
     ID3D11DepthStencilView* RendererInterfaceD3D11::getDSVForTexture(TextureHandle handle, uint32_t arrayItem, uint32_t mipLevel)
     {
-        TextureObjectMap::value_type* resource = (TextureObjectMap::value_type*)handle;
-        return getDSVForTexture(resource, arrayItem, mipLevel);
+        TextureViewSet* resource = getTextureViewSet(handle);
+        return getDSVForTexture(resource, arrayItem, mipLevel).Get();
     }
         
     ID3D11UnorderedAccessView* RendererInterfaceD3D11::getUAVForTexture(TextureHandle handle, uint32_t mipLevel)
     {
-        TextureObjectMap::value_type* resource = (TextureObjectMap::value_type*)handle;
+        TextureViewSet* resource = getTextureViewSet(handle);
         UINT dontCare;
-        return getUAVForTexture(resource, getTypedTextureFormat(resource->second.textureDesc.format, dontCare, true), mipLevel);
+        return getUAVForTexture(resource, getTypedTextureFormat(resource->textureDesc.format, dontCare, true), mipLevel).Get();
     }
 
     void RendererInterfaceD3D11::applyState(const DrawCallState& state, uint32_t denyStageMask)
@@ -1348,18 +1849,18 @@ namespace NVRHI
 
             if(state.indexBuffer)
             {
-                BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)state.indexBuffer;
+                BufferViewSet* handle = getBufferViewSet(state.indexBuffer);
                 UINT dontCare = 0;
-                context->IASetIndexBuffer(handle->first.Get(), getTypedTextureFormat(state.indexBufferFormat, dontCare, true), state.indexBufferOffset);
+                context->IASetIndexBuffer(handle->resource.Get(), getTypedTextureFormat(state.indexBufferFormat, dontCare, true), state.indexBufferOffset);
             }
 
             for (uint32_t i = 0; i < state.vertexBufferCount; i++)
             {
-                BufferObjectMap::value_type* handle = (BufferObjectMap::value_type*)state.vertexBuffers[i].buffer;
+                BufferViewSet* handle = getBufferViewSet(state.vertexBuffers[i].buffer);
                 if (!handle)
                     return;
 
-                ID3D11Buffer* pBuffer = (ID3D11Buffer*)handle->first.Get();
+                ID3D11Buffer* pBuffer = (ID3D11Buffer*)handle->resource.Get();
                 context->IASetVertexBuffers(state.vertexBuffers[i].slot, 1, &pBuffer, &state.vertexBuffers[i].stride, &state.vertexBuffers[i].offset);
             }
         }
@@ -1374,7 +1875,7 @@ namespace NVRHI
             //Setup the targets
             for (uint32_t rt = 0; rt < renderState.targetCount; rt++)
             {
-                renderTargetViews[rt] = getRTVForTexture((TextureObjectMap::value_type*)renderState.targets[rt], state.renderState.targetIndicies[rt], state.renderState.targetMipSlices[rt]);
+                renderTargetViews[rt] = referenceView(getRTVForTexture(getTextureViewSet(renderState.targets[rt]), state.renderState.targetIndicies[rt], state.renderState.targetMipSlices[rt]));
                 rtvCount = std::max(rtvCount, (UINT)rt + 1);
                 //clear stuff if required
                 if (renderState.clearColorTarget)
@@ -1398,7 +1899,7 @@ namespace NVRHI
             }
 
             if (state.renderState.depthTarget)
-                depthView = getDSVForTexture((TextureObjectMap::value_type*)state.renderState.depthTarget, state.renderState.depthIndex, state.renderState.depthMipSlice);
+                depthView = referenceView(getDSVForTexture(getTextureViewSet(state.renderState.depthTarget), state.renderState.depthIndex, state.renderState.depthMipSlice));
 
             //clear stuff if required
             if (depthView && (renderState.clearDepthTarget || renderState.clearStencilTarget))
@@ -1417,17 +1918,29 @@ namespace NVRHI
             context->RSSetScissorRects((UINT)renderState.viewportCount, scissorRects);
 
             // Get cached states or create new ones
-            ID3D11RasterizerState* d3dRasterizerState = getRasterizerState(renderState.rasterState);
-            ID3D11BlendState* d3dBlendState = getBlendState(renderState.blendState);
-            ID3D11DepthStencilState* d3dDepthStencilState = getDepthStencilState(renderState.depthStencilState);
+            ComPtr<ID3D11RasterizerState> d3dRasterizerState = getRasterizerState(renderState.rasterState);
+            ComPtr<ID3D11BlendState> d3dBlendState = getBlendState(renderState.blendState);
+            ComPtr<ID3D11DepthStencilState> d3dDepthStencilState = getDepthStencilState(renderState.depthStencilState);
 
             //set the states
-            context->RSSetState(d3dRasterizerState);
+            context->RSSetState(d3dRasterizerState.Get());
             FLOAT blendFactor[4] = { renderState.blendState.blendFactor.r, renderState.blendState.blendFactor.g, renderState.blendState.blendFactor.b, renderState.blendState.blendFactor.a };
-            context->OMSetBlendState(d3dBlendState, blendFactor, D3D11_DEFAULT_SAMPLE_MASK);
-            context->OMSetDepthStencilState(d3dDepthStencilState, (UINT)renderState.depthStencilState.stencilRefValue);
+            context->OMSetBlendState(d3dBlendState.Get(), blendFactor, D3D11_DEFAULT_SAMPLE_MASK);
+            context->OMSetDepthStencilState(d3dDepthStencilState.Get(), (UINT)renderState.depthStencilState.stencilRefValue);
+            NVRHI_STAT_ADD(statistics, stateChanges, 3);
         }
 
+        //Upload the constant buffers of all stages before computing any binding, see prepareConstantBuffers
+        const PipelineStageBindings* allStages[] = { &state.VS, &state.HS, &state.DS, &state.GS, &state.PS };
+        const PipelineStageBindings* usedStages[ShaderType::GRAPHIC_SHADERS_NUM];
+        uint32_t numUsedStages = 0;
+        for (uint32_t stage = 0; stage < ShaderType::GRAPHIC_SHADERS_NUM; stage++)
+        {
+            if (!(denyStageMask & (0x1 << stage)) && allStages[stage]->shader)
+                usedStages[numUsedStages++] = allStages[stage];
+        }
+        prepareConstantBuffers(usedStages, numUsedStages);
+
         //Bind resources
         for (uint32_t stage = 0; stage < ShaderType::GRAPHIC_SHADERS_NUM; stage++)
         {
@@ -1465,6 +1978,8 @@ namespace NVRHI
                 continue;
             }
 
+            NVRHI_STAT_ADD(statistics, stateChanges, 1);
+
             ID3D11ShaderResourceView* shaderResourceViews[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = { 0 };
             UINT minSRV = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, maxSRV = 0;
 
@@ -1473,6 +1988,8 @@ namespace NVRHI
             UINT uavCountersUnused[D3D11_PS_CS_UAV_REGISTER_COUNT] = { D3D11_KEEP_UNORDERED_ACCESS_VIEWS };
 
             ID3D11Buffer* constantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT] = { 0 };
+            UINT firstConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT] = { 0 };
+            UINT numConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT] = { 0 };
             UINT minCB = D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT, maxCB = 0;
 
             ID3D11SamplerState* samplers[D3D11_COMMONSHADER_SAMPLER_REGISTER_COUNT] = { 0 };
@@ -1484,7 +2001,7 @@ namespace NVRHI
                 DXGI_FORMAT textureFormat = DXGI_FORMAT_UNKNOWN;
                 UINT dontCareSize;
                 UINT slot = (UINT)bindings->textures[i].slot;
-                TextureObjectMap::value_type* resource = (TextureObjectMap::value_type*)bindings->textures[i].texture;
+                TextureViewSet* resource = getTextureViewSet(bindings->textures[i].texture);
                 switch (bindings->textures[i].format)
                 {
                 case Format::R32_UINT:  textureFormat = DXGI_FORMAT_R32_UINT; break;
@@ -1493,7 +2010,7 @@ namespace NVRHI
                 case Format::BGRA8_UNORM:  textureFormat = DXGI_FORMAT_B8G8R8A8_UNORM; break;
                 case Format::RGBA16_FLOAT:  textureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT; break;
                 case Format::X24G8_UINT:  textureFormat = DXGI_FORMAT_X24_TYPELESS_G8_UINT; break;
-                case Format::UNKNOWN:  textureFormat = getTypedTextureFormat(resource->second.textureDesc.format, dontCareSize, true); break;
+                case Format::UNKNOWN:  textureFormat = getTypedTextureFormat(resource->textureDesc.format, dontCareSize, true); break;
                 default:
                     CHECK_ERROR(0, "Unknown format");
                 }
@@ -1502,13 +2019,13 @@ namespace NVRHI
                 if (bindings->textures[i].isWritable)
                 {
                     CHECK_ERROR(stage == ShaderType::SHADER_PIXEL, "UAVs only supported in pixel shaders");
-                    unorderedAccessViews[slot] = getUAVForTexture(resource, textureFormat, bindings->textures[i].mipLevel);
+                    unorderedAccessViews[slot] = referenceView(getUAVForTexture(resource, textureFormat, bindings->textures[i].mipLevel));
                     minUAV = std::min(slot, minUAV);
                     maxUAV = std::max(slot, maxUAV);
                 }
                 else
                 {
-                    shaderResourceViews[slot] = getSRVForTexture(resource, textureFormat, bindings->textures[i].mipLevel);
+                    shaderResourceViews[slot] = referenceView(getSRVForTexture(resource, textureFormat, bindings->textures[i].mipLevel));
                     minSRV = std::min(slot, minSRV);
                     maxSRV = std::max(slot, maxSRV);
                 }
@@ -1529,18 +2046,18 @@ namespace NVRHI
             for (uint32_t i = 0; i < bindings->bufferBindingCount; i++)
             {
                 UINT slot = (UINT)bindings->buffers[i].slot;
-                BufferObjectMap::value_type* resource = (BufferObjectMap::value_type*)bindings->buffers[i].buffer;
+                BufferViewSet* resource = getBufferViewSet(bindings->buffers[i].buffer);
                 //choose a SRV or UAV
                 if (bindings->buffers[i].isWritable)
                 {
                     CHECK_ERROR(stage == ShaderType::SHADER_PIXEL, "UAVs only supported in pixel shaders");
-                    unorderedAccessViews[slot] = getUAVForBuffer(resource);
+                    unorderedAccessViews[slot] = referenceView(getUAVForBuffer(resource));
                     minUAV = std::min(slot, minUAV);
                     maxUAV = std::max(slot, maxUAV);
                 }
                 else
                 {
-                    shaderResourceViews[slot] = getSRVForBuffer(resource, bindings->buffers[i].format);
+                    shaderResourceViews[slot] = referenceView(getSRVForBuffer(resource, bindings->buffers[i].format));
                     minSRV = std::min(slot, minSRV);
                     maxSRV = std::max(slot, maxSRV);
                 }
@@ -1550,9 +2067,8 @@ namespace NVRHI
             for (uint32_t i = 0; i < bindings->constantBufferBindingCount; i++)
             {
                 UINT slot = (UINT)bindings->constantBuffers[i].slot;
-                ID3D11Buffer* cbuffer = (ID3D11Buffer*)bindings->constantBuffers[i].buffer;
+                getConstantBufferBinding(bindings->constantBuffers[i].buffer, constantBuffers[slot], firstConstants[slot], numConstants[slot]);
 
-                constantBuffers[slot] = cbuffer;
                 minCB = std::min(slot, minCB);
                 maxCB = std::max(slot, maxCB);
             }
@@ -1571,7 +2087,12 @@ namespace NVRHI
 
                 //Apply them to the context
                 if (maxCB >= minCB)
-                    context->VSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                {
+                    if (context1)
+                        context1->VSSetConstantBuffers1(minCB, maxCB - minCB + 1, constantBuffers + minCB, firstConstants + minCB, numConstants + minCB);
+                    else
+                        context->VSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                }
 
                 if (maxSRV >= minSRV)
                     context->VSSetShaderResources(minSRV, maxSRV - minSRV + 1, shaderResourceViews + minSRV);
@@ -1593,7 +2114,12 @@ namespace NVRHI
 
                 //Apply them to the context
                 if (maxCB >= minCB)
-                    context->GSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                {
+                    if (context1)
+                        context1->GSSetConstantBuffers1(minCB, maxCB - minCB + 1, constantBuffers + minCB, firstConstants + minCB, numConstants + minCB);
+                    else
+                        context->GSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                }
 
                 if (maxSRV >= minSRV)
                     context->GSSetShaderResources(minSRV, maxSRV - minSRV + 1, shaderResourceViews + minSRV);
@@ -1615,7 +2141,12 @@ namespace NVRHI
 
                 //Apply them to the context
                 if (maxCB >= minCB)
-                    context->HSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                {
+                    if (context1)
+                        context1->HSSetConstantBuffers1(minCB, maxCB - minCB + 1, constantBuffers + minCB, firstConstants + minCB, numConstants + minCB);
+                    else
+                        context->HSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                }
 
                 if (maxSRV >= minSRV)
                     context->HSSetShaderResources(minSRV, maxSRV - minSRV + 1, shaderResourceViews + minSRV);
@@ -1637,7 +2168,12 @@ namespace NVRHI
 
                 //Apply them to the context
                 if (maxCB >= minCB)
-                    context->DSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                {
+                    if (context1)
+                        context1->DSSetConstantBuffers1(minCB, maxCB - minCB + 1, constantBuffers + minCB, firstConstants + minCB, numConstants + minCB);
+                    else
+                        context->DSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                }
 
                 if (maxSRV >= minSRV)
                     context->DSSetShaderResources(minSRV, maxSRV - minSRV + 1, shaderResourceViews + minSRV);
@@ -1659,7 +2195,12 @@ namespace NVRHI
 
                 //Apply them to the context
                 if (maxCB >= minCB)
-                    context->PSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                {
+                    if (context1)
+                        context1->PSSetConstantBuffers1(minCB, maxCB - minCB + 1, constantBuffers + minCB, firstConstants + minCB, numConstants + minCB);
+                    else
+                        context->PSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+                }
 
                 if (maxSRV >= minSRV)
                     context->PSSetShaderResources(minSRV, maxSRV - minSRV + 1, shaderResourceViews + minSRV);
@@ -1681,6 +2222,9 @@ namespace NVRHI
             }
 
         }
+
+        //the views are bound now, so the context references them
+        viewReferences.clear();
     }
 
     void RendererInterfaceD3D11::applyState(const DispatchState& state)
@@ -1693,6 +2237,10 @@ namespace NVRHI
 
         //apply the shader
         context->CSSetShader(computeShader.Get(), NULL, 0);
+        NVRHI_STAT_ADD(statistics, stateChanges, 1);
+
+        const PipelineStageBindings* stages[] = { &state };
+        prepareConstantBuffers(stages, 1);
 
         ID3D11ShaderResourceView* shaderResourceViews[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = { 0 };
         UINT minSRV = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, maxSRV = 0;
@@ -1702,6 +2250,8 @@ namespace NVRHI
         UINT uavCountersUnused[D3D11_PS_CS_UAV_REGISTER_COUNT] = { D3D11_KEEP_UNORDERED_ACCESS_VIEWS };
 
         ID3D11Buffer* constantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT] = { 0 };
+        UINT firstConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT] = { 0 };
+        UINT numConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT] = { 0 };
         UINT minCB = D3D11_COMMONSHADER_CONSTANT_BUFFER_REGISTER_COUNT, maxCB = 0;
 
         ID3D11SamplerState* samplers[D3D11_COMMONSHADER_SAMPLER_REGISTER_COUNT] = { 0 };
@@ -1713,7 +2263,7 @@ namespace NVRHI
             DXGI_FORMAT textureFormat = DXGI_FORMAT_UNKNOWN;
             UINT dontCareSize;
             UINT slot = (UINT)state.textures[i].slot;
-            TextureObjectMap::value_type* resource = (TextureObjectMap::value_type*)state.textures[i].texture;
+            TextureViewSet* resource = getTextureViewSet(state.textures[i].texture);
             switch (state.textures[i].format)
             {
             case Format::R8_UNORM:  textureFormat = DXGI_FORMAT_R8_UNORM; break;
@@ -1723,7 +2273,7 @@ namespace NVRHI
             case Format::BGRA8_UNORM:  textureFormat = DXGI_FORMAT_B8G8R8A8_UNORM; break;
             case Format::RGBA16_FLOAT:  textureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT; break;
             case Format::X24G8_UINT:  textureFormat = DXGI_FORMAT_X24_TYPELESS_G8_UINT; break;
-            case Format::UNKNOWN:  textureFormat = getTypedTextureFormat(resource->second.textureDesc.format, dontCareSize, true); break;
+            case Format::UNKNOWN:  textureFormat = getTypedTextureFormat(resource->textureDesc.format, dontCareSize, true); break;
             default:
                 CHECK_ERROR(0, "Unknown format");
             }
@@ -1731,13 +2281,13 @@ namespace NVRHI
             //choose a SRV or UAV
             if (state.textures[i].isWritable)
             {
-                unorderedAccessViews[slot] = getUAVForTexture(resource, textureFormat, state.textures[i].mipLevel);
+                unorderedAccessViews[slot] = referenceView(getUAVForTexture(resource, textureFormat, state.textures[i].mipLevel));
                 minUAV = std::min(slot, minUAV);
                 maxUAV = std::max(slot, maxUAV);
             }
             else
             {
-                shaderResourceViews[slot] = getSRVForTexture(resource, textureFormat, state.textures[i].mipLevel);
+                shaderResourceViews[slot] = referenceView(getSRVForTexture(resource, textureFormat, state.textures[i].mipLevel));
                 minSRV = std::min(slot, minSRV);
                 maxSRV = std::max(slot, maxSRV);
             }
@@ -1758,17 +2308,17 @@ namespace NVRHI
         for (uint32_t i = 0; i < state.bufferBindingCount; i++)
         {
             UINT slot = (UINT)state.buffers[i].slot;
-            BufferObjectMap::value_type* resource = (BufferObjectMap::value_type*)state.buffers[i].buffer;
+            BufferViewSet* resource = getBufferViewSet(state.buffers[i].buffer);
             //choose a SRV or UAV
             if (state.buffers[i].isWritable)
             {
-                unorderedAccessViews[slot] = getUAVForBuffer(resource);
+                unorderedAccessViews[slot] = referenceView(getUAVForBuffer(resource));
                 minUAV = std::min(slot, minUAV);
                 maxUAV = std::max(slot, maxUAV);
             }
             else
             {
-                shaderResourceViews[slot] = getSRVForBuffer(resource, state.buffers[i].format);
+                shaderResourceViews[slot] = referenceView(getSRVForBuffer(resource, state.buffers[i].format));
                 minSRV = std::min(slot, minSRV);
                 maxSRV = std::max(slot, maxSRV);
             }
@@ -1778,16 +2328,20 @@ namespace NVRHI
         for (uint32_t i = 0; i < state.constantBufferBindingCount; i++)
         {
             UINT slot = (UINT)state.constantBuffers[i].slot;
-            ID3D11Buffer* cbuffer = (ID3D11Buffer*)state.constantBuffers[i].buffer;
+            getConstantBufferBinding(state.constantBuffers[i].buffer, constantBuffers[slot], firstConstants[slot], numConstants[slot]);
 
-            constantBuffers[slot] = cbuffer;
             minCB = std::min(slot, minCB);
             maxCB = std::max(slot, maxCB);
         }
 
         //Apply them to the context
         if (maxCB >= minCB)
-            context->CSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+        {
+            if (context1)
+                context1->CSSetConstantBuffers1(minCB, maxCB - minCB + 1, constantBuffers + minCB, firstConstants + minCB, numConstants + minCB);
+            else
+                context->CSSetConstantBuffers(minCB, maxCB - minCB + 1, constantBuffers + minCB);
+        }
 
         if (maxSRV >= minSRV)
             context->CSSetShaderResources(minSRV, maxSRV - minSRV + 1, shaderResourceViews + minSRV);
@@ -1797,6 +2351,9 @@ namespace NVRHI
 
         if (maxUAV >= minUAV)
             context->CSSetUnorderedAccessViews(minUAV, maxUAV - minUAV + 1, unorderedAccessViews + minUAV, uavCountersUnused);
+
+        //the views are bound now, so the context references them
+        viewReferences.clear();
     }
 
     void RendererInterfaceD3D11::clearState()
@@ -1957,22 +2514,52 @@ namespace NVRHI
         return returnValue;
     }
 
-    RendererInterfaceD3D11::BufferObjectMap::value_type* RendererInterfaceD3D11::getHandleForBuffer(ID3D11Buffer* resource, const BufferDesc* bufferDesc /*= NULL*/)
+    BufferHandle RendererInterfaceD3D11::getHandleForBuffer(ID3D11Buffer* resource, const BufferDesc* bufferDesc /*= NULL*/)
     {
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getHandleForBuffer(resource, bufferDesc);
+
+        auto lock = lockCaches();
+
         if (!resource) //if it's null, we want a null handle
             return NULL;
 
-        BufferObjectMap::iterator it = buffers.find(resource);
-        if (it == buffers.end())
-        {
-            it = buffers.insert(BufferObjectMap::value_type(resource, BufferViewSet())).first; //we haven't seen this one before
+        auto it = bufferLookup.find(resource);
+        if (it != bufferLookup.end())
+            return it->second;
 
-            //use our provided one or make one from the D3D data
-            it->second.bufferDesc = bufferDesc ? *bufferDesc : getBufferDescFromD3D11Buffer(resource);
-        }
+        //we haven't seen this one before
+        BufferViewSet viewSet;
+        viewSet.resource = resource;
+
+        //use our provided one or make one from the D3D data
+        viewSet.bufferDesc = bufferDesc ? *bufferDesc : getBufferDescFromD3D11Buffer(resource);
 
-        BufferObjectMap::value_type& mapValue = *it;
-        return &mapValue;
+        BufferHandle handle = (BufferHandle)buffers.Insert(viewSet);
+        CHECK_ERROR(handle != NULL, "Too many buffers");
+        if (handle)
+            bufferLookup[resource] = handle;
+
+        return handle;
+    }
+
+    RendererInterfaceD3D11::BufferViewSet* RendererInterfaceD3D11::getBufferViewSet(BufferHandle handle)
+    {
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getBufferViewSet(handle);
+
+        if (!handle)
+            return NULL;
+
+        auto lock = lockCaches();
+
+        BufferViewSet* viewSet = buffers.Get((BufferObjectMap::Id)handle);
+#ifdef _DEBUG
+        CHECK_ERROR(viewSet != NULL, "Stale buffer handle: the buffer has been destroyed");
+#endif
+        return viewSet;
     }
 
     BufferDesc RendererInterfaceD3D11::getBufferDescFromD3D11Buffer(ID3D11Buffer* buffer)
@@ -1989,11 +2576,17 @@ namespace NVRHI
         return returnValue;
     }
 
-    ID3D11ShaderResourceView* RendererInterfaceD3D11::getSRVForBuffer(BufferObjectMap::value_type* resource, Format::Enum format)
+    ComPtr<ID3D11ShaderResourceView> RendererInterfaceD3D11::getSRVForBuffer(BufferViewSet* resource, Format::Enum format)
     {
-        BufferViewSet& bufferData = resource->second;
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getSRVForBuffer(resource, format);
+
+        auto lock = lockCaches();
+
+        BufferViewSet& bufferData = *resource;
         if (bufferData.shaderResourceView)
-            return bufferData.shaderResourceView.Get();
+            return bufferData.shaderResourceView;
 
 
         D3D11_SHADER_RESOURCE_VIEW_DESC desc11;
@@ -2016,15 +2609,21 @@ namespace NVRHI
             desc11.BufferEx.NumElements = bufferData.bufferDesc.byteSize / elementSize;
         }
 
-        CHECK_ERROR(SUCCEEDED(device->CreateShaderResourceView(resource->first.Get(), &desc11, &bufferData.shaderResourceView)), "Creation failed");
-        return bufferData.shaderResourceView.Get();
+        CHECK_ERROR(SUCCEEDED(device->CreateShaderResourceView(resource->resource.Get(), &desc11, &bufferData.shaderResourceView)), "Creation failed");
+        return bufferData.shaderResourceView;
     }
 
-    ID3D11UnorderedAccessView* RendererInterfaceD3D11::getUAVForBuffer(BufferObjectMap::value_type* resource)
+    ComPtr<ID3D11UnorderedAccessView> RendererInterfaceD3D11::getUAVForBuffer(BufferViewSet* resource)
     {
-        BufferViewSet& bufferData = resource->second;
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getUAVForBuffer(resource);
+
+        auto lock = lockCaches();
+
+        BufferViewSet& bufferData = *resource;
         if (bufferData.unorderedAccessView)
-            return bufferData.unorderedAccessView.Get();
+            return bufferData.unorderedAccessView;
 
         D3D11_UNORDERED_ACCESS_VIEW_DESC desc11;
         desc11.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
@@ -2033,28 +2632,84 @@ namespace NVRHI
         desc11.Buffer.NumElements = bufferData.bufferDesc.byteSize / (bufferData.bufferDesc.structStride ? bufferData.bufferDesc.structStride : 4);
         desc11.Buffer.Flags = 0;
 
-        CHECK_ERROR(SUCCEEDED(device->CreateUnorderedAccessView(resource->first.Get(), &desc11, &bufferData.unorderedAccessView)), "Creation failed");
-        return bufferData.unorderedAccessView.Get();
+        CHECK_ERROR(SUCCEEDED(device->CreateUnorderedAccessView(resource->resource.Get(), &desc11, &bufferData.unorderedAccessView)), "Creation failed");
+        return bufferData.unorderedAccessView;
     }
 
     void RendererInterfaceD3D11::forgetAboutTexture(ID3D11Resource* resource)
     {
-        textures.erase(resource);
+        auto lock = lockCaches();
+
+        auto it = textureLookup.find(resource);
+        if (it == textureLookup.end())
+            return;
+
+        textures.Remove((TextureObjectMap::Id)it->second);
+        textureLookup.erase(it);
     }
 
     void RendererInterfaceD3D11::forgetAboutBuffer(ID3D11Buffer* resource)
     {
-        buffers.erase(resource);
+        auto lock = lockCaches();
+
+        auto it = bufferLookup.find(resource);
+        if (it == bufferLookup.end())
+            return;
+
+        buffers.Remove((BufferObjectMap::Id)it->second);
+        bufferLookup.erase(it);
+    }
+
+    void RendererInterfaceD3D11::setStateCacheCapacity(uint32_t maxStatesPerCache)
+    {
+        if (sharedOwner)
+            return sharedOwner->setStateCacheCapacity(maxStatesPerCache);
+
+        auto lock = lockCaches();
+
+        std::vector<ComPtr<ID3D11BlendState>> evictedBlendStates;
+        std::vector<ComPtr<ID3D11DepthStencilState>> evictedDepthStencilStates;
+        std::vector<ComPtr<ID3D11RasterizerState>> evictedRasterizerStates;
+        blendStates.SetCapacity(maxStatesPerCache, evictedBlendStates);
+        depthStencilStates.SetCapacity(maxStatesPerCache, evictedDepthStencilStates);
+        rasterizerStates.SetCapacity(maxStatesPerCache, evictedRasterizerStates);
+    }
+
+    StateCacheStats RendererInterfaceD3D11::getStateCacheStats()
+    {
+        if (sharedOwner)
+            return sharedOwner->getStateCacheStats();
+
+        auto lock = lockCaches();
+
+        StateCacheStats stats = blendStates.GetStats();
+        stats += depthStencilStates.GetStats();
+        stats += rasterizerStates.GetStats();
+        return stats;
+    }
+
+    ShaderCacheStats RendererInterfaceD3D11::getShaderCacheStats()
+    {
+        if (sharedOwner)
+            return sharedOwner->getShaderCacheStats();
+
+        auto lock = lockCaches();
+
+        return shaderCache.GetStats();
     }
 
     void RendererInterfaceD3D11::clearCachedData()
     {
-        textures.clear();
-        buffers.clear();
+        auto lock = lockCaches();
+
+        textures.Clear();
+        textureLookup.clear();
+        buffers.Clear();
+        bufferLookup.clear();
 
-        rasterizerStates.clear();
-        blendStates.clear();
-        depthStencilStates.clear();
+        rasterizerStates.Clear();
+        blendStates.Clear();
+        depthStencilStates.Clear();
 
         for(auto query: perfQueries)
             delete query;
@@ -2134,17 +2789,17 @@ namespace NVRHI
         }
     }
 
-    ID3D11BlendState* RendererInterfaceD3D11::getBlendState(const BlendState& blendState)
+    ComPtr<ID3D11BlendState> RendererInterfaceD3D11::getBlendState(const BlendState& blendState)
     {
-        CrcHash hasher;
-        hasher.Add(blendState);
-        uint32_t hash = hasher.Get();
-        ComPtr<ID3D11BlendState> d3dBlendState = blendStates[hash];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getBlendState(blendState);
 
-        if (d3dBlendState)
-            return d3dBlendState.Get();
+        auto lock = lockCaches();
 
-        D3D11_BLEND_DESC desc11New;
+        //the D3D11 descriptor is the cache key, so it is built before the lookup
+        PodKey<D3D11_BLEND_DESC> key;
+        D3D11_BLEND_DESC& desc11New = key.value;
         desc11New.AlphaToCoverageEnable = blendState.alphaToCoverage ? TRUE : FALSE;
         //we always use this and set the states for each target explicitly
         desc11New.IndependentBlendEnable = TRUE;
@@ -2165,23 +2820,31 @@ namespace NVRHI
                 (blendState.colorWriteEnable[i] & BlendState::COLOR_MASK_ALPHA ? D3D11_COLOR_WRITE_ENABLE_ALPHA : 0);
         }
 
+        ComPtr<ID3D11BlendState>* cachedState = blendStates.Find(key);
+        if (cachedState)
+            return *cachedState;
+
+        ComPtr<ID3D11BlendState> d3dBlendState;
         CHECK_ERROR(SUCCEEDED(device->CreateBlendState(&desc11New, &d3dBlendState)), "Creating blend state failed");
+        NVRHI_STAT_ADD(statistics, stateCacheMisses, 1);
 
-        blendStates[hash] = d3dBlendState;
-        return d3dBlendState.Get();
+        //evicted states are released when the vector goes out of scope
+        std::vector<ComPtr<ID3D11BlendState>> evictedStates;
+        blendStates.Insert(key, d3dBlendState, evictedStates);
+        return d3dBlendState;
     }
 
-    ID3D11DepthStencilState* RendererInterfaceD3D11::getDepthStencilState(const DepthStencilState& depthState)
+    ComPtr<ID3D11DepthStencilState> RendererInterfaceD3D11::getDepthStencilState(const DepthStencilState& depthState)
     {
-        CrcHash hasher;
-        hasher.Add(depthState);
-        uint32_t hash = hasher.Get();
-        ComPtr<ID3D11DepthStencilState> d3dDepthStencilState = depthStencilStates[hash];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getDepthStencilState(depthState);
 
-        if (d3dDepthStencilState)
-            return d3dDepthStencilState.Get();
+        auto lock = lockCaches();
 
-        D3D11_DEPTH_STENCIL_DESC desc11New;
+        //the D3D11 descriptor is the cache key; the stencil reference value is not part of it
+        PodKey<D3D11_DEPTH_STENCIL_DESC> key;
+        D3D11_DEPTH_STENCIL_DESC& desc11New = key.value;
         desc11New.DepthEnable = depthState.depthEnable ? TRUE : FALSE;
         desc11New.DepthWriteMask = depthState.depthWriteMask == DepthStencilState::DEPTH_WRITE_MASK_ALL ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
         desc11New.DepthFunc = convertComparisonFunc(depthState.depthFunc);
@@ -2197,23 +2860,30 @@ namespace NVRHI
         desc11New.BackFace.StencilPassOp = convertStencilOp(depthState.backFace.stencilPassOp);
         desc11New.BackFace.StencilFunc = convertComparisonFunc(depthState.backFace.stencilFunc);
 
+        ComPtr<ID3D11DepthStencilState>* cachedState = depthStencilStates.Find(key);
+        if (cachedState)
+            return *cachedState;
+
+        ComPtr<ID3D11DepthStencilState> d3dDepthStencilState;
         CHECK_ERROR(SUCCEEDED(device->CreateDepthStencilState(&desc11New, &d3dDepthStencilState)), "Creating depth-stencil state failed");
+        NVRHI_STAT_ADD(statistics, stateCacheMisses, 1);
 
-        depthStencilStates[hash] = d3dDepthStencilState;
-        return d3dDepthStencilState.Get();
+        std::vector<ComPtr<ID3D11DepthStencilState>> evictedStates;
+        depthStencilStates.Insert(key, d3dDepthStencilState, evictedStates);
+        return d3dDepthStencilState;
     }
 
-    ID3D11RasterizerState* RendererInterfaceD3D11::getRasterizerState(const RasterState& rasterState)
+    ComPtr<ID3D11RasterizerState> RendererInterfaceD3D11::getRasterizerState(const RasterState& rasterState)
     {
-        CrcHash hasher;
-        hasher.Add(rasterState);
-        uint32_t hash = hasher.Get();
-        ComPtr<ID3D11RasterizerState> d3dRasterizerState = rasterizerStates[hash];
+        //deferred contexts share the caches of the interface that created them
+        if (sharedOwner)
+            return sharedOwner->getRasterizerState(rasterState);
 
-        if (d3dRasterizerState)
-            return d3dRasterizerState.Get();
+        auto lock = lockCaches();
 
-        D3D11_RASTERIZER_DESC desc11New;
+        //the D3D11 descriptor and the extended NVAPI fields are the cache key
+        PodKey<RasterizerStateKey> key;
+        D3D11_RASTERIZER_DESC& desc11New = key.value.desc;
         switch (rasterState.fillMode)
         {
         case RasterState::FILL_SOLID:
@@ -2252,6 +2922,21 @@ namespace NVRHI
 
         bool extendedState = rasterState.conservativeRasterEnable || rasterState.forcedSampleCount || rasterState.programmableSamplePositionsEnable;
 
+        if (extendedState)
+        {
+            key.value.conservativeRasterEnable = rasterState.conservativeRasterEnable;
+            key.value.programmableSamplePositionsEnable = rasterState.programmableSamplePositionsEnable;
+            key.value.forcedSampleCount = rasterState.forcedSampleCount;
+            memcpy(key.value.samplePositionsX, rasterState.samplePositionsX, sizeof(rasterState.samplePositionsX));
+            memcpy(key.value.samplePositionsY, rasterState.samplePositionsY, sizeof(rasterState.samplePositionsY));
+        }
+
+        ComPtr<ID3D11RasterizerState>* cachedState = rasterizerStates.Find(key);
+        if (cachedState)
+            return *cachedState;
+
+        ComPtr<ID3D11RasterizerState> d3dRasterizerState;
+
         if (extendedState)
         {
 #if NVRHI_D3D11_WITH_NVAPI
@@ -2276,8 +2961,11 @@ namespace NVRHI
             CHECK_ERROR(SUCCEEDED(device->CreateRasterizerState(&desc11New, &d3dRasterizerState)), "Creating rasterizer state failed");
         }
 
-        rasterizerStates[hash] = d3dRasterizerState;
-        return d3dRasterizerState.Get();
+        NVRHI_STAT_ADD(statistics, stateCacheMisses, 1);
+
+        std::vector<ComPtr<ID3D11RasterizerState>> evictedStates;
+        rasterizerStates.Insert(key, d3dRasterizerState, evictedStates);
+        return d3dRasterizerState;
     }
 
     D3D11_BLEND RendererInterfaceD3D11::convertBlendValue(BlendState::BlendValue value)
@@ -2438,6 +3126,10 @@ namespace NVRHI
 
     void RendererInterfaceD3D11::disableSLIResouceSync(ID3D11Resource* resource)
     {
+        //NVAPI is initialized by the immediate context interface only
+        if (sharedOwner)
+            return sharedOwner->disableSLIResouceSync(resource);
+
 #if NVRHI_D3D11_WITH_NVAPI
         if (!nvapiIsInitalized)
             return;
@@ -2458,6 +3150,9 @@ namespace NVRHI
 
     uint32_t RendererInterfaceD3D11::getNumberOfAFRGroups()
     {
+        if (sharedOwner)
+            return sharedOwner->getNumberOfAFRGroups();
+
 #if NVRHI_D3D11_WITH_NVAPI
         if (!nvapiIsInitalized)
             return 1; //No NVAPI
@@ -2475,6 +3170,9 @@ namespace NVRHI
 
     uint32_t RendererInterfaceD3D11::getAFRGroupOfCurrentFrame(uint32_t numAFRGroups)
     {
+        if (sharedOwner)
+            return sharedOwner->getAFRGroupOfCurrentFrame(numAFRGroups);
+
 #if NVRHI_D3D11_WITH_NVAPI
         if (!nvapiIsInitalized)
             return 0; //No NVAPI
@@ -2509,7 +3207,10 @@ namespace NVRHI
             MultiByteToWideChar(CP_ACP, 0, name, int(nameLength), &query->name[0], int(nameLength));
         }
 
-        perfQueries.insert(query);
+        {
+            auto lock = lockCaches();
+            perfQueries.insert(query);
+        }
 
         return query;
     }
@@ -2518,6 +3219,7 @@ namespace NVRHI
     {
         if(query)
         {
+            auto lock = lockCaches();
             perfQueries.erase(query);
             delete query;
         }
@@ -11,6 +11,11 @@
 #pragma once
 
 #include <GFSDK_NVRHI.h>
+#include "GFSDK_NVRHI_ConstantBufferRing.h"
+#include "GFSDK_NVRHI_ShaderCache.h"
+#include "GFSDK_NVRHI_SlotMap.h"
+#include "GFSDK_NVRHI_StateCache.h"
+#include "GFSDK_NVRHI_Statistics.h"
 #include <d3d11.h>
 #include <d3d11_1.h>
 #include <wrl.h>
@@ -18,6 +23,9 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
 namespace NVRHI
 {
@@ -37,6 +45,8 @@ namespace NVRHI
       };
   };
 
+  class DeferredContextD3D11;
+
   class RendererInterfaceD3D11 : public IRendererInterface
   {
   public:
@@ -50,25 +60,33 @@ namespace NVRHI
     //You should not call this while the client is initialized or else resources it is using may be deleted
     void clearCachedData();
 
+    //Limits the number of blend, depth-stencil and rasterizer states kept in each cache (0 = unlimited).
+    //The least recently used states are released first.
+    void setStateCacheCapacity(uint32_t maxStatesPerCache);
+    StateCacheStats getStateCacheStats();
+
+    //createShader calls with identical bytecode return the same shader object; destroyShader releases a reference
+    ShaderCacheStats getShaderCacheStats();
+
     inline ID3D11DeviceContext* GetDeviceContext() const { return context.Get(); }
     inline ID3D11Device* GetDevice() const { return device.Get(); }
 
     //These are for convenience. They also do not alter the reference count of the returned value
     inline ID3D11ShaderResourceView* getSRVForTexture(ID3D11Resource* resource, DXGI_FORMAT format, uint32_t mipLevel = 0)
     {
-      return getSRVForTexture(getHandleForTexture(resource, NULL), format, mipLevel);
+      return getSRVForTexture(getTextureViewSet(getHandleForTexture(resource, NULL)), format, mipLevel).Get();
     }
     inline ID3D11RenderTargetView* getRTVForTexture(ID3D11Resource* resource, uint32_t arrayItem = 0)
     {
-      return getRTVForTexture(getHandleForTexture(resource, NULL), arrayItem);
+      return getRTVForTexture(getTextureViewSet(getHandleForTexture(resource, NULL)), arrayItem).Get();
     }
     inline ID3D11DepthStencilView* getDSVForTexture(ID3D11Resource* resource, uint32_t arrayItem = 0)
     {
-      return getDSVForTexture(getHandleForTexture(resource, NULL), arrayItem);
+      return getDSVForTexture(getTextureViewSet(getHandleForTexture(resource, NULL)), arrayItem).Get();
     }
     inline ID3D11UnorderedAccessView* getUAVForTexture(ID3D11Resource* resource, DXGI_FORMAT format, uint32_t mipLevel = 0)
     {
-      return getUAVForTexture(getHandleForTexture(resource, NULL), format, mipLevel);
+      return getUAVForTexture(getTextureViewSet(getHandleForTexture(resource, NULL)), format, mipLevel).Get();
     }
 
     ID3D11ShaderResourceView* getSRVForTexture(TextureHandle handle, uint32_t mipLevel = 0);
@@ -79,42 +97,105 @@ namespace NVRHI
 
     TextureHandle getHandleForTexture(ID3D11Resource* resource)
     {
-      return (TextureHandle)getHandleForTexture(resource, NULL);
+      return getHandleForTexture(resource, NULL);
     }
     BufferHandle getHandleForBuffer(ID3D11Buffer* resource)
     {
-      return (BufferHandle)getHandleForBuffer(resource, NULL);
+      return getHandleForBuffer(resource, NULL);
     }
 
+    //Deferred contexts for recording on other threads. They implement the same API as this interface
+    //and share its resources, views and state objects. The resulting command lists are executed here in order;
+    //the immediate context state is restored after each list, so the application state (see UserState) is preserved.
+    DeferredContextD3D11* createDeferredContext();
+    void destroyDeferredContext(DeferredContextD3D11* deferredContext);
+    void executeCommandList(ID3D11CommandList* commandList);
+
   private:
+    friend class DeferredContextD3D11;
     RendererInterfaceD3D11& operator=(const RendererInterfaceD3D11& other); //undefined
   protected:
+    //For deferred contexts: uses the device, NVAPI and caches of the owner and only sets up the recording state
+    RendererInterfaceD3D11(RendererInterfaceD3D11& owner, ID3D11DeviceContext* deferredContext);
+
     ComPtr<ID3D11DeviceContext> context;
     ComPtr<ID3D11Device> device;
     IErrorCallback* errorCB;
     bool nvapiIsInitalized;
     ComPtr<ID3DUserDefinedAnnotation> userDefinedAnnotation;
 
+    //Deferred contexts forward all cache lookups to the interface that created them; the caches are guarded by cacheMutex
+    //while any deferred context exists, see lockCaches. Lookups return new references to the cached objects, because
+    //another context can evict a state or destroy a texture before the object is bound; once bound, the context keeps it alive.
+    RendererInterfaceD3D11* sharedOwner;
+    std::recursive_mutex cacheMutex;
+    std::atomic<uint32_t> numDeferredContexts;
+    std::unique_lock<std::recursive_mutex> lockCaches();
+
+    //The views looked up by applyState, referenced until they are bound
+    std::vector<ComPtr<ID3D11View>> viewReferences;
+
+    //Constant buffer versions are suballocated from one dynamic buffer and bound with offsets when D3D11.1 is available;
+    //otherwise every constant buffer has its own buffer that is discarded on every write. context1 is null in that case.
+    //Deferred contexts use a smaller ring that is created when they first write a constant buffer.
+    ComPtr<ID3D11DeviceContext1> context1;
+    ComPtr<ID3D11Buffer> cbufferRingBuffer;
+    ConstantBufferRing cbufferRing;
+
+    //Every interface, including each deferred context, keeps its own version of each constant buffer it writes:
+    //a copy of the data and the place it was uploaded to. A context never binds data written by another context.
+    struct ConstantBufferVersion
+    {
+      uint64_t bufferId;                  //ConstantBuffer::id, to detect a destroyed buffer whose address was reused
+      std::vector<char> contents;
+      bool hasContents;
+      bool inRing;
+      uint32_t ringOffset;
+      uint64_t ringGeneration;
+      ComPtr<ID3D11Buffer> ownBuffer;     //deferred contexts only, when the ring is not used; the immediate context uses ConstantBuffer::buffer
+      uint64_t ownBufferCommandList;      //value of commandListCounter when ownBuffer was last written
+
+      ConstantBufferVersion() : bufferId(0), hasContents(false), inRing(false), ringOffset(0), ringGeneration(0), ownBufferCommandList(0) { }
+    };
+    std::unordered_map<const ConstantBuffer*, ConstantBufferVersion> cbufferVersions;
+    uint64_t commandListCounter;          //incremented by finishCommandList; dynamic buffers must be discarded again in every command list
+
+    //The deferred contexts created by this interface, so that destroyConstantBuffer reaches all of their versions. Guarded by cacheMutex.
+    std::vector<DeferredContextD3D11*> deferredContexts;
+
+    //Constant buffers destroyed by another context, with their ids. The versions are only used by the thread of this context,
+    //so it drops them itself before it writes or binds constant buffers again. Guarded by the owner's cacheMutex.
+    std::vector<std::pair<const ConstantBuffer*, uint64_t>> destroyedConstantBuffers;
+    std::atomic<bool> hasDestroyedConstantBuffers;
+
     void signalError(const char* file, int line, const char* errorDesc);
 
-    //Store the views we have created for a particular resource. Most of these will be null at a given time
+    ConstantBufferVersion& getConstantBufferVersion(const ConstantBuffer* cbuffer);
+    void purgeDestroyedConstantBuffers();
+    bool isConstantBufferVersionCurrent(const ConstantBufferVersion& version);
+    void uploadConstantBuffer(const ConstantBuffer* cbuffer, ConstantBufferVersion& version);
+    void prepareConstantBuffers(const PipelineStageBindings* const* stages, uint32_t numStages);
+    void getConstantBufferBinding(ConstantBufferHandle cbuffer, ID3D11Buffer*& outBuffer, UINT& outFirstConstant, UINT& outNumConstants);
+
+    //Store the views we have created for a particular resource, keyed by makeTextureViewKey
     struct TextureViewSet 
     {
+      ComPtr<ID3D11Resource> resource;
       //cache this here for simplicity.
       TextureDesc textureDesc;
-      std::map<std::pair<DXGI_FORMAT, uint32_t>, ComPtr<ID3D11ShaderResourceView> > shaderResourceViews;
-      std::map<std::pair<uint32_t, uint32_t>, ComPtr<ID3D11RenderTargetView> > renderTargetViews;
-      std::map<std::pair<uint32_t, uint32_t>, ComPtr<ID3D11DepthStencilView> > depthStencilViews;
-      std::vector<std::map<DXGI_FORMAT, ComPtr<ID3D11UnorderedAccessView> > > unorderedAccessViewsPerMip;
+      OpenHashTable<ComPtr<ID3D11View>> views;
     };
 
-    //We store these in a map so that we can map a raw D3D pointer back to the struct (eg if they from the user's code)
-    typedef std::map<ComPtr<ID3D11Resource>, TextureViewSet> TextureObjectMap;
+    //Texture and buffer handles are slot map ids, so a handle to a destroyed resource can be detected.
+    //The lookup tables map a raw D3D pointer back to the handle (eg if they from the user's code)
+    typedef SlotMap<TextureViewSet> TextureObjectMap;
     TextureObjectMap textures;
+    std::unordered_map<ID3D11Resource*, TextureHandle> textureLookup;
 
     //We only have single views here since you can't really alias different formats and we don't support partial views
     struct BufferViewSet 
     {
+      ComPtr<ID3D11Buffer> resource;
       //cache this here for simplicity. Only one is used depending on if this is a texture or a buffer
       BufferDesc bufferDesc;
       ComPtr<ID3D11Buffer> stagingBuffer;
@@ -122,36 +203,65 @@ namespace NVRHI
       ComPtr<ID3D11UnorderedAccessView> unorderedAccessView;
     };
 
-    typedef std::map<ComPtr<ID3D11Buffer>, BufferViewSet> BufferObjectMap;
+    typedef SlotMap<BufferViewSet> BufferObjectMap;
     BufferObjectMap buffers;
+    std::unordered_map<ID3D11Buffer*, BufferHandle> bufferLookup;
     
-    std::map<uint32_t, ComPtr<ID3D11BlendState>> blendStates;
-    std::map<uint32_t, ComPtr<ID3D11DepthStencilState>> depthStencilStates;
-    std::map<uint32_t, ComPtr<ID3D11RasterizerState>> rasterizerStates;
+    //State objects are cached by their full D3D11 descriptors
+    struct RasterizerStateKey
+    {
+      D3D11_RASTERIZER_DESC desc;
+      char forcedSampleCount;
+      bool programmableSamplePositionsEnable;
+      bool conservativeRasterEnable;
+      char samplePositionsX[16];
+      char samplePositionsY[16];
+    };
+
+    StateCache<PodKey<D3D11_BLEND_DESC>, ComPtr<ID3D11BlendState>> blendStates;
+    StateCache<PodKey<D3D11_DEPTH_STENCIL_DESC>, ComPtr<ID3D11DepthStencilState>> depthStencilStates;
+    StateCache<PodKey<RasterizerStateKey>, ComPtr<ID3D11RasterizerState>> rasterizerStates;
+
+    //Shader objects are shared by bytecode and reference counted; the handles are the D3D shader objects
+    ShaderCache shaderCache;
 
     std::set<PerformanceQueryHandle> perfQueries;
+
+    //Every interface, including each deferred context, counts its own calls; state object creation is counted
+    //by the interface that owns the caches, under cacheMutex. Deferred contexts count while the owner does, as of
+    //their next command list, and attach the counters to the command list; executeCommandList adds them to the owner.
+    StatisticsCollector statistics;
+    std::atomic<bool> statisticsEnabled;
     
     D3D11_BLEND convertBlendValue(BlendState::BlendValue value);
     D3D11_BLEND_OP convertBlendOp(BlendState::BlendOp value);
     D3D11_STENCIL_OP convertStencilOp(DepthStencilState::StencilOp value);
     D3D11_COMPARISON_FUNC convertComparisonFunc(DepthStencilState::ComparisonFunc value);
-    ID3D11BlendState* getBlendState(const BlendState& blendState);
-    ID3D11DepthStencilState* getDepthStencilState(const DepthStencilState& depthStencilState);
-    ID3D11RasterizerState* getRasterizerState(const RasterState& rasterState);
-
-    ID3D11ShaderResourceView* getSRVForTexture(TextureObjectMap::value_type* resource, DXGI_FORMAT format, uint32_t mipLevel = 0);
-    ID3D11RenderTargetView* getRTVForTexture(TextureObjectMap::value_type* resource, uint32_t arrayItem = 0, uint32_t mipLevel = 0);
-    ID3D11DepthStencilView* getDSVForTexture(TextureObjectMap::value_type* resource, uint32_t arrayItem = 0, uint32_t mipLevel = 0);
-    ID3D11UnorderedAccessView* getUAVForTexture(TextureObjectMap::value_type* resource, DXGI_FORMAT format, uint32_t mipLevel = 0);
+    ComPtr<ID3D11BlendState> getBlendState(const BlendState& blendState);
+    ComPtr<ID3D11DepthStencilState> getDepthStencilState(const DepthStencilState& depthStencilState);
+    ComPtr<ID3D11RasterizerState> getRasterizerState(const RasterState& rasterState);
+
+    ComPtr<ID3D11ShaderResourceView> getSRVForTexture(TextureViewSet* resource, DXGI_FORMAT format, uint32_t mipLevel = 0);
+    ComPtr<ID3D11RenderTargetView> getRTVForTexture(TextureViewSet* resource, uint32_t arrayItem = 0, uint32_t mipLevel = 0);
+    ComPtr<ID3D11DepthStencilView> getDSVForTexture(TextureViewSet* resource, uint32_t arrayItem = 0, uint32_t mipLevel = 0);
+    ComPtr<ID3D11UnorderedAccessView> getUAVForTexture(TextureViewSet* resource, DXGI_FORMAT format, uint32_t mipLevel = 0);
     //if there are multiple views to clear you can keep calling index until you get all null
-    void getClearViewForTexture(TextureObjectMap::value_type* resource, uint32_t index, bool asUINT, ID3D11UnorderedAccessView*& outUAV, ID3D11RenderTargetView*& outRTV, ID3D11DepthStencilView*& outDSV);
+    void getClearViewForTexture(TextureViewSet* resource, uint32_t index, bool asUINT, ComPtr<ID3D11UnorderedAccessView>& outUAV, ComPtr<ID3D11RenderTargetView>& outRTV, ComPtr<ID3D11DepthStencilView>& outDSV);
 
-    ID3D11ShaderResourceView* getSRVForBuffer(BufferObjectMap::value_type* resource, Format::Enum format);
-    ID3D11UnorderedAccessView* getUAVForBuffer(BufferObjectMap::value_type* resource);
+    ComPtr<ID3D11ShaderResourceView> getSRVForBuffer(BufferViewSet* resource, Format::Enum format);
+    ComPtr<ID3D11UnorderedAccessView> getUAVForBuffer(BufferViewSet* resource);
+
+    //Keeps a reference to the view in viewReferences and returns it for binding
+    template<typename T> T* referenceView(ComPtr<T> view);
 
     //If we just created this texture pass in the texture desc, otherwise deduce it from D3D11
-    TextureObjectMap::value_type* getHandleForTexture(ID3D11Resource* resource, const TextureDesc* textureDesc);
-    BufferObjectMap::value_type* getHandleForBuffer(ID3D11Buffer* resource, const BufferDesc* bufferDesc);
+    TextureHandle getHandleForTexture(ID3D11Resource* resource, const TextureDesc* textureDesc);
+    BufferHandle getHandleForBuffer(ID3D11Buffer* resource, const BufferDesc* bufferDesc);
+
+    //Resolve handles to the tracked data; null for null handles. Stale handles are reported in debug builds.
+    //The view sets never move in the slot maps, so the pointers stay valid until the resource is destroyed.
+    TextureViewSet* getTextureViewSet(TextureHandle handle);
+    BufferViewSet* getBufferViewSet(BufferHandle handle);
 
     TextureDesc getTextureDescFromD3D11Resource(ID3D11Resource* resource);
     BufferDesc getBufferDescFromD3D11Buffer(ID3D11Buffer* buffer);
@@ -215,6 +325,10 @@ namespace NVRHI
 
 	virtual void setEnableUavBarriersForTexture(TextureHandle, bool) { }
 	virtual void setEnableUavBarriersForBuffer(BufferHandle, bool) { }
+
+    virtual bool setEnableStatistics(bool enable);
+    virtual void endStatisticsFrame();
+    virtual bool getFrameStatistics(RendererStatistics& stats);
     
     //These do not handle the pre/post commands
     void applyState(const DrawCallState& state, uint32_t denyStageMask = 0);
@@ -222,6 +336,26 @@ namespace NVRHI
     void clearState();
   };
 
+  //Records into an ID3D11DeviceContext deferred context. Use one per thread.
+  class DeferredContextD3D11 : public RendererInterfaceD3D11
+  {
+  public:
+    DeferredContextD3D11(RendererInterfaceD3D11* owner, ID3D11DeviceContext* deferredContext);
+
+    //Finishes recording; the context can be used again right away
+    ComPtr<ID3D11CommandList> finishCommandList();
+
+    virtual void destroyTexture(TextureHandle t);
+    virtual void destroyBuffer(BufferHandle b);
+    virtual void readBuffer(BufferHandle b, void* data, size_t* dataSize);
+    virtual PerformanceQueryHandle createPerformanceQuery(const char* name);
+    virtual void destroyPerformanceQuery(PerformanceQueryHandle query);
+    virtual float getPerformanceQueryTimeMS(PerformanceQueryHandle query);
+    virtual bool setEnableStatistics(bool enable);
+    virtual void endStatisticsFrame();
+    virtual bool getFrameStatistics(RendererStatistics& stats);
+  };
+
   struct UserState
   {
     void save(ID3D11DeviceContext* context);
@@ -9,7 +9,13 @@
 */
 
 #include "GFSDK_NVRHI_D3D12.h"
+#include "GFSDK_NVRHI_BuddyAllocator.h"
+#include "GFSDK_NVRHI_ResidencyPolicy.h"
+#include "GFSDK_NVRHI_FrameContexts.h"
+#include "GFSDK_NVRHI_StateCache.h"
+#include "GFSDK_NVRHI_Statistics.h"
 #include <d3d12.h>
+#include <dxgi1_4.h>
 #include <vector>
 #include <set>
 #include <bitset>
@@ -18,7 +24,6 @@
 #include <assert.h>
 #include <list>
 #include <pix.h>
-#include <nmmintrin.h>
 
 #ifndef NVRHI_D3D12_WITH_NVAPI
 #define NVRHI_D3D12_WITH_NVAPI 1
@@ -52,6 +57,9 @@
 
 #define INVALID_DESCRIPTOR_INDEX (~0u)
 #define MAX_COMMANDS_IN_LIST 128
+#define PLACED_HEAP_SIZE (64 * 1024 * 1024)
+#define MAX_EVICTIONS_PER_FRAME 64
+#define DEFAULT_FRAMES_IN_FLIGHT 2
 
 namespace NVRHI
 {
@@ -59,15 +67,36 @@ namespace NVRHI
     {
     public:
         UINT64 fenceCounterAtLastUse;
+        UINT64 computeFenceCounterAtLastUse;
 
         ManagedResource()
             : fenceCounterAtLastUse(0)
+            , computeFenceCounterAtLastUse(0)
         { }
 
         virtual ~ManagedResource() 
         { }
     };
 
+    class PlacedHeap;
+
+    struct HeapAllocation
+    {
+        PlacedHeap* heap;           // null for committed resources and transient regions
+        ID3D12Pageable* pageable;   // the object that is made resident or evicted: the heap or the committed resource
+        uint64_t offset;
+        uint32_t transientRegion;   // 0 if the resource is not aliased
+        bool committed;
+
+        HeapAllocation()
+            : heap(nullptr)
+            , pageable(nullptr)
+            , offset(0)
+            , transientRegion(0)
+            , committed(false)
+        { }
+    };
+
     class Shader : public ManagedResource
     {
     public:
@@ -111,6 +140,7 @@ namespace NVRHI
         std::map<std::pair<ArrayIndex, MipLevel>, DescriptorIndex> depthStencilViews;
         std::map<std::pair<Format::Enum, MipLevel>, DescriptorIndex> shaderResourceViews;
         std::map<std::pair<Format::Enum, MipLevel>, DescriptorIndex> unorderedAccessViews;
+        HeapAllocation heapAllocation;
 
         Texture() 
             : resource(nullptr)
@@ -124,6 +154,7 @@ namespace NVRHI
         { 
             parent->releaseTextureViews(this);
             SAFE_RELEASE(resource); 
+            parent->releaseHeapAllocation(heapAllocation);
         }
     };
 
@@ -139,6 +170,7 @@ namespace NVRHI
         DescriptorIndex shaderResourceView;
         DescriptorIndex unorderedAccessView;
 		D3D12_GPU_VIRTUAL_ADDRESS gpuVA;
+        HeapAllocation heapAllocation;
 
         Buffer() 
             : resource(nullptr)
@@ -154,6 +186,7 @@ namespace NVRHI
         { 
             parent->releaseBufferViews(this);
             SAFE_RELEASE(resource); 
+            parent->releaseHeapAllocation(heapAllocation);
         }
     };
 
@@ -234,12 +267,14 @@ namespace NVRHI
         uint32_t beginIndex;
         uint32_t endIndex;
         State state;
+        bool computeQueue;  // started inside a compute queue scope; the timestamps use the compute queue frequency
         float time;
 
         PerformanceQuery()
             : beginIndex(INVALID_DESCRIPTOR_INDEX)
             , endIndex(INVALID_DESCRIPTOR_INDEX)
             , state(NEW)
+            , computeQueue(false)
             , time(0.f)
         { }
     };
@@ -365,104 +400,6 @@ namespace NVRHI
         return mapping;
     }
 
-    bool GetSSE42Support()
-    {
-        int cpui[4];
-        __cpuidex(cpui, 1, 0);
-        return !!(cpui[2] & 0x100000);
-    }
-
-    static const bool CpuSupportsSSE42 = GetSSE42Support();
-
-    static const uint32_t CrcTable[] = {
-        0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-        0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-        0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-        0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-        0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-        0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-        0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-        0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-        0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-        0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-        0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-        0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-        0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-        0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-        0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-        0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-        0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-        0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-        0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-        0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-        0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-        0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-        0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-        0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-        0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-        0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-        0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-        0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-        0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-        0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-        0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-        0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-        0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-        0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-        0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-        0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-        0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-        0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-        0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-        0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-        0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-        0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-        0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-    };
-
-    class CrcHash
-    {
-    private:
-        uint32_t crc;
-    public:
-        CrcHash() 
-            : crc(0) 
-        { 
-        }
-
-        uint32_t Get() 
-        {
-            return crc;
-        }
-
-        template<size_t size> __forceinline void AddBytesSSE42(void* p)
-        {
-            static_assert(size % 4 == 0, "Size of hashable types must be multiple of 4");
-
-            uint32_t* data = (uint32_t*)p;
-
-            const size_t numIterations = size / sizeof(uint32_t);
-            for (size_t i = 0; i < numIterations; i++)
-            {
-                crc = _mm_crc32_u32(crc, data[i]);
-            }
-        }
-
-        __forceinline void AddBytes(char* p, uint32_t size)
-        {
-            for (uint32_t idx = 0; idx < size; idx++)
-                crc = CrcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
-        }
-
-        template<typename T> void Add(const T& value)
-        {
-            if (CpuSupportsSSE42)
-                AddBytesSSE42<sizeof(value)>((void*)&value);
-            else
-                AddBytes((char*)&value, sizeof(value));
-        }
-    };
-
     class DescriptorHeap
     {
     private:
@@ -474,6 +411,7 @@ namespace NVRHI
         uint32_t m_NumDescriptors;
         std::list<std::pair<UINT64, uint32_t>> m_FencePointers;
         uint32_t m_WritePointer;
+        UINT64 m_TotalAllocated;
         bool m_Monitored;
         const char* m_TypeString;
 
@@ -484,6 +422,7 @@ namespace NVRHI
             , m_Stride(0)
             , m_NumDescriptors(0)
             , m_WritePointer(0)
+            , m_TotalAllocated(0)
             , m_Monitored(false)
         {
         }
@@ -568,9 +507,13 @@ namespace NVRHI
 
             firstIndex = m_WritePointer;
             m_WritePointer += numDescriptors;
+            m_TotalAllocated += numDescriptors;
             return true;
         }
 
+        uint32_t GetNumDescriptors() const { return m_NumDescriptors; }
+        UINT64 GetTotalAllocated() const { return m_TotalAllocated; }
+
         D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t index)
         {
             D3D12_CPU_DESCRIPTOR_HANDLE handle = m_StartCpuHandle;
@@ -733,6 +676,7 @@ namespace NVRHI
 		D3D12_GPU_VIRTUAL_ADDRESS m_UploadBufferGPUVA;
         UINT64 m_BufferSize;
         UINT64 m_WritePointer;
+        UINT64 m_TotalAllocated;
         std::list<std::pair<UINT64, UINT64>> m_FencePointers;
         const std::list<ConstantBufferHandle>& m_ConstantBuffers;
     public:
@@ -743,6 +687,7 @@ namespace NVRHI
             , m_pUploadBufferHostData(NULL)
             , m_BufferSize(0)
             , m_WritePointer(0)
+            , m_TotalAllocated(0)
         {
         }
 
@@ -846,9 +791,13 @@ namespace NVRHI
 
             UINT64 bufferOffset = m_WritePointer;
             m_WritePointer += size;
+            m_TotalAllocated += size;
             return bufferOffset;
         }
 
+        UINT64 GetSize() const { return m_BufferSize; }
+        UINT64 GetTotalAllocated() const { return m_TotalAllocated; }
+
         void* GetCpuVA(UINT64 bufferOffset)
         {
             return (char*)m_pUploadBufferHostData + bufferOffset;
@@ -908,7 +857,398 @@ namespace NVRHI
             m_FencePointers.erase(m_FencePointers.begin(), it);
         }
     };
+
+    class PlacedHeap
+    {
+    public:
+        ID3D12Heap* heap;
+        BuddyAllocator allocator;
+
+        PlacedHeap(UINT64 minBlockSize, uint32_t numOrders)
+            : heap(nullptr)
+            , allocator(minBlockSize, numOrders)
+        { }
+
+        ~PlacedHeap()
+        {
+            SAFE_RELEASE(heap);
+        }
+    };
+
+    class PlacedResourceAllocator
+    {
+    private:
+        // With resource heap tier 1, buffers, RT/DS textures and other textures need separate heaps.
+        // With tier 2, everything goes into the first category.
+        enum HeapCategory
+        {
+            HEAP_BUFFERS = 0,
+            HEAP_RT_DS_TEXTURES,
+            HEAP_OTHER_TEXTURES,
+            NUM_HEAP_CATEGORIES
+        };
+
+        // Alignment classes: regular resources and MSAA textures
+        enum { NUM_ALIGNMENT_CLASSES = 2 };
+
+        struct HeapPool
+        {
+            D3D12_HEAP_FLAGS flags;
+            UINT64 alignment;
+            std::vector<PlacedHeap*> heaps;
+        };
+
+        struct TransientRegion
+        {
+            UINT64 size;
+            ID3D12Heap* heaps[NUM_HEAP_CATEGORIES];
+            uint32_t numResources;
+        };
+
+        RendererInterfaceD3D12* m_pParent;
+        ResidencyPolicy& m_Residency;
+        bool m_MixedHeaps;
+        HeapPool m_Pools[NUM_HEAP_CATEGORIES][NUM_ALIGNMENT_CLASSES];
+        std::map<uint32_t, TransientRegion> m_TransientRegions;
+        uint32_t m_NextTransientRegion;
+        uint32_t m_ActiveTransientRegion;
+        uint32_t m_NumCommittedResources;
+
+        HeapCategory GetCategory(const D3D12_RESOURCE_DESC& desc)
+        {
+            if (m_MixedHeaps || desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+                return HEAP_BUFFERS;
+
+            if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+                return HEAP_RT_DS_TEXTURES;
+
+            return HEAP_OTHER_TEXTURES;
+        }
+
+        ID3D12Heap* CreateHeap(UINT64 size, UINT64 alignment, D3D12_HEAP_FLAGS flags)
+        {
+            D3D12_HEAP_DESC heapDesc = {};
+            heapDesc.SizeInBytes = size;
+            heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+            heapDesc.Alignment = alignment;
+            heapDesc.Flags = flags;
+
+            ID3D12Heap* heap = nullptr;
+            if (FAILED(m_pParent->m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap))))
+                return nullptr;
+
+            return heap;
+        }
+
+        bool CreateInTransientRegion(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_ALLOCATION_INFO& info, const D3D12_CLEAR_VALUE* clearValue, HeapAllocation& allocation, ID3D12Resource** ppResource)
+        {
+            auto it = m_TransientRegions.find(m_ActiveTransientRegion);
+            if (it == m_TransientRegions.end() || info.SizeInBytes > it->second.size)
+            {
+                DEBUG_PRINT("WARNING: resource does not fit into the active transient region, allocating it separately\n");
+                return false;
+            }
+
+            TransientRegion& region = it->second;
+            HeapCategory category = GetCategory(desc);
+
+            if (!region.heaps[category])
+            {
+                region.heaps[category] = CreateHeap(region.size, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT, m_Pools[category][0].flags);
+                if (!region.heaps[category])
+                    return false;
+
+                m_Residency.AddObject(region.heaps[category], region.size);
+            }
+
+            if (FAILED(m_pParent->m_pDevice->CreatePlacedResource(region.heaps[category], 0, &desc, D3D12_RESOURCE_STATE_COMMON, clearValue, IID_PPV_ARGS(ppResource))))
+                return false;
+
+            allocation.transientRegion = m_ActiveTransientRegion;
+            allocation.pageable = region.heaps[category];
+            region.numResources++;
+            return true;
+        }
+
+        bool CreateInPool(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_ALLOCATION_INFO& info, const D3D12_CLEAR_VALUE* clearValue, HeapAllocation& allocation, ID3D12Resource** ppResource)
+        {
+            HeapPool& pool = m_Pools[GetCategory(desc)][desc.SampleDesc.Count > 1 ? 1 : 0];
+
+            if (info.SizeInBytes > PLACED_HEAP_SIZE || info.Alignment > pool.alignment)
+                return false;
+
+            PlacedHeap* placedHeap = nullptr;
+            UINT64 offset = BuddyAllocator::INVALID_OFFSET;
+
+            for (auto heap : pool.heaps)
+            {
+                offset = heap->allocator.Allocate(info.SizeInBytes, info.Alignment);
+                if (offset != BuddyAllocator::INVALID_OFFSET)
+                {
+                    placedHeap = heap;
+                    break;
+                }
+            }
+
+            if (!placedHeap)
+            {
+                uint32_t numOrders = 0;
+                while ((pool.alignment << numOrders) < PLACED_HEAP_SIZE)
+                    numOrders++;
+
+                placedHeap = new PlacedHeap(pool.alignment, numOrders);
+                placedHeap->heap = CreateHeap(PLACED_HEAP_SIZE, pool.alignment, pool.flags);
+
+                if (!placedHeap->heap)
+                {
+                    delete placedHeap;
+                    return false;
+                }
+
+                pool.heaps.push_back(placedHeap);
+                m_Residency.AddObject(placedHeap->heap, PLACED_HEAP_SIZE);
+                offset = placedHeap->allocator.Allocate(info.SizeInBytes, info.Alignment);
+            }
+
+            if (FAILED(m_pParent->m_pDevice->CreatePlacedResource(placedHeap->heap, offset, &desc, D3D12_RESOURCE_STATE_COMMON, clearValue, IID_PPV_ARGS(ppResource))))
+            {
+                placedHeap->allocator.Free(offset);
+                return false;
+            }
+
+            allocation.heap = placedHeap;
+            allocation.pageable = placedHeap->heap;
+            allocation.offset = offset;
+            return true;
+        }
+
+    public:
+        PlacedResourceAllocator(RendererInterfaceD3D12* pParent, ResidencyPolicy& residency)
+            : m_pParent(pParent)
+            , m_Residency(residency)
+            , m_MixedHeaps(false)
+            , m_NextTransientRegion(1)
+            , m_ActiveTransientRegion(0)
+            , m_NumCommittedResources(0)
+        {
+        }
+
+        ~PlacedResourceAllocator()
+        {
+            for (auto& category : m_Pools)
+                for (auto& pool : category)
+                    for (auto heap : pool.heaps)
+                        delete heap;
+
+            for (auto& pair : m_TransientRegions)
+                for (auto heap : pair.second.heaps)
+                    SAFE_RELEASE(heap);
+        }
+
+        void Initialize()
+        {
+            D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+            m_pParent->m_pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+            m_MixedHeaps = options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+
+            const D3D12_HEAP_FLAGS categoryFlags[NUM_HEAP_CATEGORIES] = {
+                D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+                D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+                D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES
+            };
+
+            for (uint32_t category = 0; category < NUM_HEAP_CATEGORIES; category++)
+            {
+                for (uint32_t alignmentClass = 0; alignmentClass < NUM_ALIGNMENT_CLASSES; alignmentClass++)
+                {
+                    HeapPool& pool = m_Pools[category][alignmentClass];
+                    pool.flags = m_MixedHeaps ? D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES : categoryFlags[category];
+                    pool.alignment = alignmentClass ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+                }
+            }
+        }
+
+        HRESULT CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, bool allowPlacement, HeapAllocation& allocation, ID3D12Resource** ppResource)
+        {
+            D3D12_RESOURCE_ALLOCATION_INFO info = m_pParent->m_pDevice->GetResourceAllocationInfo(0, 1, &desc);
+
+            if (allowPlacement)
+            {
+                if (m_ActiveTransientRegion && CreateInTransientRegion(desc, info, clearValue, allocation, ppResource))
+                    return S_OK;
+
+                if (CreateInPool(desc, info, clearValue, allocation, ppResource))
+                    return S_OK;
+            }
+
+            // Fall back to a committed resource when the resource is too large for a heap or placement failed
+
+            D3D12_HEAP_PROPERTIES heapProps = {};
+            heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+            HRESULT hr = m_pParent->m_pDevice->CreateCommittedResource(
+                &heapProps,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_COMMON,
+                clearValue,
+                IID_PPV_ARGS(ppResource));
+
+            if (SUCCEEDED(hr))
+            {
+                allocation.committed = true;
+                allocation.pageable = *ppResource;
+                m_Residency.AddObject(allocation.pageable, info.SizeInBytes);
+                m_NumCommittedResources++;
+            }
+
+            return hr;
+        }
+
+        void Free(const HeapAllocation& allocation)
+        {
+            if (allocation.committed)
+            {
+                m_Residency.RemoveObject(allocation.pageable);
+                m_NumCommittedResources--;
+            }
+            else if (allocation.transientRegion)
+            {
+                auto it = m_TransientRegions.find(allocation.transientRegion);
+                if (it != m_TransientRegions.end())
+                    it->second.numResources--;
+            }
+            else if (allocation.heap)
+            {
+                allocation.heap->allocator.Free(allocation.offset);
+
+                if (!allocation.heap->allocator.IsEmpty())
+                    return;
+
+                // Release empty heaps, but keep one per pool to avoid re-creating it all the time
+                for (auto& category : m_Pools)
+                    for (auto& pool : category)
+                    {
+                        auto it = std::find(pool.heaps.begin(), pool.heaps.end(), allocation.heap);
+                        if (it != pool.heaps.end() && pool.heaps.size() > 1)
+                        {
+                            m_Residency.RemoveObject(allocation.heap->heap);
+                            delete allocation.heap;
+                            pool.heaps.erase(it);
+                            return;
+                        }
+                    }
+            }
+        }
+
+        uint32_t CreateTransientRegion(UINT64 size)
+        {
+            TransientRegion region = {};
+            region.size = Align(size, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+
+            uint32_t id = m_NextTransientRegion++;
+            m_TransientRegions[id] = region;
+            return id;
+        }
+
+        void DestroyTransientRegion(uint32_t id)
+        {
+            auto it = m_TransientRegions.find(id);
+            if (it == m_TransientRegions.end())
+                return;
+
+            // Placed resources keep their own references to the heaps
+            for (auto heap : it->second.heaps)
+            {
+                m_Residency.RemoveObject(heap);
+                SAFE_RELEASE(heap);
+            }
+
+            m_TransientRegions.erase(it);
+
+            if (m_ActiveTransientRegion == id)
+                m_ActiveTransientRegion = 0;
+        }
+
+        bool SetActiveTransientRegion(uint32_t id)
+        {
+            if (id != 0 && m_TransientRegions.find(id) == m_TransientRegions.end())
+                return false;
+
+            m_ActiveTransientRegion = id;
+            return true;
+        }
+
+        HeapAllocatorStats GetStats()
+        {
+            HeapAllocatorStats stats;
+            UINT64 freeBytes = 0;
+
+            for (auto& category : m_Pools)
+                for (auto& pool : category)
+                {
+                    UINT64 poolAllocated = 0;
+
+                    for (auto heap : pool.heaps)
+                    {
+                        stats.numHeaps++;
+                        stats.heapBytes += heap->allocator.GetSize();
+                        stats.allocatedBytes += heap->allocator.GetAllocatedSize();
+                        stats.numPlacedResources += heap->allocator.GetNumAllocations();
+                        stats.numFreeBlocks += heap->allocator.GetNumFreeBlocks();
+                        stats.largestFreeBlock = std::max(stats.largestFreeBlock, heap->allocator.GetLargestFreeBlock());
+                        freeBytes += heap->allocator.GetSize() - heap->allocator.GetAllocatedSize();
+                        poolAllocated += heap->allocator.GetAllocatedSize();
+                    }
+
+                    uint32_t minHeaps = uint32_t((poolAllocated + PLACED_HEAP_SIZE - 1) / PLACED_HEAP_SIZE);
+                    stats.numReclaimableHeaps += uint32_t(pool.heaps.size()) - std::min(minHeaps, uint32_t(pool.heaps.size()));
+                }
+
+            for (auto& pair : m_TransientRegions)
+            {
+                stats.numTransientRegions++;
+                stats.numAliasedResources += pair.second.numResources;
+
+                for (auto heap : pair.second.heaps)
+                    if (heap)
+                        stats.transientBytes += pair.second.size;
+            }
+
+            stats.numCommittedResources = m_NumCommittedResources;
+            stats.fragmentation = freeBytes > 0 ? 1.f - float(double(stats.largestFreeBlock) / double(freeBytes)) : 0.f;
+
+            return stats;
+        }
+    };
         
+    // Cache keys for root signatures and pipeline states. They are filled into zeroed storage (PodKey)
+    // field by field, so they are compared and hashed as plain bytes.
+    struct RootSignatureKey
+    {
+        ShaderHandle shaders[ShaderType::GRAPHIC_SHADERS_NUM];    // just the compute shader for compute root signatures
+        uint32_t allowInputLayout;
+    };
+
+    struct GraphicsPipelineKey
+    {
+        ShaderHandle shaders[ShaderType::GRAPHIC_SHADERS_NUM];
+        InputLayoutHandle inputLayout;
+        BlendState blendState;
+        DepthStencilState depthStencilState;
+        RasterState rasterState;
+        uint32_t primType;
+        uint32_t depthFormat;
+        uint32_t targetFormats[RenderState::MAX_RENDER_TARGETS];
+        uint32_t sampleCount;
+        uint32_t sampleQuality;
+    };
+
+    struct ComputePipelineKey
+    {
+        ShaderHandle shader;
+    };
+
     struct BackendResources
     {
         RendererInterfaceD3D12* parent;
@@ -929,15 +1269,50 @@ namespace NVRHI
         DescriptorHeap dhSRVetc;
         DescriptorHeap dhSamplers;
         UploadManager upload;
+        ResidencyPolicy residency;
+        PlacedResourceAllocator placedResources;
 
-        std::map<uint32_t, PipelineStateHandle> psoCache;
-        std::map<uint32_t, RootSignatureHandle> rootsigCache;
+        StateCache<PodKey<GraphicsPipelineKey>, PipelineStateHandle> psoCache;
+        StateCache<PodKey<ComputePipelineKey>, PipelineStateHandle> computePsoCache;
+        StateCache<PodKey<RootSignatureKey>, RootSignatureHandle> rootsigCache;
+        ShaderCache shaderCache;
         std::vector<D3D12_RESOURCE_BARRIER> barrier;
 
+        StatisticsCollector statistics;
+
         ID3D12Fence* fence;
         HANDLE fenceEvent;
         UINT64 fenceCounter;
 
+        // Frame contexts. waitTime accumulates the time the CPU spent blocked on GPU fences.
+        FrameContextRing frames;
+        double waitTime;
+        double frameWaitTimeStart;
+        double lastFrameStallTime;
+
+        // Residency management. Evicted heaps and committed resources that are used again are collected
+        // in pendingMakeResident and made resident in one batch before the command list is executed.
+        IDXGIAdapter3* adapter;
+        HANDLE budgetChangeEvent;
+        DWORD budgetChangeCookie;
+        std::vector<ID3D12Pageable*> pendingMakeResident;
+        std::vector<ResidencyPolicy::ObjectKey> evictionList;
+
+        // Async compute queue state. Work recorded inside a compute scope goes into computeCommandList,
+        // graphics-only state transitions for the resources it uses are collected in handoffBarrier
+        // and executed on the direct queue before the compute list.
+        ID3D12CommandQueue* computeQueue;
+        ID3D12Fence* computeFence;
+        UINT64 computeFenceCounter;
+        UINT64 computeFenceJoined;
+        bool computeScopeActive;
+        bool computeScopeDemoted;       // the scope is open, but graphics work moved the rest of it to the direct queue
+        bool computeDependency;
+        CommandListHandle computeCommandList;
+        CommandListHandle directCommandList;
+        std::list<CommandListHandle> computeCommandLists;
+        std::vector<D3D12_RESOURCE_BARRIER> handoffBarrier;
+
         ID3D12CommandSignature* drawIndirectSignature;
         ID3D12CommandSignature* dispatchIndirectSignature;
 
@@ -966,9 +1341,26 @@ namespace NVRHI
             , dhSamplerStatic(pParent)
             , dhSamplers(pParent)
             , upload(pParent, constantBuffers)
+            , placedResources(pParent, residency)
             , fence(nullptr)
             , fenceEvent(0)
             , fenceCounter(0)
+            , frames(DEFAULT_FRAMES_IN_FLIGHT)
+            , waitTime(0.0)
+            , frameWaitTimeStart(0.0)
+            , lastFrameStallTime(0.0)
+            , adapter(nullptr)
+            , budgetChangeEvent(0)
+            , budgetChangeCookie(0)
+            , computeQueue(nullptr)
+            , computeFence(nullptr)
+            , computeFenceCounter(0)
+            , computeFenceJoined(0)
+            , computeScopeActive(false)
+            , computeScopeDemoted(false)
+            , computeDependency(false)
+            , computeCommandList(nullptr)
+            , directCommandList(nullptr)
             , drawIndirectSignature(nullptr)
             , dispatchIndirectSignature(nullptr)
             , nullCBV(INVALID_DESCRIPTOR_INDEX)
@@ -1010,16 +1402,22 @@ namespace NVRHI
             for (auto query : perfQueries)
                 delete query;
 
-            for (auto& pair : psoCache)
-                delete pair.second;
-
-            for (auto& pair : rootsigCache)
-                delete pair.second;
+            psoCache.ForEach([](const PodKey<GraphicsPipelineKey>&, PipelineStateHandle pso) { delete pso; });
+            computePsoCache.ForEach([](const PodKey<ComputePipelineKey>&, PipelineStateHandle pso) { delete pso; });
+            rootsigCache.ForEach([](const PodKey<RootSignatureKey>&, RootSignatureHandle rootsig) { delete rootsig; });
 
             for (auto list : commandLists)
                 delete list;
 
+            for (auto list : computeCommandLists)
+                delete list;
+
+            delete computeCommandList;
+            delete directCommandList;
+
             SAFE_RELEASE(fence);
+            SAFE_RELEASE(computeFence);
+            SAFE_RELEASE(computeQueue);
 
             if (fenceEvent)
             {
@@ -1030,17 +1428,87 @@ namespace NVRHI
             SAFE_RELEASE(drawIndirectSignature);
             SAFE_RELEASE(dispatchIndirectSignature);
             SAFE_RELEASE(perfQueryHeap);
+
+            if (adapter && budgetChangeEvent)
+                adapter->UnregisterVideoMemoryBudgetChangeNotification(budgetChangeCookie);
+
+            if (budgetChangeEvent)
+            {
+                CloseHandle(budgetChangeEvent);
+                budgetChangeEvent = 0;
+            }
+
+            SAFE_RELEASE(adapter);
+        }
+
+        // Evicted objects may still be used by command lists in flight, so they go to the deleted pool
+        template<typename Key, typename Object>
+        void CacheObject(StateCache<Key, Object*>& cache, const Key& key, Object* object)
+        {
+            std::vector<Object*> evicted;
+            cache.Insert(key, object, evicted);
+            deletedResources.insert(evicted.begin(), evicted.end());
+        }
+
+        void MakePendingResident()
+        {
+            if (pendingMakeResident.empty())
+                return;
+
+            if (FAILED(parent->m_pDevice->MakeResident(uint32_t(pendingMakeResident.size()), &pendingMakeResident[0])))
+                DEBUG_PRINT("WARNING: MakeResident failed, the GPU is out of memory\n");
+
+            pendingMakeResident.clear();
         }
 
         void SetFence()
         {
             fenceCounter++;
+
+            // Descriptors and upload memory used by the compute queue are only safe to reuse
+            // after a direct queue fence that is ordered after the compute work.
+            if (!computeScopeActive)
+                JoinComputeQueue();
+
             parent->m_pCommandQueue->Signal(fence, fenceCounter);
             
-            dhSRVetc.AddFencePointer(fenceCounter);
-            dhSamplers.AddFencePointer(fenceCounter);
+            if (!computeScopeActive)
+            {
+                dhSRVetc.AddFencePointer(fenceCounter);
+                dhSamplers.AddFencePointer(fenceCounter);
+
+                upload.AddFencePointer(fenceCounter);
+            }
+        }
+
+        void JoinComputeQueue()
+        {
+            if (computeFenceCounter > computeFenceJoined)
+            {
+                parent->m_pCommandQueue->Wait(computeFence, computeFenceCounter);
+                computeFenceJoined = computeFenceCounter;
+            }
+
+            computeDependency = false;
+        }
+
+        void WaitForComputeFence(UINT64 fenceValue, const char* reason)
+        {
+            (void)reason; // unused in non-debug builds
+
+            if (!computeFence || computeFence->GetCompletedValue() >= fenceValue)
+                return;
+
+            computeFence->SetEventOnCompletion(fenceValue, fenceEvent);
+            START_CPU_PERF
+
+            WaitForSingleObject(fenceEvent, INFINITE);
 
-            upload.AddFencePointer(fenceCounter);
+            END_CPU_PERF(time)
+            waitTime += time;
+#ifdef _DEBUG
+            DEBUG_PRINTF("D3D12 RHI: WaitForComputeFence(%llu, %s) took %.3f ms\n", fenceValue, reason, time * 1000.0);
+#endif
         }
 
         void WaitForFence(UINT64 fenceValue, const char* reason)
@@ -1056,14 +1524,13 @@ namespace NVRHI
             if (completed < fenceValue)
             {
                 fence->SetEventOnCompletion(fenceValue, fenceEvent);
-#ifdef _DEBUG
                 START_CPU_PERF
-#endif
 
                 WaitForSingleObject(fenceEvent, INFINITE);
 
-#ifdef _DEBUG
                 END_CPU_PERF(time)
+                waitTime += time;
+#ifdef _DEBUG
                 DEBUG_PRINTF("D3D12 RHI: WaitForFence(%llu, %s) took %.3f ms\n", fenceValue, reason, time * 1000.0);
 #endif
 
@@ -1076,10 +1543,12 @@ namespace NVRHI
 
             upload.ReleaseFences(completed);
 
+            UINT64 computeCompleted = computeFence ? computeFence->GetCompletedValue() : 0;
+
             std::set<ManagedResource*> unreferenced;
             for (auto resource : deletedResources)
             {
-                if (resource->fenceCounterAtLastUse <= completed)
+                if (resource->fenceCounterAtLastUse <= completed && resource->computeFenceCounterAtLastUse <= computeCompleted)
                     unreferenced.insert(resource);
             }
 
@@ -1101,7 +1570,7 @@ namespace NVRHI
         m_pDevice->AddRef();
         m_pCommandQueue->AddRef();
 
-        m_ActiveCommandList = createCommandList();
+        m_ActiveCommandList = createCommandList(false);
 
         D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
         descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
@@ -1139,6 +1608,22 @@ namespace NVRHI
         m_pResources->dhSamplers.AllocateResources(descriptorHeapDesc);
 
         m_pResources->upload.AllocateResources(64 * 1024 * 1024);
+        m_pResources->placedResources.Initialize();
+
+        // The memory budget is reported by the DXGI adapter that the device was created on
+        {
+            IDXGIFactory4* pFactory = nullptr;
+            if (SUCCEEDED(CreateDXGIFactory1(IID_PPV_ARGS(&pFactory))))
+            {
+                if (SUCCEEDED(pFactory->EnumAdapterByLuid(m_pDevice->GetAdapterLuid(), IID_PPV_ARGS(&m_pResources->adapter))))
+                {
+                    m_pResources->budgetChangeEvent = CreateEvent(nullptr, false, true, nullptr);
+                    m_pResources->adapter->RegisterVideoMemoryBudgetChangeNotificationEvent(m_pResources->budgetChangeEvent, &m_pResources->budgetChangeCookie);
+                }
+
+                pFactory->Release();
+            }
+        }
 
         m_pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_pResources->fence));
         m_pResources->fenceEvent = CreateEvent(nullptr, false, false, nullptr);
@@ -1180,153 +1665,579 @@ namespace NVRHI
 
             m_pDevice->CreateUnorderedAccessView(nullptr, nullptr, &descUAV, m_pResources->dhSRVstatic.GetCpuHandle(m_pResources->nullUAV));
 
-            D3D12_SAMPLER_DESC descSampler = {};
-            descSampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-            descSampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-            descSampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+            D3D12_SAMPLER_DESC descSampler = {};
+            descSampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+            descSampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+            descSampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+
+            m_pDevice->CreateSampler(&descSampler, m_pResources->dhSamplerStatic.GetCpuHandle(m_pResources->nullSampler));
+        }
+
+        D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+        queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        queryHeapDesc.Count = 256;
+        m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pResources->perfQueryHeap));
+
+        BufferDesc qbDesc;
+        qbDesc.byteSize = queryHeapDesc.Count * 8;
+        m_pResources->perfQueryResolveBuffer = createBuffer(qbDesc, nullptr);
+
+
+		ID3D12DescriptorHeap* heaps[2] = { m_pResources->dhSRVetc.GetHeap(), m_pResources->dhSamplers.GetHeap() };
+		m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
+    }
+
+    RendererInterfaceD3D12::~RendererInterfaceD3D12()
+    {
+        syncWithGPU("Shutdown");
+        delete m_pResources;
+        delete m_ActiveCommandList;
+        SAFE_RELEASE(m_pDevice);
+        SAFE_RELEASE(m_pCommandQueue);
+    }
+
+    TextureHandle RendererInterfaceD3D12::getHandleForTexture(ID3D12Resource * pResource)
+    {
+        if (pResource == nullptr)
+            return nullptr;
+
+        for (auto texture : m_pResources->textures)
+            if (texture->resource == pResource)
+                return texture;
+
+        D3D12_RESOURCE_DESC desc = pResource->GetDesc();
+        TextureHandle texture = new Texture();
+        texture->isManaged = false;
+        texture->resource = pResource;
+        texture->parent = this;
+        texture->desc.width = uint32_t(desc.Width);
+        texture->desc.height = desc.Height;
+        texture->desc.depthOrArraySize = desc.DepthOrArraySize;
+        texture->desc.mipLevels = desc.MipLevels;
+        texture->desc.sampleCount = desc.SampleDesc.Count;
+        texture->desc.sampleQuality = desc.SampleDesc.Quality;
+        texture->desc.isArray = desc.DepthOrArraySize > 1 && desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        texture->desc.isRenderTarget = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+        texture->desc.isUAV = (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS) != 0;
+
+        for (auto& mapping : FormatMappings)
+            if (mapping.resourceFormat == desc.Format || mapping.srvFormat == desc.Format || mapping.rtvFormat == desc.Format)
+            {
+                texture->desc.format = mapping.abstractFormat;
+                break;
+            }
+
+        CHECK_ERROR(desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D || desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D, "Unsupported unmanaged texture dimension");
+        CHECK_ERROR(texture->desc.format != Format::UNKNOWN, "Unknown unmanaged texture format");
+
+        uint32_t numSubresources = texture->desc.mipLevels;
+        if (texture->desc.isArray)
+            numSubresources *= texture->desc.depthOrArraySize;
+        texture->subresourceStates.resize(numSubresources, D3D12_RESOURCE_STATE_COMMON);
+
+        pResource->AddRef();
+        m_pResources->textures.insert(texture);
+        return texture;
+    }
+
+    void RendererInterfaceD3D12::setNonManagedTextureResourceState(TextureHandle texture, uint32_t state)
+    {
+        for (auto& storedState : texture->subresourceStates)
+            storedState = D3D12_RESOURCE_STATES(state);
+    }
+
+    void RendererInterfaceD3D12::releaseNonManagedTextures()
+    {
+        std::set<TextureHandle> nonManaged;
+
+        for (auto texture : m_pResources->textures)
+            if (!texture->isManaged)
+                nonManaged.insert(texture);
+
+        for (auto texture : nonManaged)
+        {
+            m_pResources->textures.erase(texture);
+            delete texture;
+        }
+    }
+
+    void RendererInterfaceD3D12::flushCommandList()
+    {
+        if (m_pResources->computeScopeActive)
+            submitComputeCommandList();
+        else
+            flushGraphicsCommandList();
+    }
+
+    void RendererInterfaceD3D12::flushGraphicsCommandList()
+    {
+        if (m_ActiveCommandList->size > 0)
+        {
+            // The list uses resources last written or read on the compute queue: wait for it before execution
+            if (m_pResources->computeDependency)
+                m_pResources->JoinComputeQueue();
+
+            m_pResources->MakePendingResident();
+
+            m_ActiveCommandList->commandList->Close();
+            m_ActiveCommandList->fenceCounterAtLastUse = m_pResources->fenceCounter;
+            m_pCommandQueue->ExecuteCommandLists(1, (ID3D12CommandList**)&m_ActiveCommandList->commandList);
+            NVRHI_STAT_ADD(m_pResources->statistics, commandListFlushes, 1);
+            m_pResources->commandLists.push_back(m_ActiveCommandList);
+
+            m_pResources->SetFence();
+
+            UINT64 completedFence = m_pResources->fence->GetCompletedValue();
+            m_ActiveCommandList = m_pResources->commandLists.front();
+
+            if (m_ActiveCommandList->fenceCounterAtLastUse < completedFence)
+            {
+                m_ActiveCommandList->allocator->Reset();
+                m_ActiveCommandList->commandList->Reset(m_ActiveCommandList->allocator, nullptr);
+                m_ActiveCommandList->size = 0;
+                m_pResources->commandLists.pop_front();
+            }
+            else
+            {
+                m_ActiveCommandList = createCommandList(false);
+            }
+
+			m_pResources->currentRS = nullptr;
+			m_pResources->currentPSO = nullptr;
+
+			memset(m_pResources->currentRTVs, 0, sizeof(m_pResources->currentRTVs));
+			memset(m_pResources->currentVBVs, 0, sizeof(m_pResources->currentVBVs));
+			memset(&m_pResources->currentIBV, 0, sizeof(m_pResources->currentIBV));
+			m_pResources->currentDSV.ptr = 0;
+
+			ID3D12DescriptorHeap* heaps[2] = { m_pResources->dhSRVetc.GetHeap(), m_pResources->dhSamplers.GetHeap() };
+			m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
+
+
+            HRESULT hr = m_pDevice->GetDeviceRemovedReason();
+            if (FAILED(hr))
+            {
+                OutputDebugStringA("FATAL ERROR: Device Removed!\n");
+                DebugBreak();
+            }
+        }
+    }
+
+    void RendererInterfaceD3D12::submitComputeCommandList()
+    {
+        CommandListHandle computeList = m_ActiveCommandList;
+
+        // Execute the pending graphics work and the graphics-only state transitions first, then make the compute queue wait for them
+
+        m_ActiveCommandList = m_pResources->directCommandList;
+
+        if (!m_pResources->handoffBarrier.empty())
+        {
+            m_ActiveCommandList->commandList->ResourceBarrier(uint32_t(m_pResources->handoffBarrier.size()), &m_pResources->handoffBarrier[0]);
+            NVRHI_STAT_ADD(m_pResources->statistics, barriers, uint32_t(m_pResources->handoffBarrier.size()));
+            m_ActiveCommandList->size++;
+            m_pResources->handoffBarrier.clear();
+        }
+
+        flushGraphicsCommandList();
+        m_pResources->directCommandList = m_ActiveCommandList;
+        m_ActiveCommandList = computeList;
+
+        if (computeList->size == 0)
+            return;
+
+        m_pResources->computeQueue->Wait(m_pResources->fence, m_pResources->fenceCounter);
+        m_pResources->MakePendingResident();
+
+        computeList->commandList->Close();
+        computeList->fenceCounterAtLastUse = m_pResources->computeFenceCounter;
+        m_pResources->computeQueue->ExecuteCommandLists(1, (ID3D12CommandList**)&computeList->commandList);
+        NVRHI_STAT_ADD(m_pResources->statistics, commandListFlushes, 1);
+        m_pResources->computeCommandLists.push_back(computeList);
+
+        m_pResources->computeFenceCounter++;
+        m_pResources->computeQueue->Signal(m_pResources->computeFence, m_pResources->computeFenceCounter);
+
+        UINT64 completedFence = m_pResources->computeFence->GetCompletedValue();
+        m_ActiveCommandList = m_pResources->computeCommandLists.front();
+
+        if (m_ActiveCommandList->fenceCounterAtLastUse < completedFence)
+        {
+            m_ActiveCommandList->allocator->Reset();
+            m_ActiveCommandList->commandList->Reset(m_ActiveCommandList->allocator, nullptr);
+            m_ActiveCommandList->size = 0;
+            m_pResources->computeCommandLists.pop_front();
+        }
+        else
+        {
+            m_ActiveCommandList = createCommandList(true);
+        }
+
+        m_pResources->currentRS = nullptr;
+        m_pResources->currentPSO = nullptr;
+
+        ID3D12DescriptorHeap* heaps[2] = { m_pResources->dhSRVetc.GetHeap(), m_pResources->dhSamplers.GetHeap() };
+        m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
+    }
+
+    void RendererInterfaceD3D12::loadBalanceCommandList()
+    {
+        if (m_ActiveCommandList->size > MAX_COMMANDS_IN_LIST)
+            flushCommandList();
+    }
+
+    void RendererInterfaceD3D12::setMaxFramesInFlight(uint32_t count)
+    {
+        FrameContextRing& frames = m_pResources->frames;
+        uint32_t previous = frames.GetMaxFramesInFlight();
+        frames.SetMaxFramesInFlight(count);
+
+        // FrameBeginInfo::frameIndex is taken modulo the limit, so after a change the same index can refer to
+        // a frame that is still in flight; let the GPU finish all submitted frames before the indices move
+        if (frames.GetMaxFramesInFlight() != previous && frames.GetFrameNumber() > 0)
+        {
+            UINT64 fenceToWait = frames.GetFrame(frames.GetFrameNumber() - 1).fenceValue;
+            if (fenceToWait > 0)
+                m_pResources->WaitForFence(fenceToWait, "SetMaxFramesInFlight");
+        }
+    }
+
+    uint32_t RendererInterfaceD3D12::getMaxFramesInFlight()
+    {
+        return m_pResources->frames.GetMaxFramesInFlight();
+    }
+
+    FrameBeginInfo RendererInterfaceD3D12::beginFrame()
+    {
+        FrameBeginInfo info;
+        FrameContextRing& frames = m_pResources->frames;
+
+        if (frames.IsRecording())
+        {
+            SIGNAL_ERROR("beginFrame called twice without endFrame");
+            return info;
+        }
+
+        // Block until the GPU has finished the frame that is maxFramesInFlight frames behind
+        double waitTimeBefore = m_pResources->waitTime;
+
+        UINT64 fenceToWait = frames.GetFenceToWait();
+        if (fenceToWait > 0)
+            m_pResources->WaitForFence(fenceToWait, "BeginFrame");
+
+        info.cpuBlockedTime = m_pResources->waitTime - waitTimeBefore;
+
+        frames.BeginFrame(m_pResources->upload.GetTotalAllocated(), m_pResources->dhSRVetc.GetTotalAllocated());
+        m_pResources->frameWaitTimeStart = m_pResources->waitTime;
+
+        info.frameNumber = frames.GetFrameNumber();
+        info.frameIndex = uint32_t(info.frameNumber % frames.GetMaxFramesInFlight());
+        info.framesInFlight = frames.GetFramesInFlight(m_pResources->fence->GetCompletedValue());
+
+        if (info.frameNumber > 0)
+        {
+            const FrameContextRing::FrameContext& previous = frames.GetFrame(info.frameNumber - 1);
+            info.previousFrameStallTime = m_pResources->lastFrameStallTime;
+            info.previousFrameUploadBytes = previous.uploadBytes;
+            info.previousFrameDescriptors = previous.numDescriptors;
+        }
+
+        return info;
+    }
+
+    void RendererInterfaceD3D12::endFrame()
+    {
+        FrameContextRing& frames = m_pResources->frames;
+
+        if (!frames.IsRecording())
+        {
+            SIGNAL_ERROR("endFrame called without beginFrame");
+            return;
+        }
+
+        if (m_pResources->computeScopeActive || m_pResources->computeScopeDemoted)
+        {
+            SIGNAL_ERROR("endFrame cannot be called inside a compute queue scope");
+            return;
+        }
+
+        flushCommandList();
+
+        // Compute work submitted after the last direct queue signal is not covered by fenceCounter:
+        // this happens when the frame ends with a compute scope and no graphics work after it
+        if (m_pResources->computeFenceCounter > m_pResources->computeFenceJoined)
+            m_pResources->SetFence();
+
+        // Otherwise, if the command list was empty, the last signaled fence value already covers all work of the frame
+        const FrameContextRing::FrameContext& frame = frames.EndFrame(m_pResources->fenceCounter, 
+            m_pResources->upload.GetTotalAllocated(), m_pResources->dhSRVetc.GetTotalAllocated());
+
+        m_pResources->lastFrameStallTime = m_pResources->waitTime - m_pResources->frameWaitTimeStart;
+
+        // The rings are shared by all frames in flight; if one frame uses more than its share, recording will stall on them
+        uint32_t maxFrames = frames.GetMaxFramesInFlight();
+
+        if (frame.uploadBytes * maxFrames > m_pResources->upload.GetSize())
+            DEBUG_PRINTF("WARNING: frame %llu used %llu bytes of upload memory, more than 1/%u of the upload ring\n", frame.frameNumber, frame.uploadBytes, maxFrames);
+
+        if (UINT64(frame.numDescriptors) * maxFrames > m_pResources->dhSRVetc.GetNumDescriptors())
+            DEBUG_PRINTF("WARNING: frame %llu used %u descriptors, more than 1/%u of the descriptor heap\n", frame.frameNumber, frame.numDescriptors, maxFrames);
+    }
+
+    HeapAllocatorStats RendererInterfaceD3D12::getHeapAllocatorStats()
+    {
+        return m_pResources->placedResources.GetStats();
+    }
+
+    uint32_t RendererInterfaceD3D12::createTransientRegion(uint64_t sizeBytes)
+    {
+        return m_pResources->placedResources.CreateTransientRegion(sizeBytes);
+    }
 
-            m_pDevice->CreateSampler(&descSampler, m_pResources->dhSamplerStatic.GetCpuHandle(m_pResources->nullSampler));
-        }
+    void RendererInterfaceD3D12::destroyTransientRegion(uint32_t region)
+    {
+        m_pResources->placedResources.DestroyTransientRegion(region);
+    }
 
-        D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
-        queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-        queryHeapDesc.Count = 256;
-        m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pResources->perfQueryHeap));
+    void RendererInterfaceD3D12::setActiveTransientRegion(uint32_t region)
+    {
+        CHECK_ERROR(m_pResources->placedResources.SetActiveTransientRegion(region), "Invalid transient region");
+    }
 
-        BufferDesc qbDesc;
-        qbDesc.byteSize = queryHeapDesc.Count * 8;
-        m_pResources->perfQueryResolveBuffer = createBuffer(qbDesc, nullptr);
+    void RendererInterfaceD3D12::activateAliasedResource(TextureHandle texture)
+    {
+        if (texture->heapAllocation.transientRegion == 0)
+            return;
 
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+        barrier.Aliasing.pResourceBefore = nullptr;
+        barrier.Aliasing.pResourceAfter = texture->resource;
+        m_pResources->barrier.push_back(barrier);
 
-		ID3D12DescriptorHeap* heaps[2] = { m_pResources->dhSRVetc.GetHeap(), m_pResources->dhSamplers.GetHeap() };
-		m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
+        if (texture->desc.isRenderTarget)
+            discardPlacedTexture(texture);
+        else
+            commitBarriers();
     }
 
-    RendererInterfaceD3D12::~RendererInterfaceD3D12()
+    void RendererInterfaceD3D12::activateAliasedResource(BufferHandle buffer)
     {
-        syncWithGPU("Shutdown");
-        delete m_pResources;
-        delete m_ActiveCommandList;
-        SAFE_RELEASE(m_pDevice);
-        SAFE_RELEASE(m_pCommandQueue);
+        if (buffer->heapAllocation.transientRegion == 0)
+            return;
+
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+        barrier.Aliasing.pResourceBefore = nullptr;
+        barrier.Aliasing.pResourceAfter = buffer->resource;
+        m_pResources->barrier.push_back(barrier);
+
+        commitBarriers();
     }
 
-    TextureHandle RendererInterfaceD3D12::getHandleForTexture(ID3D12Resource * pResource)
+    void RendererInterfaceD3D12::discardPlacedTexture(TextureHandle texture)
     {
-        if (pResource == nullptr)
-            return nullptr;
+        const auto& formatMapping = GetFormatMapping(texture->desc.format);
 
-        for (auto texture : m_pResources->textures)
-            if (texture->resource == pResource)
-                return texture;
+        requireTextureState(texture, ~0u, ~0u, formatMapping.isDepthStencil ? D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_RENDER_TARGET);
+        commitBarriers();
 
-        D3D12_RESOURCE_DESC desc = pResource->GetDesc();
-        TextureHandle texture = new Texture();
-        texture->isManaged = false;
-        texture->resource = pResource;
-        texture->parent = this;
-        texture->desc.width = uint32_t(desc.Width);
-        texture->desc.height = desc.Height;
-        texture->desc.depthOrArraySize = desc.DepthOrArraySize;
-        texture->desc.mipLevels = desc.MipLevels;
-        texture->desc.sampleCount = desc.SampleDesc.Count;
-        texture->desc.sampleQuality = desc.SampleDesc.Quality;
-        texture->desc.isArray = desc.DepthOrArraySize > 1 && desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-        texture->desc.isRenderTarget = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
-        texture->desc.isUAV = (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS) != 0;
+        m_ActiveCommandList->commandList->DiscardResource(texture->resource, nullptr);
+        m_ActiveCommandList->size++;
+    }
 
-        for (auto& mapping : FormatMappings)
-            if (mapping.resourceFormat == desc.Format || mapping.srvFormat == desc.Format || mapping.rtvFormat == desc.Format)
-            {
-                texture->desc.format = mapping.abstractFormat;
-                break;
-            }
+    void RendererInterfaceD3D12::releaseHeapAllocation(const HeapAllocation& allocation)
+    {
+        m_pResources->placedResources.Free(allocation);
+    }
 
-        CHECK_ERROR(desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D || desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D, "Unsupported unmanaged texture dimension");
-        CHECK_ERROR(texture->desc.format != Format::UNKNOWN, "Unknown unmanaged texture format");
+    void RendererInterfaceD3D12::trackResidency(const HeapAllocation& allocation)
+    {
+        if (!allocation.pageable)
+            return;
 
-        uint32_t numSubresources = texture->desc.mipLevels;
-        if (texture->desc.isArray)
-            numSubresources *= texture->desc.depthOrArraySize;
-        texture->subresourceStates.resize(numSubresources, D3D12_RESOURCE_STATE_COMMON);
+        // The resource is pinned until the fence that follows the current command list completes
+        if (m_pResources->residency.MarkUsed(allocation.pageable, m_pResources->fenceCounter + 1))
+            m_pResources->pendingMakeResident.push_back(allocation.pageable);
+    }
 
-        pResource->AddRef();
-        m_pResources->textures.insert(texture);
-        return texture;
+    void RendererInterfaceD3D12::setPipelineCacheCapacity(uint32_t maxPipelineStates)
+    {
+        std::vector<PipelineStateHandle> evicted;
+        m_pResources->psoCache.SetCapacity(maxPipelineStates, evicted);
+        m_pResources->computePsoCache.SetCapacity(maxPipelineStates, evicted);
+        m_pResources->deletedResources.insert(evicted.begin(), evicted.end());
     }
 
-    void RendererInterfaceD3D12::setNonManagedTextureResourceState(TextureHandle texture, uint32_t state)
+    StateCacheStats RendererInterfaceD3D12::getPipelineCacheStats()
     {
-        for (auto& storedState : texture->subresourceStates)
-            storedState = D3D12_RESOURCE_STATES(state);
+        StateCacheStats stats = m_pResources->psoCache.GetStats();
+        stats += m_pResources->computePsoCache.GetStats();
+        stats += m_pResources->rootsigCache.GetStats();
+        return stats;
     }
 
-    void RendererInterfaceD3D12::releaseNonManagedTextures()
+    ShaderCacheStats RendererInterfaceD3D12::getShaderCacheStats()
     {
-        std::set<TextureHandle> nonManaged;
+        return m_pResources->shaderCache.GetStats();
+    }
 
-        for (auto texture : m_pResources->textures)
-            if (!texture->isManaged)
-                nonManaged.insert(texture);
+    ResidencyReport RendererInterfaceD3D12::updateResidency()
+    {
+        ResidencyReport report;
 
-        for (auto texture : nonManaged)
+        if (m_pResources->computeScopeActive)
         {
-            m_pResources->textures.erase(texture);
-            delete texture;
+            SIGNAL_ERROR("updateResidency cannot be called inside a compute queue scope");
+            return report;
         }
-    }
 
-    void RendererInterfaceD3D12::flushCommandList()
-    {
-        if (m_ActiveCommandList->size > 0)
+        if (m_pResources->adapter)
         {
-            m_ActiveCommandList->commandList->Close();
-            m_ActiveCommandList->fenceCounterAtLastUse = m_pResources->fenceCounter;
-            m_pCommandQueue->ExecuteCommandLists(1, (ID3D12CommandList**)&m_ActiveCommandList->commandList);
-            m_pResources->commandLists.push_back(m_ActiveCommandList);
+            report.budgetChanged = m_pResources->budgetChangeEvent && WaitForSingleObject(m_pResources->budgetChangeEvent, 0) == WAIT_OBJECT_0;
 
-            m_pResources->SetFence();
+            DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo = {};
+            if (SUCCEEDED(m_pResources->adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo)))
+            {
+                report.budgetBytes = memoryInfo.Budget;
+                report.usageBytes = memoryInfo.CurrentUsage;
+            }
+        }
+
+        // Objects used by the compute queue are not tracked on the direct queue timeline, so skip eviction while it is busy
+        bool computeIdle = !m_pResources->computeFence || m_pResources->computeFence->GetCompletedValue() >= m_pResources->computeFenceCounter;
 
+        if (report.budgetBytes > 0 && computeIdle)
+        {
+            // Evict down to 90% of the budget so that small allocations don't cause an eviction every frame
             UINT64 completedFence = m_pResources->fence->GetCompletedValue();
-            m_ActiveCommandList = m_pResources->commandLists.front();
+            UINT64 targetUsage = report.budgetBytes - report.budgetBytes / 10;
 
-            if (m_ActiveCommandList->fenceCounterAtLastUse < completedFence)
-            {
-                m_ActiveCommandList->allocator->Reset();
-                m_ActiveCommandList->commandList->Reset(m_ActiveCommandList->allocator, nullptr);
-                m_ActiveCommandList->size = 0;
-                m_pResources->commandLists.pop_front();
-            }
-            else
+            m_pResources->evictionList.clear();
+            m_pResources->residency.SelectEvictions(report.usageBytes, targetUsage, completedFence, MAX_EVICTIONS_PER_FRAME, m_pResources->evictionList);
+
+            if (!m_pResources->evictionList.empty())
             {
-                m_ActiveCommandList = createCommandList();
+                std::vector<ID3D12Pageable*> pageables;
+                for (auto key : m_pResources->evictionList)
+                    pageables.push_back((ID3D12Pageable*)key);
+
+                m_pDevice->Evict(uint32_t(pageables.size()), &pageables[0]);
             }
+        }
 
-			m_pResources->currentRS = nullptr;
-			m_pResources->currentPSO = nullptr;
+        const ResidencyPolicy& residency = m_pResources->residency;
+        report.residentBytes = residency.GetResidentBytes();
+        report.evictedBytes = residency.GetEvictedBytes();
+        report.numResidentObjects = residency.GetNumResident();
+        report.numEvictedObjects = residency.GetNumEvicted();
+        report.numPinnedObjects = residency.GetNumPinned();
+        report.numEvictionsThisFrame = residency.GetFrameEvictions();
+        report.bytesEvictedThisFrame = residency.GetFrameEvictedBytes();
+        report.numMadeResidentThisFrame = residency.GetFrameMadeResident();
+        report.bytesMadeResidentThisFrame = residency.GetFrameMadeResidentBytes();
 
-			memset(m_pResources->currentRTVs, 0, sizeof(m_pResources->currentRTVs));
-			memset(m_pResources->currentVBVs, 0, sizeof(m_pResources->currentVBVs));
-			memset(&m_pResources->currentIBV, 0, sizeof(m_pResources->currentIBV));
-			m_pResources->currentDSV.ptr = 0;
+        m_pResources->residency.ResetFrameCounters();
 
-			ID3D12DescriptorHeap* heaps[2] = { m_pResources->dhSRVetc.GetHeap(), m_pResources->dhSamplers.GetHeap() };
-			m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
+        return report;
+    }
+
+    void RendererInterfaceD3D12::beginComputeQueueScope()
+    {
+        if (m_pResources->computeScopeActive || m_pResources->computeScopeDemoted)
+        {
+            SIGNAL_ERROR("Compute queue scopes cannot be nested");
+            return;
+        }
 
+        if (!m_pResources->computeQueue)
+        {
+            D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
 
-            HRESULT hr = m_pDevice->GetDeviceRemovedReason();
-            if (FAILED(hr))
+            if (FAILED(m_pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_pResources->computeQueue))) ||
+                FAILED(m_pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_pResources->computeFence))))
             {
-                OutputDebugStringA("FATAL ERROR: Device Removed!\n");
-                DebugBreak();
+                SAFE_RELEASE(m_pResources->computeQueue);
+                SIGNAL_ERROR("Failed to create the compute queue");
+                return;
             }
+
+            m_pResources->computeCommandList = createCommandList(true);
         }
+
+        // Pending barriers belong to the graphics work recorded before the scope
+        commitBarriers();
+
+        m_pResources->directCommandList = m_ActiveCommandList;
+        m_ActiveCommandList = m_pResources->computeCommandList;
+        m_pResources->computeCommandList = nullptr;
+        m_pResources->computeScopeActive = true;
+
+        m_pResources->currentRS = nullptr;
+        m_pResources->currentPSO = nullptr;
+
+        ID3D12DescriptorHeap* heaps[2] = { m_pResources->dhSRVetc.GetHeap(), m_pResources->dhSamplers.GetHeap() };
+        m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
     }
 
-    void RendererInterfaceD3D12::loadBalanceCommandList()
+    void RendererInterfaceD3D12::endComputeQueueScope()
     {
-        if (m_ActiveCommandList->size > MAX_COMMANDS_IN_LIST)
-            flushCommandList();
+        if (m_pResources->computeScopeDemoted)
+        {
+            m_pResources->computeScopeDemoted = false;
+            return;
+        }
+
+        if (!m_pResources->computeScopeActive)
+        {
+            SIGNAL_ERROR("No compute queue scope is active");
+            return;
+        }
+
+        commitBarriers();
+        submitComputeCommandList();
+
+        // The graphics list is not joined with the compute queue here, so that graphics work
+        // submitted after the scope can overlap with the compute work until it touches a shared resource
+
+        m_pResources->computeCommandList = m_ActiveCommandList;
+        m_ActiveCommandList = m_pResources->directCommandList;
+        m_pResources->directCommandList = nullptr;
+        m_pResources->computeScopeActive = false;
+
+        m_pResources->currentRS = nullptr;
+        m_pResources->currentPSO = nullptr;
+    }
+
+    void RendererInterfaceD3D12::demoteComputeQueueScope()
+    {
+        // Code inside the scope may not know that it is there, like VXGI calls wrapped by the application.
+        // Rather than dropping its graphics work, submit the compute work recorded so far and run the rest in order.
+        endComputeQueueScope();
+        m_pResources->computeScopeDemoted = true;
+
+        static bool reported = false;
+        if (!reported)
+        {
+            DEBUG_PRINT("WARNING: graphics work inside a compute queue scope, the rest of the scope runs on the direct queue\n");
+            reported = true;
+        }
+    }
+
+    bool RendererInterfaceD3D12::setEnableStatistics(bool enable)
+    {
+        return m_pResources->statistics.SetEnabled(enable);
+    }
+
+    void RendererInterfaceD3D12::endStatisticsFrame()
+    {
+        m_pResources->statistics.EndFrame();
+    }
+
+    bool RendererInterfaceD3D12::getFrameStatistics(RendererStatistics& stats)
+    {
+        return m_pResources->statistics.GetLastFrame(stats);
     }
 
     void RendererInterfaceD3D12::signalError(const char * file, int line, const char * errorDesc)
@@ -1334,12 +2245,13 @@ namespace NVRHI
         m_pErrorCallback->signalError(file, line, errorDesc);
     }
 
-    CommandListHandle RendererInterfaceD3D12::createCommandList()
+    CommandListHandle RendererInterfaceD3D12::createCommandList(bool computeQueue)
     {
         CommandListHandle commandList = new CommandList();
 
-        m_pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandList->allocator));
-        m_pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandList->allocator, nullptr, IID_PPV_ARGS(&commandList->commandList));
+        D3D12_COMMAND_LIST_TYPE type = computeQueue ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT;
+        m_pDevice->CreateCommandAllocator(type, IID_PPV_ARGS(&commandList->allocator));
+        m_pDevice->CreateCommandList(0, type, commandList->allocator, nullptr, IID_PPV_ARGS(&commandList->commandList));
 
         return commandList;
     }
@@ -1366,48 +2278,56 @@ namespace NVRHI
         return sampleDesc;
     }
 
-    uint32_t RendererInterfaceD3D12::getStateHashForRS(const DrawCallState & state)
-    {
-        CrcHash hash;
-
-        hash.Add(state.VS.shader);
-        hash.Add(state.HS.shader);
-        hash.Add(state.DS.shader);
-        hash.Add(state.GS.shader);
-        hash.Add(state.PS.shader);
-
-        return hash.Get();
-    }
-
-    uint32_t RendererInterfaceD3D12::getComputeStateHash(const DispatchState & state)
+    static void getRootSignatureKey(const DrawCallState & state, RootSignatureKey& key)
     {
-        CrcHash hash;
-
-        hash.Add(state.shader);
-
-        return hash.Get();
+        key.shaders[0] = state.VS.shader;
+        key.shaders[1] = state.HS.shader;
+        key.shaders[2] = state.DS.shader;
+        key.shaders[3] = state.GS.shader;
+        key.shaders[4] = state.PS.shader;
+        key.allowInputLayout = state.inputLayout != nullptr;
     }
 
-    uint32_t RendererInterfaceD3D12::getStateHashForPSO(const DrawCallState & state)
+    static void getPipelineStateKey(const DrawCallState & state, const DXGI_SAMPLE_DESC& sampleDesc, GraphicsPipelineKey& key)
     {
-        CrcHash hash;
-
-        hash.Add(state.VS.shader);
-        hash.Add(state.HS.shader);
-        hash.Add(state.DS.shader);
-        hash.Add(state.GS.shader);
-        hash.Add(state.PS.shader);
-        hash.Add(state.renderState.blendState);
-        hash.Add(state.renderState.depthStencilState);
-        hash.Add(state.renderState.rasterState);
-        hash.Add(state.primType);
-        hash.Add(state.inputLayout);
-        hash.Add(state.renderState.depthTarget ? state.renderState.depthTarget->desc.format : Format::UNKNOWN);
-        for (uint32_t target = 0; target < 8; target++)
-            hash.Add(state.renderState.targets[target] ? state.renderState.targets[target]->desc.format : Format::UNKNOWN);
-        hash.Add(getStateSampleDesc(state));
-
-        return hash.Get();
+        key.shaders[0] = state.VS.shader;
+        key.shaders[1] = state.HS.shader;
+        key.shaders[2] = state.DS.shader;
+        key.shaders[3] = state.GS.shader;
+        key.shaders[4] = state.PS.shader;
+        key.inputLayout = state.inputLayout;
+
+        // Blend and depth-stencil states have explicit padding; the blend factor and the stencil reference
+        // are not part of the pipeline state
+        memcpy(&key.blendState, &state.renderState.blendState, sizeof(BlendState));
+        key.blendState.blendFactor = Color(0.f);
+        memcpy(&key.depthStencilState, &state.renderState.depthStencilState, sizeof(DepthStencilState));
+        key.depthStencilState.stencilRefValue = 0;
+
+        // The raster state has implicit padding, so copy it field by field
+        const RasterState& rasterState = state.renderState.rasterState;
+        key.rasterState.fillMode = rasterState.fillMode;
+        key.rasterState.cullMode = rasterState.cullMode;
+        key.rasterState.frontCounterClockwise = rasterState.frontCounterClockwise;
+        key.rasterState.depthClipEnable = rasterState.depthClipEnable;
+        key.rasterState.scissorEnable = rasterState.scissorEnable;
+        key.rasterState.multisampleEnable = rasterState.multisampleEnable;
+        key.rasterState.antialiasedLineEnable = rasterState.antialiasedLineEnable;
+        key.rasterState.depthBias = rasterState.depthBias;
+        key.rasterState.depthBiasClamp = rasterState.depthBiasClamp;
+        key.rasterState.slopeScaledDepthBias = rasterState.slopeScaledDepthBias;
+        key.rasterState.forcedSampleCount = rasterState.forcedSampleCount;
+        key.rasterState.programmableSamplePositionsEnable = rasterState.programmableSamplePositionsEnable;
+        key.rasterState.conservativeRasterEnable = rasterState.conservativeRasterEnable;
+        memcpy(key.rasterState.samplePositionsX, rasterState.samplePositionsX, sizeof(rasterState.samplePositionsX));
+        memcpy(key.rasterState.samplePositionsY, rasterState.samplePositionsY, sizeof(rasterState.samplePositionsY));
+
+        key.primType = state.primType;
+        key.depthFormat = state.renderState.depthTarget ? state.renderState.depthTarget->desc.format : Format::UNKNOWN;
+        for (uint32_t target = 0; target < state.renderState.targetCount; target++)
+            key.targetFormats[target] = state.renderState.targets[target] ? state.renderState.targets[target]->desc.format : Format::UNKNOWN;
+        key.sampleCount = sampleDesc.Count;
+        key.sampleQuality = sampleDesc.Quality;
     }
 
     D3D12_SHADER_VISIBILITY convertShaderStage(ShaderType::Enum s)
@@ -1527,12 +2447,13 @@ namespace NVRHI
 
     RootSignatureHandle RendererInterfaceD3D12::getRootSignature(const DrawCallState & state)
     {
-        uint32_t hash = getStateHashForRS(state);
+        PodKey<RootSignatureKey> key;
+        getRootSignatureKey(state, key.value);
 
-        RootSignatureHandle rootsig = m_pResources->rootsigCache[hash];
+        RootSignatureHandle* cachedRootsig = m_pResources->rootsigCache.Find(key);
             
-        if (rootsig)
-            return rootsig;
+        if (cachedRootsig)
+            return *cachedRootsig;
 
         ShaderHandle shaders[5] = { 
             state.VS.shader, 
@@ -1541,22 +2462,29 @@ namespace NVRHI
             state.GS.shader, 
             state.PS.shader
         };
-        rootsig = buildRootSignature(5, shaders, state.inputLayout != nullptr);
+        RootSignatureHandle rootsig = buildRootSignature(5, shaders, state.inputLayout != nullptr);
+
+        if (rootsig)
+            m_pResources->CacheObject(m_pResources->rootsigCache, key, rootsig);
 
-        m_pResources->rootsigCache[hash] = rootsig;
         return rootsig;
     }
 
-    RootSignatureHandle RendererInterfaceD3D12::getRootSignature(const DispatchState & state, uint32_t hash)
+    RootSignatureHandle RendererInterfaceD3D12::getRootSignature(const DispatchState & state)
     {
-        RootSignatureHandle rootsig = m_pResources->rootsigCache[hash];
+        PodKey<RootSignatureKey> key;
+        key.value.shaders[0] = state.shader;
 
-        if (rootsig)
-            return rootsig;
+        RootSignatureHandle* cachedRootsig = m_pResources->rootsigCache.Find(key);
+
+        if (cachedRootsig)
+            return *cachedRootsig;
+
+        RootSignatureHandle rootsig = buildRootSignature(1, &state.shader, false);
 
-        rootsig = buildRootSignature(1, &state.shader, false);
+        if (rootsig)
+            m_pResources->CacheObject(m_pResources->rootsigCache, key, rootsig);
 
-        m_pResources->rootsigCache[hash] = rootsig;
         return rootsig;
     }
 
@@ -1700,14 +2628,17 @@ namespace NVRHI
 
     PipelineStateHandle RendererInterfaceD3D12::getPipelineState(const DrawCallState & state, RootSignatureHandle pRS)
     {
-        uint32_t hash = getStateHashForPSO(state);
+        PodKey<GraphicsPipelineKey> key;
+        getPipelineStateKey(state, getStateSampleDesc(state), key.value);
 
-        PipelineStateHandle pipelineState = m_pResources->psoCache[hash];
+        PipelineStateHandle* cachedPipelineState = m_pResources->psoCache.Find(key);
 
-        if (pipelineState)
-            return pipelineState;
+        if (cachedPipelineState)
+            return *cachedPipelineState;
 
-        pipelineState = new PipelineState();
+        NVRHI_STAT_ADD(m_pResources->statistics, stateCacheMisses, 1);
+
+        PipelineStateHandle pipelineState = new PipelineState();
         pipelineState->rootSignature = pRS;
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
@@ -1868,7 +2799,7 @@ namespace NVRHI
                 return nullptr;
             }
 
-            m_pResources->psoCache[hash] = pipelineState;
+            m_pResources->CacheObject(m_pResources->psoCache, key, pipelineState);
             return pipelineState;
         }
 #endif
@@ -1882,18 +2813,23 @@ namespace NVRHI
             return nullptr;
         }
 
-        m_pResources->psoCache[hash] = pipelineState;
+        m_pResources->CacheObject(m_pResources->psoCache, key, pipelineState);
         return pipelineState;
     }
 
-    PipelineStateHandle RendererInterfaceD3D12::getPipelineState(const DispatchState & state, RootSignatureHandle pRS, uint32_t hash)
+    PipelineStateHandle RendererInterfaceD3D12::getPipelineState(const DispatchState & state, RootSignatureHandle pRS)
     {
-        PipelineStateHandle pipelineState = m_pResources->psoCache[hash];
+        PodKey<ComputePipelineKey> key;
+        key.value.shader = state.shader;
 
-        if (pipelineState)
-            return pipelineState;
+        PipelineStateHandle* cachedPipelineState = m_pResources->computePsoCache.Find(key);
 
-        pipelineState = new PipelineState();
+        if (cachedPipelineState)
+            return *cachedPipelineState;
+
+        NVRHI_STAT_ADD(m_pResources->statistics, stateCacheMisses, 1);
+
+        PipelineStateHandle pipelineState = new PipelineState();
         pipelineState->rootSignature = pRS;
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
@@ -1912,7 +2848,7 @@ namespace NVRHI
                 return nullptr;
             }
 
-            m_pResources->psoCache[hash] = pipelineState;
+            m_pResources->CacheObject(m_pResources->computePsoCache, key, pipelineState);
             return pipelineState;
         }
 #endif
@@ -1926,7 +2862,7 @@ namespace NVRHI
             return nullptr;
         }
 
-        m_pResources->psoCache[hash] = pipelineState;
+        m_pResources->CacheObject(m_pResources->computePsoCache, key, pipelineState);
         return pipelineState;
     }
 
@@ -1936,6 +2872,7 @@ namespace NVRHI
         {
             UINT64 offset = m_pResources->upload.SuballocateBuffer(cbuffer->alignedSize);
             memcpy(m_pResources->upload.GetCpuVA(offset), &cbuffer->data[0], cbuffer->data.size());
+            NVRHI_STAT_UPLOAD(m_pResources->statistics, cbuffer->data.size());
             cbuffer->currentVersionOffset = offset;
             cbuffer->uploadedDataValid = true;
 
@@ -2367,11 +3304,54 @@ namespace NVRHI
         m_pResources->deletedResources.insert(resource);
     }
 
+    // Resource states that can be used in transitions recorded on a compute command list
+    static bool IsComputeQueueState(D3D12_RESOURCE_STATES state)
+    {
+        const D3D12_RESOURCE_STATES computeStates = 
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER |
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+            D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT |
+            D3D12_RESOURCE_STATE_COPY_DEST |
+            D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+        return (state & ~computeStates) == 0;
+    }
+
+    static D3D12_RESOURCE_STATES GetComputeQueueState(D3D12_RESOURCE_STATES state)
+    {
+        if (state & D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+            state = (state & ~D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE) | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+        return state;
+    }
+
+    void RendererInterfaceD3D12::trackComputeQueueUse(ManagedResource* resource)
+    {
+        if (m_pResources->computeScopeActive)
+            resource->computeFenceCounterAtLastUse = m_pResources->computeFenceCounter + 1;
+        else if (resource->computeFenceCounterAtLastUse > m_pResources->computeFenceJoined)
+            m_pResources->computeDependency = true;
+    }
+
+    void RendererInterfaceD3D12::addTransitionBarrier(const D3D12_RESOURCE_BARRIER& barrier)
+    {
+        // Transitions from graphics-only states cannot be recorded on a compute list, execute them on the direct queue instead
+        if (m_pResources->computeScopeActive && !IsComputeQueueState(barrier.Transition.StateBefore))
+            m_pResources->handoffBarrier.push_back(barrier);
+        else
+            m_pResources->barrier.push_back(barrier);
+    }
+
     void RendererInterfaceD3D12::requireTextureState(TextureHandle texture, uint32_t arrayIndex, uint32_t mipLevel, uint32_t state)
     {
         texture->fenceCounterAtLastUse = m_pResources->fenceCounter;
+        trackComputeQueueUse(texture);
+        trackResidency(texture->heapAllocation);
 
         D3D12_RESOURCE_STATES d3dstate = D3D12_RESOURCE_STATES(state);
+        if (m_pResources->computeScopeActive)
+            d3dstate = GetComputeQueueState(d3dstate);
 
         bool isArray = texture->desc.isArray || texture->desc.isCubeMap;
         bool wholeArray = arrayIndex >= texture->desc.depthOrArraySize;
@@ -2397,7 +3377,7 @@ namespace NVRHI
                     barrier.Transition.StateBefore = texture->subresourceStates[subresource];
                     barrier.Transition.StateAfter = d3dstate;
                     barrier.Transition.Subresource = subresource;
-                    m_pResources->barrier.push_back(barrier);
+                    addTransitionBarrier(barrier);
                 }
                 else if (d3dstate == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && !anyUavBarrier && (texture->enableUavBarriers || !texture->firstUavBarrierPlaced))
                 {
@@ -2417,8 +3397,12 @@ namespace NVRHI
     void RendererInterfaceD3D12::requireBufferState(BufferHandle buffer, uint32_t state)
     {
         buffer->fenceCounterAtLastUse = m_pResources->fenceCounter;
+        trackComputeQueueUse(buffer);
+        trackResidency(buffer->heapAllocation);
 
         D3D12_RESOURCE_STATES d3dstate = D3D12_RESOURCE_STATES(state);
+        if (m_pResources->computeScopeActive)
+            d3dstate = GetComputeQueueState(d3dstate);
 
         if (buffer->state != d3dstate)
         {
@@ -2428,7 +3412,7 @@ namespace NVRHI
             barrier.Transition.StateBefore = buffer->state;
             barrier.Transition.StateAfter = d3dstate;
             barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-            m_pResources->barrier.push_back(barrier);
+            addTransitionBarrier(barrier);
         }
         else if (d3dstate == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && (buffer->enableUavBarriers || !buffer->firstUavBarrierPlaced))
         {
@@ -2447,6 +3431,8 @@ namespace NVRHI
         if (m_pResources->barrier.empty())
             return;
 
+        NVRHI_STAT_ADD(m_pResources->statistics, barriers, uint32_t(m_pResources->barrier.size()));
+
 #if 1
         m_ActiveCommandList->commandList->ResourceBarrier(uint32_t(m_pResources->barrier.size()), &m_pResources->barrier[0]);
 #else
@@ -2599,6 +3585,7 @@ namespace NVRHI
             D3D12_CPU_DESCRIPTOR_HANDLE baseDescriptor = m_pResources->dhSRVetc.GetCpuHandle(baseDescriptorIndex);
 
             m_pDevice->CopyDescriptors(1, &baseDescriptor, &stage.shader->numBindings, stage.shader->numBindings, copySources, nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+            NVRHI_STAT_ADD(m_pResources->statistics, descriptorCopies, stage.shader->numBindings);
 
             ((D3D12_GPU_DESCRIPTOR_HANDLE*)rootDescriptorTableHandles)[rootIndex] = m_pResources->dhSRVetc.GetGpuHandle(baseDescriptorIndex);
             rootIndex++;
@@ -2639,6 +3626,7 @@ namespace NVRHI
             D3D12_CPU_DESCRIPTOR_HANDLE baseDescriptor = m_pResources->dhSamplers.GetCpuHandle(baseDescriptorIndex);
 
             m_pDevice->CopyDescriptors(1, &baseDescriptor, &stage.shader->numSamplers, stage.shader->numSamplers, copySources, nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+            NVRHI_STAT_ADD(m_pResources->statistics, descriptorCopies, stage.shader->numSamplers);
                 
             ((D3D12_GPU_DESCRIPTOR_HANDLE*)rootDescriptorTableHandles)[rootIndex] = m_pResources->dhSamplers.GetGpuHandle(baseDescriptorIndex);
             rootIndex++;
@@ -2648,6 +3636,7 @@ namespace NVRHI
     void RendererInterfaceD3D12::syncWithGPU(const char* reason)
     {
         flushCommandList();
+        m_pResources->WaitForComputeFence(m_pResources->computeFenceCounter, reason);
         m_pResources->WaitForFence(m_pResources->fenceCounter, reason);
     }
 
@@ -2692,9 +3681,6 @@ namespace NVRHI
         if (d.isUAV)
             desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-        D3D12_HEAP_PROPERTIES heapProps = {};
-        heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-
         D3D12_CLEAR_VALUE clearValue = {};
         clearValue.Format = formatMapping.rtvFormat;
         if (formatMapping.isDepthStencil)
@@ -2710,13 +3696,15 @@ namespace NVRHI
             clearValue.Color[3] = d.clearValue.a;
         }
 
-        HRESULT hr = m_pDevice->CreateCommittedResource(
-            &heapProps, 
-            D3D12_HEAP_FLAG_NONE, 
-            &desc, 
-            D3D12_RESOURCE_STATE_COMMON, 
+        // Placed render targets have to be discarded before use, which cannot be done on a compute list
+        bool allowPlacement = !d.isRenderTarget || !m_pResources->computeScopeActive;
+
+        HRESULT hr = m_pResources->placedResources.CreateResource(
+            desc, 
             d.useClearValue ? &clearValue : nullptr, 
-            IID_PPV_ARGS(&texture->resource));
+            allowPlacement,
+            texture->heapAllocation,
+            &texture->resource);
 
         CHECK_ERROR(SUCCEEDED(hr), "Failed to create a texture");
 
@@ -2736,6 +3724,9 @@ namespace NVRHI
 
         m_pResources->textures.insert(texture);
 
+        if (d.isRenderTarget && !texture->heapAllocation.committed)
+            discardPlacedTexture(texture);
+
 		if (data && d.mipLevels == 1)
 		{
 			uint32_t rowPitch = formatMapping.bytesPerPixel * d.width;
@@ -2769,8 +3760,13 @@ namespace NVRHI
 
         const auto& formatMapping = GetFormatMapping(t->desc.format);
 
+        trackResidency(t->heapAllocation);
+
         if (t->desc.isRenderTarget)
         {
+            if (m_pResources->computeScopeActive)
+                demoteComputeQueueScope();
+
             if (formatMapping.isDepthStencil)
             {
                 for (UINT mipLevel = 0; mipLevel < t->desc.mipLevels; mipLevel++)
@@ -2813,6 +3809,7 @@ namespace NVRHI
                 m_pResources->dhSRVetc.AllocateDescriptors(1, indexGpu);
 
                 m_pDevice->CopyDescriptorsSimple(1, m_pResources->dhSRVetc.GetCpuHandle(indexGpu), descriptorCpu, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                NVRHI_STAT_ADD(m_pResources->statistics, descriptorCopies, 1);
 
                 m_ActiveCommandList->commandList->ClearUnorderedAccessViewFloat(m_pResources->dhSRVetc.GetGpuHandle(indexGpu), descriptorCpu, t->resource, &clearColor.r, 0, nullptr);
             }
@@ -2828,6 +3825,8 @@ namespace NVRHI
 
         const auto& formatMapping = GetFormatMapping(t->desc.format);
 
+        trackResidency(t->heapAllocation);
+
         for (UINT mipLevel = 0; mipLevel < t->desc.mipLevels; mipLevel++)
         {
             TextureBinding binding;
@@ -2842,6 +3841,7 @@ namespace NVRHI
             m_pResources->dhSRVetc.AllocateDescriptors(1, indexGpu);
 
             m_pDevice->CopyDescriptorsSimple(1, m_pResources->dhSRVetc.GetCpuHandle(indexGpu), descriptorCpu, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+            NVRHI_STAT_ADD(m_pResources->statistics, descriptorCopies, 1);
 
             uint32_t clearValues[4] = { clearColor, clearColor, clearColor, clearColor };
 
@@ -2860,6 +3860,7 @@ namespace NVRHI
         UINT64 footprintBytes;
         m_pDevice->GetCopyableFootprints(&desc, subresource, 1, 0, &footprint, nullptr, nullptr, &footprintBytes);
         footprint.Offset = m_pResources->upload.SuballocateBuffer(footprintBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        NVRHI_STAT_UPLOAD(m_pResources->statistics, footprintBytes);
             
         for (uint32_t plane = 0; plane < footprint.Footprint.Depth; plane++)
         {
@@ -2914,17 +3915,13 @@ namespace NVRHI
 
         if (d.canHaveUAVs)
             desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-            
-        D3D12_HEAP_PROPERTIES heapProps = {};
-        heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
 
-        HRESULT hr = m_pDevice->CreateCommittedResource(
-            &heapProps,
-            D3D12_HEAP_FLAG_NONE,
-            &desc,
-            D3D12_RESOURCE_STATE_COMMON,
+        HRESULT hr = m_pResources->placedResources.CreateResource(
+            desc,
             nullptr,
-            IID_PPV_ARGS(&buffer->resource));
+            true,
+            buffer->heapAllocation,
+            &buffer->resource);
 
         CHECK_ERROR(SUCCEEDED(hr), "Failed to create a buffer");
 
@@ -2951,6 +3948,7 @@ namespace NVRHI
     {
         UINT64 uploadOffset = m_pResources->upload.SuballocateBuffer(dataSize);
         memcpy(m_pResources->upload.GetCpuVA(uploadOffset), data, dataSize);
+        NVRHI_STAT_UPLOAD(m_pResources->statistics, dataSize);
         requireBufferState(b, D3D12_RESOURCE_STATE_COPY_DEST);
         commitBarriers();
         m_ActiveCommandList->commandList->CopyBufferRegion(b->resource, 0, m_pResources->upload.GetBuffer(), uploadOffset, dataSize);
@@ -2973,6 +3971,7 @@ namespace NVRHI
         m_pResources->dhSRVetc.AllocateDescriptors(1, indexGpu);
 
         m_pDevice->CopyDescriptorsSimple(1, m_pResources->dhSRVetc.GetCpuHandle(indexGpu), descriptorCpu, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        NVRHI_STAT_ADD(m_pResources->statistics, descriptorCopies, 1);
 
         const uint32_t values[4] = { clearValue, clearValue, clearValue, clearValue };
         m_ActiveCommandList->commandList->ClearUnorderedAccessViewUint(m_pResources->dhSRVetc.GetGpuHandle(indexGpu), descriptorCpu, b->resource, values, 0, nullptr);
@@ -3073,9 +4072,12 @@ namespace NVRHI
     void RendererInterfaceD3D12::writeConstantBuffer(ConstantBufferHandle b, const void * data, size_t dataSize)
     {
         size_t size = std::min(uint32_t(dataSize), b->desc.byteSize);
+        NVRHI_STAT_ADD(m_pResources->statistics, constantBufferWrites, 1);
+
         if (memcmp(&b->data[0], data, size) == 0)
         {
             b->numIdenticalWrites++;
+            NVRHI_STAT_ADD(m_pResources->statistics, identicalConstantBufferWrites, 1);
             return;
         }
 
@@ -3105,6 +4107,16 @@ namespace NVRHI
         if (binarySize == 0)
             return nullptr;
 
+        // The extension descriptors are referenced by pointer, so shaders with different descriptors are never shared
+        uint64_t variant = 0;
+        if (d.metadataValid)
+            variant = Hash::HashBytes(&d.metadata, sizeof(d.metadata), 1);
+        if (d.numPipelineStateExtensions > 0)
+            variant = Hash::HashBytes(d.pipelineStateExtensions, d.numPipelineStateExtensions * sizeof(d.pipelineStateExtensions[0]), variant);
+
+        ShaderHandle cached = m_pResources->shaderCache.Acquire(d.shaderType, variant, binary, binarySize);
+        if (cached)
+            return cached;
 
         ShaderHandle shader = new Shader();
         shader->type = d.shaderType;
@@ -3280,6 +4292,7 @@ namespace NVRHI
 
 
         m_pResources->shaders.insert(shader);
+        m_pResources->shaderCache.Insert(d.shaderType, variant, binary, binarySize, shader);
         return shader;
     }
 
@@ -3294,41 +4307,28 @@ namespace NVRHI
         if (s == nullptr)
             return;
 
-        m_pResources->shaders.erase(s);
-
-        // Step 1 - find the root signatures that reference this shader
-
-        std::set<uint32_t> rootsigHashesToDelete;
+        // Other handles still use the shader
+        if (!m_pResources->shaderCache.Release(s))
+            return;
 
-        for (auto pair : m_pResources->rootsigCache)
-        {
-            if (pair.second->shaders.count(s))
-                rootsigHashesToDelete.insert(pair.first);
-        }
+        m_pResources->shaders.erase(s);
 
-        // Step 2 - move the found root signatured to the deleted pool, find the pipeline states that reference the root signatures
+        // Step 1 - remove the root signatures that reference this shader from the cache and move them to the deleted pool
 
-        std::set<uint32_t> psoHashesToDelete;
+        std::vector<RootSignatureHandle> rootsigsToDelete;
+        m_pResources->rootsigCache.RemoveIf([s](const PodKey<RootSignatureKey>&, RootSignatureHandle rootsig) { return rootsig->shaders.count(s) != 0; }, rootsigsToDelete);
 
-        for (auto hash : rootsigHashesToDelete)
-        {
-            auto rootsig = m_pResources->rootsigCache[hash];
-            m_pResources->rootsigCache.erase(hash);
-            m_pResources->deletedResources.insert(rootsig);
+        std::set<RootSignatureHandle> deletedRootsigs(rootsigsToDelete.begin(), rootsigsToDelete.end());
+        m_pResources->deletedResources.insert(rootsigsToDelete.begin(), rootsigsToDelete.end());
 
-            for (auto pair : m_pResources->psoCache)
-                if (pair.second != nullptr && pair.second->rootSignature == rootsig)
-                    psoHashesToDelete.insert(pair.first);
-        }
+        // Step 2 - move the pipeline states that reference the root signatures to the deleted pool
 
-        // Step 3 - move the pipeline states to the deleted pool
+        std::vector<PipelineStateHandle> psosToDelete;
+        auto referencesDeletedRootsig = [&deletedRootsigs](PipelineStateHandle pso) { return deletedRootsigs.count(pso->rootSignature) != 0; };
+        m_pResources->psoCache.RemoveIf([&](const PodKey<GraphicsPipelineKey>&, PipelineStateHandle pso) { return referencesDeletedRootsig(pso); }, psosToDelete);
+        m_pResources->computePsoCache.RemoveIf([&](const PodKey<ComputePipelineKey>&, PipelineStateHandle pso) { return referencesDeletedRootsig(pso); }, psosToDelete);
 
-        for (auto hash : psoHashesToDelete)
-        {
-            auto pso = m_pResources->psoCache[hash];
-            m_pResources->psoCache.erase(hash);
-            m_pResources->deletedResources.insert(pso);
-        }
+        m_pResources->deletedResources.insert(psosToDelete.begin(), psosToDelete.end());
 
         // no need to put shaders into the deleted resources pool: they do not have actual D3D resource associated
         delete s;
@@ -3435,6 +4435,8 @@ namespace NVRHI
         if (!query->name.empty())
             PIXBeginEvent(m_ActiveCommandList->commandList, 0, query->name.c_str());
 
+        query->computeQueue = m_pResources->computeScopeActive;
+
         if (onlyAnnotation)
         {
             query->state = PerformanceQuery::ANNOTATION;
@@ -3453,6 +4455,23 @@ namespace NVRHI
     {
         CHECK_ERROR(query->state == PerformanceQuery::STARTED || query->state == PerformanceQuery::ANNOTATION, "Query is not started");
 
+        // The query was started on the other queue: a compute queue scope began, ended or was demoted in between.
+        // Timestamps from two queues cannot be subtracted, and the event was opened on a list that is already closed,
+        // so the query only keeps its annotation part.
+        if (query->computeQueue != m_pResources->computeScopeActive)
+        {
+            static bool reported = false;
+            if (!reported && query->state == PerformanceQuery::STARTED)
+            {
+                DEBUG_PRINTF("WARNING: performance query '%s' crosses a compute queue scope boundary, it will report 0 ms\n", query->name.c_str());
+                reported = true;
+            }
+
+            query->state = PerformanceQuery::RESOLVED;
+            query->time = 0.f;
+            return;
+        }
+
         if (!query->name.empty())
             PIXEndEvent(m_ActiveCommandList->commandList);
 
@@ -3485,6 +4504,10 @@ namespace NVRHI
         {
             if (q->state == PerformanceQuery::FINISHED)
             {
+                // The timestamps written on the compute queue must be there before a direct list resolves them
+                if (q->computeQueue)
+                    m_pResources->computeDependency = true;
+
                 m_ActiveCommandList->commandList->ResolveQueryData(
                     m_pResources->perfQueryHeap, 
                     D3D12_QUERY_TYPE_TIMESTAMP, 
@@ -3500,14 +4523,19 @@ namespace NVRHI
         size_t dataSize = m_pResources->nextQueryIndex * 8;
         readBuffer(m_pResources->perfQueryResolveBuffer, data, &dataSize);
 
-        uint64_t frequency;
+        // The queues may run their timestamp counters at different rates
+        uint64_t frequency = 0;
+        uint64_t computeFrequency = 0;
         m_pCommandQueue->GetTimestampFrequency(&frequency);
+        if (m_pResources->computeQueue)
+            m_pResources->computeQueue->GetTimestampFrequency(&computeFrequency);
 
         for (auto q : m_pResources->perfQueries)
         {
             if (q->state == PerformanceQuery::FINISHED)
             {
-                q->time = float(1000.0 * double(data[q->endIndex] - data[q->beginIndex]) / double(frequency));
+                uint64_t queueFrequency = q->computeQueue ? computeFrequency : frequency;
+                q->time = queueFrequency ? float(1000.0 * double(data[q->endIndex] - data[q->beginIndex]) / double(queueFrequency)) : 0.f;
                 q->state = PerformanceQuery::RESOLVED;
             }
         }
@@ -3540,35 +4568,47 @@ namespace NVRHI
 
     void RendererInterfaceD3D12::draw(const DrawCallState & state, const DrawArguments* args, uint32_t numDrawCalls)
     {
+        if (m_pResources->computeScopeActive)
+            demoteComputeQueueScope();
+
         applyState(state);
         commitBarriers();
 
         for (uint32_t i = 0; i < numDrawCalls; i++)
             m_ActiveCommandList->commandList->DrawInstanced(args[i].vertexCount, args[i].instanceCount, args[i].startVertexLocation, args[i].startInstanceLocation);
 
+        NVRHI_STAT_DRAWS(m_pResources->statistics, args, numDrawCalls);
         m_ActiveCommandList->size += numDrawCalls;
         loadBalanceCommandList();
     }
 
     void RendererInterfaceD3D12::drawIndexed(const DrawCallState & state, const DrawArguments* args, uint32_t numDrawCalls)
     {
+        if (m_pResources->computeScopeActive)
+            demoteComputeQueueScope();
+
         applyState(state);
         commitBarriers();
 
         for (uint32_t i = 0; i < numDrawCalls; i++)
             m_ActiveCommandList->commandList->DrawIndexedInstanced(args[i].vertexCount, args[i].instanceCount, args[i].startIndexLocation, args[i].startVertexLocation, args[i].startInstanceLocation);
 
+        NVRHI_STAT_DRAWS(m_pResources->statistics, args, numDrawCalls);
         m_ActiveCommandList->size += numDrawCalls;
         loadBalanceCommandList();
     }
 
     void RendererInterfaceD3D12::drawIndirect(const DrawCallState & state, BufferHandle indirectParams, uint32_t offsetBytes)
     {
+        if (m_pResources->computeScopeActive)
+            demoteComputeQueueScope();
+
         applyState(state);
         requireBufferState(indirectParams, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
         commitBarriers();
 
         m_ActiveCommandList->commandList->ExecuteIndirect(m_pResources->drawIndirectSignature, 1, indirectParams->resource, offsetBytes, nullptr, 0);
+        NVRHI_STAT_ADD(m_pResources->statistics, indirectDrawCalls, 1);
         m_ActiveCommandList->size++;
         loadBalanceCommandList();
     }
@@ -3579,6 +4619,7 @@ namespace NVRHI
         commitBarriers();
 
         m_ActiveCommandList->commandList->Dispatch(groupsX, groupsY, groupsZ);
+        NVRHI_STAT_ADD(m_pResources->statistics, dispatches, 1);
         m_ActiveCommandList->size++;
         loadBalanceCommandList();
     }
@@ -3590,6 +4631,7 @@ namespace NVRHI
         commitBarriers();
 
         m_ActiveCommandList->commandList->ExecuteIndirect(m_pResources->dispatchIndirectSignature, 1, indirectParams->resource, offsetBytes, nullptr, 0);
+        NVRHI_STAT_ADD(m_pResources->statistics, indirectDispatches, 1);
         m_ActiveCommandList->size++;
         loadBalanceCommandList();
     }
@@ -3712,12 +4754,14 @@ namespace NVRHI
 		{
 			m_ActiveCommandList->commandList->SetPipelineState(pPSO->handle);
 			m_pResources->currentPSO = pPSO->handle;
+			NVRHI_STAT_ADD(m_pResources->statistics, stateChanges, 1);
 		}
 
 		if (m_pResources->currentRS != pRS->handle)
 		{
 			m_ActiveCommandList->commandList->SetGraphicsRootSignature(pRS->handle);
 			m_pResources->currentRS = pRS->handle;
+			NVRHI_STAT_ADD(m_pResources->statistics, stateChanges, 1);
 		}
 
         if (state.indexBuffer)
@@ -3837,9 +4881,8 @@ namespace NVRHI
 
     void RendererInterfaceD3D12::applyState(const DispatchState & state)
     {
-		uint32_t hash = getComputeStateHash(state);
-        RootSignatureHandle pRS = getRootSignature(state, hash);
-        PipelineStateHandle pPSO = getPipelineState(state, pRS, hash);
+        RootSignatureHandle pRS = getRootSignature(state);
+        PipelineStateHandle pPSO = getPipelineState(state, pRS);
 
         if (pPSO == nullptr)
             return;
@@ -3856,17 +4899,21 @@ namespace NVRHI
 
         pRS->fenceCounterAtLastUse = m_pResources->fenceCounter;
         pPSO->fenceCounterAtLastUse = m_pResources->fenceCounter;
+        trackComputeQueueUse(pRS);
+        trackComputeQueueUse(pPSO);
 
 		if (m_pResources->currentPSO != pPSO->handle)
 		{
 			m_ActiveCommandList->commandList->SetPipelineState(pPSO->handle);
 			m_pResources->currentPSO = pPSO->handle;
+			NVRHI_STAT_ADD(m_pResources->statistics, stateChanges, 1);
 		}
 
 		if (m_pResources->currentRS != pRS->handle)
 		{
 			m_ActiveCommandList->commandList->SetComputeRootSignature(pRS->handle);
 			m_pResources->currentRS = pRS->handle;
+			NVRHI_STAT_ADD(m_pResources->statistics, stateChanges, 1);
 		}
 
         for (uint32_t i = 0; i < rootIndex; i++)
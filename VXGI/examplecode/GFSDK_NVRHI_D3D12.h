@@ -11,12 +11,15 @@
 #pragma once
 
 #include <GFSDK_NVRHI.h>
+#include "GFSDK_NVRHI_ShaderCache.h"
+#include "GFSDK_NVRHI_StateCache.h"
 
 struct ID3D12Device;
 struct ID3D12CommandQueue;
 struct ID3D12Resource;
 struct ID3D12GraphicsCommandList;
 struct ID3D12CommandAllocator;
+struct D3D12_RESOURCE_BARRIER;
 
 namespace NVRHI
 {
@@ -33,6 +36,56 @@ namespace NVRHI
     typedef uint32_t DescriptorIndex;
 
     struct BackendResources;
+    struct HeapAllocation;
+
+    struct HeapAllocatorStats
+    {
+        uint32_t numHeaps;
+        uint64_t heapBytes;
+        uint64_t allocatedBytes;
+        uint32_t numPlacedResources;
+        uint32_t numCommittedResources;     // resources that did not fit into a heap
+        uint32_t numTransientRegions;
+        uint64_t transientBytes;
+        uint32_t numAliasedResources;
+        uint64_t largestFreeBlock;
+        uint32_t numFreeBlocks;
+        float fragmentation;                // 1 - largestFreeBlock / free bytes; 0 means all free space is contiguous
+        uint32_t numReclaimableHeaps;       // heaps that could be released if the allocations were compacted
+
+        HeapAllocatorStats() { memset(this, 0, sizeof(*this)); }
+    };
+
+    struct FrameBeginInfo
+    {
+        uint64_t frameNumber;
+        uint32_t frameIndex;                // frameNumber % maxFramesInFlight: the GPU has finished the previous frame with this index
+        uint32_t framesInFlight;            // previous frames that the GPU has not finished yet
+        double cpuBlockedTime;              // seconds beginFrame spent waiting for the GPU
+        double previousFrameStallTime;      // seconds the previous frame spent waiting for the GPU between beginFrame and endFrame
+        uint64_t previousFrameUploadBytes;
+        uint32_t previousFrameDescriptors;
+
+        FrameBeginInfo() { memset(this, 0, sizeof(*this)); }
+    };
+
+    struct ResidencyReport
+    {
+        uint64_t budgetBytes;               // local video memory budget reported by DXGI, 0 if unavailable
+        uint64_t usageBytes;                // local video memory used by the process
+        bool budgetChanged;                 // the OS changed the budget since the previous report
+        uint64_t residentBytes;             // heaps and committed resources tracked by the backend
+        uint64_t evictedBytes;
+        uint32_t numResidentObjects;
+        uint32_t numEvictedObjects;
+        uint32_t numPinnedObjects;          // resident objects used by command lists that are still in flight
+        uint32_t numEvictionsThisFrame;
+        uint64_t bytesEvictedThisFrame;
+        uint32_t numMadeResidentThisFrame;
+        uint64_t bytesMadeResidentThisFrame;
+
+        ResidencyReport() { memset(this, 0, sizeof(*this)); }
+    };
 
     class RendererInterfaceD3D12 : public IRendererInterface
     {
@@ -46,6 +99,42 @@ namespace NVRHI
         void flushCommandList();
         void loadBalanceCommandList();
 
+        // Frame contexts. Wrap each frame into beginFrame / endFrame to limit the number of frames
+        // the CPU can record ahead of the GPU; beginFrame blocks until the GPU has finished
+        // the frame that is maxFramesInFlight frames behind. endFrame flushes the command list.
+        // Changing the limit waits until the GPU has finished all submitted frames.
+        void setMaxFramesInFlight(uint32_t count);
+        uint32_t getMaxFramesInFlight();
+        FrameBeginInfo beginFrame();
+        void endFrame();
+
+        // Placed resource heaps. Textures and buffers are suballocated from ID3D12Heap objects;
+        // resources created while a transient region is active are all placed at the start of that region
+        // and alias each other. Before using an aliased resource whose memory was last used by another one,
+        // call activateAliasedResource; render targets and depth buffers are discarded by it,
+        // other textures and buffers have undefined contents and must be fully overwritten.
+        HeapAllocatorStats getHeapAllocatorStats();
+        uint32_t createTransientRegion(uint64_t sizeBytes);
+        void destroyTransientRegion(uint32_t region);
+        void setActiveTransientRegion(uint32_t region);
+        void activateAliasedResource(TextureHandle texture);
+        void activateAliasedResource(BufferHandle buffer);
+
+        // Residency management. Call once per frame, outside of compute queue scopes: when the process
+        // exceeds its video memory budget, least recently used heaps and committed resources that are not
+        // used by in-flight command lists are evicted. Evicted objects are made resident again when used.
+        ResidencyReport updateResidency();
+
+        // Pipeline state cache. Graphics and compute pipeline states are cached by their full state;
+        // with a capacity set (0 = unlimited), the least recently used ones are released when each cache is full.
+        // The statistics include the root signature cache, which is not limited.
+        void setPipelineCacheCapacity(uint32_t maxPipelineStates);
+        StateCacheStats getPipelineCacheStats();
+
+        // Shader cache. createShader calls with identical bytecode, metadata and extensions return the same
+        // shader object, with its resource binding information extracted only once; destroyShader releases a reference.
+        ShaderCacheStats getShaderCacheStats();
+
     private:
         friend class DescriptorHeap;
         friend class StaticDescriptorHeap;
@@ -54,6 +143,7 @@ namespace NVRHI
         friend class Buffer;
         friend class ConstantBuffer;
         friend class Sampler;
+        friend class PlacedResourceAllocator;
         friend struct BackendResources;
 
         BackendResources* m_pResources;
@@ -64,15 +154,15 @@ namespace NVRHI
 
         RendererInterfaceD3D12& operator=(const RendererInterfaceD3D12& other); //undefined
         void signalError(const char* file, int line, const char* errorDesc);
-        CommandListHandle createCommandList();
-        uint32_t getStateHashForRS(const DrawCallState& state);
-        uint32_t getStateHashForPSO(const DrawCallState& state);
-        uint32_t getComputeStateHash(const DispatchState& state);
+        CommandListHandle createCommandList(bool computeQueue);
+        void flushGraphicsCommandList();
+        void submitComputeCommandList();
+        void demoteComputeQueueScope();
         RootSignatureHandle buildRootSignature(uint32_t numShaders, const ShaderHandle* shaders, bool allowInputLayout);
         RootSignatureHandle getRootSignature(const DrawCallState& state);
-        RootSignatureHandle getRootSignature(const DispatchState& state, uint32_t hash);
+        RootSignatureHandle getRootSignature(const DispatchState& state);
         PipelineStateHandle getPipelineState(const DrawCallState& state, RootSignatureHandle pRS);
-        PipelineStateHandle getPipelineState(const DispatchState& state, RootSignatureHandle pRS, uint32_t hash);
+        PipelineStateHandle getPipelineState(const DispatchState& state, RootSignatureHandle pRS);
         DescriptorIndex getCBV(ConstantBufferHandle cbuffer);
         DescriptorIndex getTextureSRV(const TextureBinding& binding);
         DescriptorIndex getTextureUAV(const TextureBinding& binding);
@@ -85,10 +175,15 @@ namespace NVRHI
         void releaseBufferViews(BufferHandle buffer);
         void releaseConstantBufferViews(ConstantBufferHandle cbuffer);
         void releaseSamplerViews(SamplerHandle sampler);
+        void releaseHeapAllocation(const HeapAllocation& allocation);
+        void discardPlacedTexture(TextureHandle texture);
+        void trackResidency(const HeapAllocation& allocation);
         uint64_t getFenceCounter();
         void deferredDestroyResource(ManagedResource* resource);
         void requireTextureState(TextureHandle texture, uint32_t arrayIndex, uint32_t mipLevel, uint32_t state);
         void requireBufferState(BufferHandle buffer, uint32_t state);
+        void trackComputeQueueUse(ManagedResource* resource);
+        void addTransitionBarrier(const D3D12_RESOURCE_BARRIER& barrier);
         void commitBarriers();
 
         void bindShaderResources(uint32_t& rootIndex, void* rootDescriptorTableHandles, const PipelineStageBindings& stage);
@@ -150,6 +245,13 @@ namespace NVRHI
 		virtual void setEnableUavBarriersForTexture(TextureHandle texture, bool enableBarriers);
 		virtual void setEnableUavBarriersForBuffer(BufferHandle buffer, bool enableBarriers);
 
+        virtual void beginComputeQueueScope();
+        virtual void endComputeQueueScope();
+
+        virtual bool setEnableStatistics(bool enable);
+        virtual void endStatisticsFrame();
+        virtual bool getFrameStatistics(RendererStatistics& stats);
+
         void applyState(const DrawCallState& state);
         void applyState(const DispatchState& state);
     };
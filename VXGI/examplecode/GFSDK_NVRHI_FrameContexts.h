@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <string.h>
+
+namespace NVRHI
+{
+    // Ring of frame contexts that limits how many frames the CPU can record ahead of the GPU.
+    // It only deals with fence values, so the actual fence and the wait are up to the caller:
+    //   uint64_t fence = ring.GetFenceToWait(); <wait until the GPU fence reaches it>
+    //   ring.BeginFrame(...); <record the frame> ring.EndFrame(<fence value signaled after the frame>, ...);
+    class FrameContextRing
+    {
+    public:
+        enum { MAX_FRAMES_IN_FLIGHT = 8 };
+
+        struct FrameContext
+        {
+            uint64_t frameNumber;
+            uint64_t fenceValue;            // signaled by the GPU when the frame is finished, 0 until submitted
+            uint64_t uploadBytes;           // upload ring memory used by the frame
+            uint32_t numDescriptors;        // shader visible descriptors used by the frame
+            uint64_t uploadStart;           // cumulative counters at the beginning of the frame
+            uint64_t descriptorStart;
+        };
+
+        FrameContextRing(uint32_t maxFramesInFlight)
+            : m_MaxFramesInFlight(1)
+            , m_FrameNumber(0)
+            , m_Recording(false)
+        {
+            memset(m_Frames, 0, sizeof(m_Frames));
+            SetMaxFramesInFlight(maxFramesInFlight);
+        }
+
+        void SetMaxFramesInFlight(uint32_t count)
+        {
+            m_MaxFramesInFlight = std::max(1u, std::min(count, uint32_t(MAX_FRAMES_IN_FLIGHT)));
+        }
+
+        uint32_t GetMaxFramesInFlight() const { return m_MaxFramesInFlight; }
+
+        // Contexts are stored by frame number modulo MAX_FRAMES_IN_FLIGHT, independent of the current limit,
+        // so that changing the limit does not lose the history of frames still in flight
+        static uint32_t GetFrameSlot(uint64_t frameNumber) { return uint32_t(frameNumber % MAX_FRAMES_IN_FLIGHT); }
+        uint64_t GetFrameNumber() const { return m_FrameNumber; }
+        bool IsRecording() const { return m_Recording; }
+
+        // The fence value of the oldest frame that has to be finished before a new frame can begin, or 0
+        uint64_t GetFenceToWait() const
+        {
+            if (m_FrameNumber < m_MaxFramesInFlight)
+                return 0;
+
+            return GetFrame(m_FrameNumber - m_MaxFramesInFlight).fenceValue;
+        }
+
+        uint32_t GetFramesInFlight(uint64_t completedFence) const
+        {
+            uint32_t count = 0;
+            uint32_t history = uint32_t(std::min<uint64_t>(m_FrameNumber, MAX_FRAMES_IN_FLIGHT));
+
+            for (uint32_t i = 1; i <= history; i++)
+                if (GetFrame(m_FrameNumber - i).fenceValue > completedFence)
+                    count++;
+
+            return count;
+        }
+
+        FrameContext& BeginFrame(uint64_t uploadCounter, uint64_t descriptorCounter)
+        {
+            FrameContext& frame = m_Frames[GetFrameSlot(m_FrameNumber)];
+            memset(&frame, 0, sizeof(frame));
+            frame.frameNumber = m_FrameNumber;
+            frame.uploadStart = uploadCounter;
+            frame.descriptorStart = descriptorCounter;
+            m_Recording = true;
+            return frame;
+        }
+
+        FrameContext& EndFrame(uint64_t fenceValue, uint64_t uploadCounter, uint64_t descriptorCounter)
+        {
+            FrameContext& frame = m_Frames[GetFrameSlot(m_FrameNumber)];
+            frame.fenceValue = fenceValue;
+            frame.uploadBytes = uploadCounter - frame.uploadStart;
+            frame.numDescriptors = uint32_t(descriptorCounter - frame.descriptorStart);
+            m_Recording = false;
+            m_FrameNumber++;
+            return frame;
+        }
+
+        // Previously recorded frame; valid for the last MAX_FRAMES_IN_FLIGHT frames
+        const FrameContext& GetFrame(uint64_t frameNumber) const
+        {
+            return m_Frames[GetFrameSlot(frameNumber)];
+        }
+
+    private:
+        FrameContext m_Frames[MAX_FRAMES_IN_FLIGHT];
+        uint32_t m_MaxFramesInFlight;
+        uint64_t m_FrameNumber;
+        bool m_Recording;
+    };
+}
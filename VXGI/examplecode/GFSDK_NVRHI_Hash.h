@@ -0,0 +1,160 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace NVRHI
+{
+    // Fast 64-bit non-cryptographic hashing for cache keys (wyhash construction).
+    // It only needs a 64x64->128 bit multiply, so it is portable and does not depend on SSE4.2 or any other
+    // instruction set extension; on 32-bit targets the multiply is emulated.
+    namespace Hash
+    {
+        static const uint64_t SECRET0 = 0xa0761d6478bd642full;
+        static const uint64_t SECRET1 = 0xe7037ed1a0b428dbull;
+        static const uint64_t SECRET2 = 0x8ebc6af09c88c6e3ull;
+        static const uint64_t SECRET3 = 0x589965cc75374cc3ull;
+
+        inline void Multiply128(uint64_t& a, uint64_t& b)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            a = _umul128(a, b, &b);
+#elif defined(__SIZEOF_INT128__)
+            __uint128_t r = __uint128_t(a) * b;
+            a = uint64_t(r);
+            b = uint64_t(r >> 64);
+#else
+            uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+            uint64_t t = rl + (rm0 << 32);
+            uint64_t c = t < rl;
+            uint64_t lo = t + (rm1 << 32);
+            c += lo < t;
+            b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+            a = lo;
+#endif
+        }
+
+        inline uint64_t Mix(uint64_t a, uint64_t b)
+        {
+            Multiply128(a, b);
+            return a ^ b;
+        }
+
+        inline uint64_t Read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+        inline uint64_t Read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+        inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+        {
+            const uint8_t* p = (const uint8_t*)data;
+            seed ^= Mix(seed ^ SECRET0, SECRET1);
+
+            uint64_t a, b;
+            if (size <= 16)
+            {
+                if (size >= 4)
+                {
+                    size_t offset = (size >> 3) << 2;
+                    a = (Read32(p) << 32) | Read32(p + offset);
+                    b = (Read32(p + size - 4) << 32) | Read32(p + size - 4 - offset);
+                }
+                else if (size > 0)
+                {
+                    a = (uint64_t(p[0]) << 16) | (uint64_t(p[size >> 1]) << 8) | p[size - 1];
+                    b = 0;
+                }
+                else
+                    a = b = 0;
+            }
+            else
+            {
+                size_t remaining = size;
+
+                // Three independent lanes for long inputs
+                if (remaining > 48)
+                {
+                    uint64_t seed1 = seed, seed2 = seed;
+                    do
+                    {
+                        seed = Mix(Read64(p) ^ SECRET1, Read64(p + 8) ^ seed);
+                        seed1 = Mix(Read64(p + 16) ^ SECRET2, Read64(p + 24) ^ seed1);
+                        seed2 = Mix(Read64(p + 32) ^ SECRET3, Read64(p + 40) ^ seed2);
+                        p += 48;
+                        remaining -= 48;
+                    } while (remaining > 48);
+
+                    seed ^= seed1 ^ seed2;
+                }
+
+                while (remaining > 16)
+                {
+                    seed = Mix(Read64(p) ^ SECRET1, Read64(p + 8) ^ seed);
+                    p += 16;
+                    remaining -= 16;
+                }
+
+                a = Read64(p + remaining - 16);
+                b = Read64(p + remaining - 8);
+            }
+
+            a ^= SECRET1;
+            b ^= seed;
+            Multiply128(a, b);
+            return Mix(a ^ SECRET0 ^ size, b ^ SECRET1);
+        }
+    }
+
+    // Incremental hashing of a struct field by field, which keeps padding bytes out of the hash.
+    // Only scalar values can be added directly; add structs through their fields or with AddBytes
+    // if they are known to have no padding.
+    class Hasher
+    {
+    public:
+        Hasher(uint64_t seed = 0)
+            : m_State(seed)
+            , m_Length(0)
+        { }
+
+        template<typename T> void Add(const T& value)
+        {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+                "Add structs field by field or with AddBytes");
+            static_assert(sizeof(T) <= sizeof(uint64_t), "Scalar type is too large");
+
+            uint64_t word = 0;
+            memcpy(&word, &value, sizeof(T));
+            m_State = Hash::Mix(m_State ^ Hash::SECRET1, word ^ Hash::SECRET2);
+            m_Length += sizeof(T);
+        }
+
+        void AddBytes(const void* data, size_t size)
+        {
+            m_State = Hash::HashBytes(data, size, m_State);
+            m_Length += size;
+        }
+
+        uint64_t Get() const
+        {
+            return Hash::Mix(m_State ^ Hash::SECRET0, m_Length ^ Hash::SECRET3);
+        }
+
+    private:
+        uint64_t m_State;
+        uint64_t m_Length;
+    };
+}
@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace NVRHI
+{
+    // Per-resource state of the memory barrier tracking
+    struct ShaderWriteState
+    {
+        uint64_t lastShaderWrite;       // command index of the last incoherent write, 0 if none
+        uint64_t earlierShaderWrite;    // the write before that, if the last one is from the current command
+        bool enableUavBarriers;
+        bool firstUavBarrierPlaced;
+
+        ShaderWriteState()
+            : lastShaderWrite(0)
+            , earlierShaderWrite(0)
+            , enableUavBarriers(true)
+            , firstUavBarrierPlaced(false)
+        { }
+
+        void SetEnableUavBarriers(bool enable)
+        {
+            enableUavBarriers = enable;
+            firstUavBarrierPlaced = false;
+        }
+    };
+
+    // Memory barrier tracking for incoherent shader writes (image stores and SSBOs) in OpenGL.
+    // Writes are recorded with the index of the command that made them. Before a resource is accessed in some way,
+    // a barrier with the bit for that kind of access is needed if the resource was written after the last barrier
+    // with that bit was issued and before the current command. Writes from the current command don't count:
+    // a resource can be both read and written by one draw or dispatch, in any order of the accesses.
+    // The tracker only selects the bits; the caller issues glMemoryBarrier with them.
+    class MemoryBarrierTracker
+    {
+    public:
+        MemoryBarrierTracker()
+            : m_CommandIndex(1)
+            , m_LastShaderWrite(0)
+            , m_RequiredBarrierBits(0)
+        {
+            memset(m_LastMemoryBarrier, 0, sizeof(m_LastMemoryBarrier));
+        }
+
+        // Records an access of the current command to the resource, and a write if unorderedAccess is set
+        void Require(ShaderWriteState& resource, uint32_t barrierBits, bool unorderedAccess)
+        {
+            // Consecutive UAV accesses to a resource with disabled barriers may overlap, except the first one in the group
+            bool skipBarrier = unorderedAccess && !resource.enableUavBarriers && resource.firstUavBarrierPlaced;
+
+            uint64_t lastWrite = resource.lastShaderWrite < m_CommandIndex ? resource.lastShaderWrite : resource.earlierShaderWrite;
+
+            if (!skipBarrier && lastWrite != 0)
+            {
+                for (uint32_t bit = 0; bit < 32; bit++)
+                {
+                    if ((barrierBits & (1u << bit)) && lastWrite >= m_LastMemoryBarrier[bit])
+                        m_RequiredBarrierBits |= 1u << bit;
+                }
+            }
+
+            if (unorderedAccess)
+            {
+                resource.firstUavBarrierPlaced = true;
+                resource.earlierShaderWrite = lastWrite;
+                resource.lastShaderWrite = m_CommandIndex;
+                m_LastShaderWrite = m_CommandIndex;
+            }
+        }
+
+        // Called before the current command is issued. Returns the barrier bits to issue before it, 0 if none,
+        // and moves on to the next command.
+        uint32_t Flush()
+        {
+            uint32_t bits = m_RequiredBarrierBits;
+
+            for (uint32_t bit = 0; bit < 32; bit++)
+            {
+                if (bits & (1u << bit))
+                    m_LastMemoryBarrier[bit] = m_CommandIndex;
+            }
+
+            m_RequiredBarrierBits = 0;
+            m_CommandIndex++;
+            return bits;
+        }
+
+        // Makes all shader writes visible to code outside of the tracking, e.g. before the renderer hands off
+        // to code that uses GL directly. Returns true if a barrier with all bits has to be issued.
+        bool FlushAll()
+        {
+            bool anyPendingWrites = false;
+            for (uint32_t bit = 0; bit < 32; bit++)
+            {
+                if (m_LastShaderWrite != 0 && m_LastShaderWrite >= m_LastMemoryBarrier[bit])
+                    anyPendingWrites = true;
+            }
+
+            if (anyPendingWrites)
+            {
+                for (uint32_t bit = 0; bit < 32; bit++)
+                    m_LastMemoryBarrier[bit] = m_CommandIndex;
+            }
+
+            m_RequiredBarrierBits = 0;
+            m_CommandIndex++;
+            return anyPendingWrites;
+        }
+
+        uint64_t GetCommandIndex() const { return m_CommandIndex; }
+        uint32_t GetRequiredBarrierBits() const { return m_RequiredBarrierBits; }
+
+    private:
+        uint64_t m_CommandIndex;
+        uint64_t m_LastMemoryBarrier[32];   // command index of the last barrier, for each barrier bit
+        uint64_t m_LastShaderWrite;
+        uint32_t m_RequiredBarrierBits;
+    };
+}
@@ -9,13 +9,14 @@
 */
 
 #include "GFSDK_NVRHI_OpenGL4.h"
+#include "GFSDK_NVRHI_SlotMap.h"
+#include "GFSDK_NVRHI_UploadRing.h"
 
 #ifdef _WIN32
 #include <sdkddkver.h>
 #define WIN32_LEAN_AND_MEAN 1
 #define NOMINMAX 1
 #include <Windows.h>
-#include <nmmintrin.h>
 #endif
 
 #define GL_GLEXT_PROTOTYPES 1
@@ -86,105 +87,7 @@ namespace NVRHI
         return mapping;
     }
 
-    bool GetSSE42Support()
-    {
-        int cpui[4];
-        __cpuidex(cpui, 1, 0);
-        return !!(cpui[2] & 0x100000);
-    }
-
-    static const bool CpuSupportsSSE42 = GetSSE42Support();
-
-    static const uint32_t CrcTable[] = {
-        0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-        0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-        0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-        0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-        0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-        0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-        0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-        0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-        0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-        0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-        0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-        0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-        0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-        0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-        0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-        0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-        0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-        0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-        0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-        0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-        0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-        0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-        0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-        0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-        0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-        0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-        0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-        0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-        0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-        0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-        0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-        0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-        0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-        0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-        0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-        0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-        0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-        0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-        0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-        0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-        0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-        0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-        0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-    };
-
-    class CrcHash
-    {
-    private:
-        uint32_t crc;
-    public:
-        CrcHash() 
-            : crc(0) 
-        { 
-        }
-
-        uint32_t Get() 
-        {
-            return crc;
-        }
-
-        template<size_t size> __forceinline void AddBytesSSE42(void* p)
-        {
-            static_assert(size % 4 == 0, "Size of hashable types must be multiple of 4");
-
-            uint32_t* data = (uint32_t*)p;
-
-            const size_t numIterations = size / sizeof(uint32_t);
-            for (size_t i = 0; i < numIterations; i++)
-            {
-                crc = _mm_crc32_u32(crc, data[i]);
-            }
-        }
-
-        __forceinline void AddBytes(char* p, uint32_t size)
-        {
-            for (uint32_t idx = 0; idx < size; idx++)
-                crc = CrcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
-        }
-
-        template<typename T> void Add(const T& value)
-        {
-            if (CpuSupportsSSE42)
-                AddBytesSSE42<sizeof(value)>((void*)&value);
-            else
-                AddBytes((char*)&value, sizeof(value));
-        }
-    };
-
-    class Texture
+    class Texture : public ShaderWriteState
     {
     public:
         TextureDesc desc;
@@ -192,13 +95,11 @@ namespace NVRHI
         GLuint handle;
         GLenum bindTarget;
         GLuint srgbView;
-        bool usedInFrameBuffers;
 
         Texture()
             : handle(0)
             , bindTarget(0)
             , srgbView(0)
-            , usedInFrameBuffers(false)
         { }
 
         ~Texture()
@@ -208,7 +109,7 @@ namespace NVRHI
         }
     };
 
-    class Buffer
+    class Buffer : public ShaderWriteState
     {
     public:
         BufferDesc desc;
@@ -292,16 +193,12 @@ namespace NVRHI
         GLuint handle;
         GLenum drawBuffers[8];
         uint32_t numBuffers;
-        TextureHandle depthTarget;
-        TextureHandle renderTargets[8];
+        PodKey<FrameBufferKey> key;
 
         FrameBuffer() 
             : handle(0) 
             , numBuffers(0)
-            , depthTarget(nullptr)
-        { 
-            memset(renderTargets, 0, sizeof(renderTargets));
-        }
+        { }
 
         ~FrameBuffer()
         {
@@ -316,6 +213,190 @@ namespace NVRHI
         std::vector<VertexAttributeDesc> attributes;
     };
 
+    static bool WaitForSync(GLsync sync, bool wait)
+    {
+        GLenum result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+        while (wait && result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+
+        return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED;
+    }
+
+    // Persistently mapped ring of pixel unpack memory. Each upload is fenced, and space is reused
+    // only after the GPU has passed the fence of the upload that occupied it.
+    class UploadRing
+    {
+    public:
+        GLuint handle;
+        uint8_t* mappedData;
+
+        UploadRing()
+            : handle(0)
+            , mappedData(nullptr)
+        { }
+
+        ~UploadRing()
+        {
+            while (m_Allocator.HasFences())
+                glDeleteSync(m_Allocator.RetireOldest());
+
+            // Deleting a mapped buffer unmaps it
+            if (handle)
+                glDeleteBuffers(1, &handle);
+        }
+
+        void Init(uint32_t bufferSize, bool directStateAccess)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            if (directStateAccess)
+            {
+                glCreateBuffers(1, &handle);
+                glNamedBufferStorage(handle, bufferSize, nullptr, flags);
+                mappedData = (uint8_t*)glMapNamedBufferRange(handle, 0, bufferSize, flags);
+            }
+            else
+            {
+                glGenBuffers(1, &handle);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, handle);
+                glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, flags);
+                mappedData = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize, flags);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+            }
+
+            m_Allocator.Init(mappedData ? bufferSize : 0);
+        }
+
+        // Returns false if the data doesn't fit into the ring at all; waits for the GPU if the ring is full
+        bool Allocate(size_t bytes, uint32_t& offset)
+        {
+            if (bytes > m_Allocator.GetSize())
+                return false;
+
+            while (!m_Allocator.TryAllocate(bytes, offset))
+            {
+                if (!m_Allocator.HasFences())
+                    return false;
+
+                WaitForSync(m_Allocator.GetOldestFence(), true);
+                glDeleteSync(m_Allocator.RetireOldest());
+            }
+
+            return true;
+        }
+
+        // Fences the allocations made since the previous call
+        void Submit()
+        {
+            if (!m_Allocator.HasPendingAllocations())
+                return;
+
+            m_Allocator.Submit(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+            // Release the space of completed uploads without waiting
+            while (m_Allocator.GetNumFences() > 1 && WaitForSync(m_Allocator.GetOldestFence(), false))
+                glDeleteSync(m_Allocator.RetireOldest());
+        }
+
+    private:
+        UploadRingAllocator<GLsync> m_Allocator;
+    };
+
+    class ReadbackBuffer
+    {
+    public:
+        GLuint handle;
+        void* mappedData;
+        size_t size;
+
+        ReadbackBuffer(size_t bufferSize, bool directStateAccess)
+            : handle(0)
+            , mappedData(nullptr)
+            , size(bufferSize)
+        {
+            const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            if (directStateAccess)
+            {
+                glCreateBuffers(1, &handle);
+                glNamedBufferStorage(handle, bufferSize, nullptr, flags);
+                mappedData = glMapNamedBufferRange(handle, 0, bufferSize, flags);
+            }
+            else
+            {
+                glGenBuffers(1, &handle);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, handle);
+                glBufferStorage(GL_COPY_WRITE_BUFFER, bufferSize, nullptr, flags);
+                mappedData = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bufferSize, flags);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+            }
+        }
+
+        ~ReadbackBuffer()
+        {
+            // Deleting a mapped buffer unmaps it
+            if (handle)
+                glDeleteBuffers(1, &handle);
+        }
+    };
+
+    struct Readback
+    {
+        ReadbackBuffer* buffer;
+        GLsync fence;
+        size_t size;
+
+        Readback() : buffer(nullptr), fence(nullptr), size(0) { }
+    };
+
+    class StagingBuffers
+    {
+    public:
+        enum : uint32_t { UPLOAD_RING_SIZE = 16 * 1024 * 1024 };
+        enum : uint32_t { READBACK_GRANULARITY = 64 * 1024 };
+
+        UploadRing uploadRing;
+        SlotMap<Readback> readbacks;
+        std::vector<ReadbackBuffer*> freeReadbackBuffers;
+
+        ~StagingBuffers()
+        {
+            readbacks.ForEach([](SlotMap<Readback>::Id, Readback& readback) 
+            { 
+                glDeleteSync(readback.fence);
+                delete readback.buffer;
+            });
+
+            for (auto buffer : freeReadbackBuffers)
+                delete buffer;
+        }
+
+        ReadbackBuffer* AcquireReadbackBuffer(size_t size, bool directStateAccess)
+        {
+            for (size_t i = 0; i < freeReadbackBuffers.size(); i++)
+            {
+                ReadbackBuffer* buffer = freeReadbackBuffers[i];
+                if (buffer->size >= size)
+                {
+                    freeReadbackBuffers[i] = freeReadbackBuffers.back();
+                    freeReadbackBuffers.pop_back();
+                    return buffer;
+                }
+            }
+
+            size_t bufferSize = __max(READBACK_GRANULARITY, (size + READBACK_GRANULARITY - 1) & ~size_t(READBACK_GRANULARITY - 1));
+            ReadbackBuffer* buffer = new ReadbackBuffer(bufferSize, directStateAccess);
+            if (!buffer->mappedData)
+            {
+                delete buffer;
+                return nullptr;
+            }
+
+            return buffer;
+        }
+    };
+
     RendererInterfaceOGL::RendererInterfaceOGL(IErrorCallback* pErrorCallback) 
         : m_pErrorCallback(pErrorCallback)
         , m_nGraphicsPipeline(0)
@@ -323,7 +404,13 @@ namespace NVRHI
         , m_nVAO(0)
         , m_bConservativeRasterEnabled(false)
         , m_bForcedSampleCountEnabled(false)
+        , m_bDirectStateAccessSupported(false)
+        , m_bDirectStateAccess(false)
+        , m_bBindlessTextureSupported(false)
+        , m_CachedFrameBuffers(256)
+        , m_BindlessHandles(4096)
         , m_pCurrentFrameBuffer(nullptr)
+        , m_pStagingBuffers(nullptr)
     { 
         m_DefaultBackBuffer = new Texture();
     }
@@ -331,10 +418,7 @@ namespace NVRHI
 
     RendererInterfaceOGL::~RendererInterfaceOGL()
     {
-        for (auto& pair : m_CachedFrameBuffers)
-        {
-            delete pair.second;
-        }
+        m_CachedFrameBuffers.ForEach([](const PodKey<FrameBufferKey>&, FrameBuffer* framebuffer) { delete framebuffer; });
     
         if (m_nGraphicsPipeline)
         {
@@ -351,6 +435,7 @@ namespace NVRHI
             glDeleteVertexArrays(1, &m_nVAO);
         }
 
+        delete m_pStagingBuffers;
         delete m_DefaultBackBuffer;
     }
 
@@ -359,6 +444,21 @@ namespace NVRHI
     {
         glGenProgramPipelines(1, &m_nGraphicsPipeline);
         glGenProgramPipelines(1, &m_nComputePipeline);
+
+        GLint majorVersion = 0, minorVersion = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+        glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+        m_bDirectStateAccessSupported = majorVersion > 4 || (majorVersion == 4 && minorVersion >= 5) || isOpenGLExtensionSupported("GL_ARB_direct_state_access");
+        m_bDirectStateAccess = m_bDirectStateAccessSupported;
+        m_bBindlessTextureSupported = isOpenGLExtensionSupported("GL_ARB_bindless_texture");
+
+        m_pStagingBuffers = new StagingBuffers();
+        m_pStagingBuffers->uploadRing.Init(StagingBuffers::UPLOAD_RING_SIZE, m_bDirectStateAccess);
+    }
+
+    void RendererInterfaceOGL::setUseDirectStateAccess(bool enable)
+    {
+        m_bDirectStateAccess = enable && m_bDirectStateAccessSupported;
     }
 
     bool RendererInterfaceOGL::isOpenGLExtensionSupported(const char* name)
@@ -399,96 +499,73 @@ namespace NVRHI
         TextureHandle texture = new Texture();
         texture->desc = d;
         texture->formatMapping = formatMapping;
-        glGenTextures(1, &texture->handle);
 
         uint32_t numlayers = 1;
     
         if (d.isCubeMap)
         {
             texture->bindTarget = GL_TEXTURE_CUBE_MAP;
-            glBindTexture(texture->bindTarget, texture->handle);
-
-            glTexStorage2D(
-                texture->bindTarget,
-                d.mipLevels,
-                formatMapping.internalFormat,
-                d.width,
-                d.height);
-
             numlayers = 6;
-
-            CHECK_GL_ERROR();
         }
         else if (d.isArray)
         {
             texture->bindTarget = GL_TEXTURE_2D_ARRAY;
-            glBindTexture(texture->bindTarget, texture->handle);
-
-            glTexStorage3D(texture->bindTarget,
-                d.mipLevels,
-                formatMapping.internalFormat,
-                d.width,
-                d.height,
-                d.depthOrArraySize);
-
             numlayers = d.depthOrArraySize;
-
-            CHECK_GL_ERROR();
         }
         else if (d.depthOrArraySize > 0)
-        {
             texture->bindTarget = GL_TEXTURE_3D;
-            glBindTexture(texture->bindTarget, texture->handle);
-
-            glTexStorage3D(texture->bindTarget,
-                d.mipLevels,
-                formatMapping.internalFormat,
-                d.width,
-                d.height,
-                d.depthOrArraySize);
-
-            CHECK_GL_ERROR();
-        }
         else if (d.sampleCount > 1)
-        {
             texture->bindTarget = GL_TEXTURE_2D_MULTISAMPLE;
-            glBindTexture(texture->bindTarget, texture->handle);
+        else
+            texture->bindTarget = GL_TEXTURE_2D;
+
+        if (m_bDirectStateAccess)
+        {
+            glCreateTextures(texture->bindTarget, 1, &texture->handle);
 
-            glTexStorage2DMultisample(texture->bindTarget,
-                d.sampleCount,
-                formatMapping.internalFormat,
-                d.width,
-                d.height,
-                GL_FALSE);
+            if (texture->bindTarget == GL_TEXTURE_2D_ARRAY || texture->bindTarget == GL_TEXTURE_3D)
+                glTextureStorage3D(texture->handle, d.mipLevels, formatMapping.internalFormat, d.width, d.height, d.depthOrArraySize);
+            else if (texture->bindTarget == GL_TEXTURE_2D_MULTISAMPLE)
+                glTextureStorage2DMultisample(texture->handle, d.sampleCount, formatMapping.internalFormat, d.width, d.height, GL_FALSE);
+            else
+                glTextureStorage2D(texture->handle, d.mipLevels, formatMapping.internalFormat, d.width, d.height);
 
             CHECK_GL_ERROR();
+
+            if (d.sampleCount == 1)
+            {
+                glTextureParameteri(texture->handle, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTextureParameteri(texture->handle, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                CHECK_GL_ERROR();
+            }
         }
         else
         {
-            texture->bindTarget = GL_TEXTURE_2D;
+            glGenTextures(1, &texture->handle);
             glBindTexture(texture->bindTarget, texture->handle);
 
-            glTexStorage2D(
-                texture->bindTarget,
-                d.mipLevels,
-                formatMapping.internalFormat,
-                d.width,
-                d.height);
+            if (texture->bindTarget == GL_TEXTURE_2D_ARRAY || texture->bindTarget == GL_TEXTURE_3D)
+                glTexStorage3D(texture->bindTarget, d.mipLevels, formatMapping.internalFormat, d.width, d.height, d.depthOrArraySize);
+            else if (texture->bindTarget == GL_TEXTURE_2D_MULTISAMPLE)
+                glTexStorage2DMultisample(texture->bindTarget, d.sampleCount, formatMapping.internalFormat, d.width, d.height, GL_FALSE);
+            else
+                glTexStorage2D(texture->bindTarget, d.mipLevels, formatMapping.internalFormat, d.width, d.height);
 
             CHECK_GL_ERROR();
-        }
 
-        if (d.sampleCount == 1)
-        {
-            glTexParameteri(texture->bindTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(texture->bindTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            CHECK_GL_ERROR();
-        }
+            if (d.sampleCount == 1)
+            {
+                glTexParameteri(texture->bindTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(texture->bindTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                CHECK_GL_ERROR();
+            }
 
-        glBindTexture(texture->bindTarget, 0);
+            glBindTexture(texture->bindTarget, 0);
+        }
 
         if (formatMapping.abstractFormat == Format::SRGBA8_UNORM)
         {
+            // Texture views need a name that has not been bound yet, so there is no DSA way to create them
             glGenTextures(1, &texture->srgbView);
 
             glTextureView(
@@ -503,7 +580,13 @@ namespace NVRHI
 
             CHECK_GL_ERROR();
 
-            if (d.sampleCount == 1)
+            if (d.sampleCount == 1 && m_bDirectStateAccess)
+            {
+                glTextureParameteri(texture->srgbView, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTextureParameteri(texture->srgbView, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                CHECK_GL_ERROR();
+            }
+            else if (d.sampleCount == 1)
             {
                 glBindTexture(texture->bindTarget, texture->srgbView);
                 glTexParameteri(texture->bindTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -542,6 +625,9 @@ namespace NVRHI
 
     void RendererInterfaceOGL::clearTextureFloat(TextureHandle t, const Color& clearColor)
     {
+        RequireMemoryBarrier(t, GL_TEXTURE_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
+
         for (uint32_t nMipLevel = 0; nMipLevel < t->desc.mipLevels; ++nMipLevel)
         {
             glClearTexImage(t->handle, nMipLevel, t->formatMapping.baseFormat, GL_FLOAT, &clearColor);
@@ -554,6 +640,9 @@ namespace NVRHI
     {
         uint32_t colors[4] = { clearColor, clearColor, clearColor, clearColor };
 
+        RequireMemoryBarrier(t, GL_TEXTURE_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
+
         for (uint32_t nMipLevel = 0; nMipLevel < t->desc.mipLevels; ++nMipLevel)
         {
             glClearTexImage(t->handle, nMipLevel, t->formatMapping.baseFormat, GL_UNSIGNED_INT, colors);
@@ -564,25 +653,82 @@ namespace NVRHI
 
     void RendererInterfaceOGL::writeTexture(TextureHandle t, uint32_t subresource, const void* data, uint32_t rowPitch, uint32_t depthPitch)
     {
-        (void)rowPitch;
+        // Every call writes one 2D image, so only the row pitch matters
         (void)depthPitch;
 
-        glBindTexture(t->bindTarget, t->handle);
+        bool isLayered = t->desc.isArray || t->desc.depthOrArraySize > 0;
+        uint32_t mipLevel = isLayered ? 0 : subresource;
+        uint32_t width = __max(1, t->desc.width >> mipLevel);
+        uint32_t height = __max(1, t->desc.height >> mipLevel);
+        uint32_t bytesPerPixel = t->formatMapping.bytesPerPixel;
+        uint32_t packedRowPitch = width * bytesPerPixel;
 
-        if (t->desc.isArray || t->desc.depthOrArraySize > 0)
+        if (rowPitch == 0)
+            rowPitch = packedRowPitch;
+
+        if (rowPitch < packedRowPitch || rowPitch % bytesPerPixel != 0)
         {
-            glTexSubImage3D(t->bindTarget, 0, 0, 0, subresource, t->desc.width, t->desc.height, 1, t->formatMapping.baseFormat, t->formatMapping.type, data);
+            SIGNAL_ERROR_FMT("Invalid row pitch %d for a texture row of %d bytes", rowPitch, packedRowPitch);
+            return;
+        }
+
+        RequireMemoryBarrier(t, GL_TEXTURE_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
+
+        // Copy the data into the upload ring, so that the transfer to the texture is asynchronous.
+        // Uploads that don't fit into the ring go directly from client memory.
+        size_t dataSize = size_t(rowPitch) * (height - 1) + packedRowPitch;
+        NVRHI_STAT_UPLOAD(m_Statistics, dataSize);
+        UploadRing& ring = m_pStagingBuffers->uploadRing;
+        const void* pixels = data;
+        uint32_t offset = 0;
+        bool staged = ring.Allocate(dataSize, offset);
+
+        if (staged)
+        {
+            memcpy(ring.mappedData + offset, data, dataSize);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.handle);
+            pixels = (const void*)size_t(offset);
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, rowPitch / bytesPerPixel);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        if (m_bDirectStateAccess)
+        {
+            if (isLayered)
+                glTextureSubImage3D(t->handle, 0, 0, 0, subresource, width, height, 1, t->formatMapping.baseFormat, t->formatMapping.type, pixels);
+            else
+                glTextureSubImage2D(t->handle, mipLevel, 0, 0, width, height, t->formatMapping.baseFormat, t->formatMapping.type, pixels);
+
             CHECK_GL_ERROR();
         }
         else
         {
-            uint32_t width = __max(1, t->desc.width >> subresource);
-            uint32_t height = __max(1, t->desc.height >> subresource);
-            glTexSubImage2D(t->bindTarget, subresource, 0, 0, width, height, t->formatMapping.baseFormat, t->formatMapping.type, data);
-            CHECK_GL_ERROR();
+            glBindTexture(t->bindTarget, t->handle);
+
+            if (isLayered)
+            {
+                glTexSubImage3D(t->bindTarget, 0, 0, 0, subresource, width, height, 1, t->formatMapping.baseFormat, t->formatMapping.type, pixels);
+                CHECK_GL_ERROR();
+            }
+            else
+            {
+                glTexSubImage2D(t->bindTarget, mipLevel, 0, 0, width, height, t->formatMapping.baseFormat, t->formatMapping.type, pixels);
+                CHECK_GL_ERROR();
+            }
+
+            glBindTexture(t->bindTarget, 0);
         }
 
-        glBindTexture(t->bindTarget, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        if (staged)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+            ring.Submit();
+        }
     }
 
 
@@ -590,28 +736,8 @@ namespace NVRHI
     {
         if (!t) return;
 
-        if (t->usedInFrameBuffers)
-        {
-            std::vector<std::pair<uint32_t, FrameBuffer*>> fbToDelete;
-            for (auto it : m_CachedFrameBuffers)
-            {
-                if (it.second->depthTarget == t)
-                    fbToDelete.push_back(it);
-
-                for (uint32_t rt = 0; rt < 8; rt++)
-                    if (it.second->renderTargets[rt] == t)
-                    {
-                        fbToDelete.push_back(it);
-                        break;
-                    }
-            }
-
-            for (auto it : fbToDelete)
-            {
-                m_CachedFrameBuffers.erase(it.first);
-                delete it.second;
-            }
-        }
+        ReleaseFrameBuffersForTexture(t);
+        ReleaseBindlessHandles(t, nullptr);
 
         delete t;
     }
@@ -626,6 +752,19 @@ namespace NVRHI
     
         GLenum usage = d.canHaveUAVs ? GL_STREAM_COPY : GL_STREAM_DRAW;
 
+        if (m_bDirectStateAccess)
+        {
+            glCreateBuffers(1, &buffer->bufferHandle);
+            glNamedBufferData(buffer->bufferHandle, d.byteSize, data, usage);
+            CHECK_GL_ERROR();
+
+            glCreateTextures(GL_TEXTURE_BUFFER, 1, &buffer->ssboHandle);
+            glTextureBuffer(buffer->ssboHandle, GL_R32UI, buffer->bufferHandle);
+            CHECK_GL_ERROR();
+
+            return buffer;
+        }
+
         glGenBuffers(1, &buffer->bufferHandle);
         glBindBuffer(buffer->bindTarget, buffer->bufferHandle);
 
@@ -649,11 +788,23 @@ namespace NVRHI
 
     void RendererInterfaceOGL::writeBuffer(BufferHandle b, const void* data, size_t dataSize)
     {
-        glBindBuffer(b->bindTarget, b->bufferHandle);
+        RequireMemoryBarrier(b, GL_BUFFER_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
 
         if (dataSize > b->desc.byteSize)
             dataSize = b->desc.byteSize;
 
+        NVRHI_STAT_UPLOAD(m_Statistics, dataSize);
+
+        if (m_bDirectStateAccess)
+        {
+            glNamedBufferSubData(b->bufferHandle, 0, dataSize, data);
+            CHECK_GL_ERROR();
+            return;
+        }
+
+        glBindBuffer(b->bindTarget, b->bufferHandle);
+
         glBufferSubData(b->bindTarget, 0, dataSize, data);
         CHECK_GL_ERROR();
 
@@ -663,6 +814,16 @@ namespace NVRHI
 
     void RendererInterfaceOGL::clearBufferUInt(BufferHandle b, uint32_t clearValue)
     {
+        RequireMemoryBarrier(b, GL_BUFFER_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
+
+        if (m_bDirectStateAccess)
+        {
+            glClearNamedBufferData(b->bufferHandle, GL_R32UI, GL_RED, GL_UNSIGNED_INT, &clearValue);
+            CHECK_GL_ERROR();
+            return;
+        }
+
         glBindBuffer(b->bindTarget, b->bufferHandle);
 
         glClearBufferData(b->bindTarget, GL_R32UI, GL_RED, GL_UNSIGNED_INT, &clearValue);
@@ -674,6 +835,17 @@ namespace NVRHI
 
     void RendererInterfaceOGL::copyToBuffer(BufferHandle dest, uint32_t destOffsetBytes, BufferHandle src, uint32_t srcOffsetBytes, size_t dataSizeBytes)
     {
+        RequireMemoryBarrier(dest, GL_BUFFER_UPDATE_BARRIER_BIT, false);
+        RequireMemoryBarrier(src, GL_BUFFER_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
+
+        if (m_bDirectStateAccess)
+        {
+            glCopyNamedBufferSubData(src->bufferHandle, dest->bufferHandle, srcOffsetBytes, destOffsetBytes, dataSizeBytes);
+            CHECK_GL_ERROR();
+            return;
+        }
+
         glBindBuffer(GL_COPY_WRITE_BUFFER, dest->bufferHandle);
         glBindBuffer(GL_COPY_READ_BUFFER, src->bufferHandle);
 
@@ -683,7 +855,6 @@ namespace NVRHI
 
         glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
         glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
     }
 
 
@@ -696,21 +867,153 @@ namespace NVRHI
             nBytesToRead = b->desc.byteSize;
         }
 
-        glBindBuffer(GL_COPY_READ_BUFFER, b->bufferHandle);
+        ReadbackTicket ticket = beginReadBuffer(b, 0, nBytesToRead);
+
+        if (!ticket || !endReadback(ticket, data, dataSize, true))
+            *dataSize = 0;
+    }
+
+
+    RendererInterfaceOGL::ReadbackTicket RendererInterfaceOGL::beginReadBuffer(BufferHandle b, size_t offsetBytes, size_t sizeBytes)
+    {
+        if (offsetBytes + sizeBytes > b->desc.byteSize)
+        {
+            SIGNAL_ERROR("Readback range is out of the buffer bounds");
+            return 0;
+        }
+
+        ReadbackBuffer* readbackBuffer = m_pStagingBuffers->AcquireReadbackBuffer(sizeBytes, m_bDirectStateAccess);
+        if (!readbackBuffer)
+        {
+            SIGNAL_ERROR("Failed to create a readback buffer");
+            return 0;
+        }
+
+        RequireMemoryBarrier(b, GL_BUFFER_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
 
-        void* pMappedData = glMapBufferRange(GL_COPY_READ_BUFFER, 0, nBytesToRead, GL_MAP_READ_BIT);
-        if (pMappedData)
+        if (m_bDirectStateAccess)
         {
-            memcpy(data, pMappedData, nBytesToRead);
-            *dataSize = nBytesToRead;
+            glCopyNamedBufferSubData(b->bufferHandle, readbackBuffer->handle, offsetBytes, 0, sizeBytes);
         }
         else
         {
-            *dataSize = 0;
+            glBindBuffer(GL_COPY_READ_BUFFER, b->bufferHandle);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer->handle);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetBytes, 0, sizeBytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
         }
+        CHECK_GL_ERROR();
 
-        glUnmapBuffer(GL_COPY_READ_BUFFER);
-        glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+        Readback readback;
+        readback.buffer = readbackBuffer;
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.size = sizeBytes;
+
+        return m_pStagingBuffers->readbacks.Insert(readback);
+    }
+
+
+    RendererInterfaceOGL::ReadbackTicket RendererInterfaceOGL::beginReadTexture(TextureHandle t, uint32_t mipLevel)
+    {
+        if (t->desc.isCubeMap || t->desc.sampleCount > 1 || mipLevel >= t->desc.mipLevels)
+        {
+            SIGNAL_ERROR("Readback is only supported for existing mip levels of non-cube, single-sample textures");
+            return 0;
+        }
+
+        uint32_t width = __max(1, t->desc.width >> mipLevel);
+        uint32_t height = __max(1, t->desc.height >> mipLevel);
+        uint32_t depth = 1;
+        if (t->desc.isArray)
+            depth = t->desc.depthOrArraySize;
+        else if (t->desc.depthOrArraySize > 0)
+            depth = __max(1, t->desc.depthOrArraySize >> mipLevel);
+
+        size_t sizeBytes = size_t(width) * height * depth * t->formatMapping.bytesPerPixel;
+
+        ReadbackBuffer* readbackBuffer = m_pStagingBuffers->AcquireReadbackBuffer(sizeBytes, m_bDirectStateAccess);
+        if (!readbackBuffer)
+        {
+            SIGNAL_ERROR("Failed to create a readback buffer");
+            return 0;
+        }
+
+        RequireMemoryBarrier(t, GL_TEXTURE_UPDATE_BARRIER_BIT, false);
+        FlushMemoryBarriers();
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer->handle);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+        if (m_bDirectStateAccess)
+        {
+            glGetTextureImage(t->handle, mipLevel, t->formatMapping.baseFormat, t->formatMapping.type, GLsizei(sizeBytes), nullptr);
+        }
+        else
+        {
+            glBindTexture(t->bindTarget, t->handle);
+            glGetTexImage(t->bindTarget, mipLevel, t->formatMapping.baseFormat, t->formatMapping.type, nullptr);
+            glBindTexture(t->bindTarget, 0);
+        }
+        CHECK_GL_ERROR();
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+        Readback readback;
+        readback.buffer = readbackBuffer;
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.size = sizeBytes;
+
+        return m_pStagingBuffers->readbacks.Insert(readback);
+    }
+
+
+    bool RendererInterfaceOGL::isReadbackReady(ReadbackTicket ticket)
+    {
+        Readback* readback = m_pStagingBuffers->readbacks.Get(ticket);
+        if (!readback)
+        {
+            SIGNAL_ERROR("Invalid readback ticket");
+            return false;
+        }
+
+        return WaitForSync(readback->fence, false);
+    }
+
+
+    bool RendererInterfaceOGL::endReadback(ReadbackTicket ticket, void* data, size_t* dataSize, bool wait)
+    {
+        Readback* readback = m_pStagingBuffers->readbacks.Get(ticket);
+        if (!readback)
+        {
+            SIGNAL_ERROR("Invalid readback ticket");
+            return false;
+        }
+
+        if (!WaitForSync(readback->fence, wait))
+            return false;
+
+        size_t bytesToCopy = __min(*dataSize, readback->size);
+        memcpy(data, readback->buffer->mappedData, bytesToCopy);
+        *dataSize = bytesToCopy;
+
+        cancelReadback(ticket);
+        return true;
+    }
+
+
+    void RendererInterfaceOGL::cancelReadback(ReadbackTicket ticket)
+    {
+        Readback* readback = m_pStagingBuffers->readbacks.Get(ticket);
+        if (!readback)
+            return;
+
+        // The buffer can be reused right away: commands using it later are ordered after the copy
+        glDeleteSync(readback->fence);
+        m_pStagingBuffers->freeReadbackBuffers.push_back(readback->buffer);
+        m_pStagingBuffers->readbacks.Remove(ticket);
     }
 
 
@@ -728,12 +1031,21 @@ namespace NVRHI
 
         buffer->desc = d;
 
-        glGenBuffers(1, &buffer->handle);
-        glBindBuffer(GL_UNIFORM_BUFFER, buffer->handle);
-        glBufferData(GL_UNIFORM_BUFFER, d.byteSize, nullptr, GL_DYNAMIC_DRAW);
-        CHECK_GL_ERROR();
+        if (m_bDirectStateAccess)
+        {
+            glCreateBuffers(1, &buffer->handle);
+            glNamedBufferData(buffer->handle, d.byteSize, nullptr, GL_DYNAMIC_DRAW);
+            CHECK_GL_ERROR();
+        }
+        else
+        {
+            glGenBuffers(1, &buffer->handle);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer->handle);
+            glBufferData(GL_UNIFORM_BUFFER, d.byteSize, nullptr, GL_DYNAMIC_DRAW);
+            CHECK_GL_ERROR();
 
-        glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE);
+            glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE);
+        }
 
         if (data)
             writeConstantBuffer(buffer, data, d.byteSize);
@@ -744,6 +1056,16 @@ namespace NVRHI
 
     void RendererInterfaceOGL::writeConstantBuffer(ConstantBufferHandle b, const void* data, size_t dataSize)
     {
+        NVRHI_STAT_ADD(m_Statistics, constantBufferWrites, 1);
+        NVRHI_STAT_UPLOAD(m_Statistics, dataSize);
+
+        if (m_bDirectStateAccess)
+        {
+            glNamedBufferSubData(b->handle, 0, dataSize, data);
+            CHECK_GL_ERROR();
+            return;
+        }
+
         glBindBuffer(GL_UNIFORM_BUFFER, b->handle);
 
         glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
@@ -764,6 +1086,21 @@ namespace NVRHI
     {
         (void)binarySize;
 
+        // The source is a null-terminated string, and some callers pass a size that does not include the terminator
+        size_t sourceSize = strlen((const char*)binary);
+
+        // The creation commands set up driver state for the creation, so shaders created with them are only shared with each other
+        uint64_t variant = (d.preCreationCommand ? 1 : 0) | (d.postCreationCommand ? 2 : 0);
+        ShaderHandle cached = m_ShaderCache.Acquire(d.shaderType, variant, binary, sourceSize);
+        if (cached)
+        {
+            if (d.preCreationCommand)
+                d.preCreationCommand->dispose();
+            if (d.postCreationCommand)
+                d.postCreationCommand->dispose();
+            return cached;
+        }
+
         if (d.preCreationCommand)
             d.preCreationCommand->executeAndDispose();
 
@@ -828,6 +1165,7 @@ namespace NVRHI
             return nullptr;
         }
 
+        m_ShaderCache.Insert(d.shaderType, variant, binary, sourceSize, shader);
         return shader;
     }
 
@@ -835,6 +1173,10 @@ namespace NVRHI
     void RendererInterfaceOGL::destroyShader(ShaderHandle s)
     {
         if (!s) return;
+
+        // Other handles still use the program
+        if (!m_ShaderCache.Release(s)) return;
+
         delete s;
     }
 
@@ -876,6 +1218,9 @@ namespace NVRHI
     void RendererInterfaceOGL::destroySampler(SamplerHandle s)
     {
         if (!s) return;
+
+        ReleaseBindlessHandles(nullptr, s);
+
         delete s;
     }
 
@@ -929,6 +1274,7 @@ namespace NVRHI
                     continue;
                 }
 
+                RequireMemoryBarrier(binding->buffer, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT, false);
                 glBindBuffer(GL_ARRAY_BUFFER, binding->buffer->bufferHandle);
 
                 const FormatMapping& formatMapping = GetFormatMapping(attr.format);
@@ -967,6 +1313,9 @@ namespace NVRHI
 
         CHECK_GL_ERROR();
 
+        if (state.indexBuffer)
+            RequireMemoryBarrier(state.indexBuffer, GL_ELEMENT_ARRAY_BARRIER_BIT, false);
+
         SetShaders(state);
         BindShaderResources(state);
         BindRenderTargets(renderState);
@@ -975,6 +1324,8 @@ namespace NVRHI
         SetBlendState(renderState.blendState, state.renderState.targetCount);
         SetDepthStencilState(renderState.depthStencilState);
 
+        FlushMemoryBarriers();
+
         ClearRenderTargets(renderState); // requires the correct depth and maybe blend state
     }
 
@@ -992,6 +1343,13 @@ namespace NVRHI
 
     void RendererInterfaceOGL::BindRenderTargets(const RenderState& renderState)
     {
+        for (uint32_t rt = 0; rt < renderState.targetCount; rt++)
+            if (renderState.targets[rt] && renderState.targets[rt] != m_DefaultBackBuffer)
+                RequireMemoryBarrier(renderState.targets[rt], GL_FRAMEBUFFER_BARRIER_BIT, false);
+
+        if (renderState.depthTarget)
+            RequireMemoryBarrier(renderState.depthTarget, GL_FRAMEBUFFER_BARRIER_BIT, false);
+
         FrameBuffer* framebuffer = GetCachedFrameBuffer(renderState);
 
         if (framebuffer != m_pCurrentFrameBuffer)
@@ -1072,23 +1430,24 @@ namespace NVRHI
             return nullptr;
         }
 
-        CrcHash hasher;
+        PodKey<FrameBufferKey> key;
+        key.value.targetCount = renderState.targetCount;
         for (uint32_t rt = 0; rt < renderState.targetCount; rt++)
         {
-            hasher.Add(renderState.targets[rt]);
-            hasher.Add(renderState.targetIndicies[rt]);
-            hasher.Add(renderState.targetMipSlices[rt]);
+            key.value.targets[rt] = renderState.targets[rt];
+            key.value.targetIndices[rt] = renderState.targetIndicies[rt];
+            key.value.targetMipSlices[rt] = renderState.targetMipSlices[rt];
         }
-        hasher.Add(renderState.depthTarget);
-        hasher.Add(renderState.depthIndex);
-        hasher.Add(renderState.depthMipSlice);
-        uint32_t hash = hasher.Get();
+        key.value.depthTarget = renderState.depthTarget;
+        key.value.depthIndex = renderState.depthIndex;
+        key.value.depthMipSlice = renderState.depthMipSlice;
 
-        auto it = m_CachedFrameBuffers.find(hash);
-        if (it != m_CachedFrameBuffers.end())
-            return it->second;
+        FrameBuffer** cached = m_CachedFrameBuffers.Find(key);
+        if (cached)
+            return *cached;
 
         FrameBuffer* framebuffer = new FrameBuffer();
+        framebuffer->key = key;
 
         glGenFramebuffers(1, &framebuffer->handle);
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->handle);
@@ -1101,8 +1460,9 @@ namespace NVRHI
             }
             else if (renderState.targets[rt] != nullptr)
             {
-                framebuffer->renderTargets[rt] = renderState.targets[rt];
-                framebuffer->renderTargets[rt]->usedInFrameBuffers = true;
+                std::vector<FrameBuffer*>& dependents = m_FrameBuffersByTexture[renderState.targets[rt]];
+                if (dependents.empty() || dependents.back() != framebuffer)
+                    dependents.push_back(framebuffer);
 
                 if (renderState.targetIndicies[rt] == ~0u || renderState.targets[rt]->desc.depthOrArraySize == 0)
                     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + rt, renderState.targets[rt]->bindTarget, renderState.targets[rt]->handle, renderState.targetMipSlices[rt]);
@@ -1115,8 +1475,9 @@ namespace NVRHI
 
         if (renderState.depthTarget)
         {
-            framebuffer->depthTarget = renderState.depthTarget;
-            framebuffer->depthTarget->usedInFrameBuffers = true;
+            std::vector<FrameBuffer*>& dependents = m_FrameBuffersByTexture[renderState.depthTarget];
+            if (dependents.empty() || dependents.back() != framebuffer)
+                dependents.push_back(framebuffer);
 
             GLenum attachment;
 
@@ -1139,14 +1500,169 @@ namespace NVRHI
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        m_CachedFrameBuffers[hash] = framebuffer;
+        NVRHI_STAT_ADD(m_Statistics, stateCacheMisses, 1);
+
+        std::vector<FrameBuffer*> evicted;
+        m_CachedFrameBuffers.Insert(key, framebuffer, evicted);
+        for (auto fb : evicted)
+            ReleaseFrameBuffer(fb);
 
         return framebuffer;
     }
 
+    // Deletes a framebuffer that is no longer in the cache and removes it from the texture dependency lists
+    void RendererInterfaceOGL::ReleaseFrameBuffer(FrameBuffer* framebuffer)
+    {
+        const FrameBufferKey& key = framebuffer->key.value;
+
+        for (uint32_t rt = 0; rt <= key.targetCount; rt++)
+        {
+            TextureHandle t = (rt < key.targetCount) ? key.targets[rt] : key.depthTarget;
+            if (!t)
+                continue;
+
+            auto it = m_FrameBuffersByTexture.find(t);
+            if (it == m_FrameBuffersByTexture.end())
+                continue;
+
+            std::vector<FrameBuffer*>& dependents = it->second;
+            for (size_t i = 0; i < dependents.size(); i++)
+            {
+                if (dependents[i] == framebuffer)
+                {
+                    dependents[i] = dependents.back();
+                    dependents.pop_back();
+                    break;
+                }
+            }
+
+            if (dependents.empty())
+                m_FrameBuffersByTexture.erase(it);
+        }
+
+        // Deleting a bound framebuffer reverts the binding to 0
+        if (m_pCurrentFrameBuffer == framebuffer)
+            m_pCurrentFrameBuffer = nullptr;
+
+        delete framebuffer;
+    }
+
+    void RendererInterfaceOGL::ReleaseFrameBuffersForTexture(TextureHandle t)
+    {
+        auto it = m_FrameBuffersByTexture.find(t);
+        if (it == m_FrameBuffersByTexture.end())
+            return;
+
+        // ReleaseFrameBuffer modifies the dependency lists
+        std::vector<FrameBuffer*> dependents;
+        dependents.swap(it->second);
+        m_FrameBuffersByTexture.erase(it);
+
+        for (auto framebuffer : dependents)
+        {
+            m_CachedFrameBuffers.Erase(framebuffer->key);
+            ReleaseFrameBuffer(framebuffer);
+        }
+    }
+
+    void RendererInterfaceOGL::setFrameBufferCacheCapacity(uint32_t capacity)
+    {
+        std::vector<FrameBuffer*> evicted;
+        m_CachedFrameBuffers.SetCapacity(capacity, evicted);
+        for (auto framebuffer : evicted)
+            ReleaseFrameBuffer(framebuffer);
+    }
+
+    uint64_t RendererInterfaceOGL::getBindlessTextureHandle(TextureHandle t, SamplerHandle s)
+    {
+        if (!m_bBindlessTextureSupported)
+        {
+            SIGNAL_ERROR("ARB_bindless_texture is not supported");
+            return 0;
+        }
+
+        if (!t || !s || t == m_DefaultBackBuffer)
+        {
+            SIGNAL_ERROR("Invalid texture or sampler for a bindless handle");
+            return 0;
+        }
+
+        // Sampling through the handle is not visible to BindShaderResources, so check for shader writes here
+        RequireMemoryBarrier(t, GL_TEXTURE_FETCH_BARRIER_BIT, false);
+
+        PodKey<BindlessTextureKey> key;
+        key.value.texture = t;
+        key.value.sampler = s;
+
+        uint64_t* cached = m_BindlessHandles.Find(key);
+        if (cached)
+            return *cached;
+
+        // GL returns the same handle for the same pair every time, so an evicted handle is simply made resident again
+        GLuint texture = (t->formatMapping.abstractFormat == Format::SRGBA8_UNORM) ? t->srgbView : t->handle;
+        GLuint64 handle = glGetTextureSamplerHandleARB(texture, s->handle);
+        if (!handle)
+        {
+            SIGNAL_ERROR("Failed to create a bindless texture handle");
+            return 0;
+        }
+
+        glMakeTextureHandleResidentARB(handle);
+        CHECK_GL_ERROR();
+
+        // Handles of the current frame may already be written into buffers that the frame's draw calls read,
+        // so only handles of earlier frames are evicted to stay within the limit
+        std::vector<uint64_t> evicted;
+        m_BindlessHandles.Insert(key, handle, evicted);
+        MakeBindlessHandlesNonResident(evicted);
+
+        return handle;
+    }
+
+    void RendererInterfaceOGL::beginBindlessHandleFrame()
+    {
+        std::vector<uint64_t> evicted;
+        m_BindlessHandles.BeginFrame(evicted);
+        MakeBindlessHandlesNonResident(evicted);
+    }
+
+    void RendererInterfaceOGL::setBindlessResidencyLimit(uint32_t limit)
+    {
+        std::vector<uint64_t> evicted;
+        m_BindlessHandles.SetLimit(limit, evicted);
+        MakeBindlessHandlesNonResident(evicted);
+    }
+
+    StateCacheStats RendererInterfaceOGL::getBindlessHandleStats()
+    {
+        return m_BindlessHandles.GetStats();
+    }
+
+    void RendererInterfaceOGL::MakeBindlessHandlesNonResident(const std::vector<uint64_t>& handles)
+    {
+        for (uint64_t handle : handles)
+            glMakeTextureHandleNonResidentARB(handle);
+    }
+
+    void RendererInterfaceOGL::ReleaseBindlessHandles(TextureHandle t, SamplerHandle s)
+    {
+        if (m_BindlessHandles.GetSize() == 0)
+            return;
+
+        std::vector<uint64_t> removed;
+        m_BindlessHandles.RemoveIf([t, s](const PodKey<BindlessTextureKey>& key, uint64_t) 
+        {
+            return key.value.texture == t || key.value.sampler == s; 
+        }, removed);
+
+        MakeBindlessHandlesNonResident(removed);
+    }
+
 
     void RendererInterfaceOGL::SetShaders(const DrawCallState& state)
     {
+        NVRHI_STAT_ADD(m_Statistics, stateChanges, 1);
+
         glUseProgramStages(m_nGraphicsPipeline, GL_VERTEX_SHADER_BIT,           state.VS.shader ? state.VS.shader->handle : GL_NONE);
         glUseProgramStages(m_nGraphicsPipeline, GL_TESS_CONTROL_SHADER_BIT,     state.HS.shader ? state.HS.shader->handle : GL_NONE);
         glUseProgramStages(m_nGraphicsPipeline, GL_TESS_EVALUATION_SHADER_BIT,  state.DS.shader ? state.DS.shader->handle : GL_NONE);
@@ -1177,6 +1693,7 @@ namespace NVRHI
                     if (binding.format != Format::UNKNOWN)
                         format = GetFormatMapping(binding.format).internalFormat;
 
+                    RequireMemoryBarrier(binding.texture, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT, true);
                     glBindImageTexture(binding.slot, binding.texture->handle, binding.mipLevel, GL_TRUE, 0, GL_READ_WRITE, format);
                     CHECK_GL_ERROR();
 
@@ -1184,6 +1701,7 @@ namespace NVRHI
                 }
                 else
                 {
+                    RequireMemoryBarrier(binding.texture, GL_TEXTURE_FETCH_BARRIER_BIT, false);
                     glActiveTexture(GL_TEXTURE0 + binding.slot);
 
                     if(binding.texture->formatMapping.abstractFormat == Format::SRGBA8_UNORM)
@@ -1223,11 +1741,13 @@ namespace NVRHI
 
             if (binding.isWritable || binding.buffer->desc.structStride > 0)
             {
+                RequireMemoryBarrier(binding.buffer, GL_SHADER_STORAGE_BARRIER_BIT, binding.isWritable);
                 glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding.slot, binding.buffer->bufferHandle);
                 m_vecBoundBuffers.push_back(binding.slot);
             }
             else
             {
+                RequireMemoryBarrier(binding.buffer, GL_TEXTURE_FETCH_BARRIER_BIT, false);
                 glActiveTexture(GL_TEXTURE0 + binding.slot);
                 glBindTexture(GL_TEXTURE_BUFFER, binding.buffer->ssboHandle);
                 glActiveTexture(GL_TEXTURE0);
@@ -1245,6 +1765,41 @@ namespace NVRHI
         BindShaderResources(state.PS);
     }
 
+    void RendererInterfaceOGL::RequireMemoryBarrier(ShaderWriteState* resource, uint32_t barrierBits, bool unorderedAccess)
+    {
+        m_MemoryBarriers.Require(*resource, barrierBits, unorderedAccess);
+    }
+
+    void RendererInterfaceOGL::FlushMemoryBarriers()
+    {
+        uint32_t barrierBits = m_MemoryBarriers.Flush();
+
+        if (barrierBits)
+        {
+            glMemoryBarrier(barrierBits);
+            NVRHI_STAT_ADD(m_Statistics, barriers, 1);
+        }
+    }
+
+    void RendererInterfaceOGL::FlushAllMemoryBarriers()
+    {
+        if (m_MemoryBarriers.FlushAll())
+        {
+            glMemoryBarrier(GL_ALL_BARRIER_BITS);
+            NVRHI_STAT_ADD(m_Statistics, barriers, 1);
+        }
+    }
+
+    void RendererInterfaceOGL::setEnableUavBarriersForTexture(TextureHandle texture, bool enableBarriers)
+    {
+        texture->SetEnableUavBarriers(enableBarriers);
+    }
+
+    void RendererInterfaceOGL::setEnableUavBarriersForBuffer(BufferHandle buffer, bool enableBarriers)
+    {
+        buffer->SetEnableUavBarriers(enableBarriers);
+    }
+
 
     void RendererInterfaceOGL::SetRasterState(const RasterState& rasterState)
     {
@@ -1434,12 +1989,13 @@ namespace NVRHI
     void RendererInterfaceOGL::draw(const DrawCallState& state, const DrawArguments* args, uint32_t numDrawCalls)
     {
         ApplyState(state);
+        NVRHI_STAT_DRAWS(m_Statistics, args, numDrawCalls);
 
         uint32_t nPrimType = convertPrimType(state.primType);
 
         for (uint32_t n = 0; n < numDrawCalls; n++)
         {
-            glDrawArraysInstanced(nPrimType, args[n].startVertexLocation, args[n].vertexCount, args[n].instanceCount);
+            glDrawArraysInstancedBaseInstance(nPrimType, args[n].startVertexLocation, args[n].vertexCount, args[n].instanceCount, args[n].startInstanceLocation);
             CHECK_GL_ERROR();
         }
 
@@ -1451,6 +2007,7 @@ namespace NVRHI
     void RendererInterfaceOGL::drawIndexed(const DrawCallState& state, const DrawArguments* args, uint32_t numDrawCalls)
     {
         ApplyState(state);
+        NVRHI_STAT_DRAWS(m_Statistics, args, numDrawCalls);
 
         if (state.indexBuffer)
         {
@@ -1462,7 +2019,8 @@ namespace NVRHI
         for (uint32_t n = 0; n < numDrawCalls; n++)
         {
             uint32_t indexOffset = args[n].startIndexLocation * 4 + state.indexBufferOffset;
-            glDrawElementsBaseVertex(nPrimType, args[n].vertexCount, GL_UNSIGNED_INT, (const void*)size_t(indexOffset), args[n].startVertexLocation);
+            glDrawElementsInstancedBaseVertexBaseInstance(nPrimType, args[n].vertexCount, GL_UNSIGNED_INT, (const void*)size_t(indexOffset), 
+                args[n].instanceCount, args[n].startVertexLocation, args[n].startInstanceLocation);
             CHECK_GL_ERROR();
         }
 
@@ -1478,7 +2036,9 @@ namespace NVRHI
 
     void RendererInterfaceOGL::drawIndirect(const DrawCallState& state, BufferHandle indirectParams, uint32_t offsetBytes)
     {
+        RequireMemoryBarrier(indirectParams, GL_COMMAND_BARRIER_BIT, false);
         ApplyState(state);
+        NVRHI_STAT_ADD(m_Statistics, indirectDrawCalls, 1);
 
         glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectParams->bufferHandle);
 
@@ -1494,12 +2054,10 @@ namespace NVRHI
     void RendererInterfaceOGL::dispatch(const NVRHI::DispatchState& state, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ)
     {
         ApplyState(state);
+        NVRHI_STAT_ADD(m_Statistics, dispatches, 1);
 
         glDispatchCompute(groupsX, groupsY, groupsZ);
 
-        // TODO:
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-
         CHECK_GL_ERROR();
 
         RestoreDefaultState();
@@ -1509,7 +2067,9 @@ namespace NVRHI
 
     void RendererInterfaceOGL::dispatchIndirect(const DispatchState& state, BufferHandle indirectParams, uint32_t offsetBytes)
     {
+        RequireMemoryBarrier(indirectParams, GL_COMMAND_BARRIER_BIT, false);
         ApplyState(state);
+        NVRHI_STAT_ADD(m_Statistics, indirectDispatches, 1);
 
         glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirectParams->bufferHandle);
 
@@ -1519,18 +2079,20 @@ namespace NVRHI
 
         glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, GL_NONE);
 
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-
         RestoreDefaultState();
     }
 
 
     void RendererInterfaceOGL::ApplyState(const DispatchState& state)
     {
+        NVRHI_STAT_ADD(m_Statistics, stateChanges, 1);
+
         glUseProgramStages(m_nComputePipeline, GL_COMPUTE_SHADER_BIT, state.shader->handle);
         glBindProgramPipeline(m_nComputePipeline);
 
         BindShaderResources(state);
+
+        FlushMemoryBarriers();
     }
 
     void RendererInterfaceOGL::checkGLError(const char* file, int line)
@@ -1576,6 +2138,7 @@ namespace NVRHI
     void RendererInterfaceOGL::executeRenderThreadCommand(IRenderThreadCommand* onCommand)
     {
         //we have a simple implementation
+        FlushAllMemoryBarriers();
         onCommand->executeAndDispose();
     }
 
@@ -1748,6 +2311,8 @@ namespace NVRHI
     {
         for (auto t : m_NonManagedTextures)
         {
+            ReleaseFrameBuffersForTexture(t);
+            ReleaseBindlessHandles(t, nullptr);
             t->handle = 0; // prevent glDeleteTextures call in ~Texture
             delete t;
         }
@@ -11,13 +11,38 @@
 #pragma once
 
 #include <GFSDK_NVRHI.h>
+#include "GFSDK_NVRHI_MemoryBarriers.h"
+#include "GFSDK_NVRHI_ShaderCache.h"
+#include "GFSDK_NVRHI_StateCache.h"
+#include "GFSDK_NVRHI_Statistics.h"
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 namespace NVRHI
 {
     class FrameBuffer;
+    class StagingBuffers;
+
+    // Full attachment tuple of a framebuffer; entries past targetCount stay zero
+    struct FrameBufferKey
+    {
+        TextureHandle targets[8];
+        uint32_t targetIndices[8];
+        uint32_t targetMipSlices[8];
+        uint32_t targetCount;
+        TextureHandle depthTarget;
+        uint32_t depthIndex;
+        uint32_t depthMipSlice;
+    };
+
+    // Texture/sampler pair of a bindless texture handle
+    struct BindlessTextureKey
+    {
+        TextureHandle texture;
+        SamplerHandle sampler;
+    };
 
     class RendererInterfaceOGL : public IRendererInterface
     {
@@ -79,18 +104,53 @@ namespace NVRHI
 
         uint32_t                getNumberOfAFRGroups() override { return 1; }
         uint32_t                getAFRGroupOfCurrentFrame(uint32_t) override { return 0; }
-        void                    setEnableUavBarriersForTexture(TextureHandle, bool) override { }
-        void                    setEnableUavBarriersForBuffer(BufferHandle, bool) override { }
+        void                    setEnableUavBarriersForTexture(TextureHandle texture, bool enableBarriers) override;
+        void                    setEnableUavBarriersForBuffer(BufferHandle buffer, bool enableBarriers) override;
+
+        bool                    setEnableStatistics(bool enable) override { return m_Statistics.SetEnabled(enable); }
+        void                    endStatisticsFrame() override { m_Statistics.EndFrame(); }
+        bool                    getFrameStatistics(RendererStatistics& stats) override { return m_Statistics.GetLastFrame(stats); }
 
         void                    ApplyState(const DrawCallState& state);
         void                    RestoreDefaultState();
         void                    UnbindFrameBuffer();
+        void                    FlushAllMemoryBarriers(); // makes all shader writes visible to code outside of NVRHI
+
+        // Resource creation and updates use ARB_direct_state_access when it's supported; this can force the bind-to-edit path
+        void                    setUseDirectStateAccess(bool enable);
+        bool                    isUsingDirectStateAccess() { return m_bDirectStateAccess; }
 
         TextureHandle           getHandleForDefaultBackBuffer() { return m_DefaultBackBuffer; }
         TextureHandle           getHandleForTexture(uint32_t target, uint32_t texture);
         uint32_t                getTextureOpenGLName(TextureHandle t);
         void                    releaseNonManagedTextures();
 
+        // Non-blocking readback: the copy into a staging buffer is queued on the GPU, and the data can be fetched
+        // once the ticket is ready. Every ticket has to be ended with endReadback or cancelReadback.
+        typedef uintptr_t       ReadbackTicket;
+        ReadbackTicket          beginReadBuffer(BufferHandle b, size_t offsetBytes, size_t sizeBytes);
+        ReadbackTicket          beginReadTexture(TextureHandle t, uint32_t mipLevel); // all layers of the mip level, tightly packed
+        bool                    isReadbackReady(ReadbackTicket ticket);
+        bool                    endReadback(ReadbackTicket ticket, void* data, size_t* dataSize, bool wait);
+        void                    cancelReadback(ReadbackTicket ticket);
+
+        // 0 means unbounded. Evicted framebuffer objects are deleted immediately.
+        void                    setFrameBufferCacheCapacity(uint32_t capacity);
+        StateCacheStats         getFrameBufferCacheStats() { return m_CachedFrameBuffers.GetStats(); }
+
+        // ARB_bindless_texture: the handle for a texture/sampler pair is created and made resident on first use.
+        // The number of resident handles is bounded by an LRU, so a handle must be requested again in every frame
+        // that uses it. Handles requested since the last beginBindlessHandleFrame call are never made non-resident;
+        // if they exceed the limit, the limit is enforced at the next frame boundary instead. 0 means unbounded.
+        bool                    isBindlessTextureSupported() { return m_bBindlessTextureSupported; }
+        void                    beginBindlessHandleFrame();
+        uint64_t                getBindlessTextureHandle(TextureHandle t, SamplerHandle s);
+        void                    setBindlessResidencyLimit(uint32_t limit);
+        StateCacheStats         getBindlessHandleStats();
+
+        // createShader calls with identical source return the same program object; destroyShader releases a reference.
+        ShaderCacheStats        getShaderCacheStats() { return m_ShaderCache.GetStats(); }
+
     protected:
 
         IErrorCallback*         m_pErrorCallback;
@@ -107,16 +167,31 @@ namespace NVRHI
         std::vector<std::pair<uint32_t, uint32_t> > m_vecBoundTextures;
         bool                    m_bConservativeRasterEnabled;
         bool                    m_bForcedSampleCountEnabled;
-
-        std::map<uint32_t, FrameBuffer*> m_CachedFrameBuffers;
+        bool                    m_bDirectStateAccessSupported;
+        bool                    m_bDirectStateAccess;
+        bool                    m_bBindlessTextureSupported;
+
+        StateCache<PodKey<FrameBufferKey>, FrameBuffer*> m_CachedFrameBuffers;
+        std::unordered_map<TextureHandle, std::vector<FrameBuffer*>> m_FrameBuffersByTexture;
+        FramePinnedCache<PodKey<BindlessTextureKey>, uint64_t> m_BindlessHandles;
+        ShaderCache             m_ShaderCache;
         std::vector<TextureHandle> m_NonManagedTextures;
         TextureHandle           m_DefaultBackBuffer;
         FrameBuffer*            m_pCurrentFrameBuffer;
+        StagingBuffers*         m_pStagingBuffers;
         NVRHI::Viewport         m_vCurrentViewports[16];
         NVRHI::Rect             m_vCurrentScissorRects[16];
         bool                    m_bCurrentViewportsValid;
 
+        MemoryBarrierTracker    m_MemoryBarriers;
+
+        StatisticsCollector     m_Statistics;
+
         FrameBuffer*            GetCachedFrameBuffer(const RenderState& state);
+        void                    ReleaseFrameBuffer(FrameBuffer* framebuffer);
+        void                    ReleaseFrameBuffersForTexture(TextureHandle t);
+        void                    ReleaseBindlessHandles(TextureHandle t, SamplerHandle s);
+        void                    MakeBindlessHandlesNonResident(const std::vector<uint64_t>& handles);
 
         void                    BindVAO();
         void                    BindRenderTargets(const RenderState& renderState);
@@ -128,6 +203,9 @@ namespace NVRHI
         void                    BindShaderResources(const PipelineStageBindings& state);
         void                    BindShaderResources(const DrawCallState& state);
 
+        void                    RequireMemoryBarrier(ShaderWriteState* resource, uint32_t barrierBits, bool unorderedAccess);
+        void                    FlushMemoryBarriers();
+
         void                    ApplyState(const DispatchState& state);
 
         void                    checkGLError(const char* file, int line);
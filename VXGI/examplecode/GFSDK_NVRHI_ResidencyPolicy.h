@@ -0,0 +1,175 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+namespace NVRHI
+{
+    // LRU bookkeeping for residency management, independent of the graphics API.
+    // Objects are identified by opaque keys and carry the fence value of the command list that used them last;
+    // objects whose last use has not completed on the GPU are never selected for eviction.
+    class ResidencyPolicy
+    {
+    public:
+        typedef const void* ObjectKey;
+
+        ResidencyPolicy()
+            : m_ResidentBytes(0)
+            , m_EvictedBytes(0)
+            , m_NumEvicted(0)
+            , m_NumPinned(0)
+            , m_FrameEvictions(0)
+            , m_FrameEvictedBytes(0)
+            , m_FrameMadeResident(0)
+            , m_FrameMadeResidentBytes(0)
+        { }
+
+        void AddObject(ObjectKey key, uint64_t size)
+        {
+            if (m_Index.find(key) != m_Index.end())
+                return;
+
+            Entry entry;
+            entry.key = key;
+            entry.size = size;
+            entry.lastUsedFence = 0;
+            entry.resident = true;
+
+            m_Index[key] = m_Lru.insert(m_Lru.end(), entry);
+            m_ResidentBytes += size;
+        }
+
+        void RemoveObject(ObjectKey key)
+        {
+            auto it = m_Index.find(key);
+            if (it == m_Index.end())
+                return;
+
+            const Entry& entry = *it->second;
+            if (entry.resident)
+                m_ResidentBytes -= entry.size;
+            else
+            {
+                m_EvictedBytes -= entry.size;
+                m_NumEvicted--;
+            }
+
+            m_Lru.erase(it->second);
+            m_Index.erase(it);
+        }
+
+        // Moves the object to the most recently used end of the list.
+        // Returns true if the object was evicted, in which case it has to be made resident before the GPU uses it.
+        bool MarkUsed(ObjectKey key, uint64_t fence)
+        {
+            auto it = m_Index.find(key);
+            if (it == m_Index.end())
+                return false;
+
+            Entry& entry = *it->second;
+            entry.lastUsedFence = std::max(entry.lastUsedFence, fence);
+            m_Lru.splice(m_Lru.end(), m_Lru, it->second);
+
+            if (entry.resident)
+                return false;
+
+            entry.resident = true;
+            m_ResidentBytes += entry.size;
+            m_EvictedBytes -= entry.size;
+            m_NumEvicted--;
+            m_FrameMadeResident++;
+            m_FrameMadeResidentBytes += entry.size;
+            return true;
+        }
+
+        // Selects the least recently used objects to evict so that the usage drops to targetUsage.
+        // Objects used by fences after completedFence are pinned.
+        void SelectEvictions(uint64_t currentUsage, uint64_t targetUsage, uint64_t completedFence, uint32_t maxObjects, std::vector<ObjectKey>& result)
+        {
+            m_NumPinned = 0;
+            for (const auto& entry : m_Lru)
+                if (entry.resident && entry.lastUsedFence > completedFence)
+                    m_NumPinned++;
+
+            if (currentUsage <= targetUsage)
+                return;
+
+            uint64_t bytesToFree = currentUsage - targetUsage;
+            uint64_t freedBytes = 0;
+
+            for (auto& entry : m_Lru)
+            {
+                if (freedBytes >= bytesToFree || result.size() >= maxObjects)
+                    break;
+
+                // The list is ordered by last use, so the objects after the first in-flight one are in flight too,
+                // or were added after it and have not been used yet; neither kind is worth evicting
+                if (entry.lastUsedFence > completedFence)
+                    break;
+
+                if (!entry.resident)
+                    continue;
+
+                entry.resident = false;
+                m_ResidentBytes -= entry.size;
+                m_EvictedBytes += entry.size;
+                m_NumEvicted++;
+                m_FrameEvictions++;
+                m_FrameEvictedBytes += entry.size;
+                freedBytes += entry.size;
+                result.push_back(entry.key);
+            }
+        }
+
+        void ResetFrameCounters()
+        {
+            m_FrameEvictions = 0;
+            m_FrameEvictedBytes = 0;
+            m_FrameMadeResident = 0;
+            m_FrameMadeResidentBytes = 0;
+        }
+
+        uint64_t GetResidentBytes() const { return m_ResidentBytes; }
+        uint64_t GetEvictedBytes() const { return m_EvictedBytes; }
+        uint32_t GetNumResident() const { return uint32_t(m_Lru.size()) - m_NumEvicted; }
+        uint32_t GetNumEvicted() const { return m_NumEvicted; }
+        uint32_t GetNumPinned() const { return m_NumPinned; }
+        uint32_t GetFrameEvictions() const { return m_FrameEvictions; }
+        uint64_t GetFrameEvictedBytes() const { return m_FrameEvictedBytes; }
+        uint32_t GetFrameMadeResident() const { return m_FrameMadeResident; }
+        uint64_t GetFrameMadeResidentBytes() const { return m_FrameMadeResidentBytes; }
+
+    private:
+        struct Entry
+        {
+            ObjectKey key;
+            uint64_t size;
+            uint64_t lastUsedFence;
+            bool resident;
+        };
+
+        std::list<Entry> m_Lru;     // least recently used first
+        std::unordered_map<ObjectKey, std::list<Entry>::iterator> m_Index;
+        uint64_t m_ResidentBytes;
+        uint64_t m_EvictedBytes;
+        uint32_t m_NumEvicted;
+        uint32_t m_NumPinned;
+        uint32_t m_FrameEvictions;
+        uint64_t m_FrameEvictedBytes;
+        uint32_t m_FrameMadeResident;
+        uint64_t m_FrameMadeResidentBytes;
+    };
+}
@@ -0,0 +1,138 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+#include <GFSDK_NVRHI.h>
+#include "GFSDK_NVRHI_Hash.h"
+
+namespace NVRHI
+{
+    struct ShaderCacheStats
+    {
+        uint64_t hits;              // createShader calls that returned an existing shader object
+        uint64_t misses;
+        uint64_t collisions;        // lookups that found an entry with the same hash but a different key
+        uint64_t bytesDeduplicated; // bytecode size of all hits
+        uint32_t uniqueShaders;     // shader objects in the cache
+        uint32_t references;        // handles to them that have not been destroyed yet
+
+        ShaderCacheStats() { memset(this, 0, sizeof(*this)); }
+    };
+
+    // Reference-counted cache of shader objects. A shader is identified by its type, the bytecode and a "variant"
+    // hash of the creation parameters that are not part of the bytecode (metadata, extensions etc.), which the backend
+    // computes. Lookups compare the full bytecode, so hash collisions never return a wrong shader.
+    // createShader calls with identical inputs share one object; it is destroyed when the last handle is released.
+    class ShaderCache
+    {
+    public:
+        // Returns the cached shader and adds a reference to it, or returns null
+        ShaderHandle Acquire(ShaderType::Enum type, uint64_t variant, const void* bytecode, size_t size)
+        {
+            uint64_t hash = HashKey(type, variant, bytecode, size);
+
+            auto range = m_ShadersByHash.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                Entry& entry = m_Entries[it->second];
+                if (entry.type == type && entry.variant == variant && entry.bytecode.size() == size &&
+                    (size == 0 || memcmp(entry.bytecode.data(), bytecode, size) == 0))
+                {
+                    entry.refCount++;
+                    m_Stats.hits++;
+                    m_Stats.bytesDeduplicated += size;
+                    return it->second;
+                }
+
+                m_Stats.collisions++;
+            }
+
+            m_Stats.misses++;
+            return nullptr;
+        }
+
+        // Adds a shader that Acquire did not find, with one reference
+        void Insert(ShaderType::Enum type, uint64_t variant, const void* bytecode, size_t size, ShaderHandle shader)
+        {
+            Entry& entry = m_Entries[shader];
+            entry.type = type;
+            entry.variant = variant;
+            entry.hash = HashKey(type, variant, bytecode, size);
+            entry.bytecode.assign((const char*)bytecode, (const char*)bytecode + size);
+            entry.refCount = 1;
+
+            m_ShadersByHash.insert(std::make_pair(entry.hash, shader));
+        }
+
+        // Drops a reference. Returns true if the caller should destroy the shader object: either that was the last
+        // reference, or the shader is not in the cache (e.g. it was created from an API interface).
+        bool Release(ShaderHandle shader)
+        {
+            auto it = m_Entries.find(shader);
+            if (it == m_Entries.end())
+                return true;
+
+            if (--it->second.refCount != 0)
+                return false;
+
+            auto range = m_ShadersByHash.equal_range(it->second.hash);
+            for (auto byHash = range.first; byHash != range.second; ++byHash)
+            {
+                if (byHash->second == shader)
+                {
+                    m_ShadersByHash.erase(byHash);
+                    break;
+                }
+            }
+
+            m_Entries.erase(it);
+            return true;
+        }
+
+        bool Contains(ShaderHandle shader) const { return m_Entries.count(shader) != 0; }
+
+        ShaderCacheStats GetStats() const
+        {
+            ShaderCacheStats stats = m_Stats;
+            stats.uniqueShaders = uint32_t(m_Entries.size());
+            for (auto& it : m_Entries)
+                stats.references += it.second.refCount;
+            return stats;
+        }
+
+        void ResetStats() { m_Stats = ShaderCacheStats(); }
+
+    private:
+        struct Entry
+        {
+            ShaderType::Enum type;
+            uint64_t variant;
+            uint64_t hash;
+            std::vector<char> bytecode;
+            uint32_t refCount;
+
+            Entry() : type(ShaderType::SHADER_VERTEX), variant(0), hash(0), refCount(0) { }
+        };
+
+        std::unordered_map<ShaderHandle, Entry> m_Entries;
+        std::unordered_multimap<uint64_t, ShaderHandle> m_ShadersByHash;
+        ShaderCacheStats m_Stats;
+
+        static uint64_t HashKey(ShaderType::Enum type, uint64_t variant, const void* bytecode, size_t size)
+        {
+            return Hash::HashBytes(bytecode, size, Hash::HashBytes(&variant, sizeof(variant), uint64_t(type)));
+        }
+    };
+}
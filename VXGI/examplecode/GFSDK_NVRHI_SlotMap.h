@@ -0,0 +1,228 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+namespace NVRHI
+{
+    // Generational slot map: objects live in fixed-size chunks that are never moved, so pointers to them stay valid
+    // until they are removed. Ids pack the slot index and the generation of the slot; a removed object's id
+    // never matches the slot again (until the generation wraps around), so stale ids are detected by Get().
+    // Ids fit into a pointer on 32-bit platforms too, and 0 is never a valid id.
+    template<typename T, uint32_t CHUNK_SIZE = 256>
+    class SlotMap
+    {
+    public:
+        typedef uintptr_t Id;
+
+        enum { INDEX_BITS = 20 };
+        static const Id INDEX_MASK = (Id(1) << INDEX_BITS) - 1;
+        static const Id GENERATION_MASK = ~Id(0) >> INDEX_BITS;
+
+        SlotMap() : m_Size(0), m_Capacity(0) { }
+
+        Id Insert(const T& value)
+        {
+            uint32_t index;
+            if (!m_FreeList.empty())
+            {
+                index = m_FreeList.back();
+                m_FreeList.pop_back();
+            }
+            else
+            {
+                if (m_Capacity > INDEX_MASK)
+                    return 0;
+
+                if (m_Capacity % CHUNK_SIZE == 0)
+                    m_Chunks.push_back(std::unique_ptr<Slot[]>(new Slot[CHUNK_SIZE]));
+
+                index = m_Capacity++;
+            }
+
+            Slot& slot = GetSlot(index);
+            slot.value = value;
+            slot.occupied = true;
+            m_Size++;
+
+            return Id(index) | (slot.generation << INDEX_BITS);
+        }
+
+        T* Get(Id id)
+        {
+            Slot* slot = Find(id);
+            return slot ? &slot->value : nullptr;
+        }
+
+        bool IsValid(Id id) { return Find(id) != nullptr; }
+
+        bool Remove(Id id)
+        {
+            Slot* slot = Find(id);
+            if (!slot)
+                return false;
+
+            slot->value = T();
+            slot->occupied = false;
+            slot->generation = (slot->generation + 1) & GENERATION_MASK;
+            if (slot->generation == 0)
+                slot->generation = 1;
+
+            m_FreeList.push_back(uint32_t(id & INDEX_MASK));
+            m_Size--;
+            return true;
+        }
+
+        void Clear()
+        {
+            for (uint32_t index = 0; index < m_Capacity; index++)
+            {
+                Slot& slot = GetSlot(index);
+                if (slot.occupied)
+                    Remove(Id(index) | (slot.generation << INDEX_BITS));
+            }
+        }
+
+        template<typename F>
+        void ForEach(F function)
+        {
+            for (uint32_t index = 0; index < m_Capacity; index++)
+            {
+                Slot& slot = GetSlot(index);
+                if (slot.occupied)
+                    function(Id(index) | (slot.generation << INDEX_BITS), slot.value);
+            }
+        }
+
+        uint32_t GetSize() const { return m_Size; }
+        uint32_t GetCapacity() const { return m_Capacity; }
+
+    private:
+        struct Slot
+        {
+            T value;
+            Id generation;
+            bool occupied;
+
+            Slot() : generation(1), occupied(false) { }
+        };
+
+        std::vector<std::unique_ptr<Slot[]>> m_Chunks;
+        std::vector<uint32_t> m_FreeList;
+        uint32_t m_Size;
+        uint32_t m_Capacity;
+
+        Slot& GetSlot(uint32_t index)
+        {
+            return m_Chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+        }
+
+        Slot* Find(Id id)
+        {
+            uint32_t index = uint32_t(id & INDEX_MASK);
+            if (id == 0 || index >= m_Capacity)
+                return nullptr;
+
+            Slot& slot = GetSlot(index);
+            if (!slot.occupied || slot.generation != (id >> INDEX_BITS))
+                return nullptr;
+
+            return &slot;
+        }
+    };
+
+    // Open-addressed hash table with linear probing for small caches keyed by packed 64-bit values.
+    // Key 0 marks empty buckets and cannot be stored; Find(0) returns null. Nothing is ever removed except by Clear(),
+    // which is all the view caches need. References returned by operator[] are invalidated by the next insertion.
+    template<typename T>
+    class OpenHashTable
+    {
+    public:
+        OpenHashTable() : m_Size(0) { }
+
+        T* Find(uint64_t key)
+        {
+            if (m_Buckets.empty() || key == 0)
+                return nullptr;
+
+            size_t mask = m_Buckets.size() - 1;
+            for (size_t i = Hash(key) & mask; ; i = (i + 1) & mask)
+            {
+                if (m_Buckets[i].key == key)
+                    return &m_Buckets[i].value;
+                if (m_Buckets[i].key == 0)
+                    return nullptr;
+            }
+        }
+
+        T& operator[](uint64_t key)
+        {
+            if ((m_Size + 1) * 2 > m_Buckets.size())
+                Grow();
+
+            size_t mask = m_Buckets.size() - 1;
+            size_t i = Hash(key) & mask;
+            while (m_Buckets[i].key != 0 && m_Buckets[i].key != key)
+                i = (i + 1) & mask;
+
+            if (m_Buckets[i].key == 0)
+            {
+                m_Buckets[i].key = key;
+                m_Size++;
+            }
+
+            return m_Buckets[i].value;
+        }
+
+        void Clear()
+        {
+            m_Buckets.clear();
+            m_Size = 0;
+        }
+
+        size_t GetSize() const { return m_Size; }
+
+    private:
+        struct Bucket
+        {
+            uint64_t key;
+            T value;
+
+            Bucket() : key(0) { }
+        };
+
+        std::vector<Bucket> m_Buckets;
+        size_t m_Size;
+
+        static size_t Hash(uint64_t key)
+        {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdull;
+            key ^= key >> 33;
+            return size_t(key);
+        }
+
+        void Grow()
+        {
+            std::vector<Bucket> oldBuckets;
+            oldBuckets.swap(m_Buckets);
+            m_Buckets.resize(oldBuckets.empty() ? 8 : oldBuckets.size() * 2);
+            m_Size = 0;
+
+            for (auto& bucket : oldBuckets)
+                if (bucket.key != 0)
+                    (*this)[bucket.key] = std::move(bucket.value);
+        }
+    };
+}
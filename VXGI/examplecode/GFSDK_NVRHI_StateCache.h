@@ -0,0 +1,440 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "GFSDK_NVRHI_Hash.h"
+
+namespace NVRHI
+{
+    struct StateCacheStats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t collisions;    // lookups that found an entry with the same hash but a different key
+        uint32_t size;
+        uint32_t capacity;      // 0 if unbounded
+
+        StateCacheStats() { memset(this, 0, sizeof(*this)); }
+
+        StateCacheStats& operator+=(const StateCacheStats& other)
+        {
+            hits += other.hits;
+            misses += other.misses;
+            evictions += other.evictions;
+            collisions += other.collisions;
+            size += other.size;
+            capacity += other.capacity;
+            return *this;
+        }
+    };
+
+    // Key for plain structs that are compared and hashed byte by byte.
+    // The storage is zeroed before the fields are filled in, so padding never affects the result;
+    // build the key with field assignments, not by copying a whole struct that may contain garbage padding.
+    template<typename T>
+    struct PodKey
+    {
+        T value;
+
+        PodKey() { memset(&value, 0, sizeof(T)); }
+
+        bool operator==(const PodKey& other) const { return memcmp(&value, &other.value, sizeof(T)) == 0; }
+
+        uint64_t Hash() const { return NVRHI::Hash::HashBytes(&value, sizeof(T)); }
+    };
+
+    // Cache of state objects with full-key comparison, open addressing and optional LRU eviction.
+    // Key needs operator== and a uint64_t Hash() method. Values are copied out when they are evicted or removed
+    // so that the caller can release them; the cache never destroys the objects itself.
+    template<typename Key, typename Value>
+    class StateCache
+    {
+    public:
+        StateCache(uint32_t capacity = 0)
+            : m_Capacity(capacity)
+            , m_Size(0)
+            , m_Oldest(INVALID_NODE)
+            , m_Newest(INVALID_NODE)
+        { }
+
+        // Finds the value and marks it as the most recently used, or returns null
+        Value* Find(const Key& key)
+        {
+            if (m_Table.empty())
+            {
+                m_Stats.misses++;
+                return nullptr;
+            }
+
+            uint64_t hash = key.Hash();
+            size_t mask = m_Table.size() - 1;
+
+            for (size_t i = size_t(hash) & mask; m_Table[i] != INVALID_NODE; i = (i + 1) & mask)
+            {
+                Node& node = m_Nodes[m_Table[i]];
+                if (node.hash != hash)
+                    continue;
+
+                if (node.key == key)
+                {
+                    m_Stats.hits++;
+                    Unlink(m_Table[i]);
+                    LinkNewest(m_Table[i]);
+                    return &node.value;
+                }
+
+                m_Stats.collisions++;
+            }
+
+            m_Stats.misses++;
+            return nullptr;
+        }
+
+        // Adds a value for a key that is not in the cache. If the cache is full, the least recently used
+        // values are appended to evicted.
+        void Insert(const Key& key, const Value& value, std::vector<Value>& evicted)
+        {
+            while (m_Capacity != 0 && m_Size >= m_Capacity)
+            {
+                evicted.push_back(m_Nodes[m_Oldest].value);
+                Remove(m_Oldest);
+                m_Stats.evictions++;
+            }
+
+            if ((m_Size + 1) * 2 > m_Table.size())
+                Rehash(m_Table.empty() ? 64 : m_Table.size() * 2);
+
+            uint32_t index;
+            if (!m_FreeNodes.empty())
+            {
+                index = m_FreeNodes.back();
+                m_FreeNodes.pop_back();
+            }
+            else
+            {
+                index = uint32_t(m_Nodes.size());
+                m_Nodes.push_back(Node());
+            }
+
+            Node& node = m_Nodes[index];
+            node.key = key;
+            node.value = value;
+            node.hash = key.Hash();
+            node.used = true;
+            LinkNewest(index);
+            PlaceInTable(index);
+            m_Size++;
+        }
+
+        // Removes the entry for the key, if there is one, and returns whether it was found
+        bool Erase(const Key& key)
+        {
+            uint32_t index = FindNode(key);
+            if (index == INVALID_NODE)
+                return false;
+
+            Remove(index);
+            return true;
+        }
+
+        // Removes all entries for which predicate(key, value) returns true and appends their values to removed
+        template<typename Predicate>
+        void RemoveIf(Predicate predicate, std::vector<Value>& removed)
+        {
+            for (uint32_t index = 0; index < uint32_t(m_Nodes.size()); index++)
+            {
+                Node& node = m_Nodes[index];
+                if (node.used && predicate(node.key, node.value))
+                {
+                    removed.push_back(node.value);
+                    Remove(index);
+                }
+            }
+        }
+
+        template<typename Function>
+        void ForEach(Function function)
+        {
+            for (auto& node : m_Nodes)
+                if (node.used)
+                    function(node.key, node.value);
+        }
+
+        void Clear()
+        {
+            m_Nodes.clear();
+            m_FreeNodes.clear();
+            m_Table.clear();
+            m_Size = 0;
+            m_Oldest = INVALID_NODE;
+            m_Newest = INVALID_NODE;
+        }
+
+        // Evicts the least recently used values into evicted while there are more than maxSize entries
+        // and canEvict(value) returns true for the oldest one. Meant for caches with an unbounded capacity
+        // whose owner decides when entries may go, for example only at a frame boundary.
+        template<typename Predicate>
+        void EvictOldestWhile(uint32_t maxSize, Predicate canEvict, std::vector<Value>& evicted)
+        {
+            while (m_Size > maxSize && canEvict(m_Nodes[m_Oldest].value))
+            {
+                evicted.push_back(m_Nodes[m_Oldest].value);
+                Remove(m_Oldest);
+                m_Stats.evictions++;
+            }
+        }
+
+        // 0 means unbounded. Shrinking the capacity evicts the least recently used values into evicted.
+        void SetCapacity(uint32_t capacity, std::vector<Value>& evicted)
+        {
+            m_Capacity = capacity;
+
+            while (m_Capacity != 0 && m_Size > m_Capacity)
+            {
+                evicted.push_back(m_Nodes[m_Oldest].value);
+                Remove(m_Oldest);
+                m_Stats.evictions++;
+            }
+        }
+
+        StateCacheStats GetStats() const
+        {
+            StateCacheStats stats = m_Stats;
+            stats.size = m_Size;
+            stats.capacity = m_Capacity;
+            return stats;
+        }
+
+        void ResetStats() { m_Stats = StateCacheStats(); }
+
+        uint32_t GetSize() const { return m_Size; }
+
+    private:
+        enum : uint32_t { INVALID_NODE = ~0u };
+
+        struct Node
+        {
+            Key key;
+            Value value;
+            uint64_t hash;
+            uint32_t older;
+            uint32_t newer;
+            bool used;
+
+            Node() : key(), value(), hash(0), older(INVALID_NODE), newer(INVALID_NODE), used(false) { }
+        };
+
+        std::vector<Node> m_Nodes;
+        std::vector<uint32_t> m_FreeNodes;
+        std::vector<uint32_t> m_Table;      // node indices, linear probing; the size is a power of 2
+        uint32_t m_Capacity;
+        uint32_t m_Size;
+        uint32_t m_Oldest;
+        uint32_t m_Newest;
+        StateCacheStats m_Stats;
+
+        uint32_t FindNode(const Key& key) const
+        {
+            if (m_Table.empty())
+                return INVALID_NODE;
+
+            uint64_t hash = key.Hash();
+            size_t mask = m_Table.size() - 1;
+
+            for (size_t i = size_t(hash) & mask; m_Table[i] != INVALID_NODE; i = (i + 1) & mask)
+            {
+                const Node& node = m_Nodes[m_Table[i]];
+                if (node.hash == hash && node.key == key)
+                    return m_Table[i];
+            }
+
+            return INVALID_NODE;
+        }
+
+        void LinkNewest(uint32_t index)
+        {
+            Node& node = m_Nodes[index];
+            node.older = m_Newest;
+            node.newer = INVALID_NODE;
+
+            if (m_Newest != INVALID_NODE)
+                m_Nodes[m_Newest].newer = index;
+            else
+                m_Oldest = index;
+
+            m_Newest = index;
+        }
+
+        void Unlink(uint32_t index)
+        {
+            Node& node = m_Nodes[index];
+
+            if (node.older != INVALID_NODE)
+                m_Nodes[node.older].newer = node.newer;
+            else
+                m_Oldest = node.newer;
+
+            if (node.newer != INVALID_NODE)
+                m_Nodes[node.newer].older = node.older;
+            else
+                m_Newest = node.older;
+        }
+
+        void PlaceInTable(uint32_t index)
+        {
+            size_t mask = m_Table.size() - 1;
+            size_t i = size_t(m_Nodes[index].hash) & mask;
+            while (m_Table[i] != INVALID_NODE)
+                i = (i + 1) & mask;
+
+            m_Table[i] = index;
+        }
+
+        void Remove(uint32_t index)
+        {
+            size_t mask = m_Table.size() - 1;
+            size_t i = size_t(m_Nodes[index].hash) & mask;
+            while (m_Table[i] != index)
+                i = (i + 1) & mask;
+
+            // Backward shift deletion: move later entries of the probe sequence into the hole
+            for (size_t j = (i + 1) & mask; m_Table[j] != INVALID_NODE; j = (j + 1) & mask)
+            {
+                size_t home = size_t(m_Nodes[m_Table[j]].hash) & mask;
+                bool canMove = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+                if (canMove)
+                {
+                    m_Table[i] = m_Table[j];
+                    i = j;
+                }
+            }
+            m_Table[i] = INVALID_NODE;
+
+            Unlink(index);
+            m_Nodes[index] = Node();
+            m_FreeNodes.push_back(index);
+            m_Size--;
+        }
+
+        void Rehash(size_t tableSize)
+        {
+            m_Table.assign(tableSize, INVALID_NODE);
+
+            for (uint32_t index = 0; index < uint32_t(m_Nodes.size()); index++)
+                if (m_Nodes[index].used)
+                    PlaceInTable(index);
+        }
+    };
+
+    // LRU of objects that may be evicted at a frame boundary, but not during the frame that last requested them,
+    // because the frame may already have handed them to the GPU (e.g. bindless handles written into buffers).
+    // The size may go over the limit during a frame; entries of earlier frames are evicted first, oldest first,
+    // and the rest of the excess goes at the next BeginFrame. A limit of 0 means unbounded.
+    template<typename Key, typename Value>
+    class FramePinnedCache
+    {
+    public:
+        FramePinnedCache(uint32_t limit)
+            : m_Limit(limit)
+            , m_Frame(0)
+        { }
+
+        // Finds the value and pins it for the current frame, or returns null
+        Value* Find(const Key& key)
+        {
+            Entry* entry = m_Cache.Find(key);
+            if (!entry)
+                return nullptr;
+
+            entry->frame = m_Frame;
+            return &entry->value;
+        }
+
+        // Adds a value for a key that is not in the cache, pinned for the current frame,
+        // and appends the values evicted to stay within the limit to evicted
+        void Insert(const Key& key, const Value& value, std::vector<Value>& evicted)
+        {
+            Entry entry;
+            entry.value = value;
+            entry.frame = m_Frame;
+
+            std::vector<Entry> unused;
+            m_Cache.Insert(key, entry, unused);
+            Trim(evicted);
+        }
+
+        // Unpins the values of the previous frame and evicts the ones over the limit
+        void BeginFrame(std::vector<Value>& evicted)
+        {
+            m_Frame++;
+            Trim(evicted);
+        }
+
+        void SetLimit(uint32_t limit, std::vector<Value>& evicted)
+        {
+            m_Limit = limit;
+            Trim(evicted);
+        }
+
+        // Removes all entries for which predicate(key, value) returns true, pinned or not
+        template<typename Predicate>
+        void RemoveIf(Predicate predicate, std::vector<Value>& removed)
+        {
+            std::vector<Entry> entries;
+            m_Cache.RemoveIf([&predicate](const Key& key, const Entry& entry) { return predicate(key, entry.value); }, entries);
+
+            for (auto& entry : entries)
+                removed.push_back(entry.value);
+        }
+
+        StateCacheStats GetStats() const
+        {
+            StateCacheStats stats = m_Cache.GetStats();
+            stats.capacity = m_Limit;
+            return stats;
+        }
+
+        uint32_t GetSize() const { return m_Cache.GetSize(); }
+        uint32_t GetLimit() const { return m_Limit; }
+        uint64_t GetFrame() const { return m_Frame; }
+
+    private:
+        struct Entry
+        {
+            Value value;
+            uint64_t frame;     // frame in which the value was last requested
+
+            Entry() : value(), frame(0) { }
+        };
+
+        StateCache<Key, Entry> m_Cache;     // unbounded, trimmed here
+        uint32_t m_Limit;
+        uint64_t m_Frame;
+
+        void Trim(std::vector<Value>& evicted)
+        {
+            if (m_Limit == 0)
+                return;
+
+            // Requested values move to the new end of the LRU, so the eviction stops at the first value of the current frame
+            uint64_t currentFrame = m_Frame;
+            std::vector<Entry> entries;
+            m_Cache.EvictOldestWhile(m_Limit, [currentFrame](const Entry& entry) { return entry.frame != currentFrame; }, entries);
+
+            for (auto& entry : entries)
+                evicted.push_back(entry.value);
+        }
+    };
+}
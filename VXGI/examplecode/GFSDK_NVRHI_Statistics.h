@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <GFSDK_NVRHI.h>
+
+// Define as 0 to compile the counting out of the backends entirely
+#ifndef NVRHI_ENABLE_STATISTICS
+#define NVRHI_ENABLE_STATISTICS 1
+#endif
+
+namespace NVRHI
+{
+    // Per-frame counters of a backend, behind the IRendererInterface statistics calls.
+    // The backends update the counters through the NVRHI_STAT macros, which test the enabled flag first,
+    // so a disabled collector costs one predictable branch per API call.
+    class StatisticsCollector
+    {
+    public:
+        StatisticsCollector()
+            : m_Enabled(false)
+            , m_FrameIndex(0)
+        { }
+
+        bool IsEnabled() const { return m_Enabled; }
+
+        // Returns false if the counting is compiled out
+        bool SetEnabled(bool enable)
+        {
+#if NVRHI_ENABLE_STATISTICS
+            if (enable && !m_Enabled)
+                m_Current = RendererStatistics();
+
+            m_Enabled = enable;
+            return true;
+#else
+            (void)enable;
+            return false;
+#endif
+        }
+
+        RendererStatistics& Current() { return m_Current; }
+
+        void EndFrame()
+        {
+            if (!m_Enabled)
+                return;
+
+            m_Current.frameIndex = m_FrameIndex++;
+            m_LastFrame = m_Current;
+            m_Current = RendererStatistics();
+        }
+
+        // Returns false until a frame has been completed with statistics enabled
+        bool GetLastFrame(RendererStatistics& stats) const
+        {
+            if (m_FrameIndex == 0)
+                return false;
+
+            stats = m_LastFrame;
+            return true;
+        }
+
+        void AddDraws(const DrawArguments* args, uint32_t numDrawCalls)
+        {
+            for (uint32_t i = 0; i < numDrawCalls; i++)
+            {
+                uint64_t vertices = uint64_t(args[i].vertexCount) * args[i].instanceCount;
+                m_Current.verticesSubmitted += vertices;
+                m_Current.drawVertexHistogram[GetBucket(vertices)]++;
+            }
+            m_Current.drawCalls += numDrawCalls;
+        }
+
+        void AddUpload(uint64_t bytes)
+        {
+            m_Current.bytesUploaded += bytes;
+            m_Current.uploadSizeHistogram[GetBucket(bytes)]++;
+        }
+
+        // Adds counters collected by another collector, e.g. while recording a deferred command list, to the current frame
+        void Merge(const RendererStatistics& other)
+        {
+            if (!m_Enabled)
+                return;
+
+            m_Current.drawCalls += other.drawCalls;
+            m_Current.indirectDrawCalls += other.indirectDrawCalls;
+            m_Current.dispatches += other.dispatches;
+            m_Current.indirectDispatches += other.indirectDispatches;
+            m_Current.verticesSubmitted += other.verticesSubmitted;
+            m_Current.stateChanges += other.stateChanges;
+            m_Current.descriptorCopies += other.descriptorCopies;
+            m_Current.barriers += other.barriers;
+            m_Current.bytesUploaded += other.bytesUploaded;
+            m_Current.constantBufferWrites += other.constantBufferWrites;
+            m_Current.identicalConstantBufferWrites += other.identicalConstantBufferWrites;
+            m_Current.stateCacheMisses += other.stateCacheMisses;
+            m_Current.commandListFlushes += other.commandListFlushes;
+
+            for (uint32_t i = 0; i < RendererStatistics::HISTOGRAM_BUCKETS; i++)
+            {
+                m_Current.drawVertexHistogram[i] += other.drawVertexHistogram[i];
+                m_Current.uploadSizeHistogram[i] += other.uploadSizeHistogram[i];
+            }
+        }
+
+        static uint32_t GetBucket(uint64_t value)
+        {
+            uint32_t bucket = 0;
+            while (value != 0 && bucket < RendererStatistics::HISTOGRAM_BUCKETS - 1)
+            {
+                value >>= 1;
+                bucket++;
+            }
+            return bucket;
+        }
+
+    private:
+        bool m_Enabled;
+        uint64_t m_FrameIndex;
+        RendererStatistics m_Current;
+        RendererStatistics m_LastFrame;
+    };
+}
+
+#if NVRHI_ENABLE_STATISTICS
+#define NVRHI_STAT_ADD(collector, counter, value) do { if ((collector).IsEnabled()) (collector).Current().counter += (value); } while (0)
+#define NVRHI_STAT_DRAWS(collector, args, numDrawCalls) do { if ((collector).IsEnabled()) (collector).AddDraws(args, numDrawCalls); } while (0)
+#define NVRHI_STAT_UPLOAD(collector, bytes) do { if ((collector).IsEnabled()) (collector).AddUpload(bytes); } while (0)
+#else
+#define NVRHI_STAT_ADD(collector, counter, value) do { } while (0)
+#define NVRHI_STAT_DRAWS(collector, args, numDrawCalls) do { } while (0)
+#define NVRHI_STAT_UPLOAD(collector, bytes) do { } while (0)
+#endif
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+
+namespace NVRHI
+{
+    // Space management of a ring of upload memory. Allocations are appended after the previous one and wrap
+    // to the beginning when they don't fit before the end; the skipped tail counts as used until it is retired.
+    // The allocations made between two Submit calls are covered by one fence, and their space, padding included,
+    // is reused only after the oldest fence has been retired. The caller waits for the fences.
+    template<typename Fence>
+    class UploadRingAllocator
+    {
+    public:
+        enum : uint32_t { ALIGNMENT = 16 };
+
+        UploadRingAllocator()
+            : m_Size(0)
+            , m_Head(0)
+            , m_UsedBytes(0)
+            , m_PendingBytes(0)
+        { }
+
+        void Init(uint32_t size)
+        {
+            m_Size = size;
+            m_Head = 0;
+            m_UsedBytes = 0;
+            m_PendingBytes = 0;
+            m_Fences.clear();
+        }
+
+        // Returns false if the data doesn't fit into the free space; a retire may make room unless the data
+        // is larger than the whole ring
+        bool TryAllocate(size_t bytes, uint32_t& offset)
+        {
+            if (bytes > m_Size)
+                return false;
+
+            if (m_UsedBytes == 0)
+                m_Head = 0;
+
+            uint32_t alignedHead = (m_Head + ALIGNMENT - 1) & ~uint32_t(ALIGNMENT - 1);
+            bool wrap = alignedHead + bytes > m_Size;
+            uint32_t start = wrap ? 0 : alignedHead;
+            uint32_t padding = wrap ? m_Size - m_Head : alignedHead - m_Head;
+            uint32_t consumed = padding + uint32_t(bytes);
+
+            if (m_UsedBytes + consumed > m_Size)
+                return false;
+
+            offset = start;
+            m_Head = start + uint32_t(bytes);
+            m_UsedBytes += consumed;
+            m_PendingBytes += consumed;
+            return true;
+        }
+
+        bool HasPendingAllocations() const { return m_PendingBytes != 0; }
+
+        // Fences the allocations made since the previous call
+        void Submit(Fence fence)
+        {
+            FencedRange range;
+            range.fence = fence;
+            range.bytes = m_PendingBytes;
+            m_Fences.push_back(range);
+            m_PendingBytes = 0;
+        }
+
+        bool HasFences() const { return !m_Fences.empty(); }
+        size_t GetNumFences() const { return m_Fences.size(); }
+        const Fence& GetOldestFence() const { return m_Fences.front().fence; }
+
+        // Releases the space of the oldest fence, which the GPU must have passed; returns the fence for deletion
+        Fence RetireOldest()
+        {
+            Fence fence = m_Fences.front().fence;
+            m_UsedBytes -= m_Fences.front().bytes;
+            m_Fences.pop_front();
+            return fence;
+        }
+
+        uint32_t GetSize() const { return m_Size; }
+        uint32_t GetUsedBytes() const { return m_UsedBytes; }
+
+    private:
+        struct FencedRange
+        {
+            Fence fence;
+            uint32_t bytes;
+        };
+
+        std::deque<FencedRange> m_Fences;
+        uint32_t m_Size;
+        uint32_t m_Head;
+        uint32_t m_UsedBytes;
+        uint32_t m_PendingBytes;
+    };
+}
@@ -0,0 +1,452 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GFSDK_VXGI.h"
+
+namespace VXGI
+{
+    // IPerformanceMonitor implementation that records a tree of nested sections per frame, for GIParameters::perfMonitor
+    // and for the application's own passes. CPU times are measured with a steady clock; GPU times come from
+    // NVRHI performance queries, which are read back FRAME_LATENCY frames after they were issued, so that reading them
+    // does not stall the CPU. Without a renderer interface only CPU times are recorded.
+    //
+    // Usage: beginFrame(), any number of (nested) beginSection/endSection pairs, endFrame(). Sections outside of
+    // a frame are ignored. Completed frames are kept in a history that can be exported as a Chrome trace
+    // (chrome://tracing, Perfetto) or as CSV.
+    class PerformanceMonitor : public IPerformanceMonitor
+    {
+    public:
+        enum { FRAME_LATENCY = 4 };
+
+        struct Section
+        {
+            std::string name;
+            std::string path;       // names of the enclosing sections and this one, separated by '/'
+            int32_t parent;         // index in Frame::sections, -1 for top-level sections
+            uint32_t depth;
+            double cpuStartMs;      // relative to the creation of the monitor
+            double cpuMs;
+            double gpuMs;           // negative if GPU timing is unavailable
+            double smoothedCpuMs;   // exponential moving averages over the frames that contain the same path
+            double smoothedGpuMs;
+
+            Section() : parent(-1), depth(0), cpuStartMs(0.0), cpuMs(0.0), gpuMs(-1.0), smoothedCpuMs(0.0), smoothedGpuMs(-1.0) { }
+        };
+
+        struct Frame
+        {
+            uint64_t index;
+            double cpuStartMs;
+            double cpuMs;
+            std::vector<Section> sections;  // in the order in which they begin, so parents precede their children
+
+            Frame() : index(0), cpuStartMs(0.0), cpuMs(0.0) { }
+        };
+
+        // Scoped section; does nothing if the monitor is null
+        class Scope
+        {
+        public:
+            Scope(IPerformanceMonitor* monitor, const char* name) : m_Monitor(monitor) { if (m_Monitor) m_Monitor->beginSection(name); }
+            ~Scope() { if (m_Monitor) m_Monitor->endSection(); }
+        private:
+            IPerformanceMonitor* m_Monitor;
+            Scope(const Scope&);
+            Scope& operator=(const Scope&);
+        };
+
+        PerformanceMonitor(NVRHI::IRendererInterface* rendererInterface, uint32_t historySize = 300)
+            : m_Renderer(rendererInterface)
+            , m_HistorySize(historySize)
+            , m_SmoothingFactor(0.1)
+            , m_FrameIndex(0)
+            , m_InFrame(false)
+            , m_IgnoredDepth(0)
+            , m_Origin(std::chrono::steady_clock::now())
+        { }
+
+        virtual ~PerformanceMonitor()
+        {
+            if (!m_Renderer)
+                return;
+
+            for (auto& slot : m_Slots)
+                for (auto& queries : slot.queries)
+                    for (NVRHI::PerformanceQueryHandle query : queries.second)
+                        m_Renderer->destroyPerformanceQuery(query);
+        }
+
+        // Weight of the newest frame in the moving averages, in (0, 1]
+        void setSmoothingFactor(double factor) { m_SmoothingFactor = factor; }
+
+        void beginFrame()
+        {
+            if (m_InFrame)
+                endFrame();
+
+            // The slot was last used FRAME_LATENCY frames ago, so its queries are complete or nearly so
+            Slot& slot = m_Slots[m_FrameIndex % FRAME_LATENCY];
+            if (slot.pending)
+                resolve(slot);
+
+            slot.frame = Frame();
+            slot.frame.index = m_FrameIndex;
+            slot.frame.cpuStartMs = now();
+            slot.sectionQueries.clear();
+            slot.queriesUsed.clear();
+
+            m_Open.clear();
+            m_InFrame = true;
+        }
+
+        // Sections that are still open are closed at the end of the frame
+        void endFrame()
+        {
+            if (!m_InFrame)
+                return;
+
+            while (!m_Open.empty())
+                closeSection();
+
+            Slot& slot = m_Slots[m_FrameIndex % FRAME_LATENCY];
+            slot.frame.cpuMs = now() - slot.frame.cpuStartMs;
+            slot.pending = true;
+
+            m_FrameIndex++;
+            m_InFrame = false;
+        }
+
+        virtual void beginSection(const char* pSectionName) override
+        {
+            if (!m_InFrame || m_IgnoredDepth)
+            {
+                m_IgnoredDepth++;
+                return;
+            }
+
+            Slot& slot = m_Slots[m_FrameIndex % FRAME_LATENCY];
+
+            Section section;
+            section.name = pSectionName ? pSectionName : "";
+            section.parent = m_Open.empty() ? -1 : int32_t(m_Open.back());
+            section.depth = uint32_t(m_Open.size());
+            section.path = m_Open.empty() ? section.name : slot.frame.sections[m_Open.back()].path + "/" + section.name;
+
+            NVRHI::PerformanceQueryHandle query = nullptr;
+            if (m_Renderer)
+            {
+                // A path that occurs several times per frame gets a query per occurrence
+                uint32_t occurrence = slot.queriesUsed[section.path]++;
+                std::vector<NVRHI::PerformanceQueryHandle>& queries = slot.queries[section.path];
+                if (occurrence == queries.size())
+                    queries.push_back(m_Renderer->createPerformanceQuery(section.name.c_str()));
+
+                query = queries[occurrence];
+            }
+
+            m_Open.push_back(uint32_t(slot.frame.sections.size()));
+            slot.sectionQueries.push_back(query);
+
+            section.cpuStartMs = now();
+            slot.frame.sections.push_back(section);
+
+            if (query)
+                m_Renderer->beginPerformanceQuery(query);
+        }
+
+        virtual void endSection() override
+        {
+            if (m_IgnoredDepth)
+            {
+                m_IgnoredDepth--;
+                return;
+            }
+
+            if (m_InFrame && !m_Open.empty())
+                closeSection();
+        }
+
+        // Resolves all frames that are waiting for GPU results, which may wait for the GPU. Call before exporting
+        // if the last frames should be included.
+        void flush()
+        {
+            if (m_InFrame)
+                endFrame();
+
+            for (uint64_t i = 0; i < FRAME_LATENCY; i++)
+            {
+                Slot& slot = m_Slots[(m_FrameIndex + i) % FRAME_LATENCY];
+                if (slot.pending)
+                    resolve(slot);
+            }
+        }
+
+        // Completed frames with GPU times, oldest first
+        const std::deque<Frame>& getHistory() const { return m_History; }
+
+        const Frame* getLastFrame() const { return m_History.empty() ? nullptr : &m_History.back(); }
+
+        // Index of the frame being recorded, or of the next one between frames; matches Frame::index
+        uint64_t getFrameIndex() const { return m_FrameIndex; }
+
+        // Chrome trace event format: one complete event per frame and section on the CPU track, and the same
+        // sections on a GPU track. GPU timestamps are not available, only durations, so GPU sections are laid out
+        // from their CPU start times; the durations are exact, the placement is approximate.
+        void formatChromeTrace(std::string& out) const
+        {
+            out = "{\"traceEvents\":[\n";
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+            for (const Frame& frame : m_History)
+            {
+                char buffer[256];
+                snprintf(buffer, sizeof(buffer), ",\n{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    (unsigned long long)frame.index, frame.cpuStartMs * 1000.0, frame.cpuMs * 1000.0);
+                out += buffer;
+
+                for (const Section& section : frame.sections)
+                {
+                    appendTraceEvent(out, section, "cpu", 1, section.cpuMs);
+
+                    if (section.gpuMs >= 0.0)
+                        appendTraceEvent(out, section, "gpu", 2, section.gpuMs);
+                }
+            }
+
+            out += "\n]}\n";
+        }
+
+        // One row per section of every frame in the history; missing GPU times are empty fields
+        void formatCSV(std::string& out) const
+        {
+            out = "frame,section,depth,cpuStartMs,cpuMs,gpuMs,smoothedCpuMs,smoothedGpuMs\n";
+
+            for (const Frame& frame : m_History)
+            {
+                for (const Section& section : frame.sections)
+                {
+                    char buffer[128];
+                    snprintf(buffer, sizeof(buffer), "%llu,", (unsigned long long)frame.index);
+                    out += buffer;
+
+                    appendCSVString(out, section.path);
+
+                    snprintf(buffer, sizeof(buffer), ",%u,%.4f,%.4f,", section.depth, section.cpuStartMs, section.cpuMs);
+                    out += buffer;
+
+                    if (section.gpuMs >= 0.0)
+                    {
+                        snprintf(buffer, sizeof(buffer), "%.4f", section.gpuMs);
+                        out += buffer;
+                    }
+
+                    snprintf(buffer, sizeof(buffer), ",%.4f,", section.smoothedCpuMs);
+                    out += buffer;
+
+                    if (section.smoothedGpuMs >= 0.0)
+                    {
+                        snprintf(buffer, sizeof(buffer), "%.4f", section.smoothedGpuMs);
+                        out += buffer;
+                    }
+
+                    out += "\n";
+                }
+            }
+        }
+
+        bool writeChromeTrace(const char* path) const
+        {
+            std::string text;
+            formatChromeTrace(text);
+            return writeFile(path, text);
+        }
+
+        bool writeCSV(const char* path) const
+        {
+            std::string text;
+            formatCSV(text);
+            return writeFile(path, text);
+        }
+
+    private:
+        struct Slot
+        {
+            Frame frame;
+            bool pending;
+            std::vector<NVRHI::PerformanceQueryHandle> sectionQueries;  // parallel to frame.sections, null without a renderer
+            std::unordered_map<std::string, std::vector<NVRHI::PerformanceQueryHandle>> queries;
+            std::unordered_map<std::string, uint32_t> queriesUsed;
+
+            Slot() : pending(false) { }
+        };
+
+        struct Average
+        {
+            double cpuMs;
+            double gpuMs;
+        };
+
+        NVRHI::IRendererInterface* m_Renderer;
+        uint32_t m_HistorySize;
+        double m_SmoothingFactor;
+        uint64_t m_FrameIndex;
+        bool m_InFrame;
+        uint32_t m_IgnoredDepth;
+        std::chrono::steady_clock::time_point m_Origin;
+        Slot m_Slots[FRAME_LATENCY];
+        std::vector<uint32_t> m_Open;
+        std::unordered_map<std::string, Average> m_Averages;
+        std::deque<Frame> m_History;
+
+        double now() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Origin).count();
+        }
+
+        void closeSection()
+        {
+            Slot& slot = m_Slots[m_FrameIndex % FRAME_LATENCY];
+            uint32_t index = m_Open.back();
+            m_Open.pop_back();
+
+            if (slot.sectionQueries[index])
+                m_Renderer->endPerformanceQuery(slot.sectionQueries[index]);
+
+            Section& section = slot.frame.sections[index];
+            section.cpuMs = now() - section.cpuStartMs;
+        }
+
+        void resolve(Slot& slot)
+        {
+            Frame& frame = slot.frame;
+            std::unordered_map<std::string, uint32_t> occurrences;
+
+            for (size_t i = 0; i < frame.sections.size(); i++)
+            {
+                Section& section = frame.sections[i];
+
+                if (slot.sectionQueries[i])
+                    section.gpuMs = m_Renderer->getPerformanceQueryTimeMS(slot.sectionQueries[i]);
+
+                // Repeated occurrences of a path in one frame are averaged separately
+                std::string key = section.path;
+                uint32_t occurrence = occurrences[section.path]++;
+                if (occurrence)
+                    key += "#" + std::to_string(occurrence);
+
+                auto found = m_Averages.find(key);
+                if (found == m_Averages.end())
+                {
+                    Average average = { section.cpuMs, section.gpuMs };
+                    found = m_Averages.insert(std::make_pair(key, average)).first;
+                }
+                else
+                {
+                    Average& average = found->second;
+                    average.cpuMs += (section.cpuMs - average.cpuMs) * m_SmoothingFactor;
+                    if (section.gpuMs >= 0.0)
+                        average.gpuMs = (average.gpuMs < 0.0) ? section.gpuMs : average.gpuMs + (section.gpuMs - average.gpuMs) * m_SmoothingFactor;
+                }
+
+                section.smoothedCpuMs = found->second.cpuMs;
+                section.smoothedGpuMs = found->second.gpuMs;
+            }
+
+            slot.pending = false;
+
+            if (m_HistorySize == 0)
+                return;
+
+            if (m_History.size() >= m_HistorySize)
+                m_History.pop_front();
+
+            m_History.push_back(frame);
+        }
+
+        static void appendJSONString(std::string& out, const std::string& value)
+        {
+            out += '"';
+            for (char c : value)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    out += '\\';
+                    out += c;
+                }
+                else if ((unsigned char)c < 0x20)
+                {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", unsigned(c));
+                    out += buffer;
+                }
+                else
+                    out += c;
+            }
+            out += '"';
+        }
+
+        static void appendCSVString(std::string& out, const std::string& value)
+        {
+            if (value.find_first_of(",\"\n") == std::string::npos)
+            {
+                out += value;
+                return;
+            }
+
+            out += '"';
+            for (char c : value)
+            {
+                if (c == '"')
+                    out += '"';
+                out += c;
+            }
+            out += '"';
+        }
+
+        static void appendTraceEvent(std::string& out, const Section& section, const char* category, int thread, double durationMs)
+        {
+            out += ",\n{\"name\":";
+            appendJSONString(out, section.name);
+
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"path\":",
+                category, thread, section.cpuStartMs * 1000.0, durationMs * 1000.0);
+            out += buffer;
+            appendJSONString(out, section.path);
+            out += "}}";
+        }
+
+        static bool writeFile(const char* path, const std::string& text)
+        {
+#ifdef _MSC_VER
+            FILE* file = nullptr;
+            if (fopen_s(&file, path, "wb") != 0)
+                file = nullptr;
+#else
+            FILE* file = fopen(path, "wb");
+#endif
+            if (!file)
+                return false;
+
+            bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+            return (fclose(file) == 0) && written;
+        }
+    };
+}
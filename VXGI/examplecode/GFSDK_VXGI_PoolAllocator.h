@@ -0,0 +1,528 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GFSDK_VXGI.h>
+
+namespace VXGI
+{
+    struct PoolAllocatorStats
+    {
+        enum { SIZE_CLASS_COUNT = 21 };
+
+        struct SizeClass
+        {
+            uint32_t blockSize;         // including the 16-byte block header
+            uint64_t allocations;
+            uint64_t frees;
+            uint64_t blocksReserved;    // blocks carved from chunks so far, live or free
+        };
+
+        uint64_t bytesLive;             // requested sizes of the allocations that have not been freed
+        uint64_t bytesHighWater;        // sampled whenever a thread goes to the shared pools, see PoolAllocator
+        uint64_t bytesReserved;         // pool chunks plus live large blocks
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t threadCacheHits;       // pool allocations served without taking a lock
+        uint64_t largeAllocations;
+        uint64_t largeFrees;
+        SizeClass sizeClasses[SIZE_CLASS_COUNT];
+
+        PoolAllocatorStats() { memset(this, 0, sizeof(*this)); }
+    };
+
+    // IAllocator for GIParameters::allocator. Small allocations come from per-size-class pools that grow in 64 KB
+    // chunks and are never returned to the heap before the allocator is destroyed; larger ones go to malloc.
+    // Each thread keeps a short free list per size class, so most allocations and frees do not take a lock.
+    // Blocks freed on another thread go to that thread's cache, which is fine as long as all threads use the same
+    // allocator; a thread that switches to another PoolAllocator abandons its cached blocks until the owner is destroyed.
+    //
+    // Statistics are counted per thread without atomic read-modify-write operations, which would cost more than
+    // the allocation itself, and summed by getStats. For the same reason the high water mark is only sampled when
+    // a thread refills its cache or allocates a large block, so it can miss a peak by up to one cache's worth per thread.
+    //
+    // The destructor releases all memory, including blocks that were never freed, and reports those through
+    // the error callback, if there is one. The allocator must outlive every object that was created with it.
+    class PoolAllocator : public IAllocator
+    {
+    public:
+        enum
+        {
+            SIZE_CLASS_COUNT = PoolAllocatorStats::SIZE_CLASS_COUNT,
+            HEADER_SIZE = 16,
+            MAX_SMALL_BLOCK = 4096,
+            CHUNK_SIZE = 64 * 1024,
+            THREAD_CACHE_BATCH = 32     // blocks moved between a thread cache and the shared pool at once
+        };
+
+        PoolAllocator(NVRHI::IErrorCallback* errorCallback = nullptr)
+            : m_ErrorCallback(errorCallback)
+            , m_Id(NextAllocatorId())
+        {
+            static const uint32_t blockSizes[SIZE_CLASS_COUNT] = {
+                32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 640, 768, 1024, 1280, 1536, 2048, 2560, 3072, 4096
+            };
+
+            for (uint32_t index = 0; index < SIZE_CLASS_COUNT; index++)
+                m_Pools[index].blockSize = blockSizes[index];
+
+            uint32_t index = 0;
+            for (uint32_t granule = 0; granule <= MAX_SMALL_BLOCK / 16; granule++)
+            {
+                while (blockSizes[index] < granule * 16)
+                    index++;
+                m_SizeClassByGranule[granule] = uint8_t(index);
+            }
+
+            m_BytesHighWater = 0;
+            m_BytesReserved = 0;
+            m_LargeBlocks = nullptr;
+        }
+
+        virtual ~PoolAllocator()
+        {
+            std::string report = formatLeakReport();
+            if (!report.empty() && m_ErrorCallback)
+                m_ErrorCallback->signalError(__FILE__, __LINE__, report.c_str());
+
+            for (Pool& pool : m_Pools)
+                for (void* chunk : pool.chunks)
+                    free(chunk);
+
+            while (m_LargeBlocks)
+            {
+                LargeBlock* block = m_LargeBlocks;
+                m_LargeBlocks = block->next;
+                free(block);
+            }
+
+            for (ThreadStats* stats : m_ThreadStats)
+                delete stats;
+        }
+
+        virtual void* allocateMemory(size_t size) override
+        {
+            if (size > MAX_SMALL_BLOCK - HEADER_SIZE)
+                return allocateLarge(size);
+
+            uint32_t sizeClass = m_SizeClassByGranule[(size + HEADER_SIZE + 15) / 16];
+            ThreadCache& cache = getThreadCache();
+
+            FreeBlock* block = cache.heads[sizeClass];
+            if (block)
+            {
+                Increment(cache.stats->threadCacheHits, 1);
+            }
+            else
+            {
+                refillThreadCache(cache, sizeClass);
+                block = cache.heads[sizeClass];
+                if (!block)
+                    return nullptr;
+            }
+
+            cache.heads[sizeClass] = block->next;
+            cache.counts[sizeClass]--;
+
+            Increment(cache.stats->allocations[sizeClass], 1);
+            return initBlock(cache, block, sizeClass, size);
+        }
+
+        virtual void freeMemory(void* ptr) override
+        {
+            if (!ptr)
+                return;
+
+            // Pool blocks stay mapped, so a second free finds the cleared magic; a large block is back in the heap
+            // after the first free, so freeing it again cannot be detected
+            BlockHeader* header = (BlockHeader*)((char*)ptr - HEADER_SIZE);
+            if (header->magic != BLOCK_MAGIC)
+            {
+                if (m_ErrorCallback)
+                    m_ErrorCallback->signalError(__FILE__, __LINE__, "PoolAllocator: freeMemory called with a pointer that it did not allocate, or twice");
+                return;
+            }
+
+            header->magic = 0;
+            uint32_t sizeClass = header->sizeClass;
+            ThreadCache& cache = getThreadCache();
+            Increment(cache.stats->bytesFreed, header->size);
+
+            if (sizeClass == LARGE_SIZE_CLASS)
+            {
+                Increment(cache.stats->largeFrees, 1);
+                freeLarge(header);
+                return;
+            }
+
+            Increment(cache.stats->frees[sizeClass], 1);
+
+            FreeBlock* block = (FreeBlock*)header;
+            block->next = cache.heads[sizeClass];
+            cache.heads[sizeClass] = block;
+            cache.counts[sizeClass]++;
+
+            if (cache.counts[sizeClass] >= 2 * THREAD_CACHE_BATCH)
+                drainThreadCache(cache, sizeClass, THREAD_CACHE_BATCH);
+        }
+
+        // Moves the blocks cached by the calling thread back to the shared pools, e.g. before the thread exits
+        void flushThreadCache()
+        {
+            ThreadCache& cache = getThreadCache();
+            for (uint32_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+                drainThreadCache(cache, sizeClass, cache.counts[sizeClass]);
+        }
+
+        PoolAllocatorStats getStats() const
+        {
+            PoolAllocatorStats stats;
+
+            for (uint32_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+            {
+                stats.sizeClasses[sizeClass].blockSize = m_Pools[sizeClass].blockSize;
+                stats.sizeClasses[sizeClass].blocksReserved = m_Pools[sizeClass].blocksReserved.load(std::memory_order_relaxed);
+            }
+
+            uint64_t bytesAllocated = 0;
+            uint64_t bytesFreed = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_ThreadStatsMutex);
+                for (const ThreadStats* thread : m_ThreadStats)
+                {
+                    for (uint32_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+                    {
+                        stats.sizeClasses[sizeClass].allocations += thread->allocations[sizeClass].load(std::memory_order_relaxed);
+                        stats.sizeClasses[sizeClass].frees += thread->frees[sizeClass].load(std::memory_order_relaxed);
+                    }
+
+                    bytesAllocated += thread->bytesAllocated.load(std::memory_order_relaxed);
+                    bytesFreed += thread->bytesFreed.load(std::memory_order_relaxed);
+                    stats.threadCacheHits += thread->threadCacheHits.load(std::memory_order_relaxed);
+                    stats.largeAllocations += thread->largeAllocations.load(std::memory_order_relaxed);
+                    stats.largeFrees += thread->largeFrees.load(std::memory_order_relaxed);
+                }
+            }
+
+            stats.allocations = stats.largeAllocations;
+            stats.frees = stats.largeFrees;
+            for (const PoolAllocatorStats::SizeClass& sizeClass : stats.sizeClasses)
+            {
+                stats.allocations += sizeClass.allocations;
+                stats.frees += sizeClass.frees;
+            }
+
+            // A block freed on another thread may be counted before its allocation is, so clamp at zero
+            stats.bytesLive = bytesFreed < bytesAllocated ? bytesAllocated - bytesFreed : 0;
+            stats.bytesHighWater = std::max(m_BytesHighWater.load(std::memory_order_relaxed), stats.bytesLive);
+            stats.bytesReserved = m_BytesReserved.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        // Describes the allocations that have not been freed, or returns an empty string if there are none
+        std::string formatLeakReport() const
+        {
+            PoolAllocatorStats stats = getStats();
+            if (stats.allocations == stats.frees)
+                return std::string();
+
+            char line[256];
+            snprintf(line, sizeof(line), "PoolAllocator: %llu allocations (%llu bytes) were not freed\n",
+                (unsigned long long)(stats.allocations - stats.frees), (unsigned long long)stats.bytesLive);
+            std::string report = line;
+
+            for (const PoolAllocatorStats::SizeClass& sizeClass : stats.sizeClasses)
+            {
+                if (sizeClass.allocations == sizeClass.frees)
+                    continue;
+
+                snprintf(line, sizeof(line), "  %u-byte blocks: %llu\n", sizeClass.blockSize,
+                    (unsigned long long)(sizeClass.allocations - sizeClass.frees));
+                report += line;
+            }
+
+            if (stats.largeAllocations != stats.largeFrees)
+            {
+                snprintf(line, sizeof(line), "  large blocks: %llu\n", (unsigned long long)(stats.largeAllocations - stats.largeFrees));
+                report += line;
+            }
+
+            return report;
+        }
+
+    private:
+        enum : uint32_t
+        {
+            BLOCK_MAGIC = 0x4B4C4256, // "VBLK"
+            LARGE_SIZE_CLASS = 0xFFFFFFFF
+        };
+
+        struct BlockHeader
+        {
+            uint32_t magic;
+            uint32_t sizeClass;
+            uint64_t size;
+        };
+
+        static_assert(sizeof(BlockHeader) == HEADER_SIZE, "The block header must keep allocations 16-byte aligned");
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        // Precedes the block header of large allocations, which are kept in a list so that leaks can be freed
+        struct LargeBlock
+        {
+            LargeBlock* prev;
+            LargeBlock* next;
+        };
+
+        static_assert(sizeof(LargeBlock) <= HEADER_SIZE, "The large block link must fit in front of the block header");
+
+        struct Pool
+        {
+            uint32_t blockSize;
+            std::mutex mutex;
+            FreeBlock* freeList;
+            std::vector<void*> chunks;
+            std::atomic<uint64_t> blocksReserved;
+
+            Pool() : blockSize(0), freeList(nullptr), blocksReserved(0) { }
+        };
+
+        // Counters written only by their own thread; getStats reads them from any thread
+        struct ThreadStats
+        {
+            std::thread::id thread;
+            std::atomic<uint64_t> allocations[SIZE_CLASS_COUNT];
+            std::atomic<uint64_t> frees[SIZE_CLASS_COUNT];
+            std::atomic<uint64_t> bytesAllocated;
+            std::atomic<uint64_t> bytesFreed;
+            std::atomic<uint64_t> threadCacheHits;
+            std::atomic<uint64_t> largeAllocations;
+            std::atomic<uint64_t> largeFrees;
+
+            ThreadStats() : bytesAllocated(0), bytesFreed(0), threadCacheHits(0), largeAllocations(0), largeFrees(0)
+            {
+                for (uint32_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+                {
+                    allocations[sizeClass] = 0;
+                    frees[sizeClass] = 0;
+                }
+            }
+        };
+
+        // The cache belongs to one allocator at a time, identified by a process-wide serial number rather than
+        // the address, so that a new allocator never picks up blocks left behind by a destroyed one.
+        struct ThreadCache
+        {
+            uint64_t ownerId;
+            ThreadStats* stats;
+            FreeBlock* heads[SIZE_CLASS_COUNT];
+            uint32_t counts[SIZE_CLASS_COUNT];
+        };
+
+        NVRHI::IErrorCallback* m_ErrorCallback;
+        uint64_t m_Id;
+        uint8_t m_SizeClassByGranule[MAX_SMALL_BLOCK / 16 + 1];
+        Pool m_Pools[SIZE_CLASS_COUNT];
+        std::atomic<uint64_t> m_BytesHighWater;
+        std::atomic<uint64_t> m_BytesReserved;
+        mutable std::mutex m_ThreadStatsMutex;
+        std::vector<ThreadStats*> m_ThreadStats;
+        std::mutex m_LargeMutex;
+        LargeBlock* m_LargeBlocks;
+
+        PoolAllocator(const PoolAllocator&);
+        PoolAllocator& operator=(const PoolAllocator&);
+
+        static uint64_t NextAllocatorId()
+        {
+            static std::atomic<uint64_t> nextId(1);
+            return nextId.fetch_add(1);
+        }
+
+        static void Increment(std::atomic<uint64_t>& counter, uint64_t value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        ThreadCache& getThreadCache()
+        {
+            static thread_local ThreadCache cache;
+            if (cache.ownerId != m_Id)
+            {
+                memset(&cache, 0, sizeof(cache));
+                cache.ownerId = m_Id;
+
+                // The thread may have used this allocator before switching to another one
+                std::thread::id thread = std::this_thread::get_id();
+                std::lock_guard<std::mutex> lock(m_ThreadStatsMutex);
+                for (ThreadStats* stats : m_ThreadStats)
+                    if (stats->thread == thread)
+                        cache.stats = stats;
+
+                if (!cache.stats)
+                {
+                    cache.stats = new ThreadStats();
+                    cache.stats->thread = thread;
+                    m_ThreadStats.push_back(cache.stats);
+                }
+            }
+            return cache;
+        }
+
+        void* initBlock(ThreadCache& cache, void* memory, uint32_t sizeClass, size_t size)
+        {
+            BlockHeader* header = (BlockHeader*)memory;
+            header->magic = BLOCK_MAGIC;
+            header->sizeClass = sizeClass;
+            header->size = size;
+
+            Increment(cache.stats->bytesAllocated, size);
+            return (char*)memory + HEADER_SIZE;
+        }
+
+        void sampleHighWater()
+        {
+            uint64_t bytesAllocated = 0;
+            uint64_t bytesFreed = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_ThreadStatsMutex);
+                for (const ThreadStats* thread : m_ThreadStats)
+                {
+                    bytesAllocated += thread->bytesAllocated.load(std::memory_order_relaxed);
+                    bytesFreed += thread->bytesFreed.load(std::memory_order_relaxed);
+                }
+            }
+
+            if (bytesAllocated <= bytesFreed)
+                return;
+
+            uint64_t live = bytesAllocated - bytesFreed;
+            uint64_t highWater = m_BytesHighWater.load(std::memory_order_relaxed);
+            while (live > highWater && !m_BytesHighWater.compare_exchange_weak(highWater, live, std::memory_order_relaxed))
+                ;
+        }
+
+        // Takes a batch of blocks from the shared pool, carving a new chunk if it is empty
+        void refillThreadCache(ThreadCache& cache, uint32_t sizeClass)
+        {
+            sampleHighWater();
+
+            Pool& pool = m_Pools[sizeClass];
+            std::lock_guard<std::mutex> lock(pool.mutex);
+
+            if (!pool.freeList)
+            {
+                void* chunk = malloc(CHUNK_SIZE);
+                if (!chunk)
+                    return;
+
+                pool.chunks.push_back(chunk);
+                m_BytesReserved.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+
+                uint32_t blockCount = CHUNK_SIZE / pool.blockSize;
+                pool.blocksReserved.fetch_add(blockCount, std::memory_order_relaxed);
+
+                // Link the blocks in address order, so that consecutive allocations are adjacent
+                for (uint32_t index = blockCount; index-- > 0; )
+                {
+                    FreeBlock* block = (FreeBlock*)((char*)chunk + index * pool.blockSize);
+                    block->next = pool.freeList;
+                    pool.freeList = block;
+                }
+            }
+
+            for (uint32_t count = 0; count < THREAD_CACHE_BATCH && pool.freeList; count++)
+            {
+                FreeBlock* block = pool.freeList;
+                pool.freeList = block->next;
+                block->next = cache.heads[sizeClass];
+                cache.heads[sizeClass] = block;
+                cache.counts[sizeClass]++;
+            }
+        }
+
+        void drainThreadCache(ThreadCache& cache, uint32_t sizeClass, uint32_t count)
+        {
+            if (count == 0)
+                return;
+
+            Pool& pool = m_Pools[sizeClass];
+            std::lock_guard<std::mutex> lock(pool.mutex);
+
+            for (; count > 0 && cache.heads[sizeClass]; count--)
+            {
+                FreeBlock* block = cache.heads[sizeClass];
+                cache.heads[sizeClass] = block->next;
+                cache.counts[sizeClass]--;
+                block->next = pool.freeList;
+                pool.freeList = block;
+            }
+        }
+
+        void* allocateLarge(size_t size)
+        {
+            if (size > SIZE_MAX - 2 * HEADER_SIZE)
+                return nullptr;
+
+            LargeBlock* block = (LargeBlock*)malloc(size + 2 * HEADER_SIZE);
+            if (!block)
+                return nullptr;
+
+            {
+                std::lock_guard<std::mutex> lock(m_LargeMutex);
+                block->prev = nullptr;
+                block->next = m_LargeBlocks;
+                if (m_LargeBlocks)
+                    m_LargeBlocks->prev = block;
+                m_LargeBlocks = block;
+            }
+
+            ThreadCache& cache = getThreadCache();
+            Increment(cache.stats->largeAllocations, 1);
+            m_BytesReserved.fetch_add(size + 2 * HEADER_SIZE, std::memory_order_relaxed);
+            void* result = initBlock(cache, (char*)block + HEADER_SIZE, LARGE_SIZE_CLASS, size);
+
+            sampleHighWater();
+            return result;
+        }
+
+        void freeLarge(BlockHeader* header)
+        {
+            LargeBlock* block = (LargeBlock*)((char*)header - HEADER_SIZE);
+            {
+                std::lock_guard<std::mutex> lock(m_LargeMutex);
+                if (block->prev)
+                    block->prev->next = block->next;
+                else
+                    m_LargeBlocks = block->next;
+                if (block->next)
+                    block->next->prev = block->prev;
+            }
+
+            m_BytesReserved.fetch_sub(header->size + 2 * HEADER_SIZE, std::memory_order_relaxed);
+            free(block);
+        }
+    };
+}
@@ -0,0 +1,134 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <GFSDK_VXGI.h>
+
+namespace VXGI
+{
+    struct RegionCoalescingStats
+    {
+        uint32_t inputRegions;
+        uint32_t outputRegions;
+        float coveredVolume;    // estimated volume of the union of the input regions
+        float outputVolume;     // total volume of the output boxes; the excess over coveredVolume is revoxelized needlessly
+
+        RegionCoalescingStats() : inputRegions(0), outputRegions(0), coveredVolume(0.f), outputVolume(0.f) { }
+    };
+
+    // Merges the regions returned by IGlobalIllumination::getInvalidatedRegions into fewer boxes, so that culling
+    // meshes for voxelization takes fewer box tests. Two boxes are merged when their bounding box covers at most
+    // maxOverCoverage times its volume outside of the regions it replaces. With maxOverCoverage = 0, only regions that
+    // overlap, contain each other or share a face are merged, and the output covers exactly the same space.
+    //
+    // The regions are snapped to the allocation map page grid, so regions of one clipmap level that touch line up
+    // exactly and merge without over-coverage. Drawing a mesh whose bounds intersect an output box but none of the
+    // input regions is harmless, it only costs voxelization time.
+    //
+    // The covered volume is tracked approximately: when merged boxes overlap each other, their overlap is subtracted
+    // once, which is exact for two input regions and an estimate after that. Runs in O(n^2) per merge pass.
+    inline void CoalesceRegions(
+        const Box3f* regions,
+        uint32_t numRegions,
+        float maxOverCoverage,
+        std::vector<Box3f>& output,
+        RegionCoalescingStats* stats = nullptr)
+    {
+        struct Cover
+        {
+            Box3f box;
+            float covered;
+        };
+
+        std::vector<Cover> covers;
+        covers.reserve(numRegions);
+
+        for (uint32_t index = 0; index < numRegions; index++)
+        {
+            // Empty or inverted boxes do not intersect anything, but they would stretch a merged box
+            if (!(regions[index].lower <= regions[index].upper))
+                continue;
+
+            Cover cover;
+            cover.box = regions[index];
+            cover.covered = regions[index].volume();
+            covers.push_back(cover);
+        }
+
+        float inputVolume = 0.f;
+        for (const Cover& cover : covers)
+            inputVolume += cover.covered;
+
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+
+            for (size_t i = 0; i < covers.size(); i++)
+            {
+                for (size_t j = i + 1; j < covers.size(); )
+                {
+                    const Cover& a = covers[i];
+                    const Cover& b = covers[j];
+
+                    Box3f box(
+                        Vector3f(std::min(a.box.lower.x, b.box.lower.x), std::min(a.box.lower.y, b.box.lower.y), std::min(a.box.lower.z, b.box.lower.z)),
+                        Vector3f(std::max(a.box.upper.x, b.box.upper.x), std::max(a.box.upper.y, b.box.upper.y), std::max(a.box.upper.z, b.box.upper.z)));
+                    float volume = box.volume();
+
+                    float overlap = a.box.intersectsWith(b.box) ? a.box.intersection(b.box).volume() : 0.f;
+                    float covered = std::max(std::max(a.covered, b.covered), a.covered + b.covered - overlap);
+                    covered = std::min(covered, volume);
+
+                    // The epsilon absorbs rounding in the volumes of boxes that share a face exactly
+                    if (volume - covered <= maxOverCoverage * volume + 1e-4f * volume)
+                    {
+                        covers[i].box = box;
+                        covers[i].covered = covered;
+                        covers[j] = covers.back();
+                        covers.pop_back();
+                        merged = true;
+
+                        // The grown box may now absorb regions that were rejected before
+                        j = i + 1;
+                    }
+                    else
+                        j++;
+                }
+            }
+        }
+
+        output.clear();
+        output.reserve(covers.size());
+        for (const Cover& cover : covers)
+            output.push_back(cover.box);
+
+        if (stats)
+        {
+            stats->inputRegions = numRegions;
+            stats->outputRegions = uint32_t(output.size());
+            stats->coveredVolume = 0.f;
+            stats->outputVolume = 0.f;
+
+            for (const Cover& cover : covers)
+            {
+                stats->coveredVolume += cover.covered;
+                stats->outputVolume += cover.box.volume();
+            }
+
+            // Overlaps between the inputs make the sum of their volumes an overestimate, the merged estimate is closer
+            stats->coveredVolume = std::min(stats->coveredVolume, inputVolume);
+        }
+    }
+}
@@ -0,0 +1,566 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <GFSDK_VXGI.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace VXGI
+{
+    // A run of objects with the same sort key, usually meshes that share a material
+    struct SceneBVHDrawRange
+    {
+        uint32_t sortKey;
+        uint32_t first;     // index into SceneBVHQueryResult::objects
+        uint32_t count;
+    };
+
+    // Objects sorted by sort key and then by index, split into one range per sort key
+    struct SceneBVHQueryResult
+    {
+        std::vector<uint32_t> objects;
+        std::vector<SceneBVHDrawRange> ranges;
+
+        void clear() { objects.clear(); ranges.clear(); }
+    };
+
+    struct SceneBVHStats
+    {
+        uint32_t nodes;
+        uint32_t leaves;
+        uint32_t maxDepth;
+        float cost;             // SAH cost of the tree, relative to testing every object
+        float buildCost;        // the cost right after build; refitting moving objects makes 'cost' grow from it
+
+        uint32_t visitedNodes;  // during the last query
+        uint32_t testedObjects;
+        uint32_t returnedObjects;
+
+        SceneBVHStats() { memset(this, 0, sizeof(*this)); }
+    };
+
+    // Bounding volume hierarchy over object bounds, such as Scene::GetMeshBounds, built with binned SAH.
+    // Queries return the objects whose bounds intersect any of a list of boxes or frusta, in a stable order
+    // grouped by sort key, so that a renderer can change material state once per range.
+    //
+    // Moving objects are handled with refit(), which keeps the topology and only recomputes node bounds. The tree
+    // gets looser as objects move away from where it was built; rebuild when getStats().cost grows well past buildCost.
+    class SceneBVH
+    {
+    public:
+        enum
+        {
+            SAH_BINS = 16,
+            MAX_LEAF_OBJECTS = 16,  // larger nodes are always split, smaller ones only when SAH says so
+            QUERY_BATCH = 64        // queries are tested in batches of this many per traversal
+        };
+
+        SceneBVH() : m_Stamp(0) { }
+
+        // 'sortKeys' may be null, then all objects get the same key
+        void build(const Box3f* bounds, const uint32_t* sortKeys, uint32_t numObjects)
+        {
+            m_Nodes.clear();
+            m_Objects.resize(numObjects);
+            m_ObjectBounds.resize(numObjects);
+            m_ObjectStamps.assign(numObjects, 0);
+            m_Stamp = 0;
+            m_Stats = SceneBVHStats();
+
+            std::vector<Vector3f> centroids(numObjects);
+            for (uint32_t index = 0; index < numObjects; index++)
+            {
+                m_Objects[index] = index;
+                centroids[index] = (bounds[index].lower + bounds[index].upper) * 0.5f;
+            }
+
+            BuildSortedOrder(sortKeys, numObjects);
+
+            if (numObjects == 0)
+                return;
+
+            m_Nodes.reserve(numObjects / 2 + 1);
+            m_Nodes.push_back(Node());
+            m_Nodes[0].firstObject = 0;
+            m_Nodes[0].objectCount = numObjects;
+
+            struct Task { uint32_t node; uint32_t depth; };
+            std::vector<Task> stack;
+            stack.push_back(Task{ 0, 1 });
+
+            while (!stack.empty())
+            {
+                Task task = stack.back();
+                stack.pop_back();
+
+                Node& node = m_Nodes[task.node];
+                node.bounds = UnionOfObjects(bounds, node.firstObject, node.objectCount);
+                m_Stats.maxDepth = std::max(m_Stats.maxDepth, task.depth);
+
+                uint32_t split = 0;
+                if (node.objectCount > 1)
+                    split = FindSplit(bounds, centroids, node);
+
+                if (split == 0)
+                {
+                    m_Stats.leaves++;
+                    continue;
+                }
+
+                uint32_t left = uint32_t(m_Nodes.size());
+                Node leftNode, rightNode;
+                leftNode.firstObject = m_Nodes[task.node].firstObject;
+                leftNode.objectCount = split;
+                rightNode.firstObject = leftNode.firstObject + split;
+                rightNode.objectCount = m_Nodes[task.node].objectCount - split;
+                m_Nodes[task.node].leftChild = left;
+
+                // 'node' may dangle after this
+                m_Nodes.push_back(leftNode);
+                m_Nodes.push_back(rightNode);
+
+                stack.push_back(Task{ left + 1, task.depth + 1 });
+                stack.push_back(Task{ left, task.depth + 1 });
+            }
+
+            for (uint32_t position = 0; position < numObjects; position++)
+                m_ObjectBounds[position] = bounds[m_Objects[position]];
+
+            m_Stats.nodes = uint32_t(m_Nodes.size());
+            m_Stats.cost = m_Stats.buildCost = ComputeCost();
+        }
+
+        // Updates the node bounds for new object bounds without changing the tree. 'bounds' is indexed like in build.
+        void refit(const Box3f* bounds)
+        {
+            for (uint32_t position = 0; position < uint32_t(m_Objects.size()); position++)
+                m_ObjectBounds[position] = bounds[m_Objects[position]];
+
+            // Children are always stored after their parent
+            for (size_t index = m_Nodes.size(); index-- > 0; )
+            {
+                Node& node = m_Nodes[index];
+                if (node.leftChild)
+                    node.bounds = Union(m_Nodes[node.leftChild].bounds, m_Nodes[node.leftChild + 1].bounds);
+                else
+                    node.bounds = UnionOfPositions(node.firstObject, node.objectCount);
+            }
+
+            m_Stats.cost = ComputeCost();
+        }
+
+        uint32_t getObjectCount() const { return uint32_t(m_Objects.size()); }
+
+        void queryAll(SceneBVHQueryResult& result)
+        {
+            result.objects = m_SortedObjects;
+            BuildRanges(result);
+
+            m_Stats.visitedNodes = 0;
+            m_Stats.testedObjects = 0;
+            m_Stats.returnedObjects = uint32_t(result.objects.size());
+        }
+
+        // Objects whose bounds intersect any of the boxes
+        void query(const Box3f* boxes, uint32_t numBoxes, SceneBVHQueryResult& result)
+        {
+            BoxTest test = { boxes };
+            Query(test, numBoxes, result);
+        }
+
+        // Objects whose bounds intersect any of the frusta, conservatively: a box that straddles two planes
+        // outside of a frustum corner is reported
+        void query(const Frustum* frusta, uint32_t numFrusta, SceneBVHQueryResult& result)
+        {
+            FrustumTest test = { frusta };
+            Query(test, numFrusta, result);
+        }
+
+        const SceneBVHStats& getStats() const { return m_Stats; }
+
+    private:
+        struct Node
+        {
+            Box3f bounds;
+            uint32_t firstObject;   // every node covers a contiguous range of m_Objects
+            uint32_t objectCount;
+            uint32_t leftChild;     // 0 for leaves; the right child follows the left one
+
+            Node() : firstObject(0), objectCount(0), leftChild(0) { }
+        };
+
+        enum Overlap { OUTSIDE, PARTIAL, INSIDE };
+
+        struct BoxTest
+        {
+            const Box3f* boxes;
+
+            Overlap test(uint32_t index, const Box3f& bounds) const
+            {
+                const Box3f& box = boxes[index];
+                if (!box.intersectsWith(bounds))
+                    return OUTSIDE;
+                return box.contains(bounds) ? INSIDE : PARTIAL;
+            }
+        };
+
+        struct FrustumTest
+        {
+            const Frustum* frusta;
+
+            Overlap test(uint32_t index, const Box3f& bounds) const
+            {
+                Overlap result = INSIDE;
+                for (int i = 0; i < Frustum::PLANES_COUNT; i++)
+                {
+                    const Plane& plane = frusta[index].planes[i];
+
+                    // Nearest and farthest corners along the plane normal, which points out of the frustum
+                    Vector3f nearPt(
+                        plane.normal.x > 0 ? bounds.lower.x : bounds.upper.x,
+                        plane.normal.y > 0 ? bounds.lower.y : bounds.upper.y,
+                        plane.normal.z > 0 ? bounds.lower.z : bounds.upper.z);
+                    Vector3f farPt(
+                        plane.normal.x > 0 ? bounds.upper.x : bounds.lower.x,
+                        plane.normal.y > 0 ? bounds.upper.y : bounds.lower.y,
+                        plane.normal.z > 0 ? bounds.upper.z : bounds.lower.z);
+
+                    if (plane.normal.x * nearPt.x + plane.normal.y * nearPt.y + plane.normal.z * nearPt.z > plane.distance)
+                        return OUTSIDE;
+                    if (plane.normal.x * farPt.x + plane.normal.y * farPt.y + plane.normal.z * farPt.z > plane.distance)
+                        result = PARTIAL;
+                }
+                return result;
+            }
+        };
+
+        std::vector<Node> m_Nodes;
+        std::vector<uint32_t> m_Objects;        // object indices in tree order
+        std::vector<Box3f> m_ObjectBounds;      // bounds in tree order
+        std::vector<uint32_t> m_SortedObjects;  // object indices ordered by sort key, then index
+        std::vector<uint32_t> m_SortKeys;       // by object index
+        std::vector<uint32_t> m_Ranks;          // position of each object in m_SortedObjects
+        std::vector<uint32_t> m_ObjectStamps;   // by rank; equal to m_Stamp if the current query returned the object
+        std::vector<uint32_t> m_Found;          // ranks found by the current query
+        uint32_t m_Stamp;
+        SceneBVHStats m_Stats;
+
+        struct StackEntry
+        {
+            uint32_t node;
+            uint64_t active;    // queries of the current batch that partially overlap the node
+        };
+        std::vector<StackEntry> m_Stack;
+
+        template<typename Test>
+        void Query(const Test& test, uint32_t numQueries, SceneBVHQueryResult& result)
+        {
+            result.clear();
+            m_Found.clear();
+            m_Stats.visitedNodes = 0;
+            m_Stats.testedObjects = 0;
+
+            if (++m_Stamp == 0)
+            {
+                std::fill(m_ObjectStamps.begin(), m_ObjectStamps.end(), 0);
+                m_Stamp = 1;
+            }
+
+            for (uint32_t batchStart = 0; !m_Nodes.empty() && batchStart < numQueries; batchStart += QUERY_BATCH)
+            {
+                uint32_t batchSize = std::min(numQueries - batchStart, uint32_t(QUERY_BATCH));
+
+                m_Stack.clear();
+                m_Stack.push_back(StackEntry{ 0, batchSize == 64 ? ~0ull : (1ull << batchSize) - 1 });
+
+                while (!m_Stack.empty())
+                {
+                    StackEntry entry = m_Stack.back();
+                    m_Stack.pop_back();
+
+                    const Node& node = m_Nodes[entry.node];
+                    m_Stats.visitedNodes++;
+
+                    uint64_t active = 0;
+                    bool inside = false;
+                    for (uint64_t bits = entry.active; bits && !inside; bits &= bits - 1)
+                    {
+                        uint32_t bit = BitIndex(bits);
+                        Overlap overlap = test.test(batchStart + bit, node.bounds);
+                        if (overlap == INSIDE)
+                            inside = true;
+                        else if (overlap == PARTIAL)
+                            active |= 1ull << bit;
+                    }
+
+                    if (inside)
+                    {
+                        for (uint32_t position = node.firstObject; position < node.firstObject + node.objectCount; position++)
+                            Add(m_Objects[position]);
+                    }
+                    else if (active && node.leftChild)
+                    {
+                        m_Stack.push_back(StackEntry{ node.leftChild + 1, active });
+                        m_Stack.push_back(StackEntry{ node.leftChild, active });
+                    }
+                    else if (active)
+                    {
+                        for (uint32_t position = node.firstObject; position < node.firstObject + node.objectCount; position++)
+                        {
+                            m_Stats.testedObjects++;
+                            for (uint64_t bits = active; bits; bits &= bits - 1)
+                            {
+                                if (test.test(batchStart + BitIndex(bits), m_ObjectBounds[position]) != OUTSIDE)
+                                {
+                                    Add(m_Objects[position]);
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Sorting a few results is cheaper than scanning the stamps of the whole scene
+            if (m_Found.size() * 16 < m_SortedObjects.size())
+            {
+                std::sort(m_Found.begin(), m_Found.end());
+                result.objects.reserve(m_Found.size());
+                for (uint32_t rank : m_Found)
+                    result.objects.push_back(m_SortedObjects[rank]);
+            }
+            else
+            {
+                result.objects.reserve(m_Found.size());
+                for (uint32_t rank = 0; rank < uint32_t(m_SortedObjects.size()); rank++)
+                    if (m_ObjectStamps[rank] == m_Stamp)
+                        result.objects.push_back(m_SortedObjects[rank]);
+            }
+
+            BuildRanges(result);
+            m_Stats.returnedObjects = uint32_t(result.objects.size());
+        }
+
+        void Add(uint32_t object)
+        {
+            uint32_t rank = m_Ranks[object];
+            if (m_ObjectStamps[rank] != m_Stamp)
+            {
+                m_ObjectStamps[rank] = m_Stamp;
+                m_Found.push_back(rank);
+            }
+        }
+
+        void BuildRanges(SceneBVHQueryResult& result) const
+        {
+            result.ranges.clear();
+            for (uint32_t index = 0; index < uint32_t(result.objects.size()); index++)
+            {
+                uint32_t key = m_SortKeys[result.objects[index]];
+                if (result.ranges.empty() || result.ranges.back().sortKey != key)
+                {
+                    SceneBVHDrawRange range = { key, index, 0 };
+                    result.ranges.push_back(range);
+                }
+                result.ranges.back().count++;
+            }
+        }
+
+        void BuildSortedOrder(const uint32_t* sortKeys, uint32_t numObjects)
+        {
+            m_SortKeys.assign(numObjects, 0);
+            if (sortKeys)
+                m_SortKeys.assign(sortKeys, sortKeys + numObjects);
+
+            m_SortedObjects.resize(numObjects);
+            for (uint32_t index = 0; index < numObjects; index++)
+                m_SortedObjects[index] = index;
+
+            const std::vector<uint32_t>& keys = m_SortKeys;
+            std::stable_sort(m_SortedObjects.begin(), m_SortedObjects.end(), [&keys](uint32_t a, uint32_t b)
+            {
+                return keys[a] < keys[b];
+            });
+
+            m_Ranks.resize(numObjects);
+            for (uint32_t rank = 0; rank < numObjects; rank++)
+                m_Ranks[m_SortedObjects[rank]] = rank;
+        }
+
+        // Partitions the objects of the node and returns the size of the left part, or 0 to make the node a leaf
+        uint32_t FindSplit(const Box3f* bounds, const std::vector<Vector3f>& centroids, const Node& node)
+        {
+            uint32_t* objects = &m_Objects[node.firstObject];
+            uint32_t count = node.objectCount;
+
+            Box3f centroidBounds(centroids[objects[0]], centroids[objects[0]]);
+            for (uint32_t index = 1; index < count; index++)
+                centroidBounds = Union(centroidBounds, Box3f(centroids[objects[index]], centroids[objects[index]]));
+
+            Vector3f extent = centroidBounds.size();
+            float parentArea = SurfaceArea(node.bounds);
+
+            float bestCost = float(count);
+            int bestAxis = -1;
+            int bestBin = 0;
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float axisExtent = Component(extent, axis);
+                if (axisExtent <= 0.f)
+                    continue;
+
+                struct Bin { Box3f bounds; uint32_t count; };
+                Bin bins[SAH_BINS];
+                for (Bin& bin : bins)
+                    bin.count = 0;
+
+                float scale = float(SAH_BINS) / axisExtent;
+                for (uint32_t index = 0; index < count; index++)
+                {
+                    int bin = BinIndex(Component(centroids[objects[index]], axis), Component(centroidBounds.lower, axis), scale);
+                    bins[bin].bounds = bins[bin].count ? Union(bins[bin].bounds, bounds[objects[index]]) : bounds[objects[index]];
+                    bins[bin].count++;
+                }
+
+                // Sweep from the right to get the area and count right of every split plane
+                float rightArea[SAH_BINS];
+                uint32_t rightCount[SAH_BINS];
+                Box3f accumulated;
+                uint32_t accumulatedCount = 0;
+                for (int bin = SAH_BINS - 1; bin > 0; bin--)
+                {
+                    if (bins[bin].count)
+                        accumulated = accumulatedCount ? Union(accumulated, bins[bin].bounds) : bins[bin].bounds;
+                    accumulatedCount += bins[bin].count;
+                    rightArea[bin] = accumulatedCount ? SurfaceArea(accumulated) : 0.f;
+                    rightCount[bin] = accumulatedCount;
+                }
+
+                accumulatedCount = 0;
+                for (int bin = 0; bin < SAH_BINS - 1; bin++)
+                {
+                    if (bins[bin].count)
+                        accumulated = accumulatedCount ? Union(accumulated, bins[bin].bounds) : bins[bin].bounds;
+                    accumulatedCount += bins[bin].count;
+
+                    if (accumulatedCount == 0 || rightCount[bin + 1] == 0)
+                        continue;
+
+                    // One node visit costs about as much as one object test
+                    float cost = 1.f + (SurfaceArea(accumulated) * float(accumulatedCount) + rightArea[bin + 1] * float(rightCount[bin + 1])) / std::max(parentArea, 1e-20f);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
+
+            if (bestAxis < 0)
+            {
+                if (count <= MAX_LEAF_OBJECTS)
+                    return 0;
+
+                // All centroids coincide or no split pays off; split in half to bound the leaf size
+                return count / 2;
+            }
+
+            float lower = Component(centroidBounds.lower, bestAxis);
+            float scale = float(SAH_BINS) / Component(extent, bestAxis);
+            uint32_t* middle = std::partition(objects, objects + count, [&](uint32_t object)
+            {
+                return BinIndex(Component(centroids[object], bestAxis), lower, scale) <= bestBin;
+            });
+
+            return uint32_t(middle - objects);
+        }
+
+        float ComputeCost() const
+        {
+            if (m_Nodes.empty())
+                return 0.f;
+
+            float rootArea = std::max(SurfaceArea(m_Nodes[0].bounds), 1e-20f);
+            float cost = 0.f;
+            for (const Node& node : m_Nodes)
+            {
+                float probability = SurfaceArea(node.bounds) / rootArea;
+                cost += probability * (node.leftChild ? 1.f : float(node.objectCount));
+            }
+
+            return cost / float(m_Objects.size());
+        }
+
+        Box3f UnionOfObjects(const Box3f* bounds, uint32_t first, uint32_t count) const
+        {
+            Box3f result = bounds[m_Objects[first]];
+            for (uint32_t position = first + 1; position < first + count; position++)
+                result = Union(result, bounds[m_Objects[position]]);
+            return result;
+        }
+
+        Box3f UnionOfPositions(uint32_t first, uint32_t count) const
+        {
+            Box3f result = m_ObjectBounds[first];
+            for (uint32_t position = first + 1; position < first + count; position++)
+                result = Union(result, m_ObjectBounds[position]);
+            return result;
+        }
+
+        // Box3f::unionWith ignores a box whose largest extent is 0, so a union with a point box, like the centroid
+        // bounds in FindSplit or a mesh that collapses to a point, would return the other box unchanged
+        static Box3f Union(const Box3f& a, const Box3f& b)
+        {
+            return Box3f(
+                Vector3f(std::min(a.lower.x, b.lower.x), std::min(a.lower.y, b.lower.y), std::min(a.lower.z, b.lower.z)),
+                Vector3f(std::max(a.upper.x, b.upper.x), std::max(a.upper.y, b.upper.y), std::max(a.upper.z, b.upper.z)));
+        }
+
+        static float SurfaceArea(const Box3f& box)
+        {
+            Vector3f size = box.size();
+            return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        static float Component(const Vector3f& v, int axis)
+        {
+            return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+        }
+
+        static int BinIndex(float value, float lower, float scale)
+        {
+            return std::min(int((value - lower) * scale), int(SAH_BINS) - 1);
+        }
+
+        static uint32_t BitIndex(uint64_t bits)
+        {
+#ifdef _MSC_VER
+            // _BitScanForward64 is not available in 32-bit builds
+            unsigned long index;
+            if (_BitScanForward(&index, uint32_t(bits)))
+                return uint32_t(index);
+            _BitScanForward(&index, uint32_t(bits >> 32));
+            return uint32_t(index) + 32;
+#else
+            return uint32_t(__builtin_ctzll(bits));
+#endif
+        }
+    };
+}
@@ -0,0 +1,282 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "GFSDK_NVRHI_Hash.h"
+
+namespace VXGI
+{
+    // Pack of compiled user-defined shader sets (the blobs produced by IShaderCompiler), so that an application
+    // does not have to recompile its voxelization and cone tracing shaders on every startup.
+    //
+    // Entries are keyed by the VFX_VXGI_GetInternalShaderHash value, the graphics API and a hash of the user inputs
+    // (source code, bytecode or desc) that the application computes with ShaderPack::HashSource. Blobs that are found
+    // must still be validated with IShaderCompiler::isValidUserDefinedShaderBinary before use; a mismatch means that
+    // the shader has to be compiled at runtime.
+    //
+    // File layout, all little-endian:
+    //   Header
+    //   Blob data, each blob aligned to 16 bytes
+    //   Index: entryCount * Entry
+    // The header stores a checksum of the index, and each entry stores a checksum of its blob.
+    namespace ShaderPack
+    {
+        enum : uint32_t
+        {
+            MAGIC = 0x50535856, // "VXSP"
+            VERSION = 1,
+            BLOB_ALIGNMENT = 16
+        };
+
+        struct Key
+        {
+            uint64_t internalShaderHash;
+            uint64_t sourceHash;
+            uint32_t graphicsAPI;   // NVRHI::GraphicsAPI::Enum
+
+            Key() : internalShaderHash(0), sourceHash(0), graphicsAPI(0) { }
+            Key(uint64_t _internalShaderHash, uint32_t _graphicsAPI, uint64_t _sourceHash)
+                : internalShaderHash(_internalShaderHash), sourceHash(_sourceHash), graphicsAPI(_graphicsAPI) { }
+
+            bool operator==(const Key& other) const
+            {
+                return internalShaderHash == other.internalShaderHash && sourceHash == other.sourceHash && graphicsAPI == other.graphicsAPI;
+            }
+        };
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t entryCount;
+            uint32_t reserved;
+            uint64_t indexOffset;
+            uint64_t indexChecksum;
+        };
+
+        struct Entry
+        {
+            uint64_t internalShaderHash;
+            uint64_t sourceHash;
+            uint32_t graphicsAPI;
+            uint32_t reserved;
+            uint64_t dataOffset;
+            uint64_t dataSize;
+            uint64_t dataChecksum;
+        };
+
+        inline FILE* OpenFile(const char* path, const char* mode)
+        {
+#ifdef _MSC_VER
+            FILE* file = nullptr;
+            return fopen_s(&file, path, mode) == 0 ? file : nullptr;
+#else
+            return fopen(path, mode);
+#endif
+        }
+
+        // Chains hashes of the inputs that a compiled shader depends on, e.g. a tag naming the shader, its source and its resource slots
+        inline uint64_t HashSource(const void* data, size_t size, uint64_t previous = 0)
+        {
+            return NVRHI::Hash::HashBytes(data, size, previous);
+        }
+
+        class Writer
+        {
+        public:
+            // Replaces the blob if the key is already in the pack
+            void add(const Key& key, const void* data, size_t size)
+            {
+                for (auto& item : m_Items)
+                {
+                    if (item.key == key)
+                    {
+                        item.data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+                        return;
+                    }
+                }
+
+                Item item;
+                item.key = key;
+                item.data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+                m_Items.push_back(item);
+            }
+
+            size_t getEntryCount() const { return m_Items.size(); }
+
+            void serialize(std::vector<uint8_t>& output) const
+            {
+                std::vector<Entry> index(m_Items.size());
+
+                output.assign(sizeof(Header), 0);
+
+                for (size_t i = 0; i < m_Items.size(); i++)
+                {
+                    const Item& item = m_Items[i];
+                    output.resize((output.size() + BLOB_ALIGNMENT - 1) & ~size_t(BLOB_ALIGNMENT - 1), 0);
+
+                    Entry& entry = index[i];
+                    memset(&entry, 0, sizeof(entry));
+                    entry.internalShaderHash = item.key.internalShaderHash;
+                    entry.sourceHash = item.key.sourceHash;
+                    entry.graphicsAPI = item.key.graphicsAPI;
+                    entry.dataOffset = output.size();
+                    entry.dataSize = item.data.size();
+                    entry.dataChecksum = NVRHI::Hash::HashBytes(item.data.data(), item.data.size());
+
+                    output.insert(output.end(), item.data.begin(), item.data.end());
+                }
+
+                output.resize((output.size() + BLOB_ALIGNMENT - 1) & ~size_t(BLOB_ALIGNMENT - 1), 0);
+
+                Header header;
+                memset(&header, 0, sizeof(header));
+                header.magic = MAGIC;
+                header.version = VERSION;
+                header.entryCount = uint32_t(index.size());
+                header.indexOffset = output.size();
+                header.indexChecksum = NVRHI::Hash::HashBytes(index.data(), index.size() * sizeof(Entry));
+                memcpy(output.data(), &header, sizeof(header));
+
+                output.insert(output.end(), (const uint8_t*)index.data(), (const uint8_t*)(index.data() + index.size()));
+            }
+
+            // Writes to a temporary file first and renames it, so that readers never see a partially written pack
+            bool writeFile(const char* path) const
+            {
+                std::vector<uint8_t> data;
+                serialize(data);
+
+                std::string tempPath = std::string(path) + ".tmp";
+                FILE* file = OpenFile(tempPath.c_str(), "wb");
+                if (!file)
+                    return false;
+
+                bool written = fwrite(data.data(), data.size(), 1, file) == 1;
+                written = (fclose(file) == 0) && written;
+
+                if (written)
+                {
+                    remove(path);
+                    written = rename(tempPath.c_str(), path) == 0;
+                }
+
+                if (!written)
+                    remove(tempPath.c_str());
+
+                return written;
+            }
+
+        private:
+            struct Item
+            {
+                Key key;
+                std::vector<uint8_t> data;
+            };
+
+            std::vector<Item> m_Items;
+        };
+
+        class Reader
+        {
+        public:
+            // Takes a copy of the pack. Returns false if the header or the index are damaged or from another version;
+            // the reader is empty in that case.
+            bool load(const void* data, size_t size)
+            {
+                m_Data.clear();
+                m_Index.clear();
+
+                Header header;
+                if (size < sizeof(Header))
+                    return false;
+
+                memcpy(&header, data, sizeof(header));
+                if (header.magic != MAGIC || header.version != VERSION)
+                    return false;
+
+                uint64_t indexSize = uint64_t(header.entryCount) * sizeof(Entry);
+                if (header.indexOffset < sizeof(Header) || header.indexOffset > size || indexSize != size - header.indexOffset)
+                    return false;
+
+                const uint8_t* indexData = (const uint8_t*)data + header.indexOffset;
+                if (NVRHI::Hash::HashBytes(indexData, size_t(indexSize)) != header.indexChecksum)
+                    return false;
+
+                m_Index.resize(header.entryCount);
+                if (indexSize)
+                    memcpy(m_Index.data(), indexData, size_t(indexSize));
+
+                for (const Entry& entry : m_Index)
+                {
+                    if (entry.dataOffset < sizeof(Header) || entry.dataOffset > header.indexOffset || entry.dataSize > header.indexOffset - entry.dataOffset)
+                    {
+                        m_Index.clear();
+                        return false;
+                    }
+                }
+
+                m_Data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+                return true;
+            }
+
+            bool loadFile(const char* path)
+            {
+                m_Data.clear();
+                m_Index.clear();
+
+                FILE* file = OpenFile(path, "rb");
+                if (!file)
+                    return false;
+
+                std::vector<uint8_t> data;
+                uint8_t buffer[65536];
+                size_t size;
+                while ((size = fread(buffer, 1, sizeof(buffer), file)) != 0)
+                    data.insert(data.end(), buffer, buffer + size);
+                fclose(file);
+
+                return load(data.data(), data.size());
+            }
+
+            // Returns false if the key is not in the pack or if its blob fails the checksum
+            bool find(const Key& key, const void** data, size_t* size) const
+            {
+                for (const Entry& entry : m_Index)
+                {
+                    if (entry.internalShaderHash != key.internalShaderHash || entry.sourceHash != key.sourceHash || entry.graphicsAPI != key.graphicsAPI)
+                        continue;
+
+                    const uint8_t* blob = m_Data.data() + entry.dataOffset;
+                    if (NVRHI::Hash::HashBytes(blob, size_t(entry.dataSize)) != entry.dataChecksum)
+                        return false;
+
+                    *data = blob;
+                    *size = size_t(entry.dataSize);
+                    return true;
+                }
+
+                return false;
+            }
+
+            size_t getEntryCount() const { return m_Index.size(); }
+
+        private:
+            std::vector<uint8_t> m_Data;
+            std::vector<Entry> m_Index;
+        };
+    }
+}
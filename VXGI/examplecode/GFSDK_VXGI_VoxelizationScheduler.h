@@ -0,0 +1,257 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <GFSDK_VXGI.h>
+
+namespace VXGI
+{
+    struct VoxelizationSchedulerStats
+    {
+        uint32_t candidateRegions;
+        uint32_t scheduledRegions;
+        uint32_t deferredRegions;       // the backlog carried to the next frame
+        uint32_t forcedRegions;         // scheduled over budget because they were deferred for too long
+        uint64_t scheduledTriangles;
+        uint64_t deferredTriangles;     // triangles in the backlog that the scheduled regions do not already draw
+        float estimatedMs;              // predicted cost of the scheduled regions
+        uint32_t oldestDeferredAge;     // in frames
+        float msPerMillionTriangles;    // the current cost model
+
+        VoxelizationSchedulerStats() { memset(this, 0, sizeof(*this)); }
+    };
+
+    // Spreads opacity voxelization of the regions returned by IGlobalIllumination::getInvalidatedRegions over several
+    // frames, so that a fast camera move does not revoxelize everything on one frame. Each region is costed by the
+    // triangles of the meshes whose bounds intersect it and that no region scheduled before it already draws.
+    // Regions are taken in the order of clipmap level (finest first), then the oldest first, then by distance to
+    // the camera, until the time budget is spent. Regions without geometry are free and always scheduled.
+    //
+    // VXGI clears every region it reports, so a deferred region is empty until it is voxelized. To make VXGI report it
+    // again, pass getDeferredRegions() as UpdateVoxelizationParameters::invalidatedRegions on the next frame.
+    // A region that has been deferred for maxDeferredFrames frames is scheduled regardless of the budget, and the
+    // highest priority region is always scheduled, so the backlog cannot starve. Only use the scheduler with
+    // persistentVoxelData; without it the whole clipmap is invalidated on every frame and deferred regions stay empty.
+    //
+    // The cost model is a time per triangle, refined by reportMeasuredTime with GPU times of voxelization passes.
+    class VoxelizationScheduler
+    {
+    public:
+        enum { FRAME_HISTORY = 16 };
+
+        VoxelizationScheduler()
+            : m_BudgetMs(2.f)
+            , m_MaxDeferredFrames(8)
+            , m_MsPerTriangle(1e-5f)
+            , m_Stamp(0)
+        {
+            memset(m_Frames, 0, sizeof(m_Frames));
+        }
+
+        void addMesh(const Box3f& bounds, uint32_t triangleCount)
+        {
+            Mesh mesh;
+            mesh.bounds = bounds;
+            mesh.triangles = triangleCount;
+            mesh.stamp = 0;
+            m_Meshes.push_back(mesh);
+        }
+
+        void clearMeshes() { m_Meshes.clear(); }
+
+        // A budget of 0 schedules every region on the frame it is reported
+        void setBudget(float milliseconds) { m_BudgetMs = milliseconds; }
+        void setMaxDeferredFrames(uint32_t frames) { m_MaxDeferredFrames = std::max(frames, 1u); }
+        void setCostModel(float msPerMillionTriangles) { m_MsPerTriangle = msPerMillionTriangles * 1e-6f; }
+
+        // Fills 'scheduled' with the regions to voxelize on this frame. 'levels' holds the clipmap level of each region,
+        // 0 being the finest, and may be null. 'frameId' identifies the frame for reportMeasuredTime.
+        void schedule(
+            const Box3f* regions,
+            const uint32_t* levels,
+            uint32_t numRegions,
+            const Vector3f& cameraPosition,
+            uint64_t frameId,
+            std::vector<Box3f>& scheduled)
+        {
+            scheduled.clear();
+            m_Stats = VoxelizationSchedulerStats();
+            m_Stats.candidateRegions = numRegions;
+            m_Stats.msPerMillionTriangles = m_MsPerTriangle * 1e6f;
+
+            if (++m_Stamp == 0)
+            {
+                for (Mesh& mesh : m_Meshes)
+                    mesh.stamp = 0;
+                m_Stamp = 1;
+            }
+
+            m_Candidates.resize(numRegions);
+            for (uint32_t index = 0; index < numRegions; index++)
+            {
+                Candidate& candidate = m_Candidates[index];
+                candidate.box = regions[index];
+                candidate.level = levels ? levels[index] : 0;
+                candidate.distance = DistanceSquared(regions[index], cameraPosition);
+
+                // VXGI snaps resubmitted regions to its page grid, so match them by overlap rather than equality
+                candidate.age = 0;
+                for (const Deferred& deferred : m_Deferred)
+                    if (OverlapVolume(deferred.box, candidate.box) > 0.f)
+                        candidate.age = std::max(candidate.age, deferred.age);
+
+                candidate.forced = candidate.age >= m_MaxDeferredFrames;
+            }
+
+            std::sort(m_Candidates.begin(), m_Candidates.end(), [](const Candidate& a, const Candidate& b)
+            {
+                if (a.forced != b.forced) return a.forced;
+                if (a.level != b.level) return a.level < b.level;
+                if (a.age != b.age) return a.age > b.age;
+                return a.distance < b.distance;
+            });
+
+            m_Deferred.clear();
+            m_DeferredBoxes.clear();
+
+            float spentMs = 0.f;
+            bool anyScheduled = false;
+
+            for (const Candidate& candidate : m_Candidates)
+            {
+                m_Touched.clear();
+                uint64_t triangles = 0;
+                for (uint32_t meshIndex = 0; meshIndex < uint32_t(m_Meshes.size()); meshIndex++)
+                {
+                    const Mesh& mesh = m_Meshes[meshIndex];
+                    if (mesh.stamp != m_Stamp && mesh.bounds.intersectsWith(candidate.box))
+                    {
+                        m_Touched.push_back(meshIndex);
+                        triangles += mesh.triangles;
+                    }
+                }
+
+                float costMs = float(triangles) * m_MsPerTriangle;
+                bool take = m_BudgetMs <= 0.f || candidate.forced || triangles == 0 || !anyScheduled || spentMs + costMs <= m_BudgetMs;
+
+                if (take)
+                {
+                    for (uint32_t meshIndex : m_Touched)
+                        m_Meshes[meshIndex].stamp = m_Stamp;
+
+                    scheduled.push_back(candidate.box);
+                    spentMs += costMs;
+                    anyScheduled = anyScheduled || triangles != 0;
+
+                    m_Stats.scheduledRegions++;
+                    m_Stats.scheduledTriangles += triangles;
+                    if (candidate.forced)
+                        m_Stats.forcedRegions++;
+                }
+                else
+                {
+                    Deferred deferred;
+                    deferred.box = candidate.box;
+                    deferred.age = candidate.age + 1;
+                    m_Deferred.push_back(deferred);
+                    m_DeferredBoxes.push_back(candidate.box);
+
+                    m_Stats.deferredRegions++;
+                    m_Stats.deferredTriangles += triangles;
+                    m_Stats.oldestDeferredAge = std::max(m_Stats.oldestDeferredAge, deferred.age);
+                }
+            }
+
+            m_Stats.estimatedMs = spentMs;
+
+            FrameRecord& record = m_Frames[frameId % FRAME_HISTORY];
+            record.frameId = frameId;
+            record.triangles = m_Stats.scheduledTriangles;
+            record.valid = true;
+        }
+
+        // Regions to pass as UpdateVoxelizationParameters::invalidatedRegions on the next frame
+        const std::vector<Box3f>& getDeferredRegions() const { return m_DeferredBoxes; }
+
+        // Refines the cost model with the measured GPU time of the voxelization pass of a scheduled frame.
+        // Frames with few triangles are ignored, because fixed costs dominate their timing.
+        void reportMeasuredTime(uint64_t frameId, float milliseconds)
+        {
+            const FrameRecord& record = m_Frames[frameId % FRAME_HISTORY];
+            if (!record.valid || record.frameId != frameId || record.triangles < 10000 || milliseconds <= 0.f)
+                return;
+
+            float measured = milliseconds / float(record.triangles);
+            m_MsPerTriangle += (measured - m_MsPerTriangle) * 0.25f;
+        }
+
+        const VoxelizationSchedulerStats& getStats() const { return m_Stats; }
+
+    private:
+        struct Mesh
+        {
+            Box3f bounds;
+            uint32_t triangles;
+            uint32_t stamp;     // equals m_Stamp if a region scheduled on this frame already draws the mesh
+        };
+
+        struct Candidate
+        {
+            Box3f box;
+            uint32_t level;
+            float distance;
+            uint32_t age;
+            bool forced;
+        };
+
+        struct Deferred
+        {
+            Box3f box;
+            uint32_t age;       // frames the region has been deferred for
+        };
+
+        struct FrameRecord
+        {
+            uint64_t frameId;
+            uint64_t triangles;
+            bool valid;
+        };
+
+        float m_BudgetMs;
+        uint32_t m_MaxDeferredFrames;
+        float m_MsPerTriangle;
+        uint32_t m_Stamp;
+        std::vector<Mesh> m_Meshes;
+        std::vector<Candidate> m_Candidates;
+        std::vector<Deferred> m_Deferred;
+        std::vector<Box3f> m_DeferredBoxes;
+        std::vector<uint32_t> m_Touched;
+        FrameRecord m_Frames[FRAME_HISTORY];
+        VoxelizationSchedulerStats m_Stats;
+
+        static float OverlapVolume(const Box3f& a, const Box3f& b)
+        {
+            return a.intersectsWith(b) ? a.intersection(b).volume() : 0.f;
+        }
+
+        static float DistanceSquared(const Box3f& box, const Vector3f& point)
+        {
+            float dx = std::max(std::max(box.lower.x - point.x, point.x - box.upper.x), 0.f);
+            float dy = std::max(std::max(box.lower.y - point.y, point.y - box.upper.y), 0.f);
+            float dz = std::max(std::max(box.lower.z - point.z, point.z - box.upper.z), 0.f);
+            return dx * dx + dy * dy + dz * dz;
+        }
+    };
+}
@@ -760,6 +760,34 @@ namespace NVRHI
         { }
     };
 
+    // Counters for one frame of work submitted through an IRendererInterface.
+    // Counters that a backend has no equivalent for stay zero.
+    struct RendererStatistics
+    {
+        enum { HISTOGRAM_BUCKETS = 32 };
+
+        uint64_t frameIndex;
+        uint32_t drawCalls;                 // one for every DrawArguments entry
+        uint32_t indirectDrawCalls;
+        uint32_t dispatches;
+        uint32_t indirectDispatches;
+        uint64_t verticesSubmitted;         // vertexCount * instanceCount of direct draws
+        uint32_t stateChanges;              // pipeline state, root signature, program or state object changes sent to the API
+        uint32_t descriptorCopies;          // descriptors copied into shader-visible heaps
+        uint32_t barriers;                  // resource barriers (D3D12) or memory barriers (GL)
+        uint64_t bytesUploaded;             // texture, buffer and constant buffer writes
+        uint32_t constantBufferWrites;
+        uint32_t identicalConstantBufferWrites; // writes that were skipped because the contents did not change
+        uint32_t stateCacheMisses;          // pipeline states (D3D12), state objects (D3D11) or framebuffers (GL) created
+        uint32_t commandListFlushes;        // command lists submitted or executed
+
+        // Power-of-2 histograms: bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i), the last one is open
+        uint32_t drawVertexHistogram[HISTOGRAM_BUCKETS];   // vertexCount * instanceCount of each direct draw
+        uint32_t uploadSizeHistogram[HISTOGRAM_BUCKETS];   // bytes of each write
+
+        RendererStatistics() { memset(this, 0, sizeof(*this)); }
+    };
+
     // Should be implemented by the application.
     // Clients will call signalError(...) on every error it encounters, in addition to returning one of the 
     // failure status codes. The application can display a message box in case of errors.
@@ -861,6 +889,22 @@ namespace NVRHI
 		// A barrier should still be placed before the first draw call in the group and after the last one.
 		virtual void setEnableUavBarriersForTexture(TextureHandle texture, bool enableBarriers) = 0;
 		virtual void setEnableUavBarriersForBuffer(BufferHandle buffer, bool enableBarriers) = 0;
+
+        // Marks a group of dispatch calls that may execute on an asynchronous compute queue, overlapping with graphics work
+        // submitted after the scope. The backend transitions resources and synchronizes the queues as needed.
+        // The scope is meant for dispatches, copies, buffer and texture writes and UAV clears; scopes cannot be nested.
+        // A draw call or render target clear inside the scope submits the compute work recorded before it,
+        // and the rest of the scope executes on the graphics queue in order.
+        // Backends without a separate compute queue ignore the scope and execute the work in order.
+        virtual void beginComputeQueueScope() { }
+        virtual void endComputeQueueScope() { }
+
+        // Per-frame statistics. Nothing is counted until they are enabled. endStatisticsFrame closes the current frame,
+        // whose counters are then returned by getFrameStatistics, and starts a new one with zeroed counters.
+        // Backends that don't collect statistics return false from both setEnableStatistics and getFrameStatistics.
+        virtual bool setEnableStatistics(bool enable) { (void)enable; return false; }
+        virtual void endStatisticsFrame() { }
+        virtual bool getFrameStatistics(RendererStatistics& stats) { (void)stats; return false; }
     };
 
 }
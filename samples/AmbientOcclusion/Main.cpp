@@ -10,6 +10,10 @@
 
 #include "SceneRenderer.h"
 #include "Camera.h"
+#include "GFSDK_VXGI_PerformanceMonitor.h"
+#include "GFSDK_VXGI_PoolAllocator.h"
+#include "GFSDK_VXGI_RegionCoalescer.h"
+#include "GFSDK_VXGI_VoxelizationScheduler.h"
 #include <AntTweakBar.h>
 
 #if USE_D3D11
@@ -25,6 +29,8 @@ NVRHI::RendererInterfaceD3D11* g_pRendererInterface = NULL;
 #include "GFSDK_NVRHI_D3D12.h"
 #define API_STRING "D3D12"
 NVRHI::RendererInterfaceD3D12* g_pRendererInterface = NULL;
+NVRHI::ResidencyReport g_ResidencyReport;
+NVRHI::FrameBeginInfo g_FrameInfo;
 
 #elif USE_GL4
 
@@ -43,6 +49,8 @@ SceneRenderer* g_pSceneRenderer = NULL;
 VXGI::IGlobalIllumination* g_pGI = NULL;
 VXGI::IShaderCompiler* g_pGICompiler = NULL;
 VXGI::IViewTracer* g_pGITracer = NULL;
+VXGI::PerformanceMonitor* g_pPerfMonitor = NULL;
+VXGI::PoolAllocator* g_pAllocator = NULL;
 
 static float g_fCameraClipNear = 1.0f;
 static float g_fCameraClipFar = 10000.0f;
@@ -51,6 +59,17 @@ static float g_fAmbientRange = 512.0f;
 static bool g_bEnableVXAO = true;
 static bool g_bVisualizeAO = false;
 static bool g_bRenderHUD = true;
+static bool g_bShowRendererStats = true;
+static bool g_bDumpRendererStats = false;
+static FILE* g_pRendererStatsFile = NULL;
+static NVRHI::RendererStatistics g_RendererStats;
+static bool g_bRendererStatsValid = false;
+static bool g_bShowPerfSections = true;
+static float g_fRegionOverCoverage = 0.1f;
+static VXGI::RegionCoalescingStats g_RegionStats;
+static VXGI::VoxelizationScheduler g_VoxelizationScheduler;
+static float g_fVoxelizationBudget = 2.0f;
+static bool g_bExportPerfTrace = false;
 static VXGI::DebugRenderMode::Enum g_DebugRenderMode = VXGI::DebugRenderMode::DISABLED;
 static int g_iDebugLevel = 0;
 static bool g_bInitialized = false;
@@ -82,6 +101,8 @@ HRESULT CreateVXGIObject()
     VXGI::GIParameters params;
     params.rendererInterface = g_pRendererInterface;
     params.errorCallback = &g_ErrorCallback;
+    params.perfMonitor = g_pPerfMonitor;
+    params.allocator = g_pAllocator;
 
     VXGI::ShaderCompilerParameters comparams;
     comparams.errorCallback = &g_ErrorCallback;
@@ -119,6 +140,98 @@ HRESULT CreateVXGIObject()
     return S_OK;
 }
 
+// Appends one row per frame to RendererStatistics.csv while the "Dump stats CSV" option is on
+void DumpRendererStatistics(const NVRHI::RendererStatistics& stats)
+{
+    if (!g_bDumpRendererStats)
+    {
+        if (g_pRendererStatsFile)
+        {
+            fclose(g_pRendererStatsFile);
+            g_pRendererStatsFile = NULL;
+        }
+        return;
+    }
+
+    if (!g_pRendererStatsFile)
+    {
+        if (fopen_s(&g_pRendererStatsFile, "RendererStatistics.csv", "w") != 0)
+        {
+            g_pRendererStatsFile = NULL;
+            g_bDumpRendererStats = false;
+            return;
+        }
+
+        fprintf(g_pRendererStatsFile, "frame,frameTimeMs,drawCalls,indirectDrawCalls,dispatches,indirectDispatches,vertices,"
+            "stateChanges,descriptorCopies,barriers,bytesUploaded,constantBufferWrites,identicalConstantBufferWrites,"
+            "stateCacheMisses,commandListFlushes\n");
+    }
+
+    fprintf(g_pRendererStatsFile, "%llu,%.3f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+        (unsigned long long)stats.frameIndex, g_DeviceManager->GetAverageFrameTime() * 1000.0,
+        (unsigned long long)stats.drawCalls, (unsigned long long)stats.indirectDrawCalls,
+        (unsigned long long)stats.dispatches, (unsigned long long)stats.indirectDispatches,
+        (unsigned long long)stats.verticesSubmitted, (unsigned long long)stats.stateChanges,
+        (unsigned long long)stats.descriptorCopies, (unsigned long long)stats.barriers,
+        (unsigned long long)stats.bytesUploaded, (unsigned long long)stats.constantBufferWrites,
+        (unsigned long long)stats.identicalConstantBufferWrites, (unsigned long long)stats.stateCacheMisses,
+        (unsigned long long)stats.commandListFlushes);
+}
+
+// Writes the recorded frames as a Chrome trace (open in chrome://tracing) and as CSV
+void ExportPerformanceTrace()
+{
+    g_pPerfMonitor->flush();
+
+    if (g_pPerfMonitor->writeChromeTrace("PerformanceTrace.json") && g_pPerfMonitor->writeCSV("PerformanceSections.csv"))
+        OutputDebugStringA("Performance trace written to PerformanceTrace.json and PerformanceSections.csv\n");
+    else
+        OutputDebugStringA("Failed to write the performance trace\n");
+}
+
+void InitVoxelizationScheduler()
+{
+    const Scene* pScene = g_pSceneRenderer->GetScene();
+
+    g_VoxelizationScheduler.clearMeshes();
+    for (UINT i = 0; i < pScene->GetMeshesNum(); i++)
+        g_VoxelizationScheduler.addMesh(pScene->GetMeshBounds(i), pScene->GetMeshDrawArguments(i).vertexCount / 3);
+}
+
+// Picks the invalidated regions to voxelize on this frame; the rest are resubmitted on the next frame
+void ScheduleVoxelization(const std::vector<VXGI::Box3f>& regions, const VXGI::Vector3f& cameraPosition, std::vector<VXGI::Box3f>& scheduled)
+{
+    // Each coarser clipmap level doubles the voxel size
+    float finestVoxelSize = g_pGI->getMinVoxelSizeAtPoint(g_pGI->getLastUpdatedClipmapAnchor(), VXGI::VoxelSizeFunction::EXACT);
+    std::vector<uint32_t> levels(regions.size());
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        VXGI::Vector3f center = (regions[i].lower + regions[i].upper) * 0.5f;
+        float voxelSize = g_pGI->getMinVoxelSizeAtPoint(center, VXGI::VoxelSizeFunction::EXACT);
+        levels[i] = (finestVoxelSize > 0.f && voxelSize > finestVoxelSize) ? uint32_t(log2f(voxelSize / finestVoxelSize) + 0.5f) : 0;
+    }
+
+    g_VoxelizationScheduler.schedule(regions.empty() ? NULL : &regions[0], levels.empty() ? NULL : &levels[0], uint32_t(regions.size()),
+        cameraPosition, g_pPerfMonitor->getFrameIndex(), scheduled);
+}
+
+// Refines the scheduler cost model with the GPU time of the last opacity voxelization pass that has been measured
+void CalibrateVoxelizationScheduler()
+{
+    static uint64_t lastFrameIndex = ~0ull;
+
+    const VXGI::PerformanceMonitor::Frame* perfFrame = g_pPerfMonitor->getLastFrame();
+    if (!perfFrame || perfFrame->index == lastFrameIndex)
+        return;
+
+    lastFrameIndex = perfFrame->index;
+    for (const VXGI::PerformanceMonitor::Section& section : perfFrame->sections)
+    {
+        if (section.name == "Opacity voxelization" && section.gpuMs >= 0.0)
+            g_VoxelizationScheduler.reportMeasuredTime(perfFrame->index, float(section.gpuMs));
+    }
+}
+
 class AntTweakBarVisualController : public IVisualController
 {
     virtual LRESULT MsgProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) override
@@ -144,6 +257,82 @@ class AntTweakBarVisualController : public IVisualController
         sprintf_s(msg, "%.1f FPS", fps);
         TwAddTextLine(msg, color, 0);
 
+        if (g_bShowRendererStats && g_bRendererStatsValid)
+        {
+            const NVRHI::RendererStatistics& stats = g_RendererStats;
+
+            sprintf_s(msg, "Draws: %llu (%llu indirect), %llu vertices; dispatches: %llu (%llu indirect)",
+                (unsigned long long)stats.drawCalls, (unsigned long long)stats.indirectDrawCalls, (unsigned long long)stats.verticesSubmitted,
+                (unsigned long long)stats.dispatches, (unsigned long long)stats.indirectDispatches);
+            TwAddTextLine(msg, color, 0);
+
+            sprintf_s(msg, "State changes: %llu, barriers: %llu, descriptor copies: %llu",
+                (unsigned long long)stats.stateChanges, (unsigned long long)stats.barriers, (unsigned long long)stats.descriptorCopies);
+            TwAddTextLine(msg, color, 0);
+
+            sprintf_s(msg, "Uploads: %.2f MB, CB writes: %llu (%llu identical)",
+                double(stats.bytesUploaded) / (1024.0 * 1024.0),
+                (unsigned long long)stats.constantBufferWrites, (unsigned long long)stats.identicalConstantBufferWrites);
+            TwAddTextLine(msg, color, 0);
+
+            sprintf_s(msg, "State cache misses: %llu, command list flushes: %llu",
+                (unsigned long long)stats.stateCacheMisses, (unsigned long long)stats.commandListFlushes);
+            TwAddTextLine(msg, color, 0);
+        }
+
+        if (g_bShowRendererStats && g_RegionStats.inputRegions)
+        {
+            sprintf_s(msg, "Invalidated regions: %u, merged into %u (+%.1f%% volume)", g_RegionStats.inputRegions, g_RegionStats.outputRegions,
+                g_RegionStats.coveredVolume > 0.f ? 100.f * (g_RegionStats.outputVolume / g_RegionStats.coveredVolume - 1.f) : 0.f);
+            TwAddTextLine(msg, color, 0);
+        }
+
+        if (g_bShowRendererStats && g_VoxelizationScheduler.getStats().candidateRegions)
+        {
+            const VXGI::VoxelizationSchedulerStats& schedulerStats = g_VoxelizationScheduler.getStats();
+            sprintf_s(msg, "Voxelized regions: %u of %u (%.2f ms est.), backlog: %u, oldest %u frames",
+                schedulerStats.scheduledRegions, schedulerStats.candidateRegions, schedulerStats.estimatedMs,
+                schedulerStats.deferredRegions, schedulerStats.oldestDeferredAge);
+            TwAddTextLine(msg, color, 0);
+        }
+
+        if (g_bShowRendererStats && g_pAllocator)
+        {
+            VXGI::PoolAllocatorStats heapStats = g_pAllocator->getStats();
+            sprintf_s(msg, "VXGI heap: %.1f KB live, %.1f KB peak, %.1f KB reserved, %llu allocations",
+                heapStats.bytesLive / 1024.0, heapStats.bytesHighWater / 1024.0, heapStats.bytesReserved / 1024.0,
+                (unsigned long long)(heapStats.allocations - heapStats.frees));
+            TwAddTextLine(msg, color, 0);
+        }
+
+        const VXGI::PerformanceMonitor::Frame* perfFrame = g_pPerfMonitor ? g_pPerfMonitor->getLastFrame() : NULL;
+        if (g_bShowPerfSections && perfFrame)
+        {
+            // The sample passes and the VXGI sections directly inside them, smoothed over recent frames
+            for (const VXGI::PerformanceMonitor::Section& section : perfFrame->sections)
+            {
+                if (section.depth > 1)
+                    continue;
+
+                sprintf_s(msg, "%*s%s: CPU %.2f ms, GPU %.2f ms", int(section.depth * 4), "", section.name.c_str(),
+                    section.smoothedCpuMs, std::max(section.smoothedGpuMs, 0.0));
+                TwAddTextLine(msg, color, 0);
+            }
+        }
+
+#if USE_D3D12
+        sprintf_s(msg, "CPU wait: %.2f ms, %u frames in flight", g_FrameInfo.cpuBlockedTime * 1000.0, g_FrameInfo.framesInFlight);
+        TwAddTextLine(msg, color, 0);
+
+        if (g_ResidencyReport.budgetBytes > 0)
+        {
+            sprintf_s(msg, "VRAM: %llu / %llu MB, %u evicted (%llu MB)",
+                g_ResidencyReport.usageBytes >> 20, g_ResidencyReport.budgetBytes >> 20,
+                g_ResidencyReport.numEvictedObjects, g_ResidencyReport.evictedBytes >> 20);
+            TwAddTextLine(msg, color, 0);
+        }
+#endif
+
         TwEndText();
     }
 
@@ -217,6 +406,12 @@ class AntTweakBarVisualController : public IVisualController
         }
 
         TwAddVarRW(bar, "Debug level", TW_TYPE_INT32, &g_iDebugLevel, "min=0 max=3");
+        TwAddVarRW(bar, "Renderer stats", TW_TYPE_BOOLCPP, &g_bShowRendererStats, "");
+        TwAddVarRW(bar, "Dump stats CSV", TW_TYPE_BOOLCPP, &g_bDumpRendererStats, "");
+        TwAddVarRW(bar, "Perf sections", TW_TYPE_BOOLCPP, &g_bShowPerfSections, "");
+        TwAddVarRW(bar, "Region over-coverage", TW_TYPE_FLOAT, &g_fRegionOverCoverage, "min=0 max=1 step=0.05");
+        TwAddVarRW(bar, "Voxelization budget", TW_TYPE_FLOAT, &g_fVoxelizationBudget, "min=0 max=20 step=0.25");
+        TwAddVarRW(bar, "Export perf trace", TW_TYPE_BOOLCPP, &g_bExportPerfTrace, "");
     }
 };
 
@@ -267,6 +462,7 @@ class MainVisualController : public IVisualController
         pMainResource->Release();
 #elif USE_D3D12
         (void)RTV;
+        g_FrameInfo = g_pRendererInterface->beginFrame();
         NVRHI::TextureHandle mainRenderTarget = g_pRendererInterface->getHandleForTexture(g_DeviceManager->GetCurrentBackBuffer());
         g_pRendererInterface->setNonManagedTextureResourceState(mainRenderTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
 #elif USE_GL4
@@ -274,6 +470,8 @@ class MainVisualController : public IVisualController
         NVRHI::TextureHandle mainRenderTarget = g_pRendererInterface->getHandleForDefaultBackBuffer();
 #endif
 
+        g_pPerfMonitor->beginFrame();
+
         XMVECTOR eyePt = g_Camera.GetEyePt();
         XMVECTOR viewForward = g_Camera.GetWorldAhead();
         XMMATRIX viewMatrix = g_Camera.GetViewMatrix();
@@ -282,12 +480,19 @@ class MainVisualController : public IVisualController
 
         if (g_bEnableVXAO)
         {
+            VXGI::PerformanceMonitor::Scope scope(g_pPerfMonitor, "Voxelization");
+
             XMVECTOR centerPt = eyePt + viewForward * g_fClipmapRange;
 
             VXGI::UpdateVoxelizationParameters params;
             params.clipmapAnchor = VXGI::Vector3f(centerPt.m128_f32);
             params.giRange = g_fClipmapRange;
 
+            // Deferred regions have to be invalidated again, or VXGI would not report them on this frame
+            const std::vector<VXGI::Box3f>& deferredRegions = g_VoxelizationScheduler.getDeferredRegions();
+            params.invalidatedRegions = deferredRegions.empty() ? NULL : &deferredRegions[0];
+            params.invalidatedRegionCount = uint32_t(deferredRegions.size());
+
             bool performOpacityVoxelization = false;
             bool performEmittanceVoxelization = false;
 
@@ -301,21 +506,34 @@ class MainVisualController : public IVisualController
                 VXGI::Matrix4f voxelizationMatrix;
                 g_pGI->getVoxelizationViewMatrix(voxelizationMatrix);
 
-                const uint32_t maxRegions = 128;
+                // Query the count first, so that a busy frame does not fail with BUFFER_TOO_SMALL and skip voxelization
                 uint32_t numRegions = 0;
-                VXGI::Box3f regions[maxRegions];
+                g_pGI->getInvalidatedRegions(NULL, 0, numRegions);
+                std::vector<VXGI::Box3f> invalidatedRegions(std::max(numRegions, 1u));
 
-                if (VXGI_SUCCEEDED(g_pGI->getInvalidatedRegions(regions, maxRegions, numRegions)))
+                if (VXGI_SUCCEEDED(g_pGI->getInvalidatedRegions(&invalidatedRegions[0], uint32_t(invalidatedRegions.size()), numRegions)))
                 {
+                    // Fewer, larger boxes make the per-mesh culling in RenderSceneCommon cheaper
+                    std::vector<VXGI::Box3f> coalescedRegions;
+                    VXGI::CoalesceRegions(&invalidatedRegions[0], numRegions, g_fRegionOverCoverage, coalescedRegions, &g_RegionStats);
+
+                    g_VoxelizationScheduler.setBudget(g_fVoxelizationBudget);
+                    std::vector<VXGI::Box3f> regions;
+                    ScheduleVoxelization(coalescedRegions, VXGI::Vector3f(eyePt.m128_f32), regions);
+
+                    VXGI::PerformanceMonitor::Scope opacityScope(g_pPerfMonitor, "Opacity voxelization");
                     NVRHI::DrawCallState emptyState;
-                    g_pSceneRenderer->RenderSceneCommon(emptyState, g_pGI, regions, numRegions, voxelizationMatrix, NULL, true);
+                    g_pSceneRenderer->RenderSceneCommon(emptyState, g_pGI, regions.empty() ? NULL : &regions[0], uint32_t(regions.size()), voxelizationMatrix, NULL, true);
                 }
             }
 
             g_pGI->finalizeVoxelization();
         }
 
-        g_pSceneRenderer->RenderToGBuffer((VXGI::Matrix4f&)viewProjMatrix);
+        {
+            VXGI::PerformanceMonitor::Scope scope(g_pPerfMonitor, "G-buffer");
+            g_pSceneRenderer->RenderToGBuffer((VXGI::Matrix4f&)viewProjMatrix);
+        }
 
         VXGI::IViewTracer::InputBuffers inputBuffers;
         g_pSceneRenderer->FillTracingInputBuffers(inputBuffers);
@@ -326,6 +544,8 @@ class MainVisualController : public IVisualController
 
         if (g_DebugRenderMode != VXGI::DebugRenderMode::DISABLED)
         {
+            VXGI::PerformanceMonitor::Scope scope(g_pPerfMonitor, "Debug rendering");
+
             VXGI::DebugRenderParameters params;
             params.debugMode = g_DebugRenderMode;
             params.viewMatrix = *(VXGI::Matrix4f*)&viewMatrix;
@@ -354,8 +574,12 @@ class MainVisualController : public IVisualController
                 diffuseParams.enableSSAO = g_bEnableSSAO;
 
                 NVRHI::TextureHandle ambientOcclusion = NULL;
-                g_pGITracer->computeDiffuseChannel(diffuseParams, ambientOcclusion, inputBuffers);
+                {
+                    VXGI::PerformanceMonitor::Scope scope(g_pPerfMonitor, "Tracing");
+                    g_pGITracer->computeDiffuseChannel(diffuseParams, ambientOcclusion, inputBuffers);
+                }
 
+                VXGI::PerformanceMonitor::Scope scope(g_pPerfMonitor, "Shading");
                 if (g_bVisualizeAO)
                     g_pSceneRenderer->Blit(ambientOcclusion, mainRenderTarget);
                 else
@@ -363,10 +587,19 @@ class MainVisualController : public IVisualController
             }
             else
             {
+                VXGI::PerformanceMonitor::Scope scope(g_pPerfMonitor, "Shading");
                 g_pSceneRenderer->Blit(gbufferAlbedo, mainRenderTarget);
             }
         }
 
+        g_pPerfMonitor->endFrame();
+        CalibrateVoxelizationScheduler();
+
+        if (g_bExportPerfTrace)
+        {
+            ExportPerformanceTrace();
+            g_bExportPerfTrace = false;
+        }
 
 #if USE_D3D11
         g_pRendererInterface->forgetAboutTexture(pMainResource);
@@ -374,10 +607,16 @@ class MainVisualController : public IVisualController
         // This needs to be done before resizing the window, but there's no PreResize event from DeviceManager
         g_pRendererInterface->releaseNonManagedTextures();
 
-        g_pRendererInterface->flushCommandList();
+        g_pRendererInterface->endFrame();
+        g_ResidencyReport = g_pRendererInterface->updateResidency();
 #elif USE_GL4
         g_pRendererInterface->UnbindFrameBuffer();
 #endif
+
+        g_pRendererInterface->endStatisticsFrame();
+        g_bRendererStatsValid = g_pRendererInterface->getFrameStatistics(g_RendererStats);
+        if (g_bRendererStatsValid)
+            DumpRendererStatistics(g_RendererStats);
     }
 
     virtual HRESULT DeviceCreated() override
@@ -390,6 +629,11 @@ class MainVisualController : public IVisualController
         g_pRendererInterface = new NVRHI::RendererInterfaceOGL(&g_ErrorCallback);
         g_pRendererInterface->init();
 #endif
+        g_pRendererInterface->setEnableStatistics(true);
+
+        g_pPerfMonitor = new VXGI::PerformanceMonitor(g_pRendererInterface);
+        g_pAllocator = new VXGI::PoolAllocator(&g_ErrorCallback);
+
         g_pSceneRenderer = new SceneRenderer(g_pRendererInterface);
 
         if (FAILED(CreateVXGIObject()))
@@ -402,6 +646,8 @@ class MainVisualController : public IVisualController
         if (FAILED(g_pSceneRenderer->AllocateResources(g_pGI, g_pGICompiler)))
             return E_FAIL;
 
+        InitVoxelizationScheduler();
+
         g_bInitialized = true;
 
         return S_OK;
@@ -409,6 +655,13 @@ class MainVisualController : public IVisualController
 
     virtual void DeviceDestroyed() override
     {
+        if (g_pRendererStatsFile)
+        {
+            fclose(g_pRendererStatsFile);
+            g_pRendererStatsFile = NULL;
+        }
+        g_bRendererStatsValid = false;
+
         if (g_pSceneRenderer)
         {
             g_pSceneRenderer->ReleaseViewDependentResources();
@@ -424,6 +677,19 @@ class MainVisualController : public IVisualController
             g_pGI = NULL;
         }
 
+        if (g_pPerfMonitor)
+        {
+            delete g_pPerfMonitor;
+            g_pPerfMonitor = NULL;
+        }
+
+        // Reports the VXGI allocations that were not freed, if any
+        if (g_pAllocator)
+        {
+            delete g_pAllocator;
+            g_pAllocator = NULL;
+        }
+
         if (g_pSceneRenderer)
         {
             delete g_pSceneRenderer;
@@ -75,7 +75,23 @@ SceneRenderer::SceneRenderer(NVRHI::IRendererInterface* pRenderer)
 HRESULT SceneRenderer::LoadMesh(const char* strFileName)
 {
     m_pScene = new Scene();
-    return m_pScene->Load(strFileName, 0);
+    HRESULT hr = m_pScene->Load(strFileName, 0);
+    if (FAILED(hr))
+        return hr;
+
+    // The scene is static, so the hierarchy is built once. Moving meshes would need m_SceneBVH.refit after they move.
+    UINT numMeshes = m_pScene->GetMeshesNum();
+    std::vector<VXGI::Box3f> meshBounds(numMeshes);
+    std::vector<uint32_t> materials(numMeshes);
+    for (UINT i = 0; i < numMeshes; ++i)
+    {
+        meshBounds[i] = m_pScene->GetMeshBounds(i);
+        materials[i] = uint32_t(m_pScene->GetMaterialIndex(i));
+    }
+
+    m_SceneBVH.build(numMeshes ? &meshBounds[0] : NULL, numMeshes ? &materials[0] : NULL, numMeshes);
+
+    return S_OK;
 }
 
 HRESULT SceneRenderer::AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::IShaderCompiler* pCompiler)
@@ -250,7 +266,8 @@ void SceneRenderer::RenderToGBuffer(const VXGI::Matrix4f& viewProjMatrix)
     state.renderState.viewportCount = 1;
     state.renderState.viewports[0] = NVRHI::Viewport(float(m_Width), float(m_Height));
 
-    RenderSceneCommon(state, NULL, NULL, 0, viewProjMatrix, &onChangeMaterial, false);
+    VXGI::Frustum viewFrustum(viewProjMatrix);
+    RenderSceneCommon(state, NULL, NULL, 0, viewProjMatrix, &onChangeMaterial, false, &viewFrustum);
 }
 
 void SceneRenderer::RenderSceneCommon(
@@ -260,7 +277,8 @@ void SceneRenderer::RenderSceneCommon(
     uint32_t numBoxes,
     const VXGI::Matrix4f& viewProjMatrix,
     MaterialCallback* onChangeMaterial,
-    bool voxelization)
+    bool voxelization,
+    const VXGI::Frustum* cullingFrustum)
 {
     GlobalConstants globalConstants;
     globalConstants.viewProjMatrix = viewProjMatrix;
@@ -292,31 +310,20 @@ void SceneRenderer::RenderSceneCommon(
     int lastMaterial = -2;
     VXGI::MaterialInfo lastMaterialInfo;
 
-    UINT numMeshes = m_pScene->GetMeshesNum();
+    // The visible meshes come back sorted by material, one range per material
+    if (clippingBoxes && numBoxes)
+        m_SceneBVH.query(clippingBoxes, numBoxes, m_VisibleMeshes);
+    else if (cullingFrustum)
+        m_SceneBVH.query(cullingFrustum, 1, m_VisibleMeshes);
+    else
+        m_SceneBVH.queryAll(m_VisibleMeshes);
 
     std::vector<NVRHI::DrawArguments> drawCalls;
 
-    for (UINT i = 0; i < numMeshes; ++i)
+    for (const VXGI::SceneBVHDrawRange& range : m_VisibleMeshes.ranges)
     {
-        VXGI::Box3f meshBounds = m_pScene->GetMeshBounds(i);
-
-        if (clippingBoxes && numBoxes)
-        {
-            bool contained = false;
-            for (UINT clipbox = 0; clipbox < numBoxes; ++clipbox)
-            {
-                if (clippingBoxes[clipbox].intersectsWith(meshBounds))
-                {
-                    contained = true;
-                    break;
-                }
-            }
-
-            if (!contained)
-                continue;
-        }
-
-        int material = m_pScene->GetMaterialIndex(i);
+        const uint32_t* meshes = &m_VisibleMeshes.objects[range.first];
+        int material = int(range.sortKey);
 
         if (material != lastMaterial)
         {
@@ -330,7 +337,7 @@ void SceneRenderer::RenderSceneCommon(
             }
 
             MeshMaterialInfo materialInfo;
-            GetMaterialInfo(i, materialInfo);
+            GetMaterialInfo(meshes[0], materialInfo);
 
             if (voxelization)
             {
@@ -361,13 +368,26 @@ void SceneRenderer::RenderSceneCommon(
             lastMaterialInfo = materialInfo;
         }
 
-        drawCalls.push_back(m_pScene->GetMeshDrawArguments(i));
+        for (uint32_t index = 0; index < range.count; ++index)
+            drawCalls.push_back(m_pScene->GetMeshDrawArguments(meshes[index]));
     }
 
     if (!drawCalls.empty())
     {
         m_RendererInterface->drawIndexed(state, &drawCalls[0], uint32_t(drawCalls.size()));
     }
+    else
+    {
+        // Culling left nothing to draw, so the clears that come with the first draw call have to be done here
+        if (state.renderState.clearColorTarget)
+        {
+            for (uint32_t target = 0; target < state.renderState.targetCount; ++target)
+                m_RendererInterface->clearTextureFloat(state.renderState.targets[target], state.renderState.clearColor);
+        }
+
+        if (state.renderState.clearDepthTarget && state.renderState.depthTarget)
+            m_RendererInterface->clearTextureFloat(state.renderState.depthTarget, NVRHI::Color(state.renderState.clearDepth, 0.f, 0.f, 0.f));
+    }
 
     if (voxelization)
     {
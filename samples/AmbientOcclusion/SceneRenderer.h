@@ -12,6 +12,7 @@
 
 #include "GFSDK_VXGI.h"
 #include "Scene.h"
+#include "GFSDK_VXGI_SceneBVH.h"
 #include <functional>
 
 #pragma warning(disable : 4324)
@@ -70,10 +71,14 @@ private:
     VXGI::IUserDefinedShaderSet* m_pVoxelizationGS;
     VXGI::IUserDefinedShaderSet* m_pVoxelizationPS;
 
+    VXGI::SceneBVH           m_SceneBVH;
+    VXGI::SceneBVHQueryResult m_VisibleMeshes;
+
 public:
     SceneRenderer(NVRHI::IRendererInterface* pRenderer);
 
     HRESULT LoadMesh(const char* strFileName);
+    const Scene* GetScene() const { return m_pScene; }
 
     HRESULT AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::IShaderCompiler* pCompiler);
     void AllocateViewDependentResources(UINT width, UINT height, UINT sampleCount = 1);
@@ -90,6 +95,8 @@ public:
     void Blit(NVRHI::TextureHandle pSource, NVRHI::TextureHandle pDest);
     void ComposeAO(NVRHI::TextureHandle pSource, NVRHI::TextureHandle pDest);
 
+    // Draws the meshes that intersect any of the clipping boxes, or the culling frustum when there are no boxes,
+    // or all meshes when neither is set. Meshes are drawn in batches of the same material.
     void RenderSceneCommon(
         NVRHI::DrawCallState& state,
         VXGI::IGlobalIllumination* pGI,
@@ -97,5 +104,6 @@ public:
         uint32_t numBoxes,
         const VXGI::Matrix4f& viewProjMatrix,
         MaterialCallback* onChangeMaterial,
-        bool voxelization);
+        bool voxelization,
+        const VXGI::Frustum* cullingFrustum = NULL);
 };
\ No newline at end of file
@@ -12,8 +12,11 @@
 #include "SceneRenderer.h"
 #include "BindingHelpers.h"
 #include "DirectXMath.h"
+#include "GFSDK_VXGI_ShaderPack.h"
+#include "JobGraph.h"
 
 #if USE_GL4
+#include "GFSDK_NVRHI_OpenGL4.h"
 
 std::string LoadShader(const char* name)
 {
@@ -30,6 +33,8 @@ std::string LoadShader(const char* name)
 
 const std::string g_DefaultVS = LoadShader("DefaultVS");
 const std::string g_AttributesPS = LoadShader("AttributesPS");
+const std::string g_DefaultBindlessVS = LoadShader("DefaultBindlessVS");
+const std::string g_AttributesBindlessPS = LoadShader("AttributesBindlessPS");
 const std::string g_FullScreenQuadVS = LoadShader("FullScreenQuadVS");
 const std::string g_BlitPS = LoadShader("BlitPS");
 const std::string g_CompositingPS = LoadShader("CompositingPS");
@@ -47,6 +52,86 @@ static const UINT s_ShadowMapSize = 2048;
 
 using namespace DirectX;
 
+struct ShaderPackContext
+{
+    VXGI::ShaderPack::Reader reader;
+    VXGI::ShaderPack::Writer writer;
+    uint64_t internalShaderHash;
+    uint32_t graphicsAPI;
+    bool modified;
+};
+
+static VXGI::ShaderPack::Key GetShaderPackKey(const ShaderPackContext* pack, uint64_t sourceHash)
+{
+    return VXGI::ShaderPack::Key(pack ? pack->internalShaderHash : 0, pack ? pack->graphicsAPI : 0, sourceHash);
+}
+
+// A VXGI shader set that is created by the startup job graph in two steps: PrepareShaderSet finds a valid binary
+// in the pack or compiles one on a worker thread, and FinishShaderSet creates the shader set on the main thread.
+struct ShaderSetJob
+{
+    uint64_t sourceHash;
+    std::function<VXGI::Status::Enum(VXGI::IBlob**)> compile;
+    VXGI::IUserDefinedShaderSet** ppShaderSet;
+    const void* packData;
+    size_t packSize;
+    VXGI::IBlob* blob;
+
+    ShaderSetJob() : sourceHash(0), ppShaderSet(nullptr), packData(nullptr), packSize(0), blob(nullptr) { }
+};
+
+// Only reads the pack and calls the shader compiler, so several of these can run at the same time
+static bool PrepareShaderSet(const ShaderPackContext* pack, VXGI::IShaderCompiler* pCompiler, ShaderSetJob& job)
+{
+    if (pack)
+    {
+        const void* data = nullptr;
+        size_t size = 0;
+
+        if (pack->reader.find(GetShaderPackKey(pack, job.sourceHash), &data, &size) &&
+            pCompiler->isValidUserDefinedShaderBinary(data, size))
+        {
+            job.packData = data;
+            job.packSize = size;
+            return true;
+        }
+    }
+
+    return VXGI_SUCCEEDED(job.compile(&job.blob));
+}
+
+// The binaries that are used end up in the writer, so a rewritten pack contains only the current shaders.
+static bool FinishShaderSet(ShaderPackContext* pack, VXGI::IGlobalIllumination* pGI, ShaderSetJob& job)
+{
+    VXGI::ShaderPack::Key key = GetShaderPackKey(pack, job.sourceHash);
+
+    if (job.packData)
+    {
+        if (VXGI_SUCCEEDED(pGI->loadUserDefinedShaderSet(job.ppShaderSet, job.packData, job.packSize, true)))
+        {
+            pack->writer.add(key, job.packData, job.packSize);
+            return true;
+        }
+
+        // The pack binary passed validation but could not be loaded; compile it here instead
+        if (VXGI_FAILED(job.compile(&job.blob)))
+            return false;
+    }
+
+    VXGI::Status::Enum status = pGI->loadUserDefinedShaderSet(job.ppShaderSet, job.blob->getData(), job.blob->getSize());
+
+    if (pack && VXGI_SUCCEEDED(status))
+    {
+        pack->writer.add(key, job.blob->getData(), job.blob->getSize());
+        pack->modified = true;
+    }
+
+    job.blob->dispose();
+    job.blob = nullptr;
+
+    return VXGI_SUCCEEDED(status);
+}
+
 SceneRenderer::SceneRenderer(NVRHI::IRendererInterface* pRenderer)
     : m_RendererInterface(pRenderer)
     , m_pScene(NULL)
@@ -69,18 +154,36 @@ SceneRenderer::SceneRenderer(NVRHI::IRendererInterface* pRenderer)
     , m_TargetDepth(NULL)
     , m_ShadowMap(NULL)
     , m_NullTexture(NULL)
+    , m_UseBindlessTextures(false)
+    , m_pDefaultBindlessVS(NULL)
+    , m_pAttributesBindlessPS(NULL)
+    , m_BindlessHandleBuffer(NULL)
 { }
 
 HRESULT SceneRenderer::LoadMesh(const char* strFileName)
 {
     m_pScene = new Scene();
-    return m_pScene->Load(strFileName, 0);
+    HRESULT hr = m_pScene->Load(strFileName, 0);
+    if (FAILED(hr))
+        return hr;
+
+    // The scene is static, so the hierarchy is built once. Moving meshes would need m_SceneBVH.refit after they move.
+    UINT numMeshes = m_pScene->GetMeshesNum();
+    std::vector<VXGI::Box3f> meshBounds(numMeshes);
+    std::vector<uint32_t> materials(numMeshes);
+    for (UINT i = 0; i < numMeshes; ++i)
+    {
+        meshBounds[i] = m_pScene->GetMeshBounds(i);
+        materials[i] = uint32_t(m_pScene->GetMaterialIndex(i));
+    }
+
+    m_SceneBVH.build(numMeshes ? &meshBounds[0] : NULL, numMeshes ? &materials[0] : NULL, numMeshes);
+
+    return S_OK;
 }
 
-HRESULT SceneRenderer::AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::IShaderCompiler* pCompiler)
+HRESULT SceneRenderer::AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::IShaderCompiler* pCompiler, const char* shaderPackPath)
 {
-    m_pDefaultVS = CREATE_SHADER(VERTEX, g_DefaultVS);
-
     const NVRHI::VertexAttributeDesc SceneLayout[] =
     {
         { "POSITION", NVRHI::Format::RGB32_FLOAT, 0, offsetof(VertexBufferEntry, position), false },
@@ -96,11 +199,6 @@ HRESULT SceneRenderer::AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::I
     m_pInputLayout = m_RendererInterface->createInputLayout(SceneLayout, _countof(SceneLayout), g_DefaultVS, sizeof(g_DefaultVS));
 #endif
 
-    m_pFullScreenQuadVS = CREATE_SHADER(VERTEX, g_FullScreenQuadVS);
-    m_pAttributesPS = CREATE_SHADER(PIXEL, g_AttributesPS);
-    m_pBlitPS = CREATE_SHADER(PIXEL, g_BlitPS);
-    m_pCompositingPS = CREATE_SHADER(PIXEL, g_CompositingPS);
-
     m_pGlobalCBuffer = m_RendererInterface->createConstantBuffer(NVRHI::ConstantBufferDesc(sizeof(GlobalConstants), nullptr), nullptr);
 
     NVRHI::SamplerDesc samplerDesc;
@@ -143,31 +241,67 @@ HRESULT SceneRenderer::AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::I
     if (FAILED(m_pScene->InitResources(m_RendererInterface)))
         return E_FAIL;
 
-    VXGI::IBlob* blob = nullptr;
-
 #if USE_GL4
+    NVRHI::RendererInterfaceOGL* pRendererGL = static_cast<NVRHI::RendererInterfaceOGL*>(m_RendererInterface);
+    UINT numMeshes = m_pScene->GetMeshesNum();
+
+    if (numMeshes > 0 && pRendererGL->isBindlessTextureSupported() && pRendererGL->isOpenGLExtensionSupported("GL_ARB_shader_draw_parameters"))
+    {
+        m_pDefaultBindlessVS = CREATE_SHADER(VERTEX, g_DefaultBindlessVS);
+        m_pAttributesBindlessPS = CREATE_SHADER(PIXEL, g_AttributesBindlessPS);
+
+        m_BindlessHandles.resize(numMeshes * 3);
+
+        NVRHI::BufferDesc handleBufferDesc;
+        handleBufferDesc.byteSize = uint32_t(m_BindlessHandles.size() * sizeof(uint64_t));
+        handleBufferDesc.structStride = sizeof(uint64_t);
+        handleBufferDesc.isCPUWritable = true;
+        handleBufferDesc.debugName = "BindlessHandles";
+        m_BindlessHandleBuffer = m_RendererInterface->createBuffer(handleBufferDesc, nullptr);
+
+        m_UseBindlessTextures = m_pDefaultBindlessVS && m_pAttributesBindlessPS && m_BindlessHandleBuffer;
+    }
+#endif
+
+    ShaderPackContext pack;
+    pack.internalShaderHash = VXGI::VFX_VXGI_GetInternalShaderHash();
+    pack.graphicsAPI = uint32_t(m_RendererInterface->getGraphicsAPI());
+    pack.modified = false;
+
+    ShaderPackContext* pPack = nullptr;
+    if (shaderPackPath)
     {
-        VXGI::VoxelizationGeometryShaderDesc desc;
-        desc.pixelShaderInputCount = 5;
-        strcpy_s(desc.pixelShaderInputs[0].name, "v_texCoord");   desc.pixelShaderInputs[0].width = 2;
-        strcpy_s(desc.pixelShaderInputs[1].name, "v_normal");     desc.pixelShaderInputs[1].width = 3;
-        strcpy_s(desc.pixelShaderInputs[2].name, "v_tangent");    desc.pixelShaderInputs[2].width = 3;
-        strcpy_s(desc.pixelShaderInputs[3].name, "v_binormal");   desc.pixelShaderInputs[3].width = 3;
-        strcpy_s(desc.pixelShaderInputs[4].name, "v_positionWS"); desc.pixelShaderInputs[4].width = 3;
-
-        if (VXGI_FAILED(pCompiler->compileVoxelizationGeometryShader(&blob, desc)))
-            return E_FAIL;
+        // A missing or damaged pack is the same as an empty one
+        pack.reader.loadFile(shaderPackPath);
+        pPack = &pack;
     }
+
+    ShaderSetJob voxelizationGS;
+    voxelizationGS.ppShaderSet = &m_pVoxelizationGS;
+
+    static const char voxelizationGSTag[] = "VoxelizationGS";
+    uint64_t voxelizationGSHash = VXGI::ShaderPack::HashSource(voxelizationGSTag, sizeof(voxelizationGSTag));
+
+#if USE_GL4
+    VXGI::VoxelizationGeometryShaderDesc gsDesc;
+    gsDesc.pixelShaderInputCount = 5;
+    strcpy_s(gsDesc.pixelShaderInputs[0].name, "v_texCoord");   gsDesc.pixelShaderInputs[0].width = 2;
+    strcpy_s(gsDesc.pixelShaderInputs[1].name, "v_normal");     gsDesc.pixelShaderInputs[1].width = 3;
+    strcpy_s(gsDesc.pixelShaderInputs[2].name, "v_tangent");    gsDesc.pixelShaderInputs[2].width = 3;
+    strcpy_s(gsDesc.pixelShaderInputs[3].name, "v_binormal");   gsDesc.pixelShaderInputs[3].width = 3;
+    strcpy_s(gsDesc.pixelShaderInputs[4].name, "v_positionWS"); gsDesc.pixelShaderInputs[4].width = 3;
+
+    // The attributes have no padding and are zero-initialized, so they can be hashed as bytes
+    voxelizationGSHash = VXGI::ShaderPack::HashSource(gsDesc.pixelShaderInputs, gsDesc.pixelShaderInputCount * sizeof(gsDesc.pixelShaderInputs[0]), voxelizationGSHash);
+
+    voxelizationGS.compile = [pCompiler, &gsDesc](VXGI::IBlob** ppBlob) { return pCompiler->compileVoxelizationGeometryShader(ppBlob, gsDesc); };
 #else
-    if (VXGI_FAILED(pCompiler->compileVoxelizationGeometryShaderFromVS(&blob, g_DefaultVS, sizeof(g_DefaultVS))))
-        return E_FAIL;
+    voxelizationGSHash = VXGI::ShaderPack::HashSource(g_DefaultVS, sizeof(g_DefaultVS), voxelizationGSHash);
+
+    voxelizationGS.compile = [pCompiler](VXGI::IBlob** ppBlob) { return pCompiler->compileVoxelizationGeometryShaderFromVS(ppBlob, g_DefaultVS, sizeof(g_DefaultVS)); };
 #endif
-        
-    if (VXGI_FAILED(pGI->loadUserDefinedShaderSet(&m_pVoxelizationGS, blob->getData(), blob->getSize())))
-        return E_FAIL;
 
-    blob->dispose();
-    
+    voxelizationGS.sourceHash = voxelizationGSHash;
 
 #if USE_GL4
     HRSRC resource = FindResourceA(NULL, "VoxelizationPSGL", "TEXTFILE");
@@ -198,13 +332,62 @@ HRESULT SceneRenderer::AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::I
     desc.source = (char*)data;
     desc.sourceSize = size;
 
-    if (VXGI_FAILED(pCompiler->compileVoxelizationPixelShader(&blob, desc)))
-        return E_FAIL;
+    static const char voxelizationPSTag[] = "VoxelizationPS";
+    uint64_t voxelizationPSHash = VXGI::ShaderPack::HashSource(voxelizationPSTag, sizeof(voxelizationPSTag));
+    voxelizationPSHash = VXGI::ShaderPack::HashSource(data, size, voxelizationPSHash);
+    voxelizationPSHash = VXGI::ShaderPack::HashSource(&resources, sizeof(resources), voxelizationPSHash);
+
+    ShaderSetJob voxelizationPS;
+    voxelizationPS.sourceHash = voxelizationPSHash;
+    voxelizationPS.compile = [pCompiler, &desc](VXGI::IBlob** ppBlob) { return pCompiler->compileVoxelizationPixelShader(ppBlob, desc); };
+    voxelizationPS.ppShaderSet = &m_pVoxelizationPS;
+
+    // Shaders and shader sets are API objects and are created on this thread; the VXGI shader compilation,
+    // which dominates the startup time when the pack is missing or stale, runs on a worker thread meanwhile.
+    JobGraph jobs;
+
+    JobGraph::JobId defaultVSJob = jobs.Add("DefaultVS", [this]() { m_pDefaultVS = CREATE_SHADER(VERTEX, g_DefaultVS); return m_pDefaultVS != nullptr; }, JobGraph::MAIN_THREAD);
+    jobs.Add("FullScreenQuadVS", [this]() { m_pFullScreenQuadVS = CREATE_SHADER(VERTEX, g_FullScreenQuadVS); return m_pFullScreenQuadVS != nullptr; }, JobGraph::MAIN_THREAD);
+    jobs.Add("AttributesPS", [this]() { m_pAttributesPS = CREATE_SHADER(PIXEL, g_AttributesPS); return m_pAttributesPS != nullptr; }, JobGraph::MAIN_THREAD);
+    jobs.Add("BlitPS", [this]() { m_pBlitPS = CREATE_SHADER(PIXEL, g_BlitPS); return m_pBlitPS != nullptr; }, JobGraph::MAIN_THREAD);
+    jobs.Add("CompositingPS", [this]() { m_pCompositingPS = CREATE_SHADER(PIXEL, g_CompositingPS); return m_pCompositingPS != nullptr; }, JobGraph::MAIN_THREAD);
+
+    JobGraph::JobId prepareGSJob = jobs.Add("PrepareVoxelizationGS", [pPack, pCompiler, &voxelizationGS]() { return PrepareShaderSet(pPack, pCompiler, voxelizationGS); });
+    JobGraph::JobId finishGSJob = jobs.Add("FinishVoxelizationGS", [pPack, pGI, &voxelizationGS]() { return FinishShaderSet(pPack, pGI, voxelizationGS); }, JobGraph::MAIN_THREAD);
+    JobGraph::JobId preparePSJob = jobs.Add("PrepareVoxelizationPS", [pPack, pCompiler, &voxelizationPS]() { return PrepareShaderSet(pPack, pCompiler, voxelizationPS); });
+    JobGraph::JobId finishPSJob = jobs.Add("FinishVoxelizationPS", [pPack, pGI, &voxelizationPS]() { return FinishShaderSet(pPack, pGI, voxelizationPS); }, JobGraph::MAIN_THREAD);
+
+    // The voxelization GS is built for the outputs of the default VS, so it is pointless without that shader
+    jobs.AddDependency(prepareGSJob, defaultVSJob);
+    jobs.AddDependency(finishGSJob, prepareGSJob);
+    jobs.AddDependency(finishPSJob, preparePSJob);
 
-    if (VXGI_FAILED(pGI->loadUserDefinedShaderSet(&m_pVoxelizationPS, blob->getData(), blob->getSize())))
+    // IShaderCompiler makes no promise that it can be called from several threads at once, so the two compilations
+    // run one after the other. They still overlap with the main-thread jobs, which is where the time is saved.
+    // FinishShaderSet compiles on the main thread when a pack binary fails to load, so the GS set is only created
+    // after the PS compilation is done; the PS set is finished after that anyway.
+    jobs.AddDependency(preparePSJob, prepareGSJob);
+    jobs.AddDependency(finishGSJob, preparePSJob);
+
+    uint32_t workerCount = std::thread::hardware_concurrency() > 1 ? 1 : 0;
+
+    bool jobsSucceeded = jobs.Run(workerCount);
+
+    for (const JobGraph::JobTiming& timing : jobs.GetTimings())
+    {
+        char buf[256];
+        sprintf_s(buf, "AllocateResources: %-24s %-6s start %8.2f ms, took %8.2f ms%s\n",
+            timing.name.c_str(), timing.mainThread ? "main" : "worker", timing.startMs, timing.durationMs,
+            timing.skipped ? ", skipped" : (timing.succeeded ? "" : ", FAILED"));
+        OutputDebugStringA(buf);
+    }
+
+    if (!jobsSucceeded)
         return E_FAIL;
 
-    blob->dispose();
+    // Failing to write the pack only costs compilation time on the next start
+    if (pPack && pack.modified)
+        pack.writer.writeFile(shaderPackPath);
 
     return S_OK;
 }
@@ -251,10 +434,14 @@ void SceneRenderer::ReleaseResources(VXGI::IGlobalIllumination* pGI)
     DESTROY_SHADER(m_pDefaultVS);
     DESTROY_SHADER(m_pFullScreenQuadVS);
     DESTROY_SHADER(m_pAttributesPS);
+    DESTROY_SHADER(m_pDefaultBindlessVS);
+    DESTROY_SHADER(m_pAttributesBindlessPS);
     DESTROY_SHADER(m_pBlitPS);
     DESTROY_SHADER(m_pCompositingPS);
     
     DESTROY_CONSTANT_BUFFER(m_pGlobalCBuffer);
+    DESTROY_BUFFER(m_BindlessHandleBuffer);
+    m_UseBindlessTextures = false;
 
     DESTROY_SAMPLER(m_pDefaultSamplerState);
     DESTROY_SAMPLER(m_pComparisonSamplerState);
@@ -316,7 +503,8 @@ void SceneRenderer::RenderShadowMap(const VXGI::Vector3f cameraPosition, float l
     state.renderState.rasterState.cullMode = NVRHI::RasterState::CULL_NONE;
     state.renderState.rasterState.slopeScaledDepthBias = 4.0f;
 
-    RenderSceneCommon(state, NULL, NULL, 0, m_LightViewProjMatrix, NULL, false, false);
+    VXGI::Frustum lightFrustum(m_LightViewProjMatrix);
+    RenderSceneCommon(state, NULL, NULL, 0, m_LightViewProjMatrix, NULL, false, false, &lightFrustum);
 }
 
 void SceneRenderer::RenderToGBuffer(const VXGI::Matrix4f& viewProjMatrix)
@@ -330,9 +518,6 @@ void SceneRenderer::RenderToGBuffer(const VXGI::Matrix4f& viewProjMatrix)
         NVRHI::BindTextureAndSampler(state.PS, 2, material.normalsTexture ? material.normalsTexture : m_NullTexture, m_pDefaultSamplerState);
     };
 
-    state.PS.shader = m_pAttributesPS;
-    NVRHI::BindSampler(state.PS, 0, m_pDefaultSamplerState);
-
     state.renderState.targetCount = 2;
     state.renderState.targets[0] = m_TargetAlbedo;
     state.renderState.targets[1] = m_TargetNormal;
@@ -342,7 +527,48 @@ void SceneRenderer::RenderToGBuffer(const VXGI::Matrix4f& viewProjMatrix)
     state.renderState.viewportCount = 1;
     state.renderState.viewports[0] = NVRHI::Viewport(float(m_Width), float(m_Height));
 
-    RenderSceneCommon(state, NULL, NULL, 0, viewProjMatrix, &onChangeMaterial, false, false);
+    VXGI::Frustum viewFrustum(viewProjMatrix);
+
+    if (m_UseBindlessTextures)
+    {
+        UpdateBindlessHandles();
+
+        state.VS.shader = m_pDefaultBindlessVS;
+        state.PS.shader = m_pAttributesBindlessPS;
+        NVRHI::BindBuffer(state.PS, 0, m_BindlessHandleBuffer);
+
+        RenderSceneCommon(state, NULL, NULL, 0, viewProjMatrix, NULL, false, false, &viewFrustum);
+        return;
+    }
+
+    state.PS.shader = m_pAttributesPS;
+    NVRHI::BindSampler(state.PS, 0, m_pDefaultSamplerState);
+
+    RenderSceneCommon(state, NULL, NULL, 0, viewProjMatrix, &onChangeMaterial, false, false, &viewFrustum);
+}
+
+void SceneRenderer::UpdateBindlessHandles()
+{
+#if USE_GL4
+    NVRHI::RendererInterfaceOGL* pRendererGL = static_cast<NVRHI::RendererInterfaceOGL*>(m_RendererInterface);
+
+    // The handles are requested every frame to keep them resident; repeated requests are cache hits.
+    // Starting a new bindless frame pins the handles requested below, so none of them is evicted by a later request in this pass.
+    pRendererGL->beginBindlessHandleFrame();
+
+    UINT numMeshes = m_pScene->GetMeshesNum();
+    for (UINT i = 0; i < numMeshes; ++i)
+    {
+        MeshMaterialInfo materialInfo;
+        GetMaterialInfo(i, materialInfo);
+
+        m_BindlessHandles[i * 3 + 0] = pRendererGL->getBindlessTextureHandle(materialInfo.diffuseTexture ? materialInfo.diffuseTexture : m_NullTexture, m_pDefaultSamplerState);
+        m_BindlessHandles[i * 3 + 1] = pRendererGL->getBindlessTextureHandle(materialInfo.specularTexture ? materialInfo.specularTexture : m_NullTexture, m_pDefaultSamplerState);
+        m_BindlessHandles[i * 3 + 2] = pRendererGL->getBindlessTextureHandle(materialInfo.normalsTexture ? materialInfo.normalsTexture : m_NullTexture, m_pDefaultSamplerState);
+    }
+
+    m_RendererInterface->writeBuffer(m_BindlessHandleBuffer, &m_BindlessHandles[0], m_BindlessHandles.size() * sizeof(uint64_t));
+#endif
 }
 
 void SceneRenderer::RenderSceneCommon(
@@ -353,7 +579,8 @@ void SceneRenderer::RenderSceneCommon(
     const VXGI::Matrix4f& viewProjMatrix,
     MaterialCallback* onChangeMaterial,
     bool voxelization,
-    bool emittance)
+    bool emittance,
+    const VXGI::Frustum* cullingFrustum)
 {
     static const UINT SRV_SLOT_DIFFUSE_TEXTURE = 0;
     static const UINT SRV_SLOT_SHADOW_MAP = 1;
@@ -379,7 +606,8 @@ void SceneRenderer::RenderSceneCommon(
 
     bool extraStateSetup = false;
 
-    state.VS.shader = m_pDefaultVS;
+    if (!state.VS.shader)
+        state.VS.shader = m_pDefaultVS;
     NVRHI::BindConstantBuffer(state.VS, 0, m_pGlobalCBuffer);
 
     if (voxelization)
@@ -390,33 +618,23 @@ void SceneRenderer::RenderSceneCommon(
     int lastMaterial = -2;
     VXGI::MaterialInfo lastMaterialInfo;
 
-    UINT numMeshes = m_pScene->GetMeshesNum();
+    // The visible meshes come back sorted by material, one range per material
+    if (clippingBoxes && numBoxes)
+        m_SceneBVH.query(clippingBoxes, numBoxes, m_VisibleMeshes);
+    else if (cullingFrustum)
+        m_SceneBVH.query(cullingFrustum, 1, m_VisibleMeshes);
+    else
+        m_SceneBVH.queryAll(m_VisibleMeshes);
 
     std::vector<NVRHI::DrawArguments> drawCalls;
 
-    for (UINT i = 0; i < numMeshes; ++i)
+    for (const VXGI::SceneBVHDrawRange& range : m_VisibleMeshes.ranges)
     {
-        VXGI::Box3f meshBounds = m_pScene->GetMeshBounds(i);
-
-        if (clippingBoxes && numBoxes)
-        {
-            bool contained = false;
-            for (UINT clipbox = 0; clipbox < numBoxes; ++clipbox)
-            {
-                if (clippingBoxes[clipbox].intersectsWith(meshBounds))
-                {
-                    contained = true;
-                    break;
-                }
-            }
-
-            if (!contained)
-                continue;
-        }
-
-        int material = m_pScene->GetMaterialIndex(i);
+        const uint32_t* meshes = &m_VisibleMeshes.objects[range.first];
+        int material = int(range.sortKey);
 
-        if (material != lastMaterial)
+        // Without per-material state, all meshes go into one batch
+        if (material != lastMaterial && (voxelization || onChangeMaterial))
         {
             if (!drawCalls.empty())
             {
@@ -428,7 +646,7 @@ void SceneRenderer::RenderSceneCommon(
             }
 
             MeshMaterialInfo materialInfo;
-            GetMaterialInfo(i, materialInfo);
+            GetMaterialInfo(meshes[0], materialInfo);
 
             if (voxelization)
             {
@@ -477,13 +695,31 @@ void SceneRenderer::RenderSceneCommon(
             lastMaterialInfo = materialInfo;
         }
 
-        drawCalls.push_back(m_pScene->GetMeshDrawArguments(i));
+        // The base instance carries the mesh index to shaders that use per-mesh data, like the bindless G-buffer pass
+        for (uint32_t index = 0; index < range.count; ++index)
+        {
+            NVRHI::DrawArguments args = m_pScene->GetMeshDrawArguments(meshes[index]);
+            args.startInstanceLocation = meshes[index];
+            drawCalls.push_back(args);
+        }
     }
 
     if (!drawCalls.empty())
     {
         m_RendererInterface->drawIndexed(state, &drawCalls[0], uint32_t(drawCalls.size()));
     }
+    else
+    {
+        // Culling left nothing to draw, so the clears that come with the first draw call have to be done here
+        if (state.renderState.clearColorTarget)
+        {
+            for (uint32_t target = 0; target < state.renderState.targetCount; ++target)
+                m_RendererInterface->clearTextureFloat(state.renderState.targets[target], state.renderState.clearColor);
+        }
+
+        if (state.renderState.clearDepthTarget && state.renderState.depthTarget)
+            m_RendererInterface->clearTextureFloat(state.renderState.depthTarget, NVRHI::Color(state.renderState.clearDepth, 0.f, 0.f, 0.f));
+    }
 
     if (voxelization)
     {
@@ -12,6 +12,7 @@
 
 #include "GFSDK_VXGI.h"
 #include "Scene.h"
+#include "GFSDK_VXGI_SceneBVH.h"
 #include <functional>
 
 #pragma warning(disable : 4324)
@@ -88,12 +89,28 @@ private:
     VXGI::IUserDefinedShaderSet* m_pVoxelizationGS;
     VXGI::IUserDefinedShaderSet* m_pVoxelizationPS;
 
+    // OpenGL only: the G-buffer pass samples material textures through bindless handles indexed by mesh,
+    // so it doesn't have to split draws at material changes
+    bool                     m_UseBindlessTextures;
+    NVRHI::ShaderHandle      m_pDefaultBindlessVS;
+    NVRHI::ShaderHandle      m_pAttributesBindlessPS;
+    NVRHI::BufferHandle      m_BindlessHandleBuffer;
+    std::vector<uint64_t>    m_BindlessHandles;
+
+    void UpdateBindlessHandles();
+
+    VXGI::SceneBVH           m_SceneBVH;
+    VXGI::SceneBVHQueryResult m_VisibleMeshes;
+
 public:
     SceneRenderer(NVRHI::IRendererInterface* pRenderer);
     
     HRESULT LoadMesh(const char* strFileName);
+    const Scene* GetScene() const { return m_pScene; }
 
-    HRESULT AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::IShaderCompiler* pCompiler);
+    // If shaderPackPath is set, the voxelization shaders are loaded from that pack when it has valid binaries for them,
+    // and the pack is rewritten when any of them had to be compiled
+    HRESULT AllocateResources(VXGI::IGlobalIllumination* pGI, VXGI::IShaderCompiler* pCompiler, const char* shaderPackPath = nullptr);
     void AllocateViewDependentResources(UINT width, UINT height, UINT sampleCount = 1);
     void ReleaseResources(VXGI::IGlobalIllumination* pGI);
     void ReleaseViewDependentResources();
@@ -116,6 +133,8 @@ public:
         const VXGI::Matrix4f& viewProjMatrix, 
         VXGI::Vector3f ambientColor);
 
+    // Draws the meshes that intersect any of the clipping boxes, or the culling frustum when there are no boxes,
+    // or all meshes when neither is set. Meshes are drawn in batches of the same material.
     void RenderSceneCommon(
         NVRHI::DrawCallState& state,
         VXGI::IGlobalIllumination* pGI,
@@ -124,7 +143,8 @@ public:
         const VXGI::Matrix4f& viewProjMatrix,
         MaterialCallback* onChangeMaterial,
         bool voxelization,
-        bool emittance);
+        bool emittance,
+        const VXGI::Frustum* cullingFrustum = NULL);
 
     VXGI::Frustum GetLightFrustum();
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout(row_major) uniform;
+
+layout(std140, binding = 0) uniform GlobalConstants
+{
+    mat4x4 g_ViewProjMatrix;
+    mat4x4 g_ViewProjMatrixInv;
+    mat4x4 g_LightViewProjMatrix;
+    vec4 g_LightDirection;
+    vec4 g_DiffuseColor;
+    vec4 g_LightColor;
+    vec4 g_AmbientColor;
+    float g_rShadowMapSize;
+    uint g_EnableIndirectDiffuse;
+    uint g_EnableIndirectSpecular;
+};
+
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec2 a_texCoord;
+layout(location = 2) in vec3 a_normal;
+layout(location = 3) in vec3 a_tangent;
+layout(location = 4) in vec3 a_binormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+layout(location = 0) out vec2 v_texCoord;
+layout(location = 1) out vec3 v_normal;
+layout(location = 2) out vec3 v_tangent;
+layout(location = 3) out vec3 v_binormal;
+layout(location = 4) out vec3 v_positionWS;
+layout(location = 5) flat out uint v_meshIndex;
+
+void main()
+{
+    gl_Position = vec4(a_position.xyz, 1.0) * g_ViewProjMatrix;
+    v_positionWS = a_position.xyz;
+
+    v_texCoord = a_texCoord;
+    v_normal = a_normal;
+    v_tangent = a_tangent;
+    v_binormal = a_binormal;
+
+    // The scene renderer passes the mesh index as the base instance of each draw
+    v_meshIndex = gl_BaseInstanceARB;
+} 
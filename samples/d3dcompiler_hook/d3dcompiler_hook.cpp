@@ -2,10 +2,27 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
+// Defines IID_ID3D11ShaderReflection In This Translation Unit, So That dxguid.lib Is Not Needed
+#include <initguid.h>
 #include <d3dcompiler.h>
+#include <d3d11shader.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include "shader_cache.h"
+#include "shader_policy.h"
 
 static HRESULT(WINAPI* g_pFn_Original_D3DCompile)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName, CONST D3D_SHADER_MACRO* pDefines, ID3DInclude* pInclude, LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob** ppCode, ID3DBlob** ppErrorMsgs) = NULL;
 static HRESULT(WINAPI* g_pFn_Original_D3DReflect)(LPCVOID pSrcData, SIZE_T SrcDataSize, REFIID pInterface, void** ppReflector) = NULL;
+static HRESULT(WINAPI* g_pFn_Original_D3DPreprocess)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName, CONST D3D_SHADER_MACRO* pDefines, ID3DInclude* pInclude, ID3DBlob** ppCodeText, ID3DBlob** ppErrorMsgs) = NULL;
+static HRESULT(WINAPI* g_pFn_Original_D3DCreateBlob)(SIZE_T Size, ID3DBlob** ppBlob) = NULL;
+static HRESULT(WINAPI* g_pFn_Original_D3DStripShader)(LPCVOID pShaderBytecode, SIZE_T BytecodeLength, UINT uStripFlags, ID3DBlob** ppStrippedBlob) = NULL;
+static char g_CompilerIdentity[MAX_PATH + 64] = "";
 
 static struct Initialize_Original_Function_Pointers
 {
@@ -14,14 +31,265 @@ static struct Initialize_Original_Function_Pointers
         HMODULE hModule = LoadLibraryExW(D3DCOMPILER_DLL_W, NULL, 0U);
         g_pFn_Original_D3DCompile = reinterpret_cast<HRESULT(WINAPI*)(LPCVOID, SIZE_T, LPCSTR, CONST D3D_SHADER_MACRO*, ID3DInclude*, LPCSTR, LPCSTR, UINT, UINT, ID3DBlob**, ID3DBlob**)>(GetProcAddress(hModule, "D3DCompile"));
         g_pFn_Original_D3DReflect = reinterpret_cast<HRESULT(WINAPI*)(LPCVOID, SIZE_T, REFIID, void**)>(GetProcAddress(hModule, "D3DReflect"));
+        g_pFn_Original_D3DPreprocess = reinterpret_cast<HRESULT(WINAPI*)(LPCVOID, SIZE_T, LPCSTR, CONST D3D_SHADER_MACRO*, ID3DInclude*, ID3DBlob**, ID3DBlob**)>(GetProcAddress(hModule, "D3DPreprocess"));
+        g_pFn_Original_D3DCreateBlob = reinterpret_cast<HRESULT(WINAPI*)(SIZE_T, ID3DBlob**)>(GetProcAddress(hModule, "D3DCreateBlob"));
+        g_pFn_Original_D3DStripShader = reinterpret_cast<HRESULT(WINAPI*)(LPCVOID, SIZE_T, UINT, ID3DBlob**)>(GetProcAddress(hModule, "D3DStripShader"));
+
+        // The Path And Time Stamp Of The Real Compiler Identify Its Version, So That Updating It Invalidates The Cache
+        char ModulePath[MAX_PATH] = "";
+        WIN32_FILE_ATTRIBUTE_DATA ModuleAttributes = {};
+        if (hModule != NULL && GetModuleFileNameA(hModule, ModulePath, MAX_PATH) != 0U)
+            GetFileAttributesExA(ModulePath, GetFileExInfoStandard, &ModuleAttributes);
+        sprintf_s(g_CompilerIdentity, "%s|%08x%08x|%u", ModulePath, ModuleAttributes.ftLastWriteTime.dwHighDateTime, ModuleAttributes.ftLastWriteTime.dwLowDateTime, ModuleAttributes.nFileSizeLow);
     };
 } Instance_Initialize_Original_Function_Pointers;
 
+// Environment Variables:
+// "VXGI_SHADER_CACHE_DIR"      Cache Directory (Default "ShaderCache" In The Working Directory), Which Also Receives "compile_log.jsonl"
+// "VXGI_SHADER_CACHE_MAX_MB"   Cache Size Limit In Megabytes (Default 256)
+// "VXGI_SHADER_CACHE_DISABLE"  Set To 1 To Always Compile; The Compile Log Is Still Written
+// "VXGI_SHADER_POLICY"         Rules File That Selects The Compile Flags Per Shader (Default "shader_policy.txt" In The Working Directory, If It Exists);
+//                              See "shader_policy.h" For The Format
+class CompileHookState
+{
+public:
+    CompileHookState(std::string const& RootDirectory, uint64_t MaxSizeBytes, bool bCacheEnabled, std::string const& PolicyPath, bool bPolicyRequired)
+        : m_Store(RootDirectory, MaxSizeBytes)
+        , m_bCacheEnabled(bCacheEnabled)
+        , m_pLogFile(NULL)
+    {
+        std::string LogPath = RootDirectory + "/compile_log.jsonl";
+        if (0 != fopen_s(&m_pLogFile, LogPath.c_str(), "a"))
+            m_pLogFile = NULL;
+
+        // The Default Rules File Is Optional, But A Rules File That Was Asked For Has To Be Loaded
+        std::string Errors;
+        if ((bPolicyRequired || GetFileAttributesA(PolicyPath.c_str()) != INVALID_FILE_ATTRIBUTES) && !m_Policy.LoadFile(PolicyPath, Errors))
+        {
+            OutputDebugStringA(("d3dcompiler_hook: " + PolicyPath + "\n").c_str());
+            OutputDebugStringA(Errors.c_str());
+        }
+    }
+
+    ~CompileHookState()
+    {
+        if (m_pLogFile != NULL)
+            fclose(m_pLogFile);
+    }
+
+    ShaderCacheStore* GetStore() { return m_bCacheEnabled ? &m_Store : NULL; }
+
+    ShaderPolicy const& GetPolicy() const { return m_Policy; }
+
+    void Log(CompileTelemetryRecord const& Record)
+    {
+        if (m_pLogFile == NULL)
+            return;
+
+        std::string Line = FormatCompileTelemetry(Record);
+
+        std::lock_guard<std::mutex> Lock(m_LogMutex);
+        fprintf(m_pLogFile, "%s\n", Line.c_str());
+        fflush(m_pLogFile);
+    }
+
+private:
+    ShaderCacheStore m_Store;
+    bool m_bCacheEnabled;
+    ShaderPolicy m_Policy;
+    FILE* m_pLogFile;
+    std::mutex m_LogMutex;
+};
+
+static std::string GetEnvironmentString(char const* pName, char const* pDefault, bool* pIsSet)
+{
+    char Value[MAX_PATH];
+    size_t Length = 0U;
+    bool bIsSet = (0 == getenv_s(&Length, Value, pName) && Length > 1U);
+
+    if (pIsSet != NULL)
+        *pIsSet = bIsSet;
+
+    return bIsSet ? std::string(Value) : std::string(pDefault);
+}
+
+static CompileHookState* CreateCompileHookState()
+{
+    std::string RootDirectory = GetEnvironmentString("VXGI_SHADER_CACHE_DIR", "ShaderCache", NULL);
+    uint64_t MaxSizeBytes = GetShaderCacheEnvironmentValue("VXGI_SHADER_CACHE_MAX_MB", 256U) << 20;
+    bool bCacheEnabled = GetShaderCacheEnvironmentValue("VXGI_SHADER_CACHE_DISABLE", 0U) == 0U && g_pFn_Original_D3DPreprocess != NULL && g_pFn_Original_D3DCreateBlob != NULL;
+
+    bool bPolicyRequired = false;
+    std::string PolicyPath = GetEnvironmentString("VXGI_SHADER_POLICY", "shader_policy.txt", &bPolicyRequired);
+
+    return new CompileHookState(RootDirectory, MaxSizeBytes, bCacheEnabled, PolicyPath, bPolicyRequired);
+}
+
+static CompileHookState* GetCompileHookState()
+{
+    // Thread-Safe Initialization On First Use, After The Original Function Pointers Are Known
+    static std::unique_ptr<CompileHookState> s_pState(CreateCompileHookState());
+    return s_pState.get();
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point Start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+// The Policy Owns These Bits; All Other Flags Of The Caller Are Passed Through
+static UINT const POLICY_FLAGS_MASK = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_OPTIMIZATION_LEVEL0 | D3DCOMPILE_OPTIMIZATION_LEVEL3 |
+    D3DCOMPILE_IEEE_STRICTNESS | D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_ENABLE_BACKWARDS_COMPATIBILITY;
+
+static UINT GetCompileFlags(ShaderCompileSettings const& Settings, UINT CallerFlags)
+{
+    UINT Flags = CallerFlags & ~POLICY_FLAGS_MASK;
+
+    switch (Settings.OptimizationLevel)
+    {
+    case ShaderCompileSettings::SKIP_OPTIMIZATION: Flags |= D3DCOMPILE_SKIP_OPTIMIZATION; break;
+    case 0: Flags |= D3DCOMPILE_OPTIMIZATION_LEVEL0; break;
+    case 1: Flags |= D3DCOMPILE_OPTIMIZATION_LEVEL1; break;
+    case 2: Flags |= D3DCOMPILE_OPTIMIZATION_LEVEL2; break;
+    default: Flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3; break;
+    }
+
+    if (Settings.Debug)
+        Flags |= D3DCOMPILE_DEBUG;
+    if (Settings.IeeeStrictness)
+        Flags |= D3DCOMPILE_IEEE_STRICTNESS;
+    if (Settings.BackwardsCompatibility)
+        Flags |= D3DCOMPILE_ENABLE_BACKWARDS_COMPATIBILITY;
+
+    return Flags;
+}
+
+static UINT GetStripFlags(ShaderCompileSettings const& Settings)
+{
+    UINT Flags = 0U;
+    if (Settings.StripFlags & SHADER_STRIP_DEBUG_INFO)
+        Flags |= D3DCOMPILER_STRIP_DEBUG_INFO;
+    if (Settings.StripFlags & SHADER_STRIP_REFLECTION_DATA)
+        Flags |= D3DCOMPILER_STRIP_REFLECTION_DATA;
+    if (Settings.StripFlags & SHADER_STRIP_PRIVATE_DATA)
+        Flags |= D3DCOMPILER_STRIP_PRIVATE_DATA;
+    return Flags;
+}
+
+static void ReflectInstructionCounts(ID3DBlob* pCode, CompileTelemetryRecord& Record)
+{
+    ID3D11ShaderReflection* pReflection = NULL;
+    if (FAILED(g_pFn_Original_D3DReflect(pCode->GetBufferPointer(), pCode->GetBufferSize(), IID_ID3D11ShaderReflection, reinterpret_cast<void**>(&pReflection))))
+        return;
+
+    D3D11_SHADER_DESC Desc;
+    if (SUCCEEDED(pReflection->GetDesc(&Desc)))
+    {
+        Record.bHasReflection = true;
+        Record.InstructionCount = Desc.InstructionCount;
+        Record.TempRegisterCount = Desc.TempRegisterCount;
+        Record.TextureInstructionCount = Desc.TextureNormalInstructions + Desc.TextureLoadInstructions + Desc.TextureCompInstructions + Desc.TextureBiasInstructions + Desc.TextureGradientInstructions;
+        Record.FloatInstructionCount = Desc.FloatInstructionCount;
+        Record.IntInstructionCount = Desc.IntInstructionCount + Desc.UintInstructionCount;
+        Record.FlowControlCount = Desc.StaticFlowControlCount + Desc.DynamicFlowControlCount;
+    }
+
+    pReflection->Release();
+}
+
 extern "C" HRESULT WINAPI D3DCompile(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName, CONST D3D_SHADER_MACRO * pDefines, ID3DInclude * pInclude, LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob * *ppCode, ID3DBlob * *ppErrorMsgs)
 {
-    Flags1 = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_ENABLE_BACKWARDS_COMPATIBILITY;
+    auto Start = std::chrono::steady_clock::now();
+
+    CompileHookState* pState = GetCompileHookState();
+
+    CompileTelemetryRecord Record;
+    Record.SourceHash = FormatShaderSourceHash(pSrcData, SrcDataSize);
+    Record.SourceName = pSourceName ? pSourceName : "";
+    Record.EntryPoint = pEntrypoint ? pEntrypoint : "";
+    Record.Target = pTarget ? pTarget : "";
+
+    ShaderCompileSettings Settings = pState->GetPolicy().Resolve(Record.EntryPoint, Record.Target, Record.SourceHash, &Record.RuleLine);
+    Flags1 = GetCompileFlags(Settings, Flags1);
+    UINT StripFlags = GetStripFlags(Settings);
+    Record.Flags1 = Flags1;
+    Record.StripFlags = Settings.StripFlags;
+
+    if (ppCode == NULL)
+        return g_pFn_Original_D3DCompile(pSrcData, SrcDataSize, pSourceName, pDefines, pInclude, pEntrypoint, pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
+
+    ShaderCacheStore* pStore = pState->GetStore();
+
+    // The Preprocessed Text Contains The Source And The Contents Of Every Included File, So Hashing It Covers Edits To The Includes As Well.
+    // If Preprocessing Fails, The Compiler Reports The Same Errors Below.
+    ID3DBlob* pPreprocessed = NULL;
+    if (pStore == NULL || FAILED(g_pFn_Original_D3DPreprocess(pSrcData, SrcDataSize, pSourceName, pDefines, pInclude, &pPreprocessed, NULL)))
+        pPreprocessed = NULL;
+
+    ShaderCacheKey Key;
+    bool bCacheable = (pPreprocessed != NULL);
+    if (bCacheable)
+    {
+        ShaderCompileInputs Inputs;
+        Inputs.pSource = pPreprocessed->GetBufferPointer();
+        Inputs.SourceSize = pPreprocessed->GetBufferSize();
+        for (CONST D3D_SHADER_MACRO* pDefine = pDefines; pDefine != NULL && pDefine->Name != NULL; ++pDefine)
+            Inputs.Defines.push_back(std::make_pair(std::string(pDefine->Name), std::string(pDefine->Definition ? pDefine->Definition : "")));
+        Inputs.EntryPoint = Record.EntryPoint;
+        Inputs.Target = Record.Target;
+        Inputs.Flags1 = Flags1;
+        Inputs.Flags2 = Flags2;
+        Inputs.StripFlags = StripFlags;
+        Inputs.CompilerIdentity = g_CompilerIdentity;
+        Key = ComputeShaderCacheKey(Inputs);
+        Record.Key = Key.ToString();
+
+        pPreprocessed->Release();
+
+        // A Hit Returns No Warnings, Because Only The Bytecode Is Stored
+        std::vector<uint8_t> CachedCode;
+        ID3DBlob* pBlob = NULL;
+        if (pStore->Load(Key, CachedCode) && SUCCEEDED(g_pFn_Original_D3DCreateBlob(CachedCode.size(), &pBlob)))
+        {
+            memcpy(pBlob->GetBufferPointer(), CachedCode.data(), CachedCode.size());
+            *ppCode = pBlob;
+            if (ppErrorMsgs != NULL)
+                *ppErrorMsgs = NULL;
+
+            // Blobs With Stripped Reflection Data Have No Instruction Counts
+            ReflectInstructionCounts(pBlob, Record);
+            Record.Result = "hit";
+            Record.BlobBytes = CachedCode.size();
+            Record.Milliseconds = MillisecondsSince(Start);
+            pState->Log(Record);
+            return S_OK;
+        }
+    }
+
+    HRESULT hr = g_pFn_Original_D3DCompile(pSrcData, SrcDataSize, pSourceName, pDefines, pInclude, pEntrypoint, pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
+
+    if (SUCCEEDED(hr) && *ppCode != NULL)
+    {
+        ReflectInstructionCounts(*ppCode, Record);
+
+        ID3DBlob* pStripped = NULL;
+        if (StripFlags != 0U && g_pFn_Original_D3DStripShader != NULL &&
+            SUCCEEDED(g_pFn_Original_D3DStripShader((*ppCode)->GetBufferPointer(), (*ppCode)->GetBufferSize(), StripFlags, &pStripped)))
+        {
+            (*ppCode)->Release();
+            *ppCode = pStripped;
+        }
+
+        Record.BlobBytes = (*ppCode)->GetBufferSize();
+
+        if (bCacheable)
+            pStore->Store(Key, (*ppCode)->GetBufferPointer(), (*ppCode)->GetBufferSize());
+    }
 
-    return g_pFn_Original_D3DCompile(pSrcData, SrcDataSize, pSourceName, pDefines, pInclude, pEntrypoint, pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
+    Record.Result = FAILED(hr) ? "error" : (bCacheable ? "miss" : "uncached");
+    Record.Milliseconds = MillisecondsSince(Start);
+    pState->Log(Record);
+    return hr;
 }
 
 extern "C" HRESULT WINAPI D3DReflect(LPCVOID pSrcData, SIZE_T SrcDataSize, REFIID pInterface, void** ppReflector)
@@ -0,0 +1,384 @@
+#if defined(_WIN32)
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "shader_cache.h"
+
+#include <GFSDK_NVRHI_Hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+// File Layout: Magic, Version, Payload Size, Payload Checksum, Payload
+static uint32_t const SHADER_CACHE_MAGIC = 0x43535856U; // "VXSC"
+static uint32_t const SHADER_CACHE_VERSION = 1U;
+static uint64_t const SHADER_CACHE_MAX_PAYLOAD = 64ULL << 20; // Rejects Damaged Headers Before Allocating
+
+struct ShaderCacheFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t PayloadSize;
+    uint64_t PayloadChecksum;
+};
+
+static void HashString(NVRHI::Hasher& Hasher, std::string const& String)
+{
+    // The Length Keeps ("ab", "c") And ("a", "bc") Apart
+    Hasher.Add(uint64_t(String.size()));
+    Hasher.AddBytes(String.data(), String.size());
+}
+
+static uint64_t HashInputs(ShaderCompileInputs const& Inputs, uint64_t Seed)
+{
+    NVRHI::Hasher Hasher(Seed);
+
+    HashString(Hasher, Inputs.CompilerIdentity);
+
+    Hasher.Add(uint64_t(Inputs.SourceSize));
+    Hasher.AddBytes(Inputs.pSource, Inputs.SourceSize);
+
+    Hasher.Add(uint64_t(Inputs.Defines.size()));
+    for (auto const& Define : Inputs.Defines)
+    {
+        HashString(Hasher, Define.first);
+        HashString(Hasher, Define.second);
+    }
+
+    HashString(Hasher, Inputs.EntryPoint);
+    HashString(Hasher, Inputs.Target);
+    Hasher.Add(Inputs.Flags1);
+    Hasher.Add(Inputs.Flags2);
+    Hasher.Add(Inputs.StripFlags);
+
+    return Hasher.Get();
+}
+
+ShaderCacheKey ComputeShaderCacheKey(ShaderCompileInputs const& Inputs)
+{
+    // Two Independently Seeded 64-bit Hashes, So That An Accidental Collision Is Not A Practical Concern
+    ShaderCacheKey Key;
+    Key.Low = HashInputs(Inputs, 0x9e3779b97f4a7c15ULL);
+    Key.High = HashInputs(Inputs, 0xc2b2ae3d27d4eb4fULL);
+    return Key;
+}
+
+std::string ShaderCacheKey::ToString() const
+{
+    char Text[33];
+    snprintf(Text, sizeof(Text), "%016llx%016llx", (unsigned long long)High, (unsigned long long)Low);
+    return Text;
+}
+
+static void MakeDirectory(std::string const& Path)
+{
+#if defined(_WIN32)
+    _mkdir(Path.c_str());
+#else
+    mkdir(Path.c_str(), 0755);
+#endif
+}
+
+static bool ReplaceFile(std::string const& From, std::string const& To)
+{
+#if defined(_WIN32)
+    // rename() Fails On Windows If The Target Exists; For A Content-Addressed Entry The Existing File Is Just As Good
+    if (rename(From.c_str(), To.c_str()) == 0)
+        return true;
+
+    remove(From.c_str());
+    return _access(To.c_str(), 0) == 0;
+#else
+    return rename(From.c_str(), To.c_str()) == 0;
+#endif
+}
+
+static void TouchFile(std::string const& Path)
+{
+#if defined(_WIN32)
+    _utime(Path.c_str(), NULL);
+#else
+    utime(Path.c_str(), NULL);
+#endif
+}
+
+static uint32_t GetProcessId()
+{
+#if defined(_WIN32)
+    return uint32_t(_getpid());
+#else
+    return uint32_t(getpid());
+#endif
+}
+
+struct ShaderCacheFileInfo
+{
+    std::string Path;
+    uint64_t Size;
+    time_t Time;
+};
+
+// Lists The Entries Of All Shard Directories
+static void ListEntries(std::string const& RootDirectory, std::vector<ShaderCacheFileInfo>& Entries)
+{
+    std::vector<std::string> Shards;
+
+#if defined(_WIN32)
+    _finddata_t FindData;
+    intptr_t hFind = _findfirst((RootDirectory + "/*").c_str(), &FindData);
+    if (hFind != -1)
+    {
+        do
+        {
+            if ((FindData.attrib & _A_SUBDIR) != 0 && FindData.name[0] != '.')
+                Shards.push_back(RootDirectory + "/" + FindData.name);
+        } while (_findnext(hFind, &FindData) == 0);
+        _findclose(hFind);
+    }
+
+    for (auto const& Shard : Shards)
+    {
+        hFind = _findfirst((Shard + "/*.bin").c_str(), &FindData);
+        if (hFind == -1)
+            continue;
+
+        do
+        {
+            if ((FindData.attrib & _A_SUBDIR) == 0)
+            {
+                ShaderCacheFileInfo Info;
+                Info.Path = Shard + "/" + FindData.name;
+                Info.Size = uint64_t(FindData.size);
+                Info.Time = FindData.time_write;
+                Entries.push_back(Info);
+            }
+        } while (_findnext(hFind, &FindData) == 0);
+        _findclose(hFind);
+    }
+#else
+    if (DIR* pRoot = opendir(RootDirectory.c_str()))
+    {
+        while (dirent* pEntry = readdir(pRoot))
+            if (pEntry->d_name[0] != '.')
+                Shards.push_back(RootDirectory + "/" + pEntry->d_name);
+        closedir(pRoot);
+    }
+
+    for (auto const& Shard : Shards)
+    {
+        DIR* pShard = opendir(Shard.c_str());
+        if (pShard == NULL)
+            continue;
+
+        while (dirent* pEntry = readdir(pShard))
+        {
+            size_t Length = strlen(pEntry->d_name);
+            if (Length < 4 || strcmp(pEntry->d_name + Length - 4, ".bin") != 0)
+                continue;
+
+            ShaderCacheFileInfo Info;
+            Info.Path = Shard + "/" + pEntry->d_name;
+
+            struct stat Stat;
+            if (stat(Info.Path.c_str(), &Stat) != 0)
+                continue;
+
+            Info.Size = uint64_t(Stat.st_size);
+            Info.Time = Stat.st_mtime;
+            Entries.push_back(Info);
+        }
+        closedir(pShard);
+    }
+#endif
+}
+
+ShaderCacheStore::ShaderCacheStore(std::string const& RootDirectory, uint64_t MaxSizeBytes)
+    : m_RootDirectory(RootDirectory)
+    , m_MaxSizeBytes(MaxSizeBytes)
+    , m_bSizeKnown(false)
+    , m_TempCounter(0U)
+{
+    MakeDirectory(m_RootDirectory);
+}
+
+std::string ShaderCacheStore::GetEntryPath(ShaderCacheKey const& Key) const
+{
+    std::string Name = Key.ToString();
+    return m_RootDirectory + "/" + Name.substr(0, 2) + "/" + Name + ".bin";
+}
+
+bool ShaderCacheStore::Load(ShaderCacheKey const& Key, std::vector<uint8_t>& Data)
+{
+    std::string Path = GetEntryPath(Key);
+
+    bool bValid = false;
+    bool bCorrupt = false;
+
+    FILE* pFile = fopen(Path.c_str(), "rb");
+    if (pFile != NULL)
+    {
+        ShaderCacheFileHeader Header;
+        if (fread(&Header, sizeof(Header), 1U, pFile) == 1U && Header.Magic == SHADER_CACHE_MAGIC && Header.Version == SHADER_CACHE_VERSION &&
+            Header.PayloadSize <= SHADER_CACHE_MAX_PAYLOAD)
+        {
+            Data.resize(size_t(Header.PayloadSize));
+            bValid = (Header.PayloadSize == 0U || fread(Data.data(), size_t(Header.PayloadSize), 1U, pFile) == 1U) &&
+                NVRHI::Hash::HashBytes(Data.data(), Data.size()) == Header.PayloadChecksum;
+        }
+        fclose(pFile);
+
+        bCorrupt = !bValid;
+    }
+
+    if (bValid)
+        TouchFile(Path);
+    else if (bCorrupt)
+        remove(Path.c_str());
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (bValid)
+        m_Stats.Hits++;
+    else
+        m_Stats.Misses++;
+    if (bCorrupt)
+    {
+        m_Stats.CorruptEntries++;
+        m_bSizeKnown = false;
+    }
+
+    return bValid;
+}
+
+bool ShaderCacheStore::Store(ShaderCacheKey const& Key, void const* pData, size_t DataSize)
+{
+    std::string Path = GetEntryPath(Key);
+    std::string Name = Key.ToString();
+    MakeDirectory(m_RootDirectory + "/" + Name.substr(0, 2));
+
+    uint32_t TempIndex;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        TempIndex = m_TempCounter++;
+    }
+
+    char Suffix[64];
+    snprintf(Suffix, sizeof(Suffix), ".%u.%u.tmp", GetProcessId(), TempIndex);
+    std::string TempPath = Path + Suffix;
+
+    ShaderCacheFileHeader Header;
+    Header.Magic = SHADER_CACHE_MAGIC;
+    Header.Version = SHADER_CACHE_VERSION;
+    Header.PayloadSize = DataSize;
+    Header.PayloadChecksum = NVRHI::Hash::HashBytes(pData, DataSize);
+
+    FILE* pFile = fopen(TempPath.c_str(), "wb");
+    if (pFile == NULL)
+        return false;
+
+    bool bWritten = fwrite(&Header, sizeof(Header), 1U, pFile) == 1U &&
+        (DataSize == 0U || fwrite(pData, DataSize, 1U, pFile) == 1U);
+    bWritten = (fclose(pFile) == 0) && bWritten;
+
+    if (!bWritten || !ReplaceFile(TempPath, Path))
+    {
+        remove(TempPath.c_str());
+        return false;
+    }
+
+    bool bNeedTrim;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_Stats.Stores++;
+        m_Stats.TotalBytes += sizeof(Header) + DataSize;
+        bNeedTrim = m_MaxSizeBytes != 0U && (!m_bSizeKnown || m_Stats.TotalBytes > m_MaxSizeBytes);
+    }
+
+    // Trim To 3/4 Of The Limit, So That Eviction Runs Once Per Many Stores Rather Than On Every One
+    if (bNeedTrim)
+        Trim(m_MaxSizeBytes - m_MaxSizeBytes / 4U);
+
+    return true;
+}
+
+void ShaderCacheStore::ScanSize()
+{
+    std::vector<ShaderCacheFileInfo> Entries;
+    ListEntries(m_RootDirectory, Entries);
+
+    uint64_t TotalBytes = 0U;
+    for (auto const& Entry : Entries)
+        TotalBytes += Entry.Size;
+
+    m_Stats.TotalBytes = TotalBytes;
+    m_bSizeKnown = true;
+}
+
+void ShaderCacheStore::Trim(uint64_t TargetBytes)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    // Other Processes May Share The Directory, So The Index Is Always Rebuilt From The File System
+    std::vector<ShaderCacheFileInfo> Entries;
+    ListEntries(m_RootDirectory, Entries);
+
+    uint64_t TotalBytes = 0U;
+    for (auto const& Entry : Entries)
+        TotalBytes += Entry.Size;
+
+    if (TotalBytes > TargetBytes)
+    {
+        std::sort(Entries.begin(), Entries.end(), [](ShaderCacheFileInfo const& A, ShaderCacheFileInfo const& B) { return A.Time < B.Time; });
+
+        for (auto const& Entry : Entries)
+        {
+            if (TotalBytes <= TargetBytes)
+                break;
+
+            if (remove(Entry.Path.c_str()) == 0)
+            {
+                TotalBytes -= Entry.Size;
+                m_Stats.Evictions++;
+            }
+        }
+    }
+
+    m_Stats.TotalBytes = TotalBytes;
+    m_bSizeKnown = true;
+}
+
+ShaderCacheStats ShaderCacheStore::GetStats()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    if (!m_bSizeKnown)
+        ScanSize();
+
+    return m_Stats;
+}
+
+uint64_t GetShaderCacheEnvironmentValue(char const* pName, uint64_t Default)
+{
+    char const* pValue = getenv(pName);
+    if (pValue == NULL || pValue[0] == '\0')
+        return Default;
+
+    char* pEnd = NULL;
+    unsigned long long Value = strtoull(pValue, &pEnd, 10);
+    return (pEnd != NULL && *pEnd == '\0') ? uint64_t(Value) : Default;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// Platform-neutral part of the compile cache: key derivation and the on-disk blob store.
+// Nothing here depends on Windows or d3dcompiler, so it can be built and exercised on any platform.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ShaderCacheKey
+{
+    uint64_t Low;
+    uint64_t High;
+
+    ShaderCacheKey() : Low(0U), High(0U) {}
+
+    bool operator==(ShaderCacheKey const& Other) const { return Low == Other.Low && High == Other.High; }
+    bool operator!=(ShaderCacheKey const& Other) const { return !(*this == Other); }
+
+    // 32 Lowercase Hex Digits, High Word First
+    std::string ToString() const;
+};
+
+// Everything That Affects The Compiled Bytecode.
+// "Source" Should Be The Preprocessed Source, Which Already Contains The Contents Of All Included Files;
+// The Defines Are Still Hashed Separately Because They Are Visible To The Compiler As Well.
+struct ShaderCompileInputs
+{
+    void const* pSource;
+    size_t SourceSize;
+    std::vector<std::pair<std::string, std::string>> Defines;
+    std::string EntryPoint;
+    std::string Target;
+    uint32_t Flags1;
+    uint32_t Flags2;
+    uint32_t StripFlags; // Applied To The Bytecode After Compilation
+    std::string CompilerIdentity; // Changes To The Compiler Invalidate The Cache
+
+    ShaderCompileInputs() : pSource(NULL), SourceSize(0U), Flags1(0U), Flags2(0U), StripFlags(0U) {}
+};
+
+ShaderCacheKey ComputeShaderCacheKey(ShaderCompileInputs const& Inputs);
+
+struct ShaderCacheStats
+{
+    uint64_t Hits;
+    uint64_t Misses;
+    uint64_t Stores;
+    uint64_t Evictions;
+    uint64_t CorruptEntries;
+    uint64_t TotalBytes;
+
+    ShaderCacheStats() : Hits(0U), Misses(0U), Stores(0U), Evictions(0U), CorruptEntries(0U), TotalBytes(0U) {}
+};
+
+// Content-Addressed Store Of Compiled Blobs: "<Root>/<First 2 Hex Digits Of The Key>/<Key>.bin".
+// Writes Go To A Unique Temporary File That Is Renamed Into Place, So Concurrent Writers (Threads Or Processes)
+// Never Expose A Partial Entry; Each Entry Also Carries A Checksum Of Its Payload, And Entries That Fail The Check Are Deleted.
+// When The Total Size Exceeds The Limit, The Least Recently Used Entries Are Removed (Hits Refresh The File Time).
+class ShaderCacheStore
+{
+public:
+    ShaderCacheStore(std::string const& RootDirectory, uint64_t MaxSizeBytes);
+
+    bool Load(ShaderCacheKey const& Key, std::vector<uint8_t>& Data);
+
+    bool Store(ShaderCacheKey const& Key, void const* pData, size_t DataSize);
+
+    // Removes Entries Until The Store Fits Into "TargetBytes"
+    void Trim(uint64_t TargetBytes);
+
+    ShaderCacheStats GetStats();
+
+    std::string GetEntryPath(ShaderCacheKey const& Key) const;
+
+private:
+    std::string m_RootDirectory;
+    uint64_t m_MaxSizeBytes;
+    bool m_bSizeKnown;
+    uint32_t m_TempCounter;
+    ShaderCacheStats m_Stats;
+    std::mutex m_Mutex;
+
+    void ScanSize();
+};
+
+// Reads An Unsigned Integer From The Environment, Or Returns The Default
+uint64_t GetShaderCacheEnvironmentValue(char const* pName, uint64_t Default);
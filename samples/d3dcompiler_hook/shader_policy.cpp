@@ -0,0 +1,305 @@
+#if defined(_WIN32)
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "shader_policy.h"
+
+#include <GFSDK_NVRHI_Hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+
+bool MatchShaderPolicyPattern(char const* pPattern, char const* pText)
+{
+    // Iterative Wildcard Matching With Backtracking To The Last '*'
+    char const* pStarPattern = NULL;
+    char const* pStarText = NULL;
+
+    while (*pText != '\0')
+    {
+        if (*pPattern == '*')
+        {
+            pStarPattern = ++pPattern;
+            pStarText = pText;
+        }
+        else if (*pPattern == '?' || *pPattern == *pText)
+        {
+            ++pPattern;
+            ++pText;
+        }
+        else if (pStarPattern != NULL)
+        {
+            pPattern = pStarPattern;
+            pText = ++pStarText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*pPattern == '*')
+        ++pPattern;
+
+    return *pPattern == '\0';
+}
+
+static bool MatchSourceHash(std::string const& Pattern, std::string const& SourceHash)
+{
+    if (Pattern.find_first_of("*?") != std::string::npos)
+        return MatchShaderPolicyPattern(Pattern.c_str(), SourceHash.c_str());
+
+    return !Pattern.empty() && SourceHash.compare(0, Pattern.size(), Pattern) == 0;
+}
+
+static bool ParseBool(std::string const& Value, bool& Result)
+{
+    if (Value == "1" || Value == "on" || Value == "true")
+        Result = true;
+    else if (Value == "0" || Value == "off" || Value == "false")
+        Result = false;
+    else
+        return false;
+
+    return true;
+}
+
+static bool ParseStripFlags(std::string const& Value, uint32_t& Result)
+{
+    Result = 0U;
+
+    std::stringstream Stream(Value);
+    std::string Item;
+    while (std::getline(Stream, Item, ','))
+    {
+        if (Item == "none")
+            continue;
+        else if (Item == "debug")
+            Result |= SHADER_STRIP_DEBUG_INFO;
+        else if (Item == "reflection")
+            Result |= SHADER_STRIP_REFLECTION_DATA;
+        else if (Item == "private")
+            Result |= SHADER_STRIP_PRIVATE_DATA;
+        else if (Item == "all")
+            Result |= SHADER_STRIP_DEBUG_INFO | SHADER_STRIP_REFLECTION_DATA | SHADER_STRIP_PRIVATE_DATA;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+static bool ParseSetting(std::string const& Setting, ShaderPolicyRule& Rule)
+{
+    size_t Separator = Setting.find('=');
+    if (Separator == std::string::npos)
+        return false;
+
+    std::string Name = Setting.substr(0, Separator);
+    std::string Value = Setting.substr(Separator + 1);
+
+    if (Name == "optimization")
+    {
+        if (Value == "skip")
+            Rule.Settings.OptimizationLevel = ShaderCompileSettings::SKIP_OPTIMIZATION;
+        else if (Value.size() == 1 && Value[0] >= '0' && Value[0] <= '3')
+            Rule.Settings.OptimizationLevel = Value[0] - '0';
+        else
+            return false;
+
+        Rule.bHasOptimizationLevel = true;
+        return true;
+    }
+
+    if (Name == "debug")
+        return (Rule.bHasDebug = ParseBool(Value, Rule.Settings.Debug));
+
+    if (Name == "ieee")
+        return (Rule.bHasIeeeStrictness = ParseBool(Value, Rule.Settings.IeeeStrictness));
+
+    if (Name == "backcompat")
+        return (Rule.bHasBackwardsCompatibility = ParseBool(Value, Rule.Settings.BackwardsCompatibility));
+
+    if (Name == "strip")
+        return (Rule.bHasStripFlags = ParseStripFlags(Value, Rule.Settings.StripFlags));
+
+    return false;
+}
+
+bool ShaderPolicy::Parse(std::string const& Text, std::string& Errors)
+{
+    m_Rules.clear();
+    Errors.clear();
+
+    std::stringstream Stream(Text);
+    std::string LineText;
+    int Line = 0;
+
+    while (std::getline(Stream, LineText))
+    {
+        ++Line;
+
+        size_t Comment = LineText.find('#');
+        if (Comment != std::string::npos)
+            LineText.resize(Comment);
+
+        std::stringstream Tokens(LineText);
+        ShaderPolicyRule Rule;
+        Rule.Line = Line;
+
+        if (!(Tokens >> Rule.EntryPointPattern))
+            continue;
+
+        if (!(Tokens >> Rule.TargetPattern >> Rule.SourceHashPattern))
+        {
+            Errors += "line " + std::to_string(Line) + ": expected <entry point> <target> <source hash> <settings>\n";
+            continue;
+        }
+
+        bool bValid = true;
+        std::string Setting;
+        while (Tokens >> Setting)
+        {
+            if (!ParseSetting(Setting, Rule))
+            {
+                Errors += "line " + std::to_string(Line) + ": invalid setting '" + Setting + "'\n";
+                bValid = false;
+            }
+        }
+
+        if (bValid)
+            m_Rules.push_back(Rule);
+    }
+
+    return Errors.empty();
+}
+
+bool ShaderPolicy::LoadFile(std::string const& Path, std::string& Errors)
+{
+    FILE* pFile = fopen(Path.c_str(), "rb");
+    if (pFile == NULL)
+    {
+        m_Rules.clear();
+        Errors = "cannot open " + Path + "\n";
+        return false;
+    }
+
+    std::string Text;
+    char Buffer[4096];
+    size_t Size;
+    while ((Size = fread(Buffer, 1U, sizeof(Buffer), pFile)) != 0U)
+        Text.append(Buffer, Size);
+    fclose(pFile);
+
+    return Parse(Text, Errors);
+}
+
+ShaderCompileSettings ShaderPolicy::Resolve(std::string const& EntryPoint, std::string const& Target, std::string const& SourceHash, int* pLastRuleLine) const
+{
+    ShaderCompileSettings Settings;
+    int LastRuleLine = 0;
+
+    for (auto const& Rule : m_Rules)
+    {
+        if (!MatchShaderPolicyPattern(Rule.EntryPointPattern.c_str(), EntryPoint.c_str()) ||
+            !MatchShaderPolicyPattern(Rule.TargetPattern.c_str(), Target.c_str()) ||
+            !MatchSourceHash(Rule.SourceHashPattern, SourceHash))
+            continue;
+
+        if (Rule.bHasOptimizationLevel) Settings.OptimizationLevel = Rule.Settings.OptimizationLevel;
+        if (Rule.bHasDebug) Settings.Debug = Rule.Settings.Debug;
+        if (Rule.bHasIeeeStrictness) Settings.IeeeStrictness = Rule.Settings.IeeeStrictness;
+        if (Rule.bHasBackwardsCompatibility) Settings.BackwardsCompatibility = Rule.Settings.BackwardsCompatibility;
+        if (Rule.bHasStripFlags) Settings.StripFlags = Rule.Settings.StripFlags;
+
+        LastRuleLine = Rule.Line;
+    }
+
+    if (pLastRuleLine != NULL)
+        *pLastRuleLine = LastRuleLine;
+
+    return Settings;
+}
+
+std::string FormatShaderSourceHash(void const* pSource, size_t SourceSize)
+{
+    char Text[17];
+    snprintf(Text, sizeof(Text), "%016llx", (unsigned long long)NVRHI::Hash::HashBytes(pSource, SourceSize));
+    return Text;
+}
+
+static void AppendJsonString(std::string& Out, char const* pName, std::string const& Value)
+{
+    Out += "\"";
+    Out += pName;
+    Out += "\":\"";
+
+    for (char Char : Value)
+    {
+        switch (Char)
+        {
+        case '"': Out += "\\\""; break;
+        case '\\': Out += "\\\\"; break;
+        case '\n': Out += "\\n"; break;
+        case '\r': Out += "\\r"; break;
+        case '\t': Out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(Char) < 0x20U)
+            {
+                char Escape[8];
+                snprintf(Escape, sizeof(Escape), "\\u%04x", unsigned(Char));
+                Out += Escape;
+            }
+            else
+            {
+                Out += Char;
+            }
+        }
+    }
+
+    Out += "\",";
+}
+
+static void AppendJsonNumber(std::string& Out, char const* pName, unsigned long long Value)
+{
+    char Text[64];
+    snprintf(Text, sizeof(Text), "\"%s\":%llu,", pName, Value);
+    Out += Text;
+}
+
+std::string FormatCompileTelemetry(CompileTelemetryRecord const& Record)
+{
+    std::string Out = "{";
+
+    AppendJsonString(Out, "result", Record.Result);
+
+    char Text[64];
+    snprintf(Text, sizeof(Text), "\"ms\":%.3f,", Record.Milliseconds);
+    Out += Text;
+
+    AppendJsonString(Out, "key", Record.Key);
+    AppendJsonString(Out, "sourceHash", Record.SourceHash);
+    AppendJsonString(Out, "source", Record.SourceName);
+    AppendJsonString(Out, "entry", Record.EntryPoint);
+    AppendJsonString(Out, "target", Record.Target);
+    AppendJsonNumber(Out, "flags1", Record.Flags1);
+    AppendJsonNumber(Out, "strip", Record.StripFlags);
+    AppendJsonNumber(Out, "ruleLine", unsigned(Record.RuleLine));
+    AppendJsonNumber(Out, "bytes", Record.BlobBytes);
+
+    if (Record.bHasReflection)
+    {
+        AppendJsonNumber(Out, "instructions", Record.InstructionCount);
+        AppendJsonNumber(Out, "tempRegisters", Record.TempRegisterCount);
+        AppendJsonNumber(Out, "textureInstructions", Record.TextureInstructionCount);
+        AppendJsonNumber(Out, "floatInstructions", Record.FloatInstructionCount);
+        AppendJsonNumber(Out, "intInstructions", Record.IntInstructionCount);
+        AppendJsonNumber(Out, "flowControl", Record.FlowControlCount);
+    }
+
+    // Every Field Above Ends With A Comma
+    Out.back() = '}';
+    return Out;
+}
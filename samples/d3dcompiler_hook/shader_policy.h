@@ -0,0 +1,131 @@
+#pragma once
+
+// Platform-neutral part of the compile policy: the rules file, the rule matcher and the telemetry record format.
+// The hook translates the resolved settings into D3DCOMPILE flags.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum ShaderStripFlags
+{
+    SHADER_STRIP_DEBUG_INFO = 0x1,
+    SHADER_STRIP_REFLECTION_DATA = 0x2,
+    SHADER_STRIP_PRIVATE_DATA = 0x4
+};
+
+struct ShaderCompileSettings
+{
+    enum { SKIP_OPTIMIZATION = -1 };
+
+    int OptimizationLevel; // SKIP_OPTIMIZATION Or 0..3
+    bool Debug;
+    bool IeeeStrictness;
+    bool BackwardsCompatibility;
+    uint32_t StripFlags; // ShaderStripFlags
+
+    // The Settings Used When No Rule Matches: The Flags The Hook Always Forced Before Rules Existed
+    ShaderCompileSettings()
+        : OptimizationLevel(SKIP_OPTIMIZATION)
+        , Debug(true)
+        , IeeeStrictness(false)
+        , BackwardsCompatibility(true)
+        , StripFlags(0U)
+    {}
+};
+
+// One Line Of The Rules File:
+//
+//     <entry point pattern> <target pattern> <source hash pattern> <setting>=<value> ...
+//
+// Patterns Support '*' And '?'; The Source Hash Is The 16 Hex Digits Reported In The Telemetry Log, And A Pattern Without Wildcards
+// Matches It By Prefix. Settings: "optimization=skip|0|1|2|3", "debug=0|1", "ieee=0|1", "backcompat=0|1",
+// "strip=none|debug|reflection|private|all" (Comma Separated). '#' Starts A Comment.
+// Every Matching Rule Is Applied In File Order, So Later Rules Override The Settings Of Earlier Ones.
+struct ShaderPolicyRule
+{
+    std::string EntryPointPattern;
+    std::string TargetPattern;
+    std::string SourceHashPattern;
+    int Line;
+
+    bool bHasOptimizationLevel;
+    bool bHasDebug;
+    bool bHasIeeeStrictness;
+    bool bHasBackwardsCompatibility;
+    bool bHasStripFlags;
+    ShaderCompileSettings Settings;
+
+    ShaderPolicyRule()
+        : Line(0)
+        , bHasOptimizationLevel(false)
+        , bHasDebug(false)
+        , bHasIeeeStrictness(false)
+        , bHasBackwardsCompatibility(false)
+        , bHasStripFlags(false)
+    {}
+};
+
+class ShaderPolicy
+{
+public:
+    // Invalid Lines Are Skipped And Described In "Errors", One Per Line; Returns False If There Were Any
+    bool Parse(std::string const& Text, std::string& Errors);
+
+    bool LoadFile(std::string const& Path, std::string& Errors);
+
+    // Returns The File Line Of The Last Matching Rule In "pLastRuleLine", Or 0 If No Rule Matched
+    ShaderCompileSettings Resolve(std::string const& EntryPoint, std::string const& Target, std::string const& SourceHash, int* pLastRuleLine) const;
+
+    size_t GetRuleCount() const { return m_Rules.size(); }
+
+private:
+    std::vector<ShaderPolicyRule> m_Rules;
+};
+
+bool MatchShaderPolicyPattern(char const* pPattern, char const* pText);
+
+// Hex Form Of The Source Hash Used By Rules And Telemetry
+std::string FormatShaderSourceHash(void const* pSource, size_t SourceSize);
+
+struct CompileTelemetryRecord
+{
+    std::string Result; // "hit", "miss", "uncached" Or "error"
+    double Milliseconds;
+    std::string Key;
+    std::string SourceHash;
+    std::string SourceName;
+    std::string EntryPoint;
+    std::string Target;
+    uint32_t Flags1;
+    uint32_t StripFlags;
+    int RuleLine;
+    uint64_t BlobBytes;
+
+    // From Shader Reflection, When It Is Available
+    bool bHasReflection;
+    uint32_t InstructionCount;
+    uint32_t TempRegisterCount;
+    uint32_t TextureInstructionCount;
+    uint32_t FloatInstructionCount;
+    uint32_t IntInstructionCount;
+    uint32_t FlowControlCount;
+
+    CompileTelemetryRecord()
+        : Milliseconds(0.0)
+        , Flags1(0U)
+        , StripFlags(0U)
+        , RuleLine(0)
+        , BlobBytes(0U)
+        , bHasReflection(false)
+        , InstructionCount(0U)
+        , TempRegisterCount(0U)
+        , TextureInstructionCount(0U)
+        , FloatInstructionCount(0U)
+        , IntInstructionCount(0U)
+        , FlowControlCount(0U)
+    {}
+};
+
+// One JSON Object Per Line, Without The Trailing Newline
+std::string FormatCompileTelemetry(CompileTelemetryRecord const& Record);
@@ -0,0 +1,247 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A one-shot graph of jobs with dependencies, used to overlap startup work such as shader compilation.
+// Jobs with MAIN_THREAD affinity run on the thread that calls Run(), which is where graphics API objects
+// have to be created; ANY_THREAD jobs run on a pool of worker threads, or on the calling thread if there are no workers.
+// A job that returns false fails the graph, and all jobs that depend on it directly or indirectly are skipped.
+class JobGraph
+{
+public:
+    typedef uint32_t JobId;
+
+    enum Affinity
+    {
+        ANY_THREAD,
+        MAIN_THREAD
+    };
+
+    struct JobTiming
+    {
+        std::string name;
+        double startMs;     // relative to the start of Run()
+        double durationMs;
+        bool mainThread;
+        bool succeeded;
+        bool skipped;
+    };
+
+    JobId Add(const char* name, std::function<bool()> function, Affinity affinity = ANY_THREAD)
+    {
+        Job job;
+        job.name = name;
+        job.function = std::move(function);
+        job.affinity = affinity;
+        m_Jobs.push_back(std::move(job));
+        return JobId(m_Jobs.size() - 1);
+    }
+
+    void AddDependency(JobId job, JobId dependsOn)
+    {
+        m_Jobs[dependsOn].dependents.push_back(job);
+        m_Jobs[job].dependencyCount++;
+    }
+
+    // Returns false if any job failed or was skipped, or if the dependencies contain a cycle (nothing runs then)
+    bool Run(uint32_t workerCount)
+    {
+        m_Timings.assign(m_Jobs.size(), JobTiming());
+        for (size_t i = 0; i < m_Jobs.size(); i++)
+        {
+            m_Timings[i].name = m_Jobs[i].name;
+            m_Jobs[i].remainingDependencies = m_Jobs[i].dependencyCount;
+            m_Jobs[i].dependencyFailed = false;
+        }
+
+        if (HasCycle())
+            return false;
+
+        m_Start = std::chrono::steady_clock::now();
+        m_Remaining = m_Jobs.size();
+        m_Failed = false;
+        m_MainQueue.clear();
+        m_WorkerQueue.clear();
+
+        for (JobId id = 0; id < JobId(m_Jobs.size()); id++)
+            if (m_Jobs[id].dependencyCount == 0)
+                Enqueue(id, workerCount);
+
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < workerCount; i++)
+            workers.emplace_back([this]() { WorkerLoop(); });
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (m_Remaining != 0)
+        {
+            if (m_MainQueue.empty())
+            {
+                m_Wake.wait(lock);
+                continue;
+            }
+
+            JobId id = m_MainQueue.front();
+            m_MainQueue.pop_front();
+
+            lock.unlock();
+            Execute(id, true);
+            lock.lock();
+
+            Complete(id, workerCount);
+        }
+
+        lock.unlock();
+        m_Wake.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+
+        return !m_Failed;
+    }
+
+    const std::vector<JobTiming>& GetTimings() const { return m_Timings; }
+
+    size_t GetJobCount() const { return m_Jobs.size(); }
+
+private:
+    struct Job
+    {
+        std::string name;
+        std::function<bool()> function;
+        Affinity affinity;
+        std::vector<JobId> dependents;
+        uint32_t dependencyCount;
+        uint32_t remainingDependencies;
+        bool dependencyFailed;
+
+        Job() : affinity(ANY_THREAD), dependencyCount(0), remainingDependencies(0), dependencyFailed(false) { }
+    };
+
+    std::vector<Job> m_Jobs;
+    std::vector<JobTiming> m_Timings;
+    std::deque<JobId> m_MainQueue;
+    std::deque<JobId> m_WorkerQueue;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::chrono::steady_clock::time_point m_Start;
+    size_t m_Remaining;
+    bool m_Failed;
+
+    bool HasCycle() const
+    {
+        std::vector<uint32_t> counts(m_Jobs.size());
+        std::vector<JobId> ready;
+        for (JobId id = 0; id < JobId(m_Jobs.size()); id++)
+        {
+            counts[id] = m_Jobs[id].dependencyCount;
+            if (counts[id] == 0)
+                ready.push_back(id);
+        }
+
+        size_t visited = 0;
+        while (!ready.empty())
+        {
+            JobId id = ready.back();
+            ready.pop_back();
+            visited++;
+
+            for (JobId dependent : m_Jobs[id].dependents)
+                if (--counts[dependent] == 0)
+                    ready.push_back(dependent);
+        }
+
+        return visited != m_Jobs.size();
+    }
+
+    // Called with the mutex locked, or before the workers start
+    void Enqueue(JobId id, uint32_t workerCount)
+    {
+        if (m_Jobs[id].affinity == MAIN_THREAD || workerCount == 0)
+            m_MainQueue.push_back(id);
+        else
+            m_WorkerQueue.push_back(id);
+    }
+
+    void Execute(JobId id, bool mainThread)
+    {
+        Job& job = m_Jobs[id];
+        JobTiming& timing = m_Timings[id];
+        timing.mainThread = mainThread;
+
+        auto start = std::chrono::steady_clock::now();
+        timing.startMs = std::chrono::duration<double, std::milli>(start - m_Start).count();
+
+        // The flag is only written by Complete() while this job is still waiting, so reading it here is safe
+        if (job.dependencyFailed)
+        {
+            timing.skipped = true;
+            timing.succeeded = false;
+            timing.durationMs = 0.0;
+            return;
+        }
+
+        timing.skipped = false;
+        timing.succeeded = job.function();
+        timing.durationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Called with the mutex locked
+    void Complete(JobId id, uint32_t workerCount)
+    {
+        bool failed = !m_Timings[id].succeeded;
+        if (failed)
+            m_Failed = true;
+
+        for (JobId dependent : m_Jobs[id].dependents)
+        {
+            Job& job = m_Jobs[dependent];
+            job.dependencyFailed = job.dependencyFailed || failed;
+
+            if (--job.remainingDependencies == 0)
+                Enqueue(dependent, workerCount);
+        }
+
+        m_Remaining--;
+        m_Wake.notify_all();
+    }
+
+    void WorkerLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (m_Remaining != 0)
+        {
+            if (m_WorkerQueue.empty())
+            {
+                m_Wake.wait(lock);
+                continue;
+            }
+
+            JobId id = m_WorkerQueue.front();
+            m_WorkerQueue.pop_front();
+
+            lock.unlock();
+            Execute(id, false);
+            lock.lock();
+
+            // There is at least one worker, or this loop would not be running
+            Complete(id, 1);
+        }
+    }
+};
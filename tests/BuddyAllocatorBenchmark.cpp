@@ -0,0 +1,192 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// Fragmentation of the D3D12 placed resource pools under texture streaming churn.
+// The pool logic mirrors PlacedResourceAllocator::CreateInPool: 64 MB heaps of 64 KB blocks,
+// first heap that fits, a new heap when none does, and empty heaps released except one.
+// Reported per configuration, sampled after warm-up:
+//  - rounding: bytes lost to power-of-2 block sizes, relative to the live texture bytes
+//  - free: unallocated bytes in the heaps, relative to the live texture bytes
+//  - fragmentation and reclaimable heaps: as in RendererInterfaceD3D12::getHeapAllocatorStats
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_BuddyAllocator.h"
+#include <algorithm>
+#include <random>
+
+using namespace NVRHI;
+
+static const uint64_t KB = 1024;
+static const uint64_t MB = 1024 * KB;
+static const uint64_t HEAP_SIZE = 64 * MB;
+
+struct Allocation
+{
+    BuddyAllocator* heap;
+    uint64_t offset;
+    uint64_t size;
+};
+
+class Pool
+{
+public:
+    std::vector<BuddyAllocator*> heaps;
+    uint32_t heapsCreated;
+
+    Pool() : heapsCreated(0) { }
+    ~Pool() { for (auto heap : heaps) delete heap; }
+
+    bool Allocate(uint64_t size, Allocation& allocation)
+    {
+        if (size > HEAP_SIZE)
+            return false;
+
+        for (auto heap : heaps)
+        {
+            uint64_t offset = heap->Allocate(size, 64 * KB);
+            if (offset != BuddyAllocator::INVALID_OFFSET)
+            {
+                allocation.heap = heap;
+                allocation.offset = offset;
+                allocation.size = size;
+                return true;
+            }
+        }
+
+        heaps.push_back(new BuddyAllocator(64 * KB, 10));
+        heapsCreated++;
+        allocation.heap = heaps.back();
+        allocation.offset = heaps.back()->Allocate(size, 64 * KB);
+        allocation.size = size;
+        return true;
+    }
+
+    void Free(const Allocation& allocation)
+    {
+        allocation.heap->Free(allocation.offset);
+
+        if (allocation.heap->IsEmpty() && heaps.size() > 1)
+        {
+            heaps.erase(std::find(heaps.begin(), heaps.end(), allocation.heap));
+            delete allocation.heap;
+        }
+    }
+
+    void GetStats(uint64_t& heapBytes, uint64_t& allocatedBytes, float& fragmentation, uint32_t& reclaimableHeaps) const
+    {
+        heapBytes = 0;
+        allocatedBytes = 0;
+        uint64_t largestFree = 0;
+        for (auto heap : heaps)
+        {
+            heapBytes += heap->GetSize();
+            allocatedBytes += heap->GetAllocatedSize();
+            largestFree = std::max(largestFree, heap->GetLargestFreeBlock());
+        }
+
+        uint64_t freeBytes = heapBytes - allocatedBytes;
+        fragmentation = freeBytes > 0 ? 1.f - float(double(largestFree) / double(freeBytes)) : 0.f;
+
+        uint32_t minHeaps = uint32_t((allocatedBytes + HEAP_SIZE - 1) / HEAP_SIZE);
+        reclaimableHeaps = uint32_t(heaps.size()) - std::min(minHeaps, uint32_t(heaps.size()));
+    }
+};
+
+// Size of a 2D texture with a full mip chain, rounded up to 64 KB pages
+static uint64_t TextureSize(uint32_t width, uint32_t height, uint32_t bytesPerPixel)
+{
+    uint64_t size = 0;
+    while (true)
+    {
+        size += uint64_t(width) * height * bytesPerPixel;
+        if (width == 1 && height == 1)
+            break;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return (size + 64 * KB - 1) & ~(64 * KB - 1);
+}
+
+static void Run(const char* name, uint64_t targetLiveBytes, uint32_t minLog2, uint32_t maxLog2, bool squareOnly)
+{
+    std::mt19937 rng(1);
+    Pool pool;
+    std::vector<Allocation> live;
+    uint64_t liveRequested = 0;
+
+    double sumRounding = 0, sumFree = 0, peakFree = 0, sumFragmentation = 0;
+    uint32_t samples = 0, peakHeaps = 0, sumReclaimable = 0;
+    uint64_t operations = 0;
+
+    TestTimer timer;
+    for (int iteration = 0; iteration < 200000; iteration++)
+    {
+        // Stream in while under the budget, evict random textures while over it
+        if (liveRequested < targetLiveBytes)
+        {
+            uint32_t width = 1u << (minLog2 + rng() % (maxLog2 - minLog2 + 1));
+            uint32_t height = squareOnly ? width : 1u << (minLog2 + rng() % (maxLog2 - minLog2 + 1));
+            uint32_t bytesPerPixel = (rng() % 4 == 0) ? 8 : 4;
+
+            Allocation allocation;
+            if (pool.Allocate(TextureSize(width, height, bytesPerPixel), allocation))
+            {
+                live.push_back(allocation);
+                liveRequested += allocation.size;
+            }
+        }
+        else if (!live.empty())
+        {
+            size_t index = rng() % live.size();
+            pool.Free(live[index]);
+            liveRequested -= live[index].size;
+            live[index] = live.back();
+            live.pop_back();
+        }
+        operations++;
+
+        if (iteration >= 20000 && iteration % 100 == 0)
+        {
+            uint64_t heapBytes, allocatedBytes;
+            float fragmentation;
+            uint32_t reclaimable;
+            pool.GetStats(heapBytes, allocatedBytes, fragmentation, reclaimable);
+
+            // Rounding to power-of-2 blocks, and free space in the heaps, both relative to the live bytes
+            double rounding = double(allocatedBytes) / double(liveRequested) - 1.0;
+            double free = double(heapBytes - allocatedBytes) / double(liveRequested);
+            sumRounding += rounding;
+            sumFree += free;
+            peakFree = std::max(peakFree, free);
+            sumFragmentation += fragmentation;
+            sumReclaimable += reclaimable;
+            peakHeaps = std::max(peakHeaps, uint32_t(pool.heaps.size()));
+            samples++;
+        }
+    }
+    double ms = timer.GetMs();
+
+    printf("%-24s heaps peak %3u | rounding avg %4.1f%% | free avg %5.1f%% peak %5.1f%% | fragmentation avg %.2f | reclaimable heaps avg %4.1f | %.0f ns/op\n",
+        name, peakHeaps, sumRounding / samples * 100.0, sumFree / samples * 100.0, peakFree * 100.0,
+        sumFragmentation / samples, double(sumReclaimable) / samples, ms * 1e6 / operations);
+
+    for (auto& allocation : live)
+        pool.Free(allocation);
+}
+
+int main()
+{
+    Run("square 64-2048, 1 GB", 1024 * MB, 6, 11, true);
+    Run("any 64-2048, 1 GB", 1024 * MB, 6, 11, false);
+    Run("square 256-2048, 2 GB", 2048 * MB, 8, 11, true);
+    Run("small 16-256, 256 MB", 256 * MB, 4, 8, false);
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_BuddyAllocator.h"
+#include <map>
+#include <random>
+
+using namespace NVRHI;
+
+static const uint64_t KB = 1024;
+static const uint64_t MB = 1024 * KB;
+
+static void TestBasics()
+{
+    // A 64 MB heap of 64 KB blocks, like the D3D12 placed resource heaps
+    BuddyAllocator allocator(64 * KB, 10);
+    TEST_CHECK(allocator.GetSize() == 64 * MB);
+    TEST_CHECK(allocator.IsEmpty());
+    TEST_CHECK(allocator.GetNumFreeBlocks() == 1);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == 64 * MB);
+
+    // Sizes round up to a power of 2 times the minimum block
+    uint64_t a = allocator.Allocate(1, 1);
+    TEST_CHECK(a == 0);
+    TEST_CHECK(allocator.GetAllocatedSize() == 64 * KB);
+
+    uint64_t b = allocator.Allocate(100 * KB, 64 * KB);
+    TEST_CHECK(b == 128 * KB);
+    TEST_CHECK(allocator.GetAllocatedSize() == 64 * KB + 128 * KB);
+
+    // The alignment raises the block size: MSAA resources need 4 MB
+    uint64_t c = allocator.Allocate(64 * KB, 4 * MB);
+    TEST_CHECK(c != BuddyAllocator::INVALID_OFFSET && c % (4 * MB) == 0);
+    TEST_CHECK(c == 4 * MB);
+
+    // The lowest free address is preferred, so the hole at 64 KB is reused first
+    uint64_t d = allocator.Allocate(64 * KB, 64 * KB);
+    TEST_CHECK(d == 64 * KB);
+
+    TEST_CHECK(allocator.GetNumAllocations() == 4);
+
+    // Freeing everything merges the buddies back into one block
+    allocator.Free(b);
+    allocator.Free(a);
+    allocator.Free(d);
+    allocator.Free(c);
+    TEST_CHECK(allocator.IsEmpty());
+    TEST_CHECK(allocator.GetAllocatedSize() == 0);
+    TEST_CHECK(allocator.GetNumFreeBlocks() == 1);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == 64 * MB);
+}
+
+static void TestLimits()
+{
+    BuddyAllocator allocator(64 * KB, 10);
+
+    TEST_CHECK(allocator.Allocate(64 * MB + 1, 1) == BuddyAllocator::INVALID_OFFSET);
+    TEST_CHECK(allocator.Allocate(64 * KB, 128 * MB) == BuddyAllocator::INVALID_OFFSET);
+
+    uint64_t whole = allocator.Allocate(64 * MB, 64 * KB);
+    TEST_CHECK(whole == 0);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == 0);
+    TEST_CHECK(allocator.Allocate(64 * KB, 64 * KB) == BuddyAllocator::INVALID_OFFSET);
+
+    // Freeing an unknown offset or freeing twice is ignored
+    allocator.Free(12345);
+    allocator.Free(whole);
+    allocator.Free(whole);
+    TEST_CHECK(allocator.IsEmpty());
+    TEST_CHECK(allocator.GetNumFreeBlocks() == 1);
+}
+
+static void TestBuddiesMergeOnlyWithBuddies()
+{
+    // Two free neighbours that are not buddies stay separate
+    BuddyAllocator allocator(64 * KB, 2);
+
+    uint64_t a = allocator.Allocate(64 * KB, 1);
+    uint64_t b = allocator.Allocate(64 * KB, 1);
+    uint64_t c = allocator.Allocate(64 * KB, 1);
+    uint64_t d = allocator.Allocate(64 * KB, 1);
+    TEST_CHECK(a == 0 && b == 64 * KB && c == 128 * KB && d == 192 * KB);
+
+    allocator.Free(b);
+    allocator.Free(c);
+    TEST_CHECK(allocator.GetNumFreeBlocks() == 2);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == 64 * KB);
+    TEST_CHECK(allocator.Allocate(128 * KB, 1) == BuddyAllocator::INVALID_OFFSET);
+
+    allocator.Free(a);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == 128 * KB);
+
+    allocator.Free(d);
+    TEST_CHECK(allocator.GetNumFreeBlocks() == 1);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == 256 * KB);
+}
+
+// Random allocations and frees, checked against a map of the live ranges
+static void TestRandom(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    BuddyAllocator allocator(64 * KB, 10);
+    std::map<uint64_t, uint64_t> live;  // offset -> requested size
+    uint64_t expectedAllocated = 0;
+    std::map<uint64_t, uint64_t> blockSizes;
+
+    for (int iteration = 0; iteration < 100000; iteration++)
+    {
+        if (rng() % 2 || live.empty())
+        {
+            uint64_t size = 1 + rng() % (4 * MB);
+            uint64_t alignment = (rng() % 4 == 0) ? 4 * MB : 64 * KB;
+            uint64_t offset = allocator.Allocate(size, alignment);
+
+            uint64_t blockSize = 64 * KB;
+            while (blockSize < std::max(size, alignment))
+                blockSize *= 2;
+
+            if (offset == BuddyAllocator::INVALID_OFFSET)
+            {
+                TEST_CHECK(allocator.GetLargestFreeBlock() < blockSize);
+                continue;
+            }
+
+            TEST_CHECK(offset % alignment == 0);
+            TEST_CHECK(offset % blockSize == 0);
+            TEST_CHECK(offset + blockSize <= allocator.GetSize());
+
+            // No overlap with the neighbouring blocks
+            auto next = blockSizes.lower_bound(offset);
+            TEST_CHECK(next == blockSizes.end() || offset + blockSize <= next->first);
+            if (next != blockSizes.begin())
+            {
+                auto previous = std::prev(next);
+                TEST_CHECK(previous->first + previous->second <= offset);
+            }
+
+            live[offset] = size;
+            blockSizes[offset] = blockSize;
+            expectedAllocated += blockSize;
+        }
+        else
+        {
+            auto it = live.begin();
+            std::advance(it, rng() % live.size());
+            allocator.Free(it->first);
+            expectedAllocated -= blockSizes[it->first];
+            blockSizes.erase(it->first);
+            live.erase(it);
+        }
+
+        TEST_CHECK(allocator.GetAllocatedSize() == expectedAllocated);
+        TEST_CHECK(allocator.GetNumAllocations() == live.size());
+    }
+
+    for (auto& allocation : live)
+        allocator.Free(allocation.first);
+
+    TEST_CHECK(allocator.IsEmpty());
+    TEST_CHECK(allocator.GetNumFreeBlocks() == 1);
+    TEST_CHECK(allocator.GetLargestFreeBlock() == allocator.GetSize());
+}
+
+int main()
+{
+    TestBasics();
+    TestLimits();
+    TestBuddiesMergeOnlyWithBuddies();
+
+    for (uint32_t seed = 1; seed <= 4; seed++)
+        TestRandom(seed);
+
+    printf("BuddyAllocatorTest passed\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_ConstantBufferRing.h"
+#include <random>
+#include <vector>
+
+using namespace NVRHI;
+
+static void TestAlignment()
+{
+    ConstantBufferRing ring(4096);
+    ConstantBufferRing::Allocation a;
+
+    // Sizes round up to whole blocks of 16 constants, so every offset can be bound
+    const uint32_t sizes[] = { 1, 16, 255, 256, 257, 1000 };
+    const uint32_t alignedSizes[] = { 256, 256, 256, 256, 512, 1024 };
+    uint32_t offset = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        TEST_CHECK(ring.Allocate(sizes[i], a));
+        TEST_CHECK(a.offset == offset && a.size == alignedSizes[i]);
+        TEST_CHECK(a.offset % ConstantBufferRing::ALIGNMENT == 0);
+        offset += a.size;
+    }
+
+    TEST_CHECK(ring.GetNumAllocations() == 6);
+    TEST_CHECK(ring.GetAllocatedBytes() == offset);
+}
+
+static void TestWrap()
+{
+    ConstantBufferRing ring(1024);
+    ConstantBufferRing::Allocation a;
+
+    // The first allocation discards, the ones after it append without overwriting
+    TEST_CHECK(ring.Allocate(100, a));
+    TEST_CHECK(a.offset == 0 && a.discard && a.generation == 0);
+    TEST_CHECK(ring.Allocate(300, a));
+    TEST_CHECK(a.offset == 256 && !a.discard && a.generation == 0);
+
+    // An allocation that ends exactly at the end of the buffer fits
+    TEST_CHECK(ring.Allocate(256, a));
+    TEST_CHECK(a.offset == 768 && !a.discard);
+    TEST_CHECK(ring.GetGeneration() == 0 && ring.GetNumDiscards() == 1);
+
+    // The next one wraps to a new generation, which discards
+    TEST_CHECK(ring.Allocate(1, a));
+    TEST_CHECK(a.offset == 0 && a.discard && a.generation == 1);
+    TEST_CHECK(ring.GetGeneration() == 1 && ring.GetNumDiscards() == 2);
+
+    // An allocation that does not fit into the rest wraps even if the buffer is mostly free
+    TEST_CHECK(ring.Allocate(1024, a));
+    TEST_CHECK(a.offset == 0 && a.discard && a.generation == 2);
+
+    // Larger than the whole buffer fails and changes nothing
+    TEST_CHECK(!ring.Allocate(1025, a));
+    TEST_CHECK(ring.GetGeneration() == 2 && ring.GetNumAllocations() == 5 && ring.GetNumDiscards() == 3);
+    TEST_CHECK(ring.GetAllocatedBytes() == 256 + 512 + 256 + 256 + 1024);
+
+    // A size that is not a multiple of the alignment leaves the tail unused
+    ConstantBufferRing odd(1000);
+    TEST_CHECK(odd.Allocate(512, a) && odd.Allocate(256, a));
+    TEST_CHECK(a.offset == 512 && a.generation == 0);
+    TEST_CHECK(odd.Allocate(256, a));
+    TEST_CHECK(a.offset == 0 && a.generation == 1);
+    TEST_CHECK(!odd.Allocate(1000, a));
+}
+
+static void TestRandomSizes()
+{
+    // Within one generation the allocations never overlap, so the GPU can still read the earlier ones
+    ConstantBufferRing ring(64 * 1024);
+    ConstantBufferRing::Allocation a;
+    std::mt19937 rng(1);
+
+    uint64_t generation = 0;
+    uint32_t end = 0;
+    uint64_t discards = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        uint32_t size = 1 + rng() % 4096;
+        TEST_CHECK(ring.Allocate(size, a));
+        TEST_CHECK(a.size >= size && a.size < size + ConstantBufferRing::ALIGNMENT);
+        TEST_CHECK(a.offset + a.size <= ring.GetSize());
+
+        if (a.generation != generation || i == 0)
+        {
+            TEST_CHECK(a.generation == generation + (i == 0 ? 0 : 1));
+            TEST_CHECK(a.discard && a.offset == 0);
+            discards++;
+        }
+        else
+        {
+            TEST_CHECK(!a.discard && a.offset == end);
+        }
+
+        generation = a.generation;
+        end = a.offset + a.size;
+    }
+
+    TEST_CHECK(ring.GetNumDiscards() == discards && ring.GetGeneration() == generation);
+}
+
+static void TestGenerations()
+{
+    ConstantBufferRing ring(1024);
+    ConstantBufferRing::Allocation a, b;
+
+    // Nothing is current before the first allocation, since the buffer has not been discarded yet
+    TEST_CHECK(!ring.IsCurrent(0));
+
+    TEST_CHECK(ring.Allocate(16, a));
+    TEST_CHECK(ring.IsCurrent(a.generation));
+
+    // A wrap invalidates the earlier versions: the discard gives the buffer new contents
+    TEST_CHECK(ring.Allocate(1024, b));
+    TEST_CHECK(b.generation == a.generation + 1);
+    TEST_CHECK(!ring.IsCurrent(a.generation) && ring.IsCurrent(b.generation));
+
+    // Reset starts a new generation that is not current until its first allocation has discarded the buffer,
+    // as on a deferred context whose first map must discard
+    ring.Reset();
+    TEST_CHECK(ring.GetGeneration() == b.generation + 1);
+    TEST_CHECK(!ring.IsCurrent(b.generation) && !ring.IsCurrent(ring.GetGeneration()));
+
+    TEST_CHECK(ring.Allocate(16, a));
+    TEST_CHECK(a.offset == 0 && a.discard && a.generation == ring.GetGeneration());
+    TEST_CHECK(ring.IsCurrent(a.generation));
+
+    // Two resets in a row skip a generation without an allocation, and the discard is still pending
+    ring.Reset();
+    ring.Reset();
+    TEST_CHECK(ring.GetGeneration() == a.generation + 2);
+    TEST_CHECK(ring.Allocate(16, b) && b.discard && b.generation == a.generation + 2);
+}
+
+// The D3D11 draw preparation: every constant buffer of a draw is made current before any of them is bound.
+// An upload that wraps invalidates the ones uploaded before it, so the pass repeats until it completes
+// without a wrap.
+struct Version
+{
+    uint32_t size;
+    uint64_t generation;
+    bool uploaded;
+};
+
+static int Prepare(ConstantBufferRing& ring, std::vector<Version>& versions)
+{
+    for (int pass = 1; pass <= 3; pass++)
+    {
+        uint64_t generation = ring.GetGeneration();
+
+        for (Version& version : versions)
+        {
+            if (version.uploaded && ring.IsCurrent(version.generation))
+                continue;
+
+            ConstantBufferRing::Allocation a;
+            TEST_CHECK(ring.Allocate(version.size, a));
+            version.generation = a.generation;
+            version.uploaded = true;
+        }
+
+        if (ring.GetGeneration() == generation)
+            return pass;
+    }
+
+    return 0;
+}
+
+static void TestDrawPreparation()
+{
+    ConstantBufferRing ring(4096);
+    std::vector<Version> versions(3);
+    for (Version& version : versions)
+    {
+        version.size = 1024;
+        version.uploaded = false;
+    }
+
+    // Fits at once
+    TEST_CHECK(Prepare(ring, versions) == 1);
+    for (const Version& version : versions)
+        TEST_CHECK(ring.IsCurrent(version.generation));
+
+    // Unchanged versions are not uploaded again
+    uint64_t allocations = ring.GetNumAllocations();
+    TEST_CHECK(Prepare(ring, versions) == 1);
+    TEST_CHECK(ring.GetNumAllocations() == allocations);
+
+    // The third upload wraps, which invalidates the first two; the second pass uploads them into the new generation
+    versions[0].uploaded = versions[1].uploaded = versions[2].uploaded = false;
+    TEST_CHECK(Prepare(ring, versions) == 2);
+    for (const Version& version : versions)
+        TEST_CHECK(ring.IsCurrent(version.generation) && version.generation == ring.GetGeneration());
+
+    // Buffers that do not fit into the ring together never become current at the same time
+    std::vector<Version> tooLarge(5);
+    for (Version& version : tooLarge)
+    {
+        version.size = 1024;
+        version.uploaded = false;
+    }
+    TEST_CHECK(Prepare(ring, tooLarge) == 0);
+}
+
+int main()
+{
+    TestAlignment();
+    TestWrap();
+    TestRandomSizes();
+    TestGenerations();
+    TestDrawPreparation();
+
+    printf("ConstantBufferRingTest passed\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_FrameContexts.h"
+#include <deque>
+#include <vector>
+
+using namespace NVRHI;
+
+static void TestLimit()
+{
+    FrameContextRing zero(0);
+    TEST_CHECK(zero.GetMaxFramesInFlight() == 1);
+
+    FrameContextRing many(100);
+    TEST_CHECK(many.GetMaxFramesInFlight() == FrameContextRing::MAX_FRAMES_IN_FLIGHT);
+
+    FrameContextRing ring(3);
+    TEST_CHECK(ring.GetMaxFramesInFlight() == 3);
+    ring.SetMaxFramesInFlight(0);
+    TEST_CHECK(ring.GetMaxFramesInFlight() == 1);
+    ring.SetMaxFramesInFlight(9);
+    TEST_CHECK(ring.GetMaxFramesInFlight() == 8);
+}
+
+static void TestFences()
+{
+    FrameContextRing ring(2);
+    TEST_CHECK(ring.GetFrameNumber() == 0 && !ring.IsRecording());
+
+    // The first frames up to the limit do not wait
+    TEST_CHECK(ring.GetFenceToWait() == 0);
+    ring.BeginFrame(0, 0);
+    TEST_CHECK(ring.IsRecording());
+    ring.EndFrame(10, 1000, 5);
+    TEST_CHECK(ring.GetFenceToWait() == 0);
+    ring.BeginFrame(1000, 5);
+    ring.EndFrame(20, 3000, 25);
+    TEST_CHECK(ring.GetFrameNumber() == 2 && !ring.IsRecording());
+
+    // Then every frame waits for the one that is the limit behind it
+    TEST_CHECK(ring.GetFenceToWait() == 10);
+
+    // Usage is the difference of the counters between the beginning and the end of the frame
+    const FrameContextRing::FrameContext& first = ring.GetFrame(0);
+    TEST_CHECK(first.frameNumber == 0 && first.fenceValue == 10);
+    TEST_CHECK(first.uploadBytes == 1000 && first.numDescriptors == 5);
+    const FrameContextRing::FrameContext& second = ring.GetFrame(1);
+    TEST_CHECK(second.frameNumber == 1 && second.fenceValue == 20);
+    TEST_CHECK(second.uploadBytes == 2000 && second.numDescriptors == 20);
+
+    // A frame that is being recorded has no fence yet, so it is never waited for or counted as in flight
+    FrameContextRing::FrameContext& third = ring.BeginFrame(3000, 25);
+    TEST_CHECK(third.frameNumber == 2 && third.fenceValue == 0 && third.uploadBytes == 0);
+    TEST_CHECK(ring.GetFramesInFlight(0) == 2);
+    TEST_CHECK(ring.GetFramesInFlight(10) == 1);
+    TEST_CHECK(ring.GetFramesInFlight(20) == 0);
+
+    // A frame without GPU work signals the same fence as the previous one
+    ring.EndFrame(20, 3000, 25);
+    TEST_CHECK(ring.GetFrame(2).uploadBytes == 0 && ring.GetFrame(2).numDescriptors == 0);
+    TEST_CHECK(ring.GetFenceToWait() == 20);
+    TEST_CHECK(ring.GetFramesInFlight(10) == 2);
+}
+
+static void TestHistory()
+{
+    FrameContextRing ring(8);
+    for (uint64_t frame = 0; frame < 20; frame++)
+    {
+        ring.BeginFrame(frame * 100, frame);
+        ring.EndFrame(frame + 1, (frame + 1) * 100, frame + 1);
+    }
+
+    // The last MAX_FRAMES_IN_FLIGHT frames are kept, whatever the limit is
+    for (uint64_t frame = 12; frame < 20; frame++)
+    {
+        TEST_CHECK(ring.GetFrame(frame).frameNumber == frame);
+        TEST_CHECK(ring.GetFrame(frame).fenceValue == frame + 1);
+    }
+
+    // GetFramesInFlight looks at no more than those
+    TEST_CHECK(ring.GetFramesInFlight(0) == 8);
+    TEST_CHECK(ring.GetFramesInFlight(15) == 5);
+
+    // Lowering the limit waits for a more recent frame right away
+    TEST_CHECK(ring.GetFenceToWait() == 13);
+    ring.SetMaxFramesInFlight(2);
+    TEST_CHECK(ring.GetFenceToWait() == 19);
+
+    // Raising it again waits for an older frame, which is still in the history
+    ring.SetMaxFramesInFlight(5);
+    TEST_CHECK(ring.GetFenceToWait() == 16);
+    TEST_CHECK(ring.GetFrame(15).frameNumber == 15);
+}
+
+// The frame loop of the D3D12 backend with a GPU that is always behind: it finishes frames only when the CPU
+// waits for them. Per-index resources are reused by frameIndex = frameNumber % limit, and the limit changes
+// every 20 frames. Checks that the limit holds and whether a frame index is reused while the GPU uses it.
+static void TestSimulation(bool drainOnLimitChange, bool& indexReusedInFlight)
+{
+    FrameContextRing ring(3);
+    uint64_t completedFence = 0;
+    uint64_t fenceCounter = 0;
+    std::deque<uint64_t> submitted;
+    std::vector<uint64_t> indexLastFence(FrameContextRing::MAX_FRAMES_IN_FLIGHT, 0);
+    indexReusedInFlight = false;
+
+    auto waitForFence = [&](uint64_t fence)
+    {
+        while (completedFence < fence)
+        {
+            completedFence = submitted.front();
+            submitted.pop_front();
+        }
+    };
+
+    const uint32_t limits[] = { 3, 2, 4, 1, 8, 2 };
+    for (uint64_t frame = 0; frame < 120; frame++)
+    {
+        if (frame % 20 == 0)
+        {
+            uint32_t previous = ring.GetMaxFramesInFlight();
+            ring.SetMaxFramesInFlight(limits[frame / 20]);
+
+            if (drainOnLimitChange && ring.GetMaxFramesInFlight() != previous && ring.GetFrameNumber() > 0)
+                waitForFence(ring.GetFrame(ring.GetFrameNumber() - 1).fenceValue);
+        }
+
+        waitForFence(ring.GetFenceToWait());
+
+        ring.BeginFrame(0, 0);
+
+        uint32_t limit = ring.GetMaxFramesInFlight();
+        TEST_CHECK(ring.GetFramesInFlight(completedFence) < limit);
+
+        uint32_t frameIndex = uint32_t(frame % limit);
+        if (indexLastFence[frameIndex] > completedFence)
+            indexReusedInFlight = true;
+
+        fenceCounter++;
+        indexLastFence[frameIndex] = fenceCounter;
+        submitted.push_back(fenceCounter);
+        ring.EndFrame(fenceCounter, 0, 0);
+
+        TEST_CHECK(ring.GetFramesInFlight(completedFence) <= limit);
+    }
+}
+
+static void TestFrameIndex()
+{
+    // With the wait on limit changes that setMaxFramesInFlight does, a frame index is never reused while in flight;
+    // without it, it is, which is why the backend waits
+    bool reused = true;
+    TestSimulation(true, reused);
+    TEST_CHECK(!reused);
+
+    TestSimulation(false, reused);
+    TEST_CHECK(reused);
+}
+
+int main()
+{
+    TestLimit();
+    TestFences();
+    TestHistory();
+    TestFrameIndex();
+
+    printf("FrameContextsTest passed\n");
+    return 0;
+}
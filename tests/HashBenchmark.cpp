@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// Hash::HashBytes against the hashes it replaced: FNV-1a (the old state cache key hash), the table-driven CRC32
+// and the SSE4.2 CRC32 of the old OpenGL framebuffer cache, the last one on x86 CPUs that support it.
+// Throughput for key-sized and blob-sized inputs; each hash is chained into the next so that they do not overlap.
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_Hash.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define HAVE_SSE42_CRC 1
+#else
+#define HAVE_SSE42_CRC 0
+#endif
+
+using namespace NVRHI;
+
+static uint32_t g_CrcTable[256];
+
+static void InitCrcTable()
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        g_CrcTable[i] = crc;
+    }
+}
+
+static uint64_t Fnv1a(const uint8_t* data, size_t size, uint64_t seed)
+{
+    uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+static uint64_t CrcTable(const uint8_t* data, size_t size, uint64_t seed)
+{
+    uint32_t crc = uint32_t(seed);
+    for (size_t i = 0; i < size; i++)
+        crc = g_CrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if HAVE_SSE42_CRC
+// One 32-bit word at a time like the old CrcHash::AddBytesSSE42; the sizes here are multiples of 4
+__attribute__((target("sse4.2")))
+static uint64_t CrcSSE42(const uint8_t* data, size_t size, uint64_t seed)
+{
+    uint32_t crc = uint32_t(seed);
+    for (size_t i = 0; i + 4 <= size; i += 4)
+    {
+        uint32_t word;
+        memcpy(&word, data + i, 4);
+        crc = _mm_crc32_u32(crc, word);
+    }
+    return crc;
+}
+#endif
+
+static uint64_t HashBytes(const uint8_t* data, size_t size, uint64_t seed)
+{
+    return Hash::HashBytes(data, size, seed);
+}
+
+typedef uint64_t(*HashFunction)(const uint8_t*, size_t, uint64_t);
+
+static const size_t TOTAL_BYTES = size_t(1) << 30;
+
+// Returns GB/s
+static double Measure(HashFunction function, const std::vector<uint8_t>& data, size_t size)
+{
+    size_t iterations = TOTAL_BYTES / size;
+    uint64_t seed = 0;
+
+    TestTimer timer;
+    for (size_t i = 0; i < iterations; i++)
+        seed = function(data.data() + (i & 63) * 4, size, seed);
+    double ms = timer.GetMs();
+
+    TEST_CHECK(seed != 1);
+    return double(iterations * size) / (ms * 1e6);
+}
+
+int main()
+{
+    InitCrcTable();
+
+    std::vector<uint8_t> data(4096 + 256);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = uint8_t(i * 131 + 7);
+
+#if HAVE_SSE42_CRC
+    bool sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+
+    printf("bytes    HashBytes      FNV-1a   CRC32 table  CRC32 SSE4.2   (GB/s)\n");
+    for (size_t size : { 8, 16, 32, 48, 64, 128, 256, 1024, 4096 })
+    {
+        double hash = Measure(HashBytes, data, size);
+        double fnv = Measure(Fnv1a, data, size);
+        double table = Measure(CrcTable, data, size);
+        double crc = 0.0;
+#if HAVE_SSE42_CRC
+        if (sse42)
+            crc = Measure(CrcSSE42, data, size);
+#endif
+
+        printf("%5zu %12.2f %11.2f %13.2f", size, hash, fnv, table);
+        if (crc > 0.0)
+            printf(" %13.2f", crc);
+        else
+            printf(" %13s", "-");
+        printf("   %5.1fx the fastest other\n", hash / std::max(std::max(fnv, table), crc));
+    }
+
+    return 0;
+}
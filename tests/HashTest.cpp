@@ -0,0 +1,233 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_Hash.h"
+#include <set>
+#include <vector>
+
+using namespace NVRHI;
+
+static std::vector<uint8_t> MakeInput(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = uint8_t(i * 7 + 1);
+    return data;
+}
+
+// Shader packs and the compiler cache store these values on disk, so they must not change between builds,
+// compilers or platforms. The sizes cover the short path (up to 16 bytes), the 16-byte blocks (up to 48)
+// and the three lanes (above 48), with remainders of every kind.
+static void TestPinnedValues()
+{
+    struct Expected
+    {
+        size_t size;
+        uint64_t unseeded;
+        uint64_t seeded;
+    };
+
+    static const Expected expected[] = {
+        {   0, 0x0409638ee2bde459ull, 0x2b4e3df129b1f482ull },
+        {   1, 0xd5b26ee485f2a92dull, 0x5928bcd3e7fe6870ull },
+        {   2, 0x27cf5787f9bbd02cull, 0x60958047d675ef43ull },
+        {   3, 0xaf4b147f7f316c0aull, 0x13482a342a89238aull },
+        {   4, 0x0bdee9a96d7d3cb2ull, 0x47c67854e25a42cbull },
+        {   7, 0xca605ac870602dc2ull, 0x850ac83d9ff150eaull },
+        {   8, 0x9ac626ab88911893ull, 0xe45505a11eb1c83eull },
+        {  12, 0x9bf8a3f5bcb6ac31ull, 0x92e1d11029b70e47ull },
+        {  16, 0x37f612201427870eull, 0xdb6a3086501d1a2dull },
+        {  17, 0x560763d84ffab150ull, 0xd32eb4baca344aceull },
+        {  31, 0xe66881ccb7a298e2ull, 0xe83186720635c617ull },
+        {  32, 0x9beafbe0061be3f1ull, 0xc65de51cccc66eb1ull },
+        {  48, 0x45b77dc5e6296f55ull, 0xf36ffe35e3e49876ull },
+        {  49, 0x249c35ef0af8c974ull, 0x972233663dbad280ull },
+        {  64, 0x4f14537d0c48dacdull, 0x11e6852b6c1b967aull },
+        {  96, 0x215db7a60d3ebd58ull, 0xbfe2676909a0dfcfull },
+        {  97, 0x12e932f682754589ull, 0xd5a9d4f10fae36adull },
+        { 100, 0xef72716f4468c056ull, 0xcadfdcbfc2e85ecfull },
+        { 144, 0x84031363750239e3ull, 0x3b3ad26103c3c03eull },
+        { 145, 0x34a6c5de6cdb3ca0ull, 0x00b8dfeae202a1a6ull },
+        { 256, 0x56348d8fcf4c9822ull, 0x8a6861f2514714dfull },
+    };
+
+    std::vector<uint8_t> data = MakeInput(256);
+    for (const Expected& e : expected)
+    {
+        TEST_CHECK(Hash::HashBytes(data.data(), e.size) == e.unseeded);
+        TEST_CHECK(Hash::HashBytes(data.data(), e.size, 0x0123456789abcdefull) == e.seeded);
+    }
+
+    Hasher fields;
+    fields.Add(uint8_t(1));
+    fields.Add(uint32_t(2));
+    fields.Add(uint16_t(3));
+    fields.Add(uint64_t(4));
+    fields.Add(1.5f);
+    TEST_CHECK(fields.Get() == 0xe5b64cc967e47a43ull);
+
+    Hasher bytes(7);
+    bytes.AddBytes(data.data(), 100);
+    TEST_CHECK(bytes.Get() == 0x3ccfba8b515c8e54ull);
+}
+
+static void TestInputs()
+{
+    std::vector<uint8_t> data = MakeInput(300);
+    std::set<uint64_t> hashes;
+
+    // Every length gives a different hash, and the bytes after the end are never read
+    for (size_t size = 0; size <= 256; size++)
+    {
+        uint64_t hash = Hash::HashBytes(data.data(), size);
+        TEST_CHECK(hashes.insert(hash).second);
+
+        std::vector<uint8_t> exact(data.begin(), data.begin() + size);
+        TEST_CHECK(Hash::HashBytes(exact.data(), size) == hash);
+
+        std::vector<uint8_t> longer = data;
+        for (size_t i = size; i < longer.size(); i++)
+            longer[i] ^= 0xFF;
+        TEST_CHECK(Hash::HashBytes(longer.data(), size) == hash);
+    }
+
+    // Flipping any single bit changes the hash, in every part of every path
+    for (size_t size : { 3, 8, 16, 40, 48, 100, 145 })
+    {
+        std::set<uint64_t> flipped;
+        flipped.insert(Hash::HashBytes(data.data(), size));
+
+        std::vector<uint8_t> changed(data.begin(), data.begin() + size);
+        for (size_t bit = 0; bit < size * 8; bit++)
+        {
+            changed[bit / 8] ^= uint8_t(1 << (bit % 8));
+            TEST_CHECK(flipped.insert(Hash::HashBytes(changed.data(), size)).second);
+            changed[bit / 8] ^= uint8_t(1 << (bit % 8));
+        }
+    }
+
+    // Zero-filled inputs of different lengths and different seeds are distinguished too
+    std::vector<uint8_t> zeros(100, 0);
+    std::set<uint64_t> zeroHashes;
+    for (size_t size = 0; size <= zeros.size(); size++)
+        TEST_CHECK(zeroHashes.insert(Hash::HashBytes(zeros.data(), size)).second);
+    for (uint64_t seed = 1; seed <= 100; seed++)
+        TEST_CHECK(zeroHashes.insert(Hash::HashBytes(zeros.data(), 16, seed)).second);
+}
+
+struct PaddedKey
+{
+    uint8_t type;       // 3 padding bytes follow
+    uint32_t format;
+    uint16_t mip;       // 6 padding bytes follow
+    uint64_t resource;
+};
+
+static uint64_t HashFields(const PaddedKey& key)
+{
+    Hasher hasher;
+    hasher.Add(key.type);
+    hasher.Add(key.format);
+    hasher.Add(key.mip);
+    hasher.Add(key.resource);
+    return hasher.Get();
+}
+
+static void TestHasher()
+{
+    // The padding bytes do not reach the hash, so equal fields give equal hashes
+    PaddedKey a, b;
+    memset(&a, 0x00, sizeof(a));
+    memset(&b, 0xAB, sizeof(b));
+    a.type = b.type = 2;
+    a.format = b.format = 28;
+    a.mip = b.mip = 5;
+    a.resource = b.resource = 0x12345678;
+
+    TEST_CHECK(HashFields(a) == HashFields(b));
+    TEST_CHECK(Hash::HashBytes(&a, sizeof(a)) != Hash::HashBytes(&b, sizeof(b)));
+
+    // The same as adding the fields from separate variables
+    uint8_t type = 2;
+    uint32_t format = 28;
+    uint16_t mip = 5;
+    uint64_t resource = 0x12345678;
+    Hasher separate;
+    separate.Add(type);
+    separate.Add(format);
+    separate.Add(mip);
+    separate.Add(resource);
+    TEST_CHECK(separate.Get() == HashFields(a));
+
+    // Every field matters
+    b = a;
+    b.mip = 6;
+    TEST_CHECK(HashFields(a) != HashFields(b));
+    b = a;
+    b.resource ^= uint64_t(1) << 63;
+    TEST_CHECK(HashFields(a) != HashFields(b));
+
+    // The order of the fields and their widths matter, not only the values
+    Hasher ab, ba;
+    ab.Add(uint32_t(1));
+    ab.Add(uint32_t(2));
+    ba.Add(uint32_t(2));
+    ba.Add(uint32_t(1));
+    TEST_CHECK(ab.Get() != ba.Get());
+
+    Hasher narrow, wide, split;
+    narrow.Add(uint32_t(1));
+    wide.Add(uint64_t(1));
+    split.Add(uint16_t(1));
+    split.Add(uint16_t(0));
+    TEST_CHECK(narrow.Get() != wide.Get() && narrow.Get() != split.Get());
+
+    // Enums and pointers are scalars; a pointer hashes like its address
+    enum Mode { MODE_A = 3 };
+    int object = 0;
+    int* pointer = &object;
+    Hasher byEnum, byValue, byPointer, byAddress;
+    byEnum.Add(MODE_A);
+    byValue.Add(int(3));
+    byPointer.Add(pointer);
+    byAddress.Add(uintptr_t(pointer));
+    TEST_CHECK(byEnum.Get() == byValue.Get());
+    TEST_CHECK(byPointer.Get() == byAddress.Get());
+
+    // The seed changes the result, and Get does not change the state
+    Hasher seeded(1);
+    seeded.Add(uint32_t(1));
+    TEST_CHECK(seeded.Get() != narrow.Get());
+    TEST_CHECK(seeded.Get() == seeded.Get());
+
+    // Each AddBytes is one HashBytes seeded with the state, so the split of the bytes matters; an empty one still counts
+    std::vector<uint8_t> data = MakeInput(64);
+    Hasher chained;
+    chained.AddBytes(data.data(), 20);
+    chained.AddBytes(data.data() + 20, 44);
+    Hasher whole;
+    whole.AddBytes(data.data(), 64);
+    TEST_CHECK(chained.Get() != whole.Get());
+
+    Hasher empty, none;
+    empty.AddBytes(nullptr, 0);
+    TEST_CHECK(empty.Get() != none.Get());
+}
+
+int main()
+{
+    TestPinnedValues();
+    TestInputs();
+    TestHasher();
+
+    printf("HashTest passed\n");
+    return 0;
+}
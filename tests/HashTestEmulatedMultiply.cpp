@@ -0,0 +1,15 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// HashTest with the emulated 64x64->128 bit multiply that 32-bit targets use, so that the pinned values
+// are checked for that path as well
+
+#undef __SIZEOF_INT128__
+#include "HashTest.cpp"
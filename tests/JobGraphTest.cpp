@@ -0,0 +1,155 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "JobGraph.h"
+#include <atomic>
+
+// The shape of SceneRenderer::AllocateResources: main-thread shader creation, and two compilations on workers
+// that must not overlap because IShaderCompiler is not known to be thread-safe. With finishCompiles, the finish jobs
+// compile as well, like FinishShaderSet does when a pack binary fails to load.
+static void TestShaderWarmup(uint32_t workerCount, bool finishCompiles)
+{
+    JobGraph jobs;
+    std::thread::id mainThread = std::this_thread::get_id();
+    std::atomic<int> order(0);
+    std::atomic<int> compilersRunning(0);
+    std::atomic<bool> overlapped(false);
+    std::atomic<bool> mainThreadOnly(true);
+    int vsOrder = -1, gsOrder = -1, psOrder = -1, finishGSOrder = -1, finishPSOrder = -1;
+
+    auto compile = [&](int& outOrder)
+    {
+        if (compilersRunning++ != 0)
+            overlapped = true;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        outOrder = order++;
+        compilersRunning--;
+        return true;
+    };
+
+    auto createOnMainThread = [&]()
+    {
+        if (std::this_thread::get_id() != mainThread)
+            mainThreadOnly = false;
+        return true;
+    };
+
+    auto finish = [&](int& outOrder)
+    {
+        createOnMainThread();
+        return finishCompiles ? compile(outOrder) : true;
+    };
+
+    JobGraph::JobId vsJob = jobs.Add("DefaultVS", [&]() { vsOrder = order++; return createOnMainThread(); }, JobGraph::MAIN_THREAD);
+    jobs.Add("BlitPS", createOnMainThread, JobGraph::MAIN_THREAD);
+    JobGraph::JobId prepareGS = jobs.Add("PrepareVoxelizationGS", [&]() { return compile(gsOrder); });
+    JobGraph::JobId finishGS = jobs.Add("FinishVoxelizationGS", [&]() { return finish(finishGSOrder); }, JobGraph::MAIN_THREAD);
+    JobGraph::JobId preparePS = jobs.Add("PrepareVoxelizationPS", [&]() { return compile(psOrder); });
+    JobGraph::JobId finishPS = jobs.Add("FinishVoxelizationPS", [&]() { return finish(finishPSOrder); }, JobGraph::MAIN_THREAD);
+
+    jobs.AddDependency(prepareGS, vsJob);
+    jobs.AddDependency(finishGS, prepareGS);
+    jobs.AddDependency(finishPS, preparePS);
+    jobs.AddDependency(preparePS, prepareGS);
+    jobs.AddDependency(finishGS, preparePS);
+
+    TEST_CHECK(jobs.Run(workerCount));
+    TEST_CHECK(!overlapped);
+    TEST_CHECK(mainThreadOnly);
+    TEST_CHECK(vsOrder < gsOrder && gsOrder < psOrder);
+    if (finishCompiles)
+        TEST_CHECK(psOrder < finishGSOrder && psOrder < finishPSOrder);
+
+    for (const JobGraph::JobTiming& timing : jobs.GetTimings())
+    {
+        TEST_CHECK(timing.succeeded && !timing.skipped);
+        TEST_CHECK(timing.mainThread == (workerCount == 0 || timing.name.compare(0, 7, "Prepare") != 0));
+    }
+}
+
+static void TestFailureSkipsDependents(uint32_t workerCount)
+{
+    JobGraph jobs;
+    std::atomic<int> ran(0);
+
+    JobGraph::JobId failing = jobs.Add("Failing", []() { return false; });
+    JobGraph::JobId dependent = jobs.Add("Dependent", [&]() { ran++; return true; });
+    JobGraph::JobId indirect = jobs.Add("Indirect", [&]() { ran++; return true; }, JobGraph::MAIN_THREAD);
+    jobs.Add("Independent", []() { return true; });
+
+    jobs.AddDependency(dependent, failing);
+    jobs.AddDependency(indirect, dependent);
+
+    TEST_CHECK(!jobs.Run(workerCount));
+    TEST_CHECK(ran == 0);
+
+    const std::vector<JobGraph::JobTiming>& timings = jobs.GetTimings();
+    TEST_CHECK(!timings[0].succeeded && !timings[0].skipped);
+    TEST_CHECK(timings[1].skipped && timings[2].skipped);
+    TEST_CHECK(timings[3].succeeded);
+}
+
+static void TestCycle(uint32_t workerCount)
+{
+    JobGraph jobs;
+    bool ran = false;
+
+    JobGraph::JobId a = jobs.Add("A", [&]() { ran = true; return true; });
+    JobGraph::JobId b = jobs.Add("B", [&]() { ran = true; return true; });
+    jobs.AddDependency(a, b);
+    jobs.AddDependency(b, a);
+
+    TEST_CHECK(!jobs.Run(workerCount));
+    TEST_CHECK(!ran);
+}
+
+static void TestWideGraph(uint32_t workerCount)
+{
+    // Every job of the second layer depends on all jobs of the first one
+    JobGraph jobs;
+    std::atomic<int> firstLayerDone(0);
+    std::atomic<bool> startedEarly(false);
+
+    std::vector<JobGraph::JobId> firstLayer;
+    for (int i = 0; i < 16; i++)
+        firstLayer.push_back(jobs.Add("First", [&]() { firstLayerDone++; return true; }, (i & 1) ? JobGraph::MAIN_THREAD : JobGraph::ANY_THREAD));
+
+    for (int i = 0; i < 16; i++)
+    {
+        JobGraph::JobId job = jobs.Add("Second", [&]() { if (firstLayerDone != 16) startedEarly = true; return true; });
+        for (JobGraph::JobId dependency : firstLayer)
+            jobs.AddDependency(job, dependency);
+    }
+
+    TEST_CHECK(jobs.Run(workerCount));
+    TEST_CHECK(!startedEarly);
+}
+
+int main()
+{
+    for (uint32_t workerCount : { 0u, 1u, 2u, 4u })
+    {
+        for (int repeat = 0; repeat < 50; repeat++)
+        {
+            TestShaderWarmup(workerCount, false);
+            TestShaderWarmup(workerCount, true);
+            TestFailureSkipsDependents(workerCount);
+            TestCycle(workerCount);
+            TestWideGraph(workerCount);
+        }
+    }
+
+    JobGraph empty;
+    TEST_CHECK(empty.Run(2));
+
+    printf("JobGraphTest passed\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_MemoryBarriers.h"
+
+using namespace NVRHI;
+
+// The values of the GL barrier bits that the OpenGL backend uses
+static const uint32_t FETCH = 0x00000008;      // GL_TEXTURE_FETCH_BARRIER_BIT
+static const uint32_t IMAGE = 0x00000020;      // GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+static const uint32_t COMMAND = 0x00000040;    // GL_COMMAND_BARRIER_BIT
+static const uint32_t STORAGE = 0x00002000;    // GL_SHADER_STORAGE_BARRIER_BIT
+
+static void TestBitSelection()
+{
+    MemoryBarrierTracker tracker;
+    ShaderWriteState texture, other;
+
+    // Resources that were never written need no barriers
+    tracker.Require(texture, FETCH | IMAGE, false);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // Command 2 writes the texture as an image
+    tracker.Require(texture, IMAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // Only the bits of the following accesses are issued, each one once
+    tracker.Require(texture, FETCH, false);
+    tracker.Require(other, IMAGE, false);
+    TEST_CHECK(tracker.GetRequiredBarrierBits() == FETCH);
+    TEST_CHECK(tracker.Flush() == FETCH);
+
+    tracker.Require(texture, FETCH, false);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // A different kind of access still needs its own bit
+    tracker.Require(texture, IMAGE | FETCH, false);
+    TEST_CHECK(tracker.Flush() == IMAGE);
+
+    // An access with several bits gets all of those that are not covered yet
+    tracker.Require(texture, IMAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(texture, FETCH | IMAGE | COMMAND, false);
+    TEST_CHECK(tracker.Flush() == (FETCH | IMAGE | COMMAND));
+
+    // Accesses to several resources in one command are combined into one barrier
+    tracker.Require(texture, IMAGE, true);
+    tracker.Require(other, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(texture, FETCH, false);
+    tracker.Require(other, COMMAND, false);
+    TEST_CHECK(tracker.Flush() == (FETCH | COMMAND));
+
+    TEST_CHECK(tracker.GetCommandIndex() == 10);
+}
+
+static void TestSameCommand()
+{
+    MemoryBarrierTracker tracker;
+    ShaderWriteState texture;
+
+    // A draw that reads and writes the same resource needs no barrier for its own write
+    tracker.Require(texture, IMAGE, true);
+    tracker.Require(texture, FETCH | IMAGE, false);
+    TEST_CHECK(tracker.GetRequiredBarrierBits() == 0);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // The next one reads the write of the previous one and writes again
+    tracker.Require(texture, FETCH, false);
+    tracker.Require(texture, IMAGE, true);
+    TEST_CHECK(tracker.Flush() == (FETCH | IMAGE));
+
+    // The barrier before a command does not cover the writes of that command
+    tracker.Require(texture, FETCH, false);
+    TEST_CHECK(tracker.Flush() == FETCH);
+
+    // The order of the accesses within a command does not matter: a read after the write of the same command
+    // still sees the write of the command before
+    tracker.Require(texture, IMAGE, true);
+    TEST_CHECK(tracker.Flush() == IMAGE);
+    tracker.Require(texture, IMAGE, true);
+    tracker.Require(texture, FETCH, false);
+    TEST_CHECK(tracker.Flush() == (IMAGE | FETCH));
+
+    // Several writes in one command keep the write before the command
+    tracker.Require(texture, IMAGE, true);
+    tracker.Require(texture, STORAGE, true);
+    tracker.Require(texture, FETCH, false);
+    TEST_CHECK(tracker.Flush() == (IMAGE | STORAGE | FETCH));
+}
+
+static void TestUavBarriersDisabled()
+{
+    MemoryBarrierTracker tracker;
+    ShaderWriteState buffer;
+
+    // With barriers enabled, every dispatch that writes a buffer waits for the previous one
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == STORAGE);
+
+    // With them disabled, the first UAV access in the group still waits for the writes before the group,
+    // and the ones after it may overlap
+    buffer.SetEnableUavBarriers(false);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == STORAGE);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // Other accesses are not part of the group and see the writes of the group
+    tracker.Require(buffer, FETCH, false);
+    TEST_CHECK(tracker.Flush() == FETCH);
+
+    // Disabling again starts a new group
+    buffer.SetEnableUavBarriers(false);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == STORAGE);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // Enabling them makes the next dispatch wait for the group
+    buffer.SetEnableUavBarriers(true);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == STORAGE);
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == STORAGE);
+
+    // A disabled resource does not affect other resources
+    ShaderWriteState disabled, enabled;
+    disabled.SetEnableUavBarriers(false);
+    tracker.Require(disabled, STORAGE, true);
+    tracker.Require(enabled, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(disabled, STORAGE, true);
+    tracker.Require(enabled, IMAGE, true);
+    TEST_CHECK(tracker.Flush() == IMAGE);
+}
+
+static void TestFlushAll()
+{
+    MemoryBarrierTracker tracker;
+    ShaderWriteState texture, buffer;
+
+    // Nothing was written
+    TEST_CHECK(!tracker.FlushAll());
+    tracker.Require(texture, FETCH, false);
+    TEST_CHECK(!tracker.FlushAll());
+    TEST_CHECK(tracker.GetCommandIndex() == 3);
+
+    // After a write, one full barrier covers every kind of access
+    tracker.Require(texture, IMAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    TEST_CHECK(tracker.FlushAll());
+    TEST_CHECK(!tracker.FlushAll());
+
+    tracker.Require(texture, FETCH | IMAGE | COMMAND | STORAGE, false);
+    TEST_CHECK(tracker.Flush() == 0);
+
+    // A barrier with some of the bits does not make the write visible to everything
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(buffer, FETCH, false);
+    TEST_CHECK(tracker.Flush() == FETCH);
+    TEST_CHECK(tracker.FlushAll());
+
+    // The bits required by the current command are replaced by the full barrier
+    tracker.Require(buffer, STORAGE, true);
+    TEST_CHECK(tracker.Flush() == 0);
+    tracker.Require(buffer, FETCH, false);
+    TEST_CHECK(tracker.GetRequiredBarrierBits() == FETCH);
+    TEST_CHECK(tracker.FlushAll());
+    TEST_CHECK(tracker.GetRequiredBarrierBits() == 0);
+    tracker.Require(buffer, FETCH, false);
+    TEST_CHECK(tracker.Flush() == 0);
+}
+
+int main()
+{
+    TestBitSelection();
+    TestSameCommand();
+    TestUavBarriersDisabled();
+    TestFlushAll();
+
+    printf("MemoryBarriersTest passed\n");
+    return 0;
+}
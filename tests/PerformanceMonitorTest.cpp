@@ -0,0 +1,365 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_PerformanceMonitor.h"
+#include <string.h>
+#include <unistd.h>
+
+using namespace VXGI;
+
+// Implements only the performance queries: the handles are addresses in an array, and each query returns
+// the time that the test assigned to it, by creation order
+class QueryRenderer : public NVRHI::IRendererInterface
+{
+public:
+    enum { MAX_QUERIES = 64 };
+
+    std::vector<std::string> names;
+    std::vector<float> times;
+    std::string log;                // "b<index> " and "e<index> " for every begin and end
+    uint32_t destroyed;
+    uint32_t timeReads;
+
+    QueryRenderer() : destroyed(0), timeReads(0) { }
+    virtual ~QueryRenderer() { }
+
+    int GetIndex(NVRHI::PerformanceQueryHandle query) const { return int((char*)query - m_Objects); }
+
+    virtual NVRHI::PerformanceQueryHandle createPerformanceQuery(const char* name) override
+    {
+        TEST_CHECK(names.size() < MAX_QUERIES);
+        names.push_back(name);
+        times.push_back(0.f);
+        return (NVRHI::PerformanceQueryHandle)&m_Objects[names.size() - 1];
+    }
+
+    virtual void destroyPerformanceQuery(NVRHI::PerformanceQueryHandle) override { destroyed++; }
+    virtual void beginPerformanceQuery(NVRHI::PerformanceQueryHandle query, bool) override { log += "b" + std::to_string(GetIndex(query)) + " "; }
+    virtual void endPerformanceQuery(NVRHI::PerformanceQueryHandle query) override { log += "e" + std::to_string(GetIndex(query)) + " "; }
+    virtual float getPerformanceQueryTimeMS(NVRHI::PerformanceQueryHandle query) override { timeReads++; return times[GetIndex(query)]; }
+
+    virtual NVRHI::TextureHandle createTexture(const NVRHI::TextureDesc&, const void*) override { return nullptr; }
+    virtual NVRHI::TextureDesc describeTexture(NVRHI::TextureHandle) override { return NVRHI::TextureDesc(); }
+    virtual void clearTextureFloat(NVRHI::TextureHandle, const NVRHI::Color&) override { }
+    virtual void clearTextureUInt(NVRHI::TextureHandle, uint32_t) override { }
+    virtual void writeTexture(NVRHI::TextureHandle, uint32_t, const void*, uint32_t, uint32_t) override { }
+    virtual void destroyTexture(NVRHI::TextureHandle) override { }
+    virtual NVRHI::BufferHandle createBuffer(const NVRHI::BufferDesc&, const void*) override { return nullptr; }
+    virtual void writeBuffer(NVRHI::BufferHandle, const void*, size_t) override { }
+    virtual void clearBufferUInt(NVRHI::BufferHandle, uint32_t) override { }
+    virtual void copyToBuffer(NVRHI::BufferHandle, uint32_t, NVRHI::BufferHandle, uint32_t, size_t) override { }
+    virtual void readBuffer(NVRHI::BufferHandle, void*, size_t*) override { }
+    virtual void destroyBuffer(NVRHI::BufferHandle) override { }
+    virtual NVRHI::ConstantBufferHandle createConstantBuffer(const NVRHI::ConstantBufferDesc&, const void*) override { return nullptr; }
+    virtual void writeConstantBuffer(NVRHI::ConstantBufferHandle, const void*, size_t) override { }
+    virtual void destroyConstantBuffer(NVRHI::ConstantBufferHandle) override { }
+    virtual NVRHI::ShaderHandle createShader(const NVRHI::ShaderDesc&, const void*, const size_t) override { return nullptr; }
+    virtual void destroyShader(NVRHI::ShaderHandle) override { }
+    virtual NVRHI::SamplerHandle createSampler(const NVRHI::SamplerDesc&) override { return nullptr; }
+    virtual void destroySampler(NVRHI::SamplerHandle) override { }
+    virtual NVRHI::InputLayoutHandle createInputLayout(const NVRHI::VertexAttributeDesc*, uint32_t, const void*, const size_t) override { return nullptr; }
+    virtual void destroyInputLayout(NVRHI::InputLayoutHandle) override { }
+    virtual NVRHI::GraphicsAPI::Enum getGraphicsAPI() override { return NVRHI::GraphicsAPI::D3D11; }
+    virtual void* getAPISpecificInterface(NVRHI::APISpecificInterface::Enum) override { return nullptr; }
+    virtual NVRHI::ShaderHandle createShaderFromAPIInterface(NVRHI::ShaderType::Enum, const void*) override { return nullptr; }
+    virtual bool isOpenGLExtensionSupported(const char*) override { return false; }
+    virtual void* getOpenGLProcAddress(const char*) override { return nullptr; }
+    virtual void draw(const NVRHI::DrawCallState&, const NVRHI::DrawArguments*, uint32_t) override { }
+    virtual void drawIndexed(const NVRHI::DrawCallState&, const NVRHI::DrawArguments*, uint32_t) override { }
+    virtual void drawIndirect(const NVRHI::DrawCallState&, NVRHI::BufferHandle, uint32_t) override { }
+    virtual void dispatch(const NVRHI::DispatchState&, uint32_t, uint32_t, uint32_t) override { }
+    virtual void dispatchIndirect(const NVRHI::DispatchState&, NVRHI::BufferHandle, uint32_t) override { }
+    virtual void executeRenderThreadCommand(NVRHI::IRenderThreadCommand*) override { }
+    virtual uint32_t getNumberOfAFRGroups() override { return 1; }
+    virtual uint32_t getAFRGroupOfCurrentFrame(uint32_t) override { return 0; }
+    virtual void setEnableUavBarriersForTexture(NVRHI::TextureHandle, bool) override { }
+    virtual void setEnableUavBarriersForBuffer(NVRHI::BufferHandle, bool) override { }
+
+private:
+    char m_Objects[MAX_QUERIES];
+};
+
+static bool Contains(const std::string& text, const std::string& part)
+{
+    return text.find(part) != std::string::npos;
+}
+
+static void TestNesting()
+{
+    PerformanceMonitor monitor(nullptr);
+
+    // Sections outside of a frame are ignored, and so are their children
+    monitor.beginSection("Outside");
+    monitor.beginSection("Child");
+    monitor.endSection();
+    monitor.endSection();
+
+    monitor.beginFrame();
+    TEST_CHECK(monitor.getFrameIndex() == 0);
+    {
+        PerformanceMonitor::Scope a(&monitor, "A");
+        {
+            PerformanceMonitor::Scope b(&monitor, "B");
+            PerformanceMonitor::Scope c(&monitor, "C");
+        }
+        PerformanceMonitor::Scope b(&monitor, "B");
+    }
+    PerformanceMonitor::Scope nullScope(nullptr, "Null");
+
+    // An unmatched endSection does nothing; open sections are closed by endFrame
+    monitor.endSection();
+    monitor.beginSection("D");
+    monitor.beginSection(nullptr);
+    monitor.endFrame();
+    TEST_CHECK(monitor.getFrameIndex() == 1);
+
+    // Without a renderer the frame is still only resolved FRAME_LATENCY frames later
+    TEST_CHECK(monitor.getHistory().empty() && monitor.getLastFrame() == nullptr);
+    monitor.flush();
+    TEST_CHECK(monitor.getHistory().size() == 1);
+
+    const PerformanceMonitor::Frame& frame = *monitor.getLastFrame();
+    TEST_CHECK(frame.index == 0);
+    TEST_CHECK(frame.sections.size() == 6);
+
+    const char* paths[] = { "A", "A/B", "A/B/C", "A/B", "D", "D/" };
+    const int32_t parents[] = { -1, 0, 1, 0, -1, 4 };
+    const uint32_t depths[] = { 0, 1, 2, 1, 0, 1 };
+    for (size_t i = 0; i < frame.sections.size(); i++)
+    {
+        const PerformanceMonitor::Section& section = frame.sections[i];
+        TEST_CHECK(section.path == paths[i]);
+        TEST_CHECK(section.parent == parents[i] && section.depth == depths[i]);
+        TEST_CHECK(section.gpuMs < 0.0 && section.smoothedGpuMs < 0.0);
+        TEST_CHECK(section.cpuMs >= 0.0 && section.cpuStartMs >= frame.cpuStartMs);
+        TEST_CHECK(section.cpuStartMs + section.cpuMs <= frame.cpuStartMs + frame.cpuMs + 1e-6);
+    }
+    TEST_CHECK(frame.sections[1].name == "B" && frame.sections[5].name.empty());
+
+    // Children lie within their parents
+    for (const PerformanceMonitor::Section& section : frame.sections)
+    {
+        if (section.parent < 0)
+            continue;
+        const PerformanceMonitor::Section& parent = frame.sections[section.parent];
+        TEST_CHECK(section.cpuStartMs >= parent.cpuStartMs);
+        TEST_CHECK(section.cpuStartMs + section.cpuMs <= parent.cpuStartMs + parent.cpuMs + 1e-6);
+    }
+
+    // An unbalanced section that started outside of a frame hides the sections until it ends
+    monitor.beginSection("Outside");
+    monitor.beginFrame();
+    monitor.beginSection("Hidden");
+    monitor.endSection();
+    monitor.endSection();
+    monitor.beginSection("Visible");
+    monitor.endSection();
+    monitor.flush();
+    TEST_CHECK(monitor.getLastFrame()->index == 1);
+    TEST_CHECK(monitor.getLastFrame()->sections.size() == 1 && monitor.getLastFrame()->sections[0].path == "Visible");
+}
+
+static void RecordFrame(PerformanceMonitor& monitor)
+{
+    monitor.beginFrame();
+    monitor.beginSection("Outer");
+    monitor.beginSection("Pass");
+    monitor.endSection();
+    monitor.beginSection("Pass");
+    monitor.endSection();
+    monitor.endSection();
+    monitor.endFrame();
+}
+
+static void TestQueries()
+{
+    QueryRenderer renderer;
+    {
+        PerformanceMonitor monitor(&renderer);
+        monitor.setSmoothingFactor(0.5);
+
+        // Each occurrence of a path gets its own query, nested like the sections
+        RecordFrame(monitor);
+        TEST_CHECK(renderer.names.size() == 3);
+        TEST_CHECK(renderer.names[0] == "Outer" && renderer.names[1] == "Pass" && renderer.names[2] == "Pass");
+        TEST_CHECK(renderer.log == "b0 b1 e1 b2 e2 e0 ");
+
+        // Every frame slot has its own queries; the results are not read until FRAME_LATENCY frames later
+        for (int i = 1; i < PerformanceMonitor::FRAME_LATENCY; i++)
+            RecordFrame(monitor);
+        TEST_CHECK(renderer.names.size() == 3 * PerformanceMonitor::FRAME_LATENCY);
+        TEST_CHECK(renderer.timeReads == 0 && monitor.getHistory().empty());
+
+        // Query 3 * slot + 1 is the first "Pass" of that slot's frames, 3 * slot + 2 the second
+        for (size_t i = 0; i < renderer.times.size(); i++)
+            renderer.times[i] = (i % 3 == 0) ? 10.f : (i % 3 == 1) ? 1.f : 3.f;
+
+        // The next frame reuses the slot of frame 0, which resolves it first
+        monitor.beginFrame();
+        TEST_CHECK(renderer.timeReads == 3);
+        TEST_CHECK(monitor.getHistory().size() == 1 && monitor.getLastFrame()->index == 0);
+
+        const PerformanceMonitor::Frame* frame = monitor.getLastFrame();
+        TEST_CHECK(frame->sections[0].gpuMs == 10.0 && frame->sections[1].gpuMs == 1.0 && frame->sections[2].gpuMs == 3.0);
+
+        // The repeated path is averaged per occurrence
+        TEST_CHECK(frame->sections[1].smoothedGpuMs == 1.0 && frame->sections[2].smoothedGpuMs == 3.0);
+
+        monitor.endFrame();
+        renderer.log.clear();
+        renderer.times[1] = 2.f;
+        renderer.times[2] = 5.f;
+
+        // Frame 5 reuses the queries of frame 1 and creates no new ones
+        RecordFrame(monitor);
+        TEST_CHECK(renderer.names.size() == 3 * PerformanceMonitor::FRAME_LATENCY);
+        TEST_CHECK(renderer.log == "b3 b4 e4 b5 e5 e3 ");
+
+        // Frame 4 had no sections, so its slot's queries are read again only for frame 8
+        monitor.flush();
+        TEST_CHECK(monitor.getHistory().size() == 6);
+        for (size_t i = 0; i < monitor.getHistory().size(); i++)
+            TEST_CHECK(monitor.getHistory()[i].index == i);
+
+        TEST_CHECK(monitor.getHistory()[4].sections.empty());
+        TEST_CHECK(monitor.getHistory()[5].sections[1].gpuMs == 1.0 && monitor.getHistory()[5].sections[1].smoothedGpuMs == 1.0);
+
+        RecordFrame(monitor);
+        RecordFrame(monitor);
+        RecordFrame(monitor);
+        monitor.flush();
+
+        // Frame 8 uses slot 0 again, whose queries now return 2 and 5: the averages move halfway
+        const PerformanceMonitor::Frame& last = *monitor.getLastFrame();
+        TEST_CHECK(last.index == 8);
+        TEST_CHECK(last.sections[1].gpuMs == 2.0 && last.sections[2].gpuMs == 5.0);
+        TEST_CHECK(last.sections[1].smoothedGpuMs == 1.5 && last.sections[2].smoothedGpuMs == 4.0);
+        TEST_CHECK(last.sections[0].smoothedGpuMs == 10.0);
+    }
+
+    // The monitor destroys all of its queries
+    TEST_CHECK(renderer.destroyed == renderer.names.size());
+}
+
+static void TestHistorySize()
+{
+    PerformanceMonitor limited(nullptr, 3);
+    for (int i = 0; i < 5; i++)
+        RecordFrame(limited);
+    limited.flush();
+
+    TEST_CHECK(limited.getHistory().size() == 3);
+    TEST_CHECK(limited.getHistory().front().index == 2 && limited.getLastFrame()->index == 4);
+
+    PerformanceMonitor none(nullptr, 0);
+    RecordFrame(none);
+    none.flush();
+    TEST_CHECK(none.getHistory().empty() && none.getLastFrame() == nullptr);
+
+    // flush ends the frame in progress
+    PerformanceMonitor open(nullptr);
+    open.beginFrame();
+    open.beginSection("Open");
+    open.flush();
+    TEST_CHECK(open.getFrameIndex() == 1 && open.getHistory().size() == 1);
+    TEST_CHECK(open.getLastFrame()->sections.size() == 1);
+}
+
+static void TestExport()
+{
+    QueryRenderer renderer;
+    PerformanceMonitor monitor(&renderer);
+
+    monitor.beginFrame();
+    monitor.beginSection("Quote\"Back\\slash");
+    monitor.beginSection("Comma, \"quoted\"");
+    monitor.endSection();
+    monitor.beginSection("Line\nbreak\x01");
+    monitor.endSection();
+    monitor.endSection();
+    monitor.endFrame();
+
+    // Only the first section has a GPU time
+    renderer.times[0] = 0.25f;
+    renderer.times[1] = -1.f;
+    renderer.times[2] = -1.f;
+    monitor.flush();
+
+    std::string trace;
+    monitor.formatChromeTrace(trace);
+    TEST_CHECK(trace.compare(0, 16, "{\"traceEvents\":[") == 0);
+    TEST_CHECK(trace.compare(trace.size() - 4, 4, "\n]}\n") == 0);
+    TEST_CHECK(Contains(trace, "{\"name\":\"Frame 0\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+    TEST_CHECK(Contains(trace, "{\"name\":\"Quote\\\"Back\\\\slash\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+    TEST_CHECK(Contains(trace, "{\"name\":\"Quote\\\"Back\\\\slash\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"));
+    TEST_CHECK(Contains(trace, ",\"dur\":250.000,\"args\":{\"path\":\"Quote\\\"Back\\\\slash\"}}"));
+    TEST_CHECK(Contains(trace, "\"args\":{\"path\":\"Quote\\\"Back\\\\slash/Comma, \\\"quoted\\\"\"}}"));
+    TEST_CHECK(Contains(trace, "{\"name\":\"Line\\u000abreak\\u0001\","));
+    TEST_CHECK(trace.find("\"cat\":\"gpu\"") == trace.rfind("\"cat\":\"gpu\""));
+
+    // Raw control characters never reach the JSON
+    TEST_CHECK(trace.find('\x01') == std::string::npos && trace.find("Line\n") == std::string::npos);
+
+    std::string csv;
+    monitor.formatCSV(csv);
+    const char* header = "frame,section,depth,cpuStartMs,cpuMs,gpuMs,smoothedCpuMs,smoothedGpuMs\n";
+    TEST_CHECK(csv.compare(0, strlen(header), header) == 0);
+    TEST_CHECK(Contains(csv, "\n0,\"Quote\"\"Back\\slash\",0,"));
+    TEST_CHECK(Contains(csv, "\n0,\"Quote\"\"Back\\slash/Comma, \"\"quoted\"\"\",1,"));
+    TEST_CHECK(Contains(csv, "\n0,\"Quote\"\"Back\\slash/Line\nbreak\x01\",1,"));
+    TEST_CHECK(Contains(csv, ",0.2500,"));
+
+    // The sections without a GPU time have two empty fields, gpuMs and smoothedGpuMs, which ends their rows with a comma
+    size_t emptyFields = 0;
+    size_t rowEnds = 0;
+    for (size_t i = 1; i < csv.size(); i++)
+    {
+        emptyFields += (csv[i - 1] == ',' && csv[i] == ',') ? 1 : 0;
+        rowEnds += (csv[i - 1] == ',' && csv[i] == '\n') ? 1 : 0;
+    }
+    TEST_CHECK(emptyFields == 2 && rowEnds == 2);
+
+    // The files contain the formatted text
+    char path[] = "/tmp/PerformanceMonitorTest.XXXXXX";
+    int fd = mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    close(fd);
+
+    TEST_CHECK(monitor.writeCSV(path));
+    FILE* file = fopen(path, "rb");
+    TEST_CHECK(file != nullptr);
+    std::string written(csv.size() + 1, '\0');
+    written.resize(fread(&written[0], 1, written.size(), file));
+    fclose(file);
+    TEST_CHECK(written == csv);
+
+    TEST_CHECK(monitor.writeChromeTrace(path));
+    file = fopen(path, "rb");
+    TEST_CHECK(file != nullptr);
+    written.assign(trace.size() + 1, '\0');
+    written.resize(fread(&written[0], 1, written.size(), file));
+    fclose(file);
+    TEST_CHECK(written == trace);
+
+    remove(path);
+    TEST_CHECK(!monitor.writeCSV("/nonexistent/PerformanceMonitorTest.csv"));
+}
+
+int main()
+{
+    TestNesting();
+    TestQueries();
+    TestHistorySize();
+    TestExport();
+
+    printf("PerformanceMonitorTest passed\n");
+    return 0;
+}
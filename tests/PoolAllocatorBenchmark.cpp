@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// PoolAllocator against malloc: 8M allocate/free pairs over a working set of 1024 slots per thread,
+// with 0% or 5% of the blocks in the 4-64 KB range that goes to malloc in both cases.
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_PoolAllocator.h"
+#include <random>
+
+static const int TOTAL_OPERATIONS = 8000000;
+
+template<typename Allocate, typename Free>
+static double Run(int numThreads, int largePercent, Allocate allocate, Free release)
+{
+    TestTimer timer;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back([=]()
+        {
+            // Precomputed sizes and slots, so that the random number generator stays out of the measurement
+            std::mt19937 rng(t);
+            std::vector<uint32_t> sizes(1 << 16), slots(1 << 16);
+            for (auto& size : sizes)
+                size = (int(rng() % 100) >= largePercent) ? 8 + rng() % 500 : 4096 + rng() % 60000;
+            for (auto& slot : slots)
+                slot = rng() & 1023;
+
+            std::vector<void*> live(1024, nullptr);
+            for (int i = 0; i < TOTAL_OPERATIONS / numThreads; i++)
+            {
+                void*& block = live[slots[(i * 7) & 0xFFFF]];
+                if (block)
+                    release(block);
+                block = allocate(sizes[i & 0xFFFF]);
+                *(char*)block = 1;
+            }
+
+            for (void* block : live)
+                if (block)
+                    release(block);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return timer.GetMs();
+}
+
+int main()
+{
+    for (int largePercent : { 0, 5 })
+    {
+        for (int numThreads : { 1, 4 })
+        {
+            VXGI::PoolAllocator allocator;
+
+            double mallocMs = Run(numThreads, largePercent, [](size_t size) { return malloc(size); }, [](void* block) { free(block); });
+            double poolMs = Run(numThreads, largePercent,
+                [&allocator](size_t size) { return allocator.allocateMemory(size); },
+                [&allocator](void* block) { allocator.freeMemory(block); });
+
+            VXGI::PoolAllocatorStats stats = allocator.getStats();
+            printf("%d%% large blocks, %d thread%s: malloc %6.1f ms, pool %6.1f ms, %5.2f%% thread cache hits, %5.1f MB reserved\n",
+                largePercent, numThreads, numThreads > 1 ? "s" : " ", mallocMs, poolMs,
+                100.0 * double(stats.threadCacheHits) / double(stats.allocations - stats.largeAllocations),
+                double(stats.bytesReserved) / (1024.0 * 1024.0));
+        }
+    }
+
+    return 0;
+}
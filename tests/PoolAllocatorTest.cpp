@@ -0,0 +1,204 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_PoolAllocator.h"
+#include <random>
+
+class RecordingErrorCallback : public NVRHI::IErrorCallback
+{
+public:
+    std::vector<std::string> errors;
+
+    void signalError(const char*, int, const char* errorDesc) override { errors.push_back(errorDesc); }
+};
+
+static void TestBlocks()
+{
+    RecordingErrorCallback errors;
+    {
+        VXGI::PoolAllocator allocator(&errors);
+
+        // Every size up to a few large blocks: 16-byte alignment, and the contents survive other allocations
+        std::vector<void*> blocks;
+        for (size_t size = 0; size <= 20000; size += (size < 5000) ? 7 : 997)
+        {
+            void* block = allocator.allocateMemory(size);
+            TEST_CHECK(block != nullptr);
+            TEST_CHECK((uintptr_t(block) & 15) == 0);
+            memset(block, int(size & 0xFF), size);
+            blocks.push_back(block);
+        }
+
+        size_t index = 0;
+        for (size_t size = 0; size <= 20000; size += (size < 5000) ? 7 : 997, index++)
+        {
+            const unsigned char* bytes = (const unsigned char*)blocks[index];
+            for (size_t i = 0; i < size; i++)
+                TEST_CHECK(bytes[i] == (size & 0xFF));
+        }
+
+        VXGI::PoolAllocatorStats stats = allocator.getStats();
+        TEST_CHECK(stats.allocations == blocks.size());
+        TEST_CHECK(stats.frees == 0);
+        TEST_CHECK(stats.largeAllocations > 0);
+        TEST_CHECK(stats.bytesLive > 0 && stats.bytesHighWater >= stats.bytesLive);
+        TEST_CHECK(stats.bytesReserved >= stats.bytesLive);
+
+        for (void* block : blocks)
+            allocator.freeMemory(block);
+
+        stats = allocator.getStats();
+        TEST_CHECK(stats.frees == blocks.size());
+        TEST_CHECK(stats.largeFrees == stats.largeAllocations);
+        TEST_CHECK(stats.bytesLive == 0);
+
+        for (const VXGI::PoolAllocatorStats::SizeClass& sizeClass : stats.sizeClasses)
+            TEST_CHECK(sizeClass.allocations == sizeClass.frees);
+
+        // Freed blocks are reused by the thread cache
+        uint64_t hits = stats.threadCacheHits;
+        allocator.freeMemory(allocator.allocateMemory(100));
+        TEST_CHECK(allocator.getStats().threadCacheHits == hits + 1);
+
+        allocator.freeMemory(nullptr);
+        TEST_CHECK(allocator.formatLeakReport().empty());
+    }
+
+    TEST_CHECK(errors.errors.empty());
+}
+
+static void TestBadFrees()
+{
+    RecordingErrorCallback errors;
+    {
+        VXGI::PoolAllocator allocator(&errors);
+
+        void* small = allocator.allocateMemory(64);
+        void* large = allocator.allocateMemory(100000);
+
+        allocator.freeMemory(small);
+        allocator.freeMemory(small);
+        TEST_CHECK(errors.errors.size() == 1);
+
+        // Large blocks go back to malloc, so freeing one twice cannot be detected and is not tested
+        allocator.freeMemory(large);
+
+        // A pointer into the middle of a block has no header in front of it
+        char* block = (char*)allocator.allocateMemory(256);
+        memset(block, 0, 256);
+        allocator.freeMemory(block + 64);
+        TEST_CHECK(errors.errors.size() == 2);
+        allocator.freeMemory(block);
+
+        VXGI::PoolAllocatorStats stats = allocator.getStats();
+        TEST_CHECK(stats.allocations == stats.frees);
+        TEST_CHECK(stats.bytesLive == 0);
+    }
+
+    TEST_CHECK(errors.errors.size() == 2);
+}
+
+static void TestLeakReport()
+{
+    RecordingErrorCallback errors;
+    {
+        VXGI::PoolAllocator allocator(&errors);
+        allocator.allocateMemory(40);
+        allocator.allocateMemory(40);
+        allocator.allocateMemory(50000);
+        allocator.freeMemory(allocator.allocateMemory(1000));
+
+        std::string report = allocator.formatLeakReport();
+        TEST_CHECK(report.find("3 allocations") != std::string::npos);
+    }
+
+    // The destructor reports the leaks and frees the memory anyway
+    TEST_CHECK(errors.errors.size() == 1);
+    TEST_CHECK(errors.errors[0].find("3 allocations") != std::string::npos);
+}
+
+// Blocks allocated on one thread and freed on another, while other threads allocate and free on their own
+static void TestThreads()
+{
+    RecordingErrorCallback errors;
+    {
+        VXGI::PoolAllocator allocator(&errors);
+        const int numThreads = 4;
+        const int numBlocks = 20000;
+
+        std::vector<std::vector<void*>> handOver(numThreads);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads.emplace_back([&allocator, &handOver, t]()
+            {
+                std::mt19937 rng(t + 1);
+                std::vector<void*> local(256, nullptr);
+
+                for (int i = 0; i < numBlocks; i++)
+                {
+                    size_t size = (rng() % 50 == 0) ? 5000 + rng() % 20000 : rng() % 2000;
+                    void*& slot = local[rng() % local.size()];
+                    allocator.freeMemory(slot);
+                    slot = allocator.allocateMemory(size);
+                    TEST_CHECK(slot != nullptr);
+                    memset(slot, t, std::min<size_t>(size, 16));
+
+                    if (i % 8 == 0)
+                        handOver[t].push_back(allocator.allocateMemory(rng() % 500));
+                }
+
+                for (void* block : local)
+                    allocator.freeMemory(block);
+
+                allocator.flushThreadCache();
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+        threads.clear();
+
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads.emplace_back([&allocator, &handOver, t]()
+            {
+                for (void* block : handOver[(t + 1) % numThreads])
+                    allocator.freeMemory(block);
+
+                allocator.flushThreadCache();
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        VXGI::PoolAllocatorStats stats = allocator.getStats();
+        TEST_CHECK(stats.allocations == stats.frees);
+        TEST_CHECK(stats.bytesLive == 0);
+        TEST_CHECK(stats.bytesHighWater > 0);
+        TEST_CHECK(stats.threadCacheHits > stats.allocations / 2);
+    }
+
+    TEST_CHECK(errors.errors.empty());
+}
+
+int main()
+{
+    TestBlocks();
+    TestBadFrees();
+    TestLeakReport();
+    TestThreads();
+
+    printf("PoolAllocatorTest passed\n");
+    return 0;
+}
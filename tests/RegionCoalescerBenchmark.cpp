@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// Mesh culling against invalidated regions, as in SceneRenderer::RenderSceneCommon, before and after CoalesceRegions.
+// 2000 meshes, and 16-215 page-aligned regions over 5 clipmap levels per frame, 200 frames per pattern.
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_RegionCoalescer.h"
+#include <random>
+
+using namespace VXGI;
+
+struct CullResult
+{
+    uint64_t boxTests;
+    uint64_t draws;
+
+    CullResult() : boxTests(0), draws(0) { }
+};
+
+// A mesh is drawn once, when it intersects any box, so the loop stops at the first hit
+static CullResult Cull(const std::vector<Box3f>& meshes, const std::vector<Box3f>& boxes)
+{
+    CullResult result;
+    for (const Box3f& mesh : meshes)
+    {
+        for (const Box3f& box : boxes)
+        {
+            result.boxTests++;
+            if (box.intersectsWith(mesh))
+            {
+                result.draws++;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+    std::vector<Box3f> meshes;
+    for (int i = 0; i < 2000; i++)
+    {
+        Vector3f center(uniform(rng) * 4096.f - 2048.f, uniform(rng) * 1024.f, uniform(rng) * 4096.f - 2048.f);
+        float halfSize = 4.f + uniform(rng) * uniform(rng) * 200.f;
+        meshes.push_back(Box3f(center - halfSize, center + halfSize));
+    }
+
+    const char* patternNames[] = { "scattered objects", "clustered objects", "camera slabs" };
+    const float maxOverCoverages[] = { 0.f, 0.1f, 0.25f, 0.5f };
+    const int NUM_THRESHOLDS = 4;
+    const int NUM_FRAMES = 200;
+
+    for (int pattern = 0; pattern < 3; pattern++)
+    {
+        CullResult base, coalesced[NUM_THRESHOLDS];
+        double cullUs = 0.0, coalesceUs[NUM_THRESHOLDS] = {};
+        double coveredVolume[NUM_THRESHOLDS] = {}, outputVolume[NUM_THRESHOLDS] = {};
+        uint64_t inputRegions = 0, outputRegions[NUM_THRESHOLDS] = {};
+
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+        {
+            std::vector<Box3f> regions;
+            int count = 16 + rng() % 200;
+            Vector3f cluster(uniform(rng) * 3000.f - 1500.f, uniform(rng) * 800.f, uniform(rng) * 3000.f - 1500.f);
+
+            for (int i = 0; i < count; i++)
+            {
+                int level = rng() % 5;
+                float page = 16.f * float(1 << level);
+
+                Vector3f position;
+                if (pattern == 0)
+                    position = Vector3f(uniform(rng) * 4096.f - 2048.f, uniform(rng) * 1024.f, uniform(rng) * 4096.f - 2048.f);
+                else if (pattern == 1)
+                    position = cluster + Vector3f(uniform(rng) * 200.f, uniform(rng) * 200.f, uniform(rng) * 200.f) * float(1 << level);
+                else
+                    position = Vector3f(float(i % 5) * 512.f - 1024.f, float(i / 5 % 8) * page, float(i / 40) * page);
+
+                Vector3f lower(floorf(position.x / page) * page, floorf(position.y / page) * page, floorf(position.z / page) * page);
+                float extent = page * float(1 + rng() % 3);
+                regions.push_back(Box3f(lower, lower + extent));
+            }
+            inputRegions += regions.size();
+
+            TestTimer cullTimer;
+            CullResult frameBase = Cull(meshes, regions);
+            cullUs += cullTimer.GetMs() * 1000.0;
+            base.boxTests += frameBase.boxTests;
+            base.draws += frameBase.draws;
+
+            for (int k = 0; k < NUM_THRESHOLDS; k++)
+            {
+                std::vector<Box3f> output;
+                RegionCoalescingStats stats;
+
+                TestTimer coalesceTimer;
+                CoalesceRegions(regions.data(), uint32_t(regions.size()), maxOverCoverages[k], output, &stats);
+                coalesceUs[k] += coalesceTimer.GetMs() * 1000.0;
+
+                CullResult frameCoalesced = Cull(meshes, output);
+                coalesced[k].boxTests += frameCoalesced.boxTests;
+                coalesced[k].draws += frameCoalesced.draws;
+
+                // A merged box covers everything its regions did, so no mesh can be lost
+                TEST_CHECK(frameCoalesced.draws >= frameBase.draws);
+
+                outputRegions[k] += output.size();
+                coveredVolume[k] += stats.coveredVolume;
+                outputVolume[k] += stats.outputVolume;
+            }
+        }
+
+        printf("%s: %.1f regions, %.0f box tests, %.0f draws per frame, culling %.0f us\n", patternNames[pattern],
+            double(inputRegions) / NUM_FRAMES, double(base.boxTests) / NUM_FRAMES, double(base.draws) / NUM_FRAMES, cullUs / NUM_FRAMES);
+
+        for (int k = 0; k < NUM_THRESHOLDS; k++)
+        {
+            printf("  maxOverCoverage %.2f: %5.1f regions, %6.0f box tests (%2.0f%% fewer), %+5.1f draws, %+5.1f%% volume, coalescing %5.0f us\n",
+                maxOverCoverages[k], double(outputRegions[k]) / NUM_FRAMES, double(coalesced[k].boxTests) / NUM_FRAMES,
+                100.0 * (1.0 - double(coalesced[k].boxTests) / double(base.boxTests)),
+                double(coalesced[k].draws - base.draws) / NUM_FRAMES,
+                100.0 * (outputVolume[k] / coveredVolume[k] - 1.0), coalesceUs[k] / NUM_FRAMES);
+        }
+    }
+
+    return 0;
+}
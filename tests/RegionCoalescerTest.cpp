@@ -0,0 +1,183 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_RegionCoalescer.h"
+#include <random>
+
+using namespace VXGI;
+
+static Box3f MakeBox(float x0, float y0, float z0, float x1, float y1, float z1)
+{
+    return Box3f(Vector3f(x0, y0, z0), Vector3f(x1, y1, z1));
+}
+
+static bool CellCovered(const std::vector<Box3f>& boxes, int x, int y, int z)
+{
+    Vector3f center(float(x) + 0.5f, float(y) + 0.5f, float(z) + 0.5f);
+    for (const Box3f& box : boxes)
+        if (box.contains(center))
+            return true;
+
+    return false;
+}
+
+static void TestFaceNeighbours()
+{
+    // A 2x2x1 block of unit boxes merges into one box
+    Box3f regions[] = {
+        MakeBox(0, 0, 0, 1, 1, 1),
+        MakeBox(1, 0, 0, 2, 1, 1),
+        MakeBox(0, 1, 0, 1, 2, 1),
+        MakeBox(1, 1, 0, 2, 2, 1),
+    };
+
+    std::vector<Box3f> output;
+    RegionCoalescingStats stats;
+    CoalesceRegions(regions, 4, 0.f, output, &stats);
+
+    TEST_CHECK(output.size() == 1);
+    TEST_CHECK(output[0].lower == Vector3f(0, 0, 0) && output[0].upper == Vector3f(2, 2, 1));
+    TEST_CHECK(stats.inputRegions == 4 && stats.outputRegions == 1);
+    TEST_CHECK(fabsf(stats.coveredVolume - 4.f) < 1e-3f && fabsf(stats.outputVolume - 4.f) < 1e-3f);
+}
+
+static void TestOverlapAndContainment()
+{
+    Box3f regions[] = {
+        MakeBox(0, 0, 0, 4, 4, 4),
+        MakeBox(1, 1, 1, 2, 2, 2),      // inside the first one
+        MakeBox(0, 0, 2, 4, 4, 6),      // overlaps the first one over a full face
+    };
+
+    std::vector<Box3f> output;
+    CoalesceRegions(regions, 3, 0.f, output);
+
+    TEST_CHECK(output.size() == 1);
+    TEST_CHECK(output[0].lower == Vector3f(0, 0, 0) && output[0].upper == Vector3f(4, 4, 6));
+}
+
+static void TestThreshold()
+{
+    // Two unit boxes with a gap of one: the bounding box is 2/3 covered
+    Box3f regions[] = {
+        MakeBox(0, 0, 0, 1, 1, 1),
+        MakeBox(2, 0, 0, 3, 1, 1),
+    };
+
+    std::vector<Box3f> output;
+    CoalesceRegions(regions, 2, 0.f, output);
+    TEST_CHECK(output.size() == 2);
+
+    CoalesceRegions(regions, 2, 0.3f, output);
+    TEST_CHECK(output.size() == 2);
+
+    RegionCoalescingStats stats;
+    CoalesceRegions(regions, 2, 0.34f, output, &stats);
+    TEST_CHECK(output.size() == 1);
+    TEST_CHECK(fabsf(stats.coveredVolume - 2.f) < 1e-3f && fabsf(stats.outputVolume - 3.f) < 1e-3f);
+
+    // Diagonal neighbours only share an edge, so they are not merged without over-coverage
+    Box3f diagonal[] = {
+        MakeBox(0, 0, 0, 1, 1, 1),
+        MakeBox(1, 1, 0, 2, 2, 1),
+    };
+    CoalesceRegions(diagonal, 2, 0.f, output);
+    TEST_CHECK(output.size() == 2);
+}
+
+static void TestDegenerateInput()
+{
+    Box3f regions[] = {
+        MakeBox(0, 0, 0, 1, 1, 1),
+        MakeBox(5, 5, 5, 4, 6, 6),      // inverted
+        MakeBox(100, 100, 100, -100, -100, -100),
+    };
+
+    std::vector<Box3f> output;
+    RegionCoalescingStats stats;
+    CoalesceRegions(regions, 3, 1.f, output, &stats);
+    TEST_CHECK(output.size() == 1);
+    TEST_CHECK(output[0].lower == Vector3f(0, 0, 0) && output[0].upper == Vector3f(1, 1, 1));
+    TEST_CHECK(stats.inputRegions == 3 && stats.outputRegions == 1);
+
+    CoalesceRegions(nullptr, 0, 0.f, output, &stats);
+    TEST_CHECK(output.empty());
+    TEST_CHECK(stats.outputRegions == 0 && stats.outputVolume == 0.f);
+}
+
+// Random grid-aligned regions: with no over-coverage the output covers exactly the same cells,
+// with over-coverage every input region is still inside an output box
+static void TestRandom(uint32_t seed)
+{
+    const int GRID = 16;
+    std::mt19937 rng(seed);
+
+    for (int iteration = 0; iteration < 200; iteration++)
+    {
+        std::vector<Box3f> regions;
+        int count = 1 + rng() % 40;
+        for (int i = 0; i < count; i++)
+        {
+            int x = rng() % GRID, y = rng() % GRID, z = rng() % GRID;
+            int sx = 1 + rng() % 4, sy = 1 + rng() % 4, sz = 1 + rng() % 4;
+            regions.push_back(MakeBox(float(x), float(y), float(z),
+                float(std::min(x + sx, GRID)), float(std::min(y + sy, GRID)), float(std::min(z + sz, GRID))));
+        }
+
+        std::vector<Box3f> output;
+        RegionCoalescingStats stats;
+        CoalesceRegions(regions.data(), uint32_t(regions.size()), 0.f, output, &stats);
+
+        TEST_CHECK(output.size() <= regions.size());
+        TEST_CHECK(stats.outputRegions == output.size());
+
+        int coveredCells = 0;
+        for (int x = 0; x < GRID; x++)
+            for (int y = 0; y < GRID; y++)
+                for (int z = 0; z < GRID; z++)
+                {
+                    bool covered = CellCovered(regions, x, y, z);
+                    TEST_CHECK(covered == CellCovered(output, x, y, z));
+                    coveredCells += covered ? 1 : 0;
+                }
+
+        // Exact merges keep the output volume equal to the covered volume, but output boxes may still overlap
+        TEST_CHECK(stats.outputVolume >= float(coveredCells) - 1e-3f);
+
+        for (float maxOverCoverage : { 0.1f, 0.5f, 2.f })
+        {
+            CoalesceRegions(regions.data(), uint32_t(regions.size()), maxOverCoverage, output, &stats);
+            TEST_CHECK(output.size() <= regions.size());
+
+            for (const Box3f& region : regions)
+            {
+                bool contained = false;
+                for (const Box3f& box : output)
+                    contained = contained || box.contains(region);
+                TEST_CHECK(contained);
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestFaceNeighbours();
+    TestOverlapAndContainment();
+    TestThreshold();
+    TestDegenerateInput();
+
+    for (uint32_t seed = 1; seed <= 5; seed++)
+        TestRandom(seed);
+
+    printf("RegionCoalescerTest passed\n");
+    return 0;
+}
@@ -0,0 +1,212 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_ResidencyPolicy.h"
+
+using namespace NVRHI;
+
+static const uint32_t NO_LIMIT = 1000;
+
+// The policy never dereferences the keys
+static char g_Objects[16];
+
+static ResidencyPolicy::ObjectKey Key(int index)
+{
+    return &g_Objects[index];
+}
+
+static bool Equals(const std::vector<ResidencyPolicy::ObjectKey>& keys, std::initializer_list<int> expected)
+{
+    if (keys.size() != expected.size())
+        return false;
+
+    size_t i = 0;
+    for (int index : expected)
+        if (keys[i++] != Key(index))
+            return false;
+
+    return true;
+}
+
+static void TestLruOrder()
+{
+    ResidencyPolicy policy;
+    for (int i = 0; i < 6; i++)
+        policy.AddObject(Key(i), 100);
+
+    // Adding an object twice does nothing
+    policy.AddObject(Key(0), 5000);
+    TEST_CHECK(policy.GetResidentBytes() == 600 && policy.GetNumResident() == 6);
+
+    // Order of use: 0, 1, 2, 3, 4, 5 by creation, then 2 and 0 were used again
+    TEST_CHECK(!policy.MarkUsed(Key(2), 1));
+    TEST_CHECK(!policy.MarkUsed(Key(0), 2));
+    TEST_CHECK(!policy.MarkUsed(Key(15), 2));
+
+    std::vector<ResidencyPolicy::ObjectKey> evicted;
+    policy.SelectEvictions(600, 300, 2, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 1, 3, 4 }));
+    TEST_CHECK(policy.GetResidentBytes() == 300 && policy.GetEvictedBytes() == 300);
+    TEST_CHECK(policy.GetNumResident() == 3 && policy.GetNumEvicted() == 3);
+
+    // Evicted objects are skipped by the next selection, which continues with the least recently used resident ones
+    evicted.clear();
+    policy.SelectEvictions(300, 200, 2, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 5 }));
+
+    // Using an evicted object makes it resident and most recently used
+    TEST_CHECK(policy.MarkUsed(Key(3), 3));
+    TEST_CHECK(!policy.MarkUsed(Key(3), 3));
+    TEST_CHECK(policy.GetResidentBytes() == 300 && policy.GetNumEvicted() == 3);
+
+    evicted.clear();
+    policy.SelectEvictions(300, 0, 3, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 2, 0, 3 }));
+    TEST_CHECK(policy.GetResidentBytes() == 0 && policy.GetNumResident() == 0);
+    TEST_CHECK(policy.GetEvictedBytes() == 600 && policy.GetNumEvicted() == 6);
+}
+
+static void TestBudget()
+{
+    ResidencyPolicy policy;
+    const uint64_t sizes[] = { 10, 200, 30, 400, 50 };
+    for (int i = 0; i < 5; i++)
+        policy.AddObject(Key(i), sizes[i]);
+
+    // Nothing to do at or under the target
+    std::vector<ResidencyPolicy::ObjectKey> evicted;
+    policy.SelectEvictions(1000, 1000, 0, NO_LIMIT, evicted);
+    policy.SelectEvictions(500, 1000, 0, NO_LIMIT, evicted);
+    TEST_CHECK(evicted.empty() && policy.GetNumEvicted() == 0);
+
+    // The selection stops as soon as enough is freed, even if the last object overshoots.
+    // The usage comes from the OS and includes memory that the policy does not track.
+    policy.SelectEvictions(2000, 1790, 0, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 0, 1 }));
+    TEST_CHECK(policy.GetEvictedBytes() == 210);
+
+    evicted.clear();
+    policy.SelectEvictions(2000, 1999, 0, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 2 }));
+
+    // More than the tracked objects can free: everything resident goes, and no more
+    evicted.clear();
+    policy.SelectEvictions(100000, 0, 0, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 3, 4 }));
+    TEST_CHECK(policy.GetResidentBytes() == 0 && policy.GetEvictedBytes() == 690);
+
+    // Removing objects updates the totals whether they are resident or not
+    TEST_CHECK(policy.MarkUsed(Key(1), 1));
+    policy.RemoveObject(Key(1));
+    policy.RemoveObject(Key(3));
+    policy.RemoveObject(Key(3));
+    TEST_CHECK(policy.GetResidentBytes() == 0 && policy.GetEvictedBytes() == 90);
+    TEST_CHECK(policy.GetNumResident() == 0 && policy.GetNumEvicted() == 3);
+    TEST_CHECK(!policy.MarkUsed(Key(1), 2));
+}
+
+static void TestEvictionCap()
+{
+    ResidencyPolicy policy;
+    for (int i = 0; i < 10; i++)
+        policy.AddObject(Key(i), 100);
+
+    // The cap limits the number of objects per call, even when the target is not reached
+    std::vector<ResidencyPolicy::ObjectKey> evicted;
+    policy.SelectEvictions(1000, 0, 0, 3, evicted);
+    TEST_CHECK(Equals(evicted, { 0, 1, 2 }));
+    TEST_CHECK(policy.GetFrameEvictions() == 3 && policy.GetFrameEvictedBytes() == 300);
+
+    // The next frame continues where this one stopped
+    policy.ResetFrameCounters();
+    TEST_CHECK(policy.GetFrameEvictions() == 0 && policy.GetFrameEvictedBytes() == 0);
+
+    evicted.clear();
+    policy.SelectEvictions(700, 0, 0, 3, evicted);
+    TEST_CHECK(Equals(evicted, { 3, 4, 5 }));
+
+    // A cap of zero evicts nothing
+    evicted.clear();
+    policy.SelectEvictions(400, 0, 0, 0, evicted);
+    TEST_CHECK(evicted.empty());
+
+    // Making objects resident is counted per frame as well
+    TEST_CHECK(policy.MarkUsed(Key(0), 1));
+    TEST_CHECK(policy.MarkUsed(Key(4), 1));
+    TEST_CHECK(policy.GetFrameMadeResident() == 2 && policy.GetFrameMadeResidentBytes() == 200);
+    TEST_CHECK(policy.GetFrameEvictions() == 3);
+
+    policy.ResetFrameCounters();
+    TEST_CHECK(policy.GetFrameMadeResident() == 0 && policy.GetFrameMadeResidentBytes() == 0);
+    TEST_CHECK(policy.GetNumEvicted() == 4 && policy.GetResidentBytes() == 600);
+}
+
+static void TestInFlight()
+{
+    ResidencyPolicy policy;
+    for (int i = 0; i < 5; i++)
+        policy.AddObject(Key(i), 100);
+
+    // Objects 0-2 were used by command lists that completed, 3 and 4 by ones that have not
+    for (int i = 0; i < 5; i++)
+        policy.MarkUsed(Key(i), uint64_t(i + 1));
+
+    // Object 5 was created after that and is behind them in the list without having been used;
+    // the selection stops at object 3 and does not reach it
+    policy.AddObject(Key(5), 100);
+
+    std::vector<ResidencyPolicy::ObjectKey> evicted;
+    policy.SelectEvictions(600, 0, 3, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 0, 1, 2 }));
+    TEST_CHECK(policy.GetNumPinned() == 2);
+    TEST_CHECK(policy.GetResidentBytes() == 300);
+
+    // Once the fences complete, the pinned objects can go
+    evicted.clear();
+    policy.SelectEvictions(300, 0, 5, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 3, 4, 5 }));
+    TEST_CHECK(policy.GetNumPinned() == 0);
+
+    // A later use with an older fence does not unpin an object
+    ResidencyPolicy pinned;
+    pinned.AddObject(Key(0), 100);
+    pinned.MarkUsed(Key(0), 10);
+    pinned.MarkUsed(Key(0), 4);
+
+    evicted.clear();
+    pinned.SelectEvictions(100, 0, 9, NO_LIMIT, evicted);
+    TEST_CHECK(evicted.empty() && pinned.GetNumPinned() == 1);
+
+    pinned.SelectEvictions(100, 0, 10, NO_LIMIT, evicted);
+    TEST_CHECK(Equals(evicted, { 0 }) && pinned.GetNumPinned() == 0);
+
+    // The pinned count is updated even when nothing needs to be evicted
+    ResidencyPolicy counted;
+    counted.AddObject(Key(0), 100);
+    counted.AddObject(Key(1), 100);
+    counted.MarkUsed(Key(0), 7);
+    counted.MarkUsed(Key(1), 8);
+    counted.SelectEvictions(0, 1000, 6, NO_LIMIT, evicted);
+    TEST_CHECK(counted.GetNumPinned() == 2);
+    counted.SelectEvictions(0, 1000, 7, NO_LIMIT, evicted);
+    TEST_CHECK(counted.GetNumPinned() == 1);
+}
+
+int main()
+{
+    TestLruOrder();
+    TestBudget();
+    TestEvictionCap();
+    TestInFlight();
+
+    printf("ResidencyPolicyTest passed\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// Query cost of SceneBVH compared to testing every object, for a camera frustum, a few large boxes like clipmap
+// levels, and many small boxes like invalidated voxelization regions. Also reports the build and refit times.
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_SceneBVH.h"
+#include <random>
+
+using namespace VXGI;
+
+static float RandomFloat(std::mt19937& rng, float lower, float upper)
+{
+    return std::uniform_real_distribution<float>(lower, upper)(rng);
+}
+
+static Box3f RandomBox(std::mt19937& rng, float worldSize, float maxSize)
+{
+    Vector3f lower(RandomFloat(rng, 0.f, worldSize), RandomFloat(rng, 0.f, worldSize), RandomFloat(rng, 0.f, worldSize));
+    Vector3f size(RandomFloat(rng, 0.f, maxSize), RandomFloat(rng, 0.f, maxSize), RandomFloat(rng, 0.f, maxSize));
+    return Box3f(lower, lower + size);
+}
+
+// A 90 degree frustum at the world center looking along +x, reaching 'range' units
+static Frustum MakeCameraFrustum(float worldSize, float range)
+{
+    float c = worldSize * 0.5f;
+    float s = sqrtf(0.5f);
+
+    Frustum frustum;
+    frustum.planes[Frustum::NEAR_PLANE] = Plane(-1.f, 0.f, 0.f, -(c + 0.1f));
+    frustum.planes[Frustum::FAR_PLANE] = Plane(1.f, 0.f, 0.f, c + range);
+    frustum.planes[Frustum::LEFT_PLANE] = Plane(-s, -s, 0.f, -s * c - s * c);
+    frustum.planes[Frustum::RIGHT_PLANE] = Plane(-s, s, 0.f, -s * c + s * c);
+    frustum.planes[Frustum::TOP_PLANE] = Plane(-s, 0.f, s, -s * c + s * c);
+    frustum.planes[Frustum::BOTTOM_PLANE] = Plane(-s, 0.f, -s, -s * c - s * c);
+    return frustum;
+}
+
+template<typename Query>
+static uint32_t LinearScan(const std::vector<Box3f>& bounds, const Query* queries, uint32_t numQueries, std::vector<uint32_t>& result)
+{
+    result.clear();
+    for (uint32_t object = 0; object < uint32_t(bounds.size()); object++)
+    {
+        for (uint32_t query = 0; query < numQueries; query++)
+        {
+            if (queries[query].intersectsWith(bounds[object]))
+            {
+                result.push_back(object);
+                break;
+            }
+        }
+    }
+    return uint32_t(result.size());
+}
+
+template<typename Query>
+static void Compare(const char* name, SceneBVH& bvh, const std::vector<Box3f>& bounds, const Query* queries, uint32_t numQueries)
+{
+    const int iterations = 200;
+    SceneBVHQueryResult result;
+    std::vector<uint32_t> scanResult;
+
+    TestTimer bvhTimer;
+    for (int i = 0; i < iterations; i++)
+        bvh.query(queries, numQueries, result);
+    double bvhMs = bvhTimer.GetMs() / iterations;
+
+    TestTimer scanTimer;
+    uint32_t found = 0;
+    for (int i = 0; i < iterations; i++)
+        found = LinearScan(bounds, queries, numQueries, scanResult);
+    double scanMs = scanTimer.GetMs() / iterations;
+
+    TEST_CHECK(found == uint32_t(result.objects.size()));
+
+    const SceneBVHStats& stats = bvh.getStats();
+    printf("  %-24s %6u found: BVH %8.3f ms (%6u nodes, %6u objects tested), linear scan %8.3f ms, %5.1fx\n",
+        name, found, bvhMs, stats.visitedNodes, stats.testedObjects, scanMs, scanMs / bvhMs);
+}
+
+static void Run(uint32_t numObjects)
+{
+    std::mt19937 rng(numObjects);
+    const float worldSize = 1000.f;
+
+    std::vector<Box3f> bounds(numObjects);
+    std::vector<uint32_t> materials(numObjects);
+    for (uint32_t i = 0; i < numObjects; i++)
+    {
+        bounds[i] = RandomBox(rng, worldSize, (i % 50 == 0) ? 100.f : 10.f);
+        materials[i] = uint32_t(rng() % 64);
+    }
+
+    SceneBVH bvh;
+    TestTimer buildTimer;
+    bvh.build(bounds.data(), materials.data(), numObjects);
+    double buildMs = buildTimer.GetMs();
+
+    printf("%u objects: build %.2f ms, %u nodes, depth %u, SAH cost %.3f\n",
+        numObjects, buildMs, bvh.getStats().nodes, bvh.getStats().maxDepth, bvh.getStats().cost);
+
+    Frustum camera = MakeCameraFrustum(worldSize, worldSize * 0.3f);
+    Compare("camera frustum", bvh, bounds, &camera, 1);
+
+    Box3f levels[4];
+    for (int i = 0; i < 4; i++)
+    {
+        float extent = 50.f * float(1 << i);
+        Vector3f center(worldSize * 0.5f, worldSize * 0.5f, worldSize * 0.5f);
+        levels[i] = Box3f(center - Vector3f(extent, extent, extent), center + Vector3f(extent, extent, extent));
+    }
+    Compare("4 clipmap levels", bvh, bounds, levels, 4);
+
+    std::vector<Box3f> regions(64);
+    for (Box3f& region : regions)
+        region = RandomBox(rng, worldSize, 20.f);
+    Compare("64 small regions", bvh, bounds, regions.data(), 64);
+
+    // Move 10% of the objects a little, like animated meshes over a frame
+    for (uint32_t i = 0; i < numObjects; i += 10)
+    {
+        Vector3f offset(RandomFloat(rng, -5.f, 5.f), RandomFloat(rng, -5.f, 5.f), RandomFloat(rng, -5.f, 5.f));
+        bounds[i] = Box3f(bounds[i].lower + offset, bounds[i].upper + offset);
+    }
+
+    TestTimer refitTimer;
+    bvh.refit(bounds.data());
+    double refitMs = refitTimer.GetMs();
+
+    printf("  refit %.3f ms, SAH cost %.3f after refit\n", refitMs, bvh.getStats().cost);
+    Compare("camera frustum, refit", bvh, bounds, &camera, 1);
+}
+
+int main()
+{
+    Run(1000);
+    Run(10000);
+    Run(100000);
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_SceneBVH.h"
+#include <random>
+
+using namespace VXGI;
+
+static float RandomFloat(std::mt19937& rng, float lower, float upper)
+{
+    return std::uniform_real_distribution<float>(lower, upper)(rng);
+}
+
+static Box3f RandomBox(std::mt19937& rng, float worldSize, float maxSize)
+{
+    Vector3f lower(RandomFloat(rng, 0.f, worldSize), RandomFloat(rng, 0.f, worldSize), RandomFloat(rng, 0.f, worldSize));
+    Vector3f size(RandomFloat(rng, 0.f, maxSize), RandomFloat(rng, 0.f, maxSize), RandomFloat(rng, 0.f, maxSize));
+    return Box3f(lower, lower + size);
+}
+
+// Six planes with random orientations around a center, which is all that the BVH assumes about a frustum
+static Frustum RandomFrustum(std::mt19937& rng, float worldSize)
+{
+    Vector3f center(RandomFloat(rng, 0.f, worldSize), RandomFloat(rng, 0.f, worldSize), RandomFloat(rng, 0.f, worldSize));
+
+    Frustum frustum;
+    for (int i = 0; i < Frustum::PLANES_COUNT; i++)
+    {
+        Plane& plane = frustum.planes[i];
+        plane.normal = Vector3f(RandomFloat(rng, -1.f, 1.f), RandomFloat(rng, -1.f, 1.f), RandomFloat(rng, -1.f, 1.f));
+        plane.normal.x += (i == 0) ? 1.f : (i == 1) ? -1.f : 0.f;
+        plane.normal.y += (i == 2) ? 1.f : (i == 3) ? -1.f : 0.f;
+        plane.normal.z += (i == 4) ? 1.f : (i == 5) ? -1.f : 0.f;
+        plane.normal = plane.normal.normalize();
+        plane.distance = plane.normal.x * center.x + plane.normal.y * center.y + plane.normal.z * center.z + RandomFloat(rng, 0.f, worldSize * 0.3f);
+    }
+    return frustum;
+}
+
+// The result a linear scan over all objects gives: objects sorted by key, then by index
+template<typename Query>
+static std::vector<uint32_t> LinearScan(const std::vector<Box3f>& bounds, const std::vector<uint32_t>& keys,
+    const Query* queries, uint32_t numQueries)
+{
+    std::vector<uint32_t> result;
+    for (uint32_t object = 0; object < uint32_t(bounds.size()); object++)
+    {
+        for (uint32_t query = 0; query < numQueries; query++)
+        {
+            if (queries[query].intersectsWith(bounds[object]))
+            {
+                result.push_back(object);
+                break;
+            }
+        }
+    }
+
+    std::stable_sort(result.begin(), result.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    return result;
+}
+
+static void CheckRanges(const SceneBVHQueryResult& result, const std::vector<uint32_t>& keys)
+{
+    uint32_t next = 0;
+    for (size_t index = 0; index < result.ranges.size(); index++)
+    {
+        const SceneBVHDrawRange& range = result.ranges[index];
+        TEST_CHECK(range.first == next && range.count > 0);
+        TEST_CHECK(index == 0 || result.ranges[index - 1].sortKey < range.sortKey);
+
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+            TEST_CHECK(keys[result.objects[i]] == range.sortKey);
+
+        next += range.count;
+    }
+    TEST_CHECK(next == uint32_t(result.objects.size()));
+}
+
+static void CheckQueries(SceneBVH& bvh, const std::vector<Box3f>& bounds, const std::vector<uint32_t>& keys, std::mt19937& rng, float worldSize)
+{
+    SceneBVHQueryResult result;
+
+    // Up to 70 queries, so that some go past one traversal batch
+    for (uint32_t numQueries : { 0u, 1u, 3u, 64u, 70u })
+    {
+        for (int repeat = 0; repeat < 4; repeat++)
+        {
+            std::vector<Box3f> boxes(numQueries);
+            for (Box3f& box : boxes)
+                box = RandomBox(rng, worldSize, worldSize * ((repeat & 1) ? 0.02f : 0.3f));
+
+            bvh.query(boxes.data(), numQueries, result);
+            TEST_CHECK(result.objects == LinearScan(bounds, keys, boxes.data(), numQueries));
+            TEST_CHECK(bvh.getStats().returnedObjects == uint32_t(result.objects.size()));
+            CheckRanges(result, keys);
+
+            std::vector<Frustum> frusta(numQueries);
+            for (Frustum& frustum : frusta)
+                frustum = RandomFrustum(rng, worldSize);
+
+            bvh.query(frusta.data(), numQueries, result);
+            TEST_CHECK(result.objects == LinearScan(bounds, keys, frusta.data(), numQueries));
+            CheckRanges(result, keys);
+        }
+    }
+
+    // A box around the whole world, including where refit moved objects, returns everything like queryAll
+    Box3f world(Vector3f(-worldSize, -worldSize, -worldSize), Vector3f(worldSize * 2.f, worldSize * 2.f, worldSize * 2.f));
+    bvh.query(&world, 1, result);
+
+    SceneBVHQueryResult all;
+    bvh.queryAll(all);
+    TEST_CHECK(all.objects.size() == bounds.size());
+    TEST_CHECK(result.objects == all.objects);
+    CheckRanges(all, keys);
+    TEST_CHECK(all.ranges.size() == result.ranges.size());
+}
+
+static void TestAgainstLinearScan(uint32_t numObjects, uint32_t numKeys, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    const float worldSize = 100.f;
+
+    std::vector<Box3f> bounds(numObjects);
+    std::vector<uint32_t> keys(numObjects);
+    for (uint32_t i = 0; i < numObjects; i++)
+    {
+        bounds[i] = RandomBox(rng, worldSize, (i % 10 == 0) ? 20.f : 2.f);
+        keys[i] = numKeys ? uint32_t(rng() % numKeys) : 0;
+    }
+
+    // A few objects collapse to a point, and a group shares one centroid
+    for (uint32_t i = 0; i < numObjects; i += 17)
+        bounds[i].upper = bounds[i].lower;
+    for (uint32_t i = 5; i < numObjects; i += 13)
+        bounds[i] = Box3f(Vector3f(50.f, 50.f, 50.f), Vector3f(51.f, 51.f, 51.f));
+
+    SceneBVH bvh;
+    bvh.build(bounds.data(), numKeys ? keys.data() : nullptr, numObjects);
+    TEST_CHECK(bvh.getObjectCount() == numObjects);
+
+    const SceneBVHStats& stats = bvh.getStats();
+    TEST_CHECK(stats.cost == stats.buildCost);
+    TEST_CHECK(numObjects == 0 || (stats.leaves * 2 == stats.nodes + 1 && stats.maxDepth > 0));
+
+    CheckQueries(bvh, bounds, keys, rng, worldSize);
+
+    // Move every object and refit: the topology is stale but the results must stay exact
+    for (int step = 0; step < 3; step++)
+    {
+        for (uint32_t i = 0; i < numObjects; i++)
+        {
+            Vector3f offset(RandomFloat(rng, -10.f, 10.f), RandomFloat(rng, -10.f, 10.f), RandomFloat(rng, -10.f, 10.f));
+            bounds[i] = Box3f(bounds[i].lower + offset, bounds[i].upper + offset);
+        }
+
+        bvh.refit(bounds.data());
+        CheckQueries(bvh, bounds, keys, rng, worldSize);
+    }
+
+    float buildCost = bvh.getStats().buildCost;
+    TEST_CHECK(numObjects < 100 || bvh.getStats().cost > buildCost);
+
+    // Rebuilding from the moved bounds restores a tight tree
+    bvh.build(bounds.data(), numKeys ? keys.data() : nullptr, numObjects);
+    TEST_CHECK(bvh.getStats().cost == bvh.getStats().buildCost);
+    CheckQueries(bvh, bounds, keys, rng, worldSize);
+}
+
+static void TestDrawRanges()
+{
+    // Keys given out of order: ranges follow the key, objects within a range follow the index
+    const uint32_t keys[] = { 7, 2, 7, 2, 5, 2 };
+    Box3f bounds[6];
+    for (int i = 0; i < 6; i++)
+        bounds[i] = Box3f(Vector3f(float(i), 0.f, 0.f), Vector3f(float(i) + 0.5f, 1.f, 1.f));
+
+    SceneBVH bvh;
+    bvh.build(bounds, keys, 6);
+
+    SceneBVHQueryResult result;
+    bvh.queryAll(result);
+
+    const uint32_t expectedObjects[] = { 1, 3, 5, 4, 0, 2 };
+    TEST_CHECK(result.objects.size() == 6);
+    for (int i = 0; i < 6; i++)
+        TEST_CHECK(result.objects[i] == expectedObjects[i]);
+
+    TEST_CHECK(result.ranges.size() == 3);
+    TEST_CHECK(result.ranges[0].sortKey == 2 && result.ranges[0].first == 0 && result.ranges[0].count == 3);
+    TEST_CHECK(result.ranges[1].sortKey == 5 && result.ranges[1].first == 3 && result.ranges[1].count == 1);
+    TEST_CHECK(result.ranges[2].sortKey == 7 && result.ranges[2].first == 4 && result.ranges[2].count == 2);
+
+    // Objects 2 and 3 only; object 2 touches the query box at x = 2.5
+    Box3f box(Vector3f(2.5f, 0.f, 0.f), Vector3f(3.2f, 1.f, 1.f));
+    bvh.query(&box, 1, result);
+    TEST_CHECK(result.objects.size() == 2 && result.objects[0] == 3 && result.objects[1] == 2);
+    TEST_CHECK(result.ranges.size() == 2);
+    TEST_CHECK(result.ranges[0].sortKey == 2 && result.ranges[0].count == 1);
+    TEST_CHECK(result.ranges[1].sortKey == 7 && result.ranges[1].first == 1 && result.ranges[1].count == 1);
+
+    // Without keys, everything is one range in index order
+    bvh.build(bounds, nullptr, 6);
+    bvh.queryAll(result);
+    TEST_CHECK(result.ranges.size() == 1 && result.ranges[0].sortKey == 0 && result.ranges[0].count == 6);
+    for (uint32_t i = 0; i < 6; i++)
+        TEST_CHECK(result.objects[i] == i);
+
+    // An object found by several queries is returned once
+    Box3f boxes[3] = { box, box, bounds[0] };
+    bvh.query(boxes, 3, result);
+    TEST_CHECK(result.objects.size() == 3 && result.objects[0] == 0 && result.objects[1] == 2 && result.objects[2] == 3);
+}
+
+static void TestEmpty()
+{
+    SceneBVH bvh;
+    bvh.build(nullptr, nullptr, 0);
+    TEST_CHECK(bvh.getObjectCount() == 0 && bvh.getStats().nodes == 0);
+
+    SceneBVHQueryResult result;
+    Box3f box(Vector3f(0.f, 0.f, 0.f), Vector3f(1.f, 1.f, 1.f));
+    bvh.query(&box, 1, result);
+    TEST_CHECK(result.objects.empty() && result.ranges.empty());
+
+    bvh.queryAll(result);
+    TEST_CHECK(result.objects.empty() && result.ranges.empty());
+
+    bvh.refit(nullptr);
+    TEST_CHECK(bvh.getStats().cost == 0.f);
+}
+
+int main()
+{
+    TestEmpty();
+    TestDrawRanges();
+
+    TestAgainstLinearScan(1, 1, 1);
+    TestAgainstLinearScan(15, 3, 2);
+    TestAgainstLinearScan(200, 0, 3);
+    TestAgainstLinearScan(2000, 8, 4);
+    TestAgainstLinearScan(5000, 40, 5);
+
+    printf("SceneBVHTest passed\n");
+    return 0;
+}
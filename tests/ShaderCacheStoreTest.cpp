@@ -0,0 +1,338 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// The compile cache of samples/d3dcompiler_hook: key derivation and the on-disk store
+
+#include "TestCommon.h"
+#include "shader_cache.h"
+#include <ftw.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+static const size_t HEADER_SIZE = 24;   // ShaderCacheFileHeader in shader_cache.cpp
+
+static int RemoveEntry(const char* path, const struct stat*, int, struct FTW*)
+{
+    return remove(path);
+}
+
+// A fresh store directory under /tmp, removed with everything in it by the destructor
+class TempDirectory
+{
+public:
+    TempDirectory()
+    {
+        char path[] = "/tmp/ShaderCacheStoreTest.XXXXXX";
+        TEST_CHECK(mkdtemp(path) != nullptr);
+        m_Path = path;
+    }
+
+    ~TempDirectory() { nftw(m_Path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS); }
+
+    const std::string& GetPath() const { return m_Path; }
+
+private:
+    std::string m_Path;
+};
+
+static bool FileExists(const std::string& path)
+{
+    struct stat s;
+    return stat(path.c_str(), &s) == 0;
+}
+
+static void SetFileTime(const std::string& path, time_t time)
+{
+    utimbuf times;
+    times.actime = time;
+    times.modtime = time;
+    TEST_CHECK(utime(path.c_str(), &times) == 0);
+}
+
+static ShaderCacheKey MakeKey(uint64_t high, uint64_t low)
+{
+    ShaderCacheKey key;
+    key.High = high;
+    key.Low = low;
+    return key;
+}
+
+static std::vector<uint8_t> MakeData(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = uint8_t(seed + i * 7);
+    return data;
+}
+
+static void TestKeyDerivation()
+{
+    const char source[] = "float4 main() : SV_Target { return VALUE; }";
+
+    ShaderCompileInputs inputs;
+    inputs.pSource = source;
+    inputs.SourceSize = sizeof(source) - 1;
+    inputs.Defines.push_back(std::make_pair(std::string("VALUE"), std::string("1")));
+    inputs.EntryPoint = "main";
+    inputs.Target = "ps_5_0";
+    inputs.Flags1 = 0x800;
+    inputs.CompilerIdentity = "d3dcompiler_47.dll 10.0.19041";
+
+    ShaderCacheKey key = ComputeShaderCacheKey(inputs);
+    TEST_CHECK(key != ShaderCacheKey());
+    TEST_CHECK(key.Low != key.High);
+
+    // Same inputs in a different buffer give the same key
+    std::string copy(source, sizeof(source) - 1);
+    ShaderCompileInputs same = inputs;
+    same.pSource = copy.data();
+    TEST_CHECK(ComputeShaderCacheKey(same) == key);
+
+    // Every input is part of the key
+    std::vector<ShaderCompileInputs> variants(10, inputs);
+    variants[0].SourceSize--;
+    variants[1].Defines[0].second = "2";
+    variants[2].Defines.push_back(std::make_pair(std::string("EXTRA"), std::string()));
+    variants[3].EntryPoint = "main2";
+    variants[4].Target = "ps_5_1";
+    variants[5].Flags1 |= 1;
+    variants[6].Flags2 = 1;
+    variants[7].StripFlags = 1;
+    variants[8].CompilerIdentity = "d3dcompiler_47.dll 10.0.22621";
+    variants[9].Defines.clear();
+
+    std::vector<ShaderCacheKey> keys(1, key);
+    for (const ShaderCompileInputs& variant : variants)
+    {
+        ShaderCacheKey variantKey = ComputeShaderCacheKey(variant);
+        for (const ShaderCacheKey& other : keys)
+            TEST_CHECK(variantKey != other);
+        keys.push_back(variantKey);
+    }
+
+    // Moving characters between adjacent strings changes the key
+    ShaderCompileInputs split1 = inputs, split2 = inputs;
+    split1.Defines[0] = std::make_pair(std::string("AB"), std::string("C"));
+    split2.Defines[0] = std::make_pair(std::string("A"), std::string("BC"));
+    TEST_CHECK(ComputeShaderCacheKey(split1) != ComputeShaderCacheKey(split2));
+
+    split1.EntryPoint = "mainps_5_0"; split1.Target = "";
+    split2.EntryPoint = "main"; split2.Target = "ps_5_0";
+    TEST_CHECK(ComputeShaderCacheKey(split1) != ComputeShaderCacheKey(split2));
+
+    // The key text is 32 hex digits, high word first
+    TEST_CHECK(MakeKey(0x0123456789abcdefull, 0xfedcba9876543210ull).ToString() == "0123456789abcdeffedcba9876543210");
+    TEST_CHECK(MakeKey(0, 1).ToString() == "00000000000000000000000000000001");
+}
+
+static void TestRoundTrip()
+{
+    TempDirectory directory;
+    std::vector<ShaderCacheKey> keys;
+
+    {
+        ShaderCacheStore store(directory.GetPath(), 0);
+
+        std::vector<uint8_t> data;
+        TEST_CHECK(!store.Load(MakeKey(1, 2), data));
+
+        for (uint32_t i = 0; i < 64; i++)
+        {
+            ShaderCacheKey key = MakeKey(uint64_t(i) * 0x0400000000000000ull + i, i);
+            std::vector<uint8_t> blob = MakeData(i * 13, uint8_t(i));
+            TEST_CHECK(store.Store(key, blob.data(), blob.size()));
+            keys.push_back(key);
+        }
+
+        // Entries are sharded by the first two hex digits of the key
+        for (const ShaderCacheKey& key : keys)
+        {
+            std::string name = key.ToString();
+            std::string path = store.GetEntryPath(key);
+            TEST_CHECK(path == directory.GetPath() + "/" + name.substr(0, 2) + "/" + name + ".bin");
+            TEST_CHECK(FileExists(path));
+            TEST_CHECK(!FileExists(path + ".tmp"));
+        }
+        TEST_CHECK(store.GetEntryPath(keys[1]).find("/04/") != std::string::npos);
+
+        for (uint32_t i = 0; i < 64; i++)
+        {
+            TEST_CHECK(store.Load(keys[i], data));
+            TEST_CHECK(data == MakeData(i * 13, uint8_t(i)));
+        }
+
+        // Storing the same key again replaces the entry
+        std::vector<uint8_t> replacement = MakeData(100, 99);
+        TEST_CHECK(store.Store(keys[5], replacement.data(), replacement.size()));
+        TEST_CHECK(store.Load(keys[5], data) && data == replacement);
+
+        ShaderCacheStats stats = store.GetStats();
+        TEST_CHECK(stats.Hits == 65 && stats.Misses == 1 && stats.Stores == 65);
+        TEST_CHECK(stats.Evictions == 0 && stats.CorruptEntries == 0);
+    }
+
+    // Another store on the same directory, like another process, sees the entries and their total size
+    ShaderCacheStore store(directory.GetPath(), 0);
+
+    uint64_t expectedBytes = 0;
+    for (uint32_t i = 0; i < 64; i++)
+        expectedBytes += HEADER_SIZE + (i == 5 ? 100 : i * 13);
+    TEST_CHECK(store.GetStats().TotalBytes == expectedBytes);
+
+    std::vector<uint8_t> data;
+    TEST_CHECK(store.Load(keys[63], data) && data == MakeData(63 * 13, 63));
+}
+
+static void TestCorruptEntries()
+{
+    TempDirectory directory;
+    ShaderCacheStore store(directory.GetPath(), 0);
+    std::vector<uint8_t> blob = MakeData(256, 1);
+    std::vector<uint8_t> data;
+
+    // A flipped payload byte fails the checksum; the entry is deleted, so the next lookup is a plain miss
+    ShaderCacheKey flipped = MakeKey(0x10, 1);
+    TEST_CHECK(store.Store(flipped, blob.data(), blob.size()));
+    {
+        FILE* file = fopen(store.GetEntryPath(flipped).c_str(), "r+b");
+        TEST_CHECK(file != nullptr);
+        fseek(file, long(HEADER_SIZE + 100), SEEK_SET);
+        fputc(blob[100] ^ 1, file);
+        fclose(file);
+    }
+    TEST_CHECK(!store.Load(flipped, data));
+    TEST_CHECK(!FileExists(store.GetEntryPath(flipped)));
+    TEST_CHECK(store.GetStats().CorruptEntries == 1);
+    TEST_CHECK(!store.Load(flipped, data));
+    TEST_CHECK(store.GetStats().CorruptEntries == 1);
+
+    // A truncated payload
+    ShaderCacheKey truncated = MakeKey(0x20, 2);
+    TEST_CHECK(store.Store(truncated, blob.data(), blob.size()));
+    TEST_CHECK(truncate(store.GetEntryPath(truncated).c_str(), HEADER_SIZE + 10) == 0);
+    TEST_CHECK(!store.Load(truncated, data));
+
+    // A header that is cut short, a wrong magic, and a payload size past the limit
+    ShaderCacheKey shortHeader = MakeKey(0x30, 3);
+    TEST_CHECK(store.Store(shortHeader, blob.data(), blob.size()));
+    TEST_CHECK(truncate(store.GetEntryPath(shortHeader).c_str(), HEADER_SIZE - 1) == 0);
+    TEST_CHECK(!store.Load(shortHeader, data));
+
+    ShaderCacheKey badMagic = MakeKey(0x40, 4);
+    TEST_CHECK(store.Store(badMagic, blob.data(), blob.size()));
+    {
+        FILE* file = fopen(store.GetEntryPath(badMagic).c_str(), "r+b");
+        fputc('X', file);
+        fclose(file);
+    }
+    TEST_CHECK(!store.Load(badMagic, data));
+
+    ShaderCacheKey hugeSize = MakeKey(0x50, 5);
+    TEST_CHECK(store.Store(hugeSize, blob.data(), blob.size()));
+    {
+        FILE* file = fopen(store.GetEntryPath(hugeSize).c_str(), "r+b");
+        uint64_t size = 1ull << 40;
+        fseek(file, 8, SEEK_SET);
+        fwrite(&size, sizeof(size), 1, file);
+        fclose(file);
+    }
+    TEST_CHECK(!store.Load(hugeSize, data));
+
+    ShaderCacheStats stats = store.GetStats();
+    TEST_CHECK(stats.CorruptEntries == 5);
+    TEST_CHECK(stats.TotalBytes == 0);
+
+    // An empty payload is valid
+    ShaderCacheKey empty = MakeKey(0x60, 6);
+    TEST_CHECK(store.Store(empty, nullptr, 0));
+    TEST_CHECK(store.Load(empty, data) && data.empty());
+}
+
+static void TestTrim()
+{
+    TempDirectory directory;
+    const size_t blobSize = 1000;
+    const uint64_t entrySize = HEADER_SIZE + blobSize;
+    std::vector<uint8_t> blob = MakeData(blobSize, 3);
+    std::vector<uint8_t> data;
+
+    {
+        ShaderCacheStore store(directory.GetPath(), 0);
+
+        // Entry i was last used at time 1000 + i, except for entry 0, which is refreshed by a hit below
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            TEST_CHECK(store.Store(MakeKey(i << 4, i), blob.data(), blob.size()));
+            SetFileTime(store.GetEntryPath(MakeKey(i << 4, i)), 1000 + i);
+        }
+
+        TEST_CHECK(store.Load(MakeKey(0, 0), data));
+
+        store.Trim(entrySize * 5);
+        ShaderCacheStats stats = store.GetStats();
+        TEST_CHECK(stats.Evictions == 3);
+        TEST_CHECK(stats.TotalBytes == entrySize * 5);
+
+        // Entries 1..3 were the least recently used
+        for (uint32_t i = 0; i < 8; i++)
+            TEST_CHECK(FileExists(store.GetEntryPath(MakeKey(i << 4, i))) == (i == 0 || i > 3));
+
+        store.Trim(0);
+        TEST_CHECK(store.GetStats().TotalBytes == 0 && store.GetStats().Evictions == 8);
+    }
+
+    // With a size limit, a store that goes over it trims down to 3/4 of the limit
+    const uint64_t limit = entrySize * 8;
+    ShaderCacheStore store(directory.GetPath(), limit);
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        TEST_CHECK(store.Store(MakeKey(i << 4, i), blob.data(), blob.size()));
+        SetFileTime(store.GetEntryPath(MakeKey(i << 4, i)), 1000 + i);
+    }
+    TEST_CHECK(store.GetStats().Evictions == 0 && store.GetStats().TotalBytes == limit);
+
+    TEST_CHECK(store.Store(MakeKey(0xff, 8), blob.data(), blob.size()));
+
+    ShaderCacheStats stats = store.GetStats();
+    TEST_CHECK(stats.TotalBytes <= limit - limit / 4);
+    TEST_CHECK(stats.Evictions == 9 - stats.TotalBytes / entrySize);
+    TEST_CHECK(!FileExists(store.GetEntryPath(MakeKey(0, 0))));
+    TEST_CHECK(FileExists(store.GetEntryPath(MakeKey(0xff, 8))));
+}
+
+static void TestEnvironment()
+{
+    setenv("SHADER_CACHE_TEST_VALUE", "12345", 1);
+    TEST_CHECK(GetShaderCacheEnvironmentValue("SHADER_CACHE_TEST_VALUE", 7) == 12345);
+
+    setenv("SHADER_CACHE_TEST_VALUE", "12x", 1);
+    TEST_CHECK(GetShaderCacheEnvironmentValue("SHADER_CACHE_TEST_VALUE", 7) == 7);
+
+    setenv("SHADER_CACHE_TEST_VALUE", "", 1);
+    TEST_CHECK(GetShaderCacheEnvironmentValue("SHADER_CACHE_TEST_VALUE", 7) == 7);
+
+    unsetenv("SHADER_CACHE_TEST_VALUE");
+    TEST_CHECK(GetShaderCacheEnvironmentValue("SHADER_CACHE_TEST_VALUE", 7) == 7);
+}
+
+int main()
+{
+    TestKeyDerivation();
+    TestRoundTrip();
+    TestCorruptEntries();
+    TestTrim();
+    TestEnvironment();
+
+    printf("ShaderCacheStoreTest passed\n");
+    return 0;
+}
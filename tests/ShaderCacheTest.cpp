@@ -0,0 +1,153 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_ShaderCache.h"
+
+using namespace NVRHI;
+
+// The cache never dereferences the handles, so any distinct addresses will do
+static char g_ShaderObjects[16];
+
+static ShaderHandle MakeHandle(int index)
+{
+    return (ShaderHandle)&g_ShaderObjects[index];
+}
+
+// What the backends do in createShader and destroyShader
+static ShaderHandle CreateShader(ShaderCache& cache, ShaderType::Enum type, uint64_t variant, const std::vector<char>& bytecode, int& nextObject)
+{
+    ShaderHandle shader = cache.Acquire(type, variant, bytecode.data(), bytecode.size());
+    if (shader)
+        return shader;
+
+    shader = MakeHandle(nextObject++);
+    cache.Insert(type, variant, bytecode.data(), bytecode.size(), shader);
+    return shader;
+}
+
+static void TestRefCounts()
+{
+    ShaderCache cache;
+    int nextObject = 0;
+    std::vector<char> bytecode(300, 'a');
+
+    ShaderHandle first = CreateShader(cache, ShaderType::SHADER_PIXEL, 0, bytecode, nextObject);
+    ShaderHandle second = CreateShader(cache, ShaderType::SHADER_PIXEL, 0, bytecode, nextObject);
+    ShaderHandle third = CreateShader(cache, ShaderType::SHADER_PIXEL, 0, bytecode, nextObject);
+
+    TEST_CHECK(first == MakeHandle(0) && second == first && third == first);
+    TEST_CHECK(nextObject == 1);
+    TEST_CHECK(cache.Contains(first));
+
+    ShaderCacheStats stats = cache.GetStats();
+    TEST_CHECK(stats.hits == 2 && stats.misses == 1 && stats.collisions == 0);
+    TEST_CHECK(stats.bytesDeduplicated == 600);
+    TEST_CHECK(stats.uniqueShaders == 1 && stats.references == 3);
+
+    // Only the last release destroys the object
+    TEST_CHECK(!cache.Release(first));
+    TEST_CHECK(!cache.Release(first));
+    TEST_CHECK(cache.GetStats().references == 1);
+    TEST_CHECK(cache.Release(first));
+    TEST_CHECK(!cache.Contains(first));
+    TEST_CHECK(cache.GetStats().uniqueShaders == 0 && cache.GetStats().references == 0);
+
+    // After that the same bytecode creates a new object
+    ShaderHandle recreated = CreateShader(cache, ShaderType::SHADER_PIXEL, 0, bytecode, nextObject);
+    TEST_CHECK(recreated == MakeHandle(1));
+    TEST_CHECK(cache.GetStats().misses == 2);
+
+    // Shaders that the cache does not know, e.g. created from an API interface, are destroyed by the caller
+    TEST_CHECK(cache.Release(MakeHandle(15)));
+    TEST_CHECK(cache.GetStats().uniqueShaders == 1);
+}
+
+static void TestMismatches()
+{
+    ShaderCache cache;
+    int nextObject = 0;
+    std::vector<char> bytecode(64);
+    for (size_t i = 0; i < bytecode.size(); i++)
+        bytecode[i] = char(i);
+
+    ShaderHandle base = CreateShader(cache, ShaderType::SHADER_VERTEX, 1, bytecode, nextObject);
+
+    // The same bytecode with another type or another variant is a different shader
+    ShaderHandle otherType = CreateShader(cache, ShaderType::SHADER_GEOMETRY, 1, bytecode, nextObject);
+    ShaderHandle otherVariant = CreateShader(cache, ShaderType::SHADER_VERTEX, 2, bytecode, nextObject);
+
+    // So is bytecode that differs in one byte, or is a prefix
+    std::vector<char> changed = bytecode;
+    changed[40] ^= 1;
+    ShaderHandle otherBytecode = CreateShader(cache, ShaderType::SHADER_VERTEX, 1, changed, nextObject);
+
+    std::vector<char> prefix(bytecode.begin(), bytecode.begin() + 63);
+    ShaderHandle otherSize = CreateShader(cache, ShaderType::SHADER_VERTEX, 1, prefix, nextObject);
+
+    std::vector<char> empty;
+    ShaderHandle emptyShader = CreateShader(cache, ShaderType::SHADER_VERTEX, 1, empty, nextObject);
+
+    TEST_CHECK(nextObject == 6);
+    ShaderHandle handles[] = { base, otherType, otherVariant, otherBytecode, otherSize, emptyShader };
+    for (int i = 0; i < 6; i++)
+        TEST_CHECK(handles[i] == MakeHandle(i));
+
+    ShaderCacheStats stats = cache.GetStats();
+    TEST_CHECK(stats.hits == 0 && stats.misses == 6);
+    TEST_CHECK(stats.uniqueShaders == 6 && stats.references == 6);
+
+    // Every one of them is found again by its own inputs, the empty bytecode as well
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_GEOMETRY, 1, bytecode, nextObject) == otherType);
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_VERTEX, 2, bytecode, nextObject) == otherVariant);
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_VERTEX, 1, changed, nextObject) == otherBytecode);
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_VERTEX, 1, empty, nextObject) == emptyShader);
+    TEST_CHECK(nextObject == 6);
+
+    stats = cache.GetStats();
+    TEST_CHECK(stats.hits == 4 && stats.misses == 6);
+    TEST_CHECK(stats.bytesDeduplicated == 64 * 3);
+    TEST_CHECK(stats.references == 10);
+    TEST_CHECK(stats.collisions == 0);
+
+    // Releasing one shader leaves the others with the same bytecode alone
+    TEST_CHECK(cache.Release(base));
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_GEOMETRY, 1, bytecode, nextObject) == otherType);
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_VERTEX, 1, bytecode, nextObject) == MakeHandle(6));
+}
+
+static void TestResetStats()
+{
+    ShaderCache cache;
+    int nextObject = 0;
+    std::vector<char> bytecode(16, 'x');
+
+    ShaderHandle shader = CreateShader(cache, ShaderType::SHADER_COMPUTE, 0, bytecode, nextObject);
+    CreateShader(cache, ShaderType::SHADER_COMPUTE, 0, bytecode, nextObject);
+
+    // The counters start over; the shaders and their references stay
+    cache.ResetStats();
+    ShaderCacheStats stats = cache.GetStats();
+    TEST_CHECK(stats.hits == 0 && stats.misses == 0 && stats.bytesDeduplicated == 0);
+    TEST_CHECK(stats.uniqueShaders == 1 && stats.references == 2);
+
+    TEST_CHECK(CreateShader(cache, ShaderType::SHADER_COMPUTE, 0, bytecode, nextObject) == shader);
+    TEST_CHECK(cache.GetStats().hits == 1);
+}
+
+int main()
+{
+    TestRefCounts();
+    TestMismatches();
+    TestResetStats();
+
+    printf("ShaderCacheTest passed\n");
+    return 0;
+}
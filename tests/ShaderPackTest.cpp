@@ -0,0 +1,257 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_ShaderPack.h"
+#include <stddef.h>
+#include <unistd.h>
+
+using namespace VXGI;
+
+static std::vector<uint8_t> MakeBlob(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> blob(size);
+    for (size_t i = 0; i < size; i++)
+        blob[i] = uint8_t(seed * 31 + i);
+    return blob;
+}
+
+static bool FindBlob(const ShaderPack::Reader& reader, const ShaderPack::Key& key, const std::vector<uint8_t>& expected)
+{
+    const void* data = nullptr;
+    size_t size = 0;
+    if (!reader.find(key, &data, &size))
+        return false;
+
+    return size == expected.size() && (size == 0 || memcmp(data, expected.data(), size) == 0);
+}
+
+// Three shaders for two APIs, with blob sizes that need padding
+static void FillWriter(ShaderPack::Writer& writer, std::vector<ShaderPack::Key>& keys, std::vector<std::vector<uint8_t>>& blobs)
+{
+    keys.clear();
+    blobs.clear();
+
+    for (uint32_t api = 1; api <= 2; api++)
+    {
+        for (uint64_t shader = 0; shader < 3; shader++)
+        {
+            keys.push_back(ShaderPack::Key(0x1234, api, 0x1000 + shader));
+            blobs.push_back(MakeBlob(size_t(shader * 37 + api), uint8_t(keys.size())));
+            writer.add(keys.back(), blobs.back().data(), blobs.back().size());
+        }
+    }
+}
+
+static void TestRoundTrip()
+{
+    ShaderPack::Writer writer;
+    std::vector<ShaderPack::Key> keys;
+    std::vector<std::vector<uint8_t>> blobs;
+    FillWriter(writer, keys, blobs);
+    TEST_CHECK(writer.getEntryCount() == 6);
+
+    std::vector<uint8_t> packed;
+    writer.serialize(packed);
+
+    // Blobs and the index are aligned, and the index ends the pack
+    ShaderPack::Header header;
+    memcpy(&header, packed.data(), sizeof(header));
+    TEST_CHECK(header.magic == ShaderPack::MAGIC && header.version == ShaderPack::VERSION && header.entryCount == 6);
+    TEST_CHECK(header.indexOffset % ShaderPack::BLOB_ALIGNMENT == 0);
+    TEST_CHECK(packed.size() == header.indexOffset + sizeof(ShaderPack::Entry) * 6);
+
+    for (uint32_t i = 0; i < header.entryCount; i++)
+    {
+        ShaderPack::Entry entry;
+        memcpy(&entry, packed.data() + header.indexOffset + sizeof(entry) * i, sizeof(entry));
+        TEST_CHECK(entry.dataOffset % ShaderPack::BLOB_ALIGNMENT == 0);
+        TEST_CHECK(entry.dataSize == blobs[i].size());
+    }
+
+    ShaderPack::Reader reader;
+    TEST_CHECK(reader.load(packed.data(), packed.size()));
+    TEST_CHECK(reader.getEntryCount() == 6);
+
+    for (size_t i = 0; i < keys.size(); i++)
+        TEST_CHECK(FindBlob(reader, keys[i], blobs[i]));
+
+    // Each field of the key matters
+    const void* data = nullptr;
+    size_t size = 0;
+    TEST_CHECK(!reader.find(ShaderPack::Key(0x1235, 1, 0x1000), &data, &size));
+    TEST_CHECK(!reader.find(ShaderPack::Key(0x1234, 3, 0x1000), &data, &size));
+    TEST_CHECK(!reader.find(ShaderPack::Key(0x1234, 1, 0x1003), &data, &size));
+
+    // The reader keeps a copy, so the input buffer can go away
+    std::vector<uint8_t> copy = packed;
+    TEST_CHECK(reader.load(copy.data(), copy.size()));
+    memset(copy.data(), 0, copy.size());
+    TEST_CHECK(FindBlob(reader, keys[4], blobs[4]));
+
+    // The same through a file
+    char path[] = "/tmp/ShaderPackTest.XXXXXX";
+    int fd = mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    close(fd);
+
+    TEST_CHECK(writer.writeFile(path));
+    TEST_CHECK(access((std::string(path) + ".tmp").c_str(), F_OK) != 0);
+
+    ShaderPack::Reader fileReader;
+    TEST_CHECK(fileReader.loadFile(path));
+    TEST_CHECK(fileReader.getEntryCount() == 6);
+    for (size_t i = 0; i < keys.size(); i++)
+        TEST_CHECK(FindBlob(fileReader, keys[i], blobs[i]));
+
+    // Writing over an existing pack replaces it
+    ShaderPack::Writer smaller;
+    smaller.add(keys[0], blobs[1].data(), blobs[1].size());
+    TEST_CHECK(smaller.writeFile(path));
+    TEST_CHECK(fileReader.loadFile(path));
+    TEST_CHECK(fileReader.getEntryCount() == 1 && FindBlob(fileReader, keys[0], blobs[1]));
+
+    remove(path);
+    TEST_CHECK(!fileReader.loadFile(path));
+    TEST_CHECK(fileReader.getEntryCount() == 0);
+
+    // An empty pack is valid
+    ShaderPack::Writer empty;
+    empty.serialize(packed);
+    TEST_CHECK(packed.size() == sizeof(ShaderPack::Header));
+    TEST_CHECK(reader.load(packed.data(), packed.size()));
+    TEST_CHECK(reader.getEntryCount() == 0 && !reader.find(keys[0], &data, &size));
+}
+
+static void TestReplace()
+{
+    ShaderPack::Writer writer;
+    std::vector<ShaderPack::Key> keys;
+    std::vector<std::vector<uint8_t>> blobs;
+    FillWriter(writer, keys, blobs);
+
+    // Adding an existing key replaces its blob instead of adding a second entry; an empty blob is allowed
+    std::vector<uint8_t> replacement = MakeBlob(1000, 77);
+    writer.add(keys[2], replacement.data(), replacement.size());
+    writer.add(keys[5], nullptr, 0);
+    TEST_CHECK(writer.getEntryCount() == 6);
+
+    std::vector<uint8_t> packed;
+    writer.serialize(packed);
+
+    ShaderPack::Reader reader;
+    TEST_CHECK(reader.load(packed.data(), packed.size()));
+    TEST_CHECK(reader.getEntryCount() == 6);
+    TEST_CHECK(FindBlob(reader, keys[2], replacement));
+    TEST_CHECK(FindBlob(reader, keys[5], std::vector<uint8_t>()));
+    TEST_CHECK(FindBlob(reader, keys[1], blobs[1]));
+    TEST_CHECK(FindBlob(reader, keys[3], blobs[3]));
+}
+
+static void TestCorruption()
+{
+    ShaderPack::Writer writer;
+    std::vector<ShaderPack::Key> keys;
+    std::vector<std::vector<uint8_t>> blobs;
+    FillWriter(writer, keys, blobs);
+
+    std::vector<uint8_t> packed;
+    writer.serialize(packed);
+
+    ShaderPack::Header header;
+    memcpy(&header, packed.data(), sizeof(header));
+    ShaderPack::Entry entry;
+    memcpy(&entry, packed.data() + header.indexOffset + sizeof(ShaderPack::Entry) * 4, sizeof(entry));
+
+    ShaderPack::Reader reader;
+
+    // A damaged blob only loses that entry
+    {
+        std::vector<uint8_t> damaged = packed;
+        damaged[size_t(entry.dataOffset + entry.dataSize / 2)] ^= 0x40;
+        TEST_CHECK(reader.load(damaged.data(), damaged.size()));
+        TEST_CHECK(!FindBlob(reader, keys[4], blobs[4]));
+        for (size_t i = 0; i < keys.size(); i++)
+            TEST_CHECK(i == 4 || FindBlob(reader, keys[i], blobs[i]));
+    }
+
+    // Any damaged byte of the index or the header rejects the whole pack
+    for (size_t offset = 0; offset < packed.size(); offset++)
+    {
+        if (offset >= sizeof(ShaderPack::Header) && offset < header.indexOffset)
+            continue;
+
+        // The reserved header field is not checked
+        if (offset >= offsetof(ShaderPack::Header, reserved) && offset < offsetof(ShaderPack::Header, indexOffset))
+            continue;
+
+        std::vector<uint8_t> damaged = packed;
+        damaged[offset] ^= 0x01;
+        TEST_CHECK(!reader.load(damaged.data(), damaged.size()));
+        TEST_CHECK(reader.getEntryCount() == 0);
+    }
+
+    // A blob range outside of the data area, with a recomputed index checksum, is rejected as well
+    {
+        std::vector<uint8_t> damaged = packed;
+        ShaderPack::Entry* index = (ShaderPack::Entry*)(damaged.data() + header.indexOffset);
+        index[1].dataSize = header.indexOffset;
+        ShaderPack::Header* damagedHeader = (ShaderPack::Header*)damaged.data();
+        damagedHeader->indexChecksum = NVRHI::Hash::HashBytes(index, sizeof(ShaderPack::Entry) * header.entryCount);
+        TEST_CHECK(!reader.load(damaged.data(), damaged.size()));
+
+        index[1].dataSize = 0;
+        index[1].dataOffset = 8;
+        damagedHeader->indexChecksum = NVRHI::Hash::HashBytes(index, sizeof(ShaderPack::Entry) * header.entryCount);
+        TEST_CHECK(!reader.load(damaged.data(), damaged.size()));
+    }
+
+    // Another version
+    {
+        std::vector<uint8_t> damaged = packed;
+        ((ShaderPack::Header*)damaged.data())->version = ShaderPack::VERSION + 1;
+        TEST_CHECK(!reader.load(damaged.data(), damaged.size()));
+    }
+
+    // Truncated anywhere, or with trailing bytes
+    for (size_t size = 0; size < packed.size(); size++)
+        TEST_CHECK(!reader.load(packed.data(), size));
+
+    std::vector<uint8_t> extended = packed;
+    extended.push_back(0);
+    TEST_CHECK(!reader.load(extended.data(), extended.size()));
+
+    TEST_CHECK(reader.load(packed.data(), packed.size()));
+    TEST_CHECK(reader.getEntryCount() == 6);
+}
+
+static void TestHashSource()
+{
+    const char tag[] = "VoxelizationPS";
+    const char source[] = "float4 main() : SV_Target { return 0; }";
+
+    uint64_t hash = ShaderPack::HashSource(tag, sizeof(tag));
+    uint64_t chained = ShaderPack::HashSource(source, sizeof(source), hash);
+
+    TEST_CHECK(chained == ShaderPack::HashSource(source, sizeof(source), ShaderPack::HashSource(tag, sizeof(tag))));
+    TEST_CHECK(chained != ShaderPack::HashSource(source, sizeof(source)));
+    TEST_CHECK(chained != ShaderPack::HashSource(tag, sizeof(tag), ShaderPack::HashSource(source, sizeof(source))));
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestReplace();
+    TestCorruption();
+    TestHashSource();
+
+    printf("ShaderPackTest passed\n");
+    return 0;
+}
@@ -0,0 +1,234 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// The compile policy of samples/d3dcompiler_hook: the rules file, the rule matcher and the telemetry format
+
+#include "TestCommon.h"
+#include "shader_policy.h"
+#include <string.h>
+#include <unistd.h>
+
+static void TestPatterns()
+{
+    TEST_CHECK(MatchShaderPolicyPattern("*", ""));
+    TEST_CHECK(MatchShaderPolicyPattern("*", "main"));
+    TEST_CHECK(MatchShaderPolicyPattern("main", "main"));
+    TEST_CHECK(!MatchShaderPolicyPattern("main", "mainPS"));
+    TEST_CHECK(!MatchShaderPolicyPattern("main", "mai"));
+    TEST_CHECK(MatchShaderPolicyPattern("ps_5_?", "ps_5_0"));
+    TEST_CHECK(!MatchShaderPolicyPattern("ps_5_?", "ps_5_"));
+    TEST_CHECK(MatchShaderPolicyPattern("*PS", "VoxelizationPS"));
+    TEST_CHECK(!MatchShaderPolicyPattern("*PS", "VoxelizationPS2"));
+    TEST_CHECK(MatchShaderPolicyPattern("Vox*ion*", "VoxelizationPS"));
+    TEST_CHECK(MatchShaderPolicyPattern("a*b*c", "aXbYbZc"));
+    TEST_CHECK(!MatchShaderPolicyPattern("a*b*c", "aXbYcZ"));
+    TEST_CHECK(MatchShaderPolicyPattern("**?", "x"));
+    TEST_CHECK(!MatchShaderPolicyPattern("", "x"));
+    TEST_CHECK(MatchShaderPolicyPattern("", ""));
+}
+
+static void TestParse()
+{
+    ShaderPolicy policy;
+    std::string errors;
+
+    const char* text =
+        "# Comment line\n"
+        "\n"
+        "   \t  \n"
+        "*      *       *    optimization=3 debug=0      # all shaders\n"
+        "main*  ps_5_?  *    strip=debug,reflection ieee=on\n"
+        "*      cs_*    abcd backcompat=false\n"
+        "*      vs_5_0  *\n";
+
+    TEST_CHECK(policy.Parse(text, errors));
+    TEST_CHECK(errors.empty());
+    TEST_CHECK(policy.GetRuleCount() == 4);
+
+    // Every setting and its accepted values
+    TEST_CHECK(policy.Parse(
+        "* * * optimization=skip\n"
+        "* * * optimization=0 optimization=1 optimization=2\n"
+        "* * * debug=1 debug=true debug=off\n"
+        "* * * strip=none strip=all strip=private strip=\n", errors));
+    TEST_CHECK(policy.GetRuleCount() == 4);
+
+    // Invalid lines are skipped, each error names its line, and the valid lines are kept
+    const char* invalid =
+        "* * * optimization=4\n"
+        "* * * debug=yes\n"
+        "* *\n"
+        "* * * strip=debug,symbols\n"
+        "* * * unknown=1\n"
+        "* * * debug\n"
+        "* * * debug=0\n";
+
+    TEST_CHECK(!policy.Parse(invalid, errors));
+    TEST_CHECK(policy.GetRuleCount() == 1);
+    TEST_CHECK(errors ==
+        "line 1: invalid setting 'optimization=4'\n"
+        "line 2: invalid setting 'debug=yes'\n"
+        "line 3: expected <entry point> <target> <source hash> <settings>\n"
+        "line 4: invalid setting 'strip=debug,symbols'\n"
+        "line 5: invalid setting 'unknown=1'\n"
+        "line 6: invalid setting 'debug'\n");
+
+    int line = 0;
+    policy.Resolve("main", "ps_5_0", "0123456789abcdef", &line);
+    TEST_CHECK(line == 7);
+
+    // Parsing again replaces the rules
+    TEST_CHECK(policy.Parse("", errors));
+    TEST_CHECK(policy.GetRuleCount() == 0);
+
+    // LoadFile reads the same format; a missing file is an error and leaves no rules
+    char path[] = "/tmp/ShaderPolicyTest.XXXXXX";
+    int fd = mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    TEST_CHECK(write(fd, text, strlen(text)) == ssize_t(strlen(text)));
+    close(fd);
+
+    TEST_CHECK(policy.LoadFile(path, errors));
+    TEST_CHECK(policy.GetRuleCount() == 4);
+    remove(path);
+
+    TEST_CHECK(!policy.LoadFile(path, errors));
+    TEST_CHECK(policy.GetRuleCount() == 0);
+    TEST_CHECK(errors == std::string("cannot open ") + path + "\n");
+}
+
+static void TestDefaults()
+{
+    // Without rules, or when no rule matches, the hook keeps the flags it always forced
+    ShaderCompileSettings defaults;
+    TEST_CHECK(defaults.OptimizationLevel == ShaderCompileSettings::SKIP_OPTIMIZATION);
+    TEST_CHECK(defaults.Debug && !defaults.IeeeStrictness && defaults.BackwardsCompatibility);
+    TEST_CHECK(defaults.StripFlags == 0);
+
+    ShaderPolicy policy;
+    int line = -1;
+    ShaderCompileSettings settings = policy.Resolve("main", "ps_5_0", "0123456789abcdef", &line);
+    TEST_CHECK(line == 0);
+    TEST_CHECK(settings.OptimizationLevel == defaults.OptimizationLevel && settings.Debug == defaults.Debug);
+    TEST_CHECK(settings.IeeeStrictness == defaults.IeeeStrictness && settings.BackwardsCompatibility == defaults.BackwardsCompatibility);
+    TEST_CHECK(settings.StripFlags == defaults.StripFlags);
+
+    std::string errors;
+    TEST_CHECK(policy.Parse("CSMain cs_5_0 * optimization=3 debug=0 ieee=1 backcompat=0 strip=all\n", errors));
+
+    settings = policy.Resolve("main", "ps_5_0", "0123456789abcdef", &line);
+    TEST_CHECK(line == 0);
+    TEST_CHECK(settings.OptimizationLevel == defaults.OptimizationLevel && settings.Debug == defaults.Debug);
+    TEST_CHECK(settings.IeeeStrictness == defaults.IeeeStrictness && settings.BackwardsCompatibility == defaults.BackwardsCompatibility);
+    TEST_CHECK(settings.StripFlags == defaults.StripFlags);
+
+    // A null line pointer is allowed
+    policy.Resolve("CSMain", "cs_5_0", "", nullptr);
+}
+
+static void TestLastMatchWins()
+{
+    ShaderPolicy policy;
+    std::string errors;
+
+    TEST_CHECK(policy.Parse(
+        "*       *       *      optimization=3 debug=0 strip=debug\n"   // 1
+        "*       ps_*    *      optimization=1\n"                       // 2
+        "main*   *       *      debug=1\n"                              // 3
+        "*       *       abcd   optimization=skip strip=none\n"         // 4
+        "*       *       ab*9   ieee=1\n"                               // 5
+        "*       *       *      \n", errors));                          // 6, matches everything and changes nothing
+    TEST_CHECK(policy.GetRuleCount() == 6);
+
+    int line = 0;
+    ShaderCompileSettings settings = policy.Resolve("CSMain", "cs_5_0", "ffff000000000000", &line);
+    TEST_CHECK(line == 6);
+    TEST_CHECK(settings.OptimizationLevel == 3 && !settings.Debug && settings.StripFlags == SHADER_STRIP_DEBUG_INFO);
+    TEST_CHECK(!settings.IeeeStrictness && settings.BackwardsCompatibility);
+
+    // Later rules override only the settings they name
+    settings = policy.Resolve("mainPS", "ps_5_0", "ffff000000000000", &line);
+    TEST_CHECK(settings.OptimizationLevel == 1 && settings.Debug && settings.StripFlags == SHADER_STRIP_DEBUG_INFO);
+
+    // A source hash pattern without wildcards is a prefix; with wildcards it must match the whole hash
+    settings = policy.Resolve("mainPS", "ps_5_0", "abcd000000000009", &line);
+    TEST_CHECK(settings.OptimizationLevel == ShaderCompileSettings::SKIP_OPTIMIZATION && settings.Debug);
+    TEST_CHECK(settings.StripFlags == 0 && settings.IeeeStrictness);
+
+    settings = policy.Resolve("mainPS", "ps_5_0", "abcd000000000090", &line);
+    TEST_CHECK(settings.StripFlags == 0 && !settings.IeeeStrictness);
+
+    settings = policy.Resolve("mainPS", "ps_5_0", "abc", &line);
+    TEST_CHECK(settings.OptimizationLevel == 1);
+
+    // Rule order decides, not how specific a rule is
+    TEST_CHECK(policy.Parse(
+        "main ps_5_0 0123 optimization=0\n"
+        "*    *      *    optimization=2\n", errors));
+    settings = policy.Resolve("main", "ps_5_0", "0123456789abcdef", &line);
+    TEST_CHECK(settings.OptimizationLevel == 2 && line == 2);
+}
+
+static void TestTelemetry()
+{
+    TEST_CHECK(FormatShaderSourceHash("abc", 3).size() == 16);
+    TEST_CHECK(FormatShaderSourceHash("abc", 3) == FormatShaderSourceHash("abcd", 3));
+    TEST_CHECK(FormatShaderSourceHash("abc", 3) != FormatShaderSourceHash("abd", 3));
+    TEST_CHECK(FormatShaderSourceHash("abc", 3).find_first_not_of("0123456789abcdef") == std::string::npos);
+
+    CompileTelemetryRecord record;
+    record.Result = "miss";
+    record.Milliseconds = 12.3456;
+    record.Key = "0123456789abcdeffedcba9876543210";
+    record.SourceHash = "00000000deadbeef";
+    record.SourceName = "C:\\shaders\\\"quoted\"\tname\n\x01";
+    record.EntryPoint = "main";
+    record.Target = "ps_5_0";
+    record.Flags1 = 0x800;
+    record.StripFlags = 3;
+    record.RuleLine = 7;
+    record.BlobBytes = 4096;
+
+    std::string line = FormatCompileTelemetry(record);
+    TEST_CHECK(line ==
+        "{\"result\":\"miss\",\"ms\":12.346,\"key\":\"0123456789abcdeffedcba9876543210\",\"sourceHash\":\"00000000deadbeef\","
+        "\"source\":\"C:\\\\shaders\\\\\\\"quoted\\\"\\tname\\n\\u0001\",\"entry\":\"main\",\"target\":\"ps_5_0\","
+        "\"flags1\":2048,\"strip\":3,\"ruleLine\":7,\"bytes\":4096}");
+    TEST_CHECK(line.find('\n') == std::string::npos);
+
+    // The reflection counters are only written when they are known
+    record.SourceName = "";
+    record.bHasReflection = true;
+    record.InstructionCount = 100;
+    record.TempRegisterCount = 8;
+    record.TextureInstructionCount = 4;
+    record.FloatInstructionCount = 60;
+    record.IntInstructionCount = 10;
+    record.FlowControlCount = 2;
+
+    const std::string reflection =
+        ",\"bytes\":4096,\"instructions\":100,\"tempRegisters\":8,\"textureInstructions\":4,\"floatInstructions\":60,\"intInstructions\":10,\"flowControl\":2}";
+
+    line = FormatCompileTelemetry(record);
+    TEST_CHECK(line.find("\"source\":\"\",") != std::string::npos);
+    TEST_CHECK(line.size() > reflection.size() && line.compare(line.size() - reflection.size(), reflection.size(), reflection) == 0);
+}
+
+int main()
+{
+    TestPatterns();
+    TestParse();
+    TestDefaults();
+    TestLastMatchWins();
+    TestTelemetry();
+
+    printf("ShaderPolicyTest passed\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// The D3D11 resource tracking before and after the slot maps. Resource churn: creating and destroying
+// resources over a live set, with the handles resolved a few times per resource like a frame's draw calls.
+// Before, the handles were std::map nodes keyed by the resource pointer; after, they are slot map ids with
+// an unordered_map from the resource pointer to the id. View lookup: a texture's views in per-type std::maps
+// keyed by (format, mip), against one OpenHashTable keyed by the packed view key.
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_SlotMap.h"
+#include <map>
+#include <random>
+#include <unordered_map>
+
+using namespace NVRHI;
+
+// About the size of TextureViewSet without the views
+struct Resource
+{
+    void* resource;
+    char desc[120];
+
+    Resource() : resource(nullptr) { }
+};
+
+static const int CHURN_OPERATIONS = 2000000;
+static const int RESOLVES_PER_RESOURCE = 8;
+
+template<typename Create, typename Resolve, typename Destroy>
+static double RunChurn(uint32_t liveResources, Create create, Resolve resolve, Destroy destroy)
+{
+    // Precomputed slots, so that the random number generator stays out of the measurement
+    std::mt19937 rng(liveResources);
+    std::vector<uint32_t> slots(1 << 16);
+    for (auto& slot : slots)
+        slot = rng() % liveResources;
+
+    std::vector<uintptr_t> handles(liveResources, 0);
+    uintptr_t nextResource = 16;
+    uintptr_t checksum = 0;
+
+    TestTimer timer;
+    for (int i = 0; i < CHURN_OPERATIONS; i++)
+    {
+        uintptr_t& handle = handles[slots[i & 0xFFFF]];
+        if (handle)
+            destroy(handle);
+        handle = create((void*)nextResource);
+        nextResource += 16;
+
+        for (int j = 0; j < RESOLVES_PER_RESOURCE; j++)
+            checksum += (uintptr_t)resolve(handles[slots[(i * RESOLVES_PER_RESOURCE + j) & 0xFFFF]]);
+    }
+    double ms = timer.GetMs();
+
+    for (uintptr_t handle : handles)
+        if (handle)
+            destroy(handle);
+
+    TEST_CHECK(checksum != 1);
+    return ms;
+}
+
+static void Churn(uint32_t liveResources)
+{
+    std::map<void*, Resource> nodes;
+    double mapMs = RunChurn(liveResources,
+        [&](void* resource) { Resource& r = nodes[resource]; r.resource = resource; return (uintptr_t)&r; },
+        [](uintptr_t handle) { return handle ? ((Resource*)handle)->resource : nullptr; },
+        [&](uintptr_t handle) { nodes.erase(((Resource*)handle)->resource); });
+
+    SlotMap<Resource> slots;
+    std::unordered_map<void*, SlotMap<Resource>::Id> lookup;
+    double slotMapMs = RunChurn(liveResources,
+        [&](void* resource)
+        {
+            Resource r;
+            r.resource = resource;
+            SlotMap<Resource>::Id id = slots.Insert(r);
+            lookup[resource] = id;
+            return id;
+        },
+        [&](uintptr_t handle) { Resource* r = slots.Get(handle); return r ? r->resource : nullptr; },
+        [&](uintptr_t handle) { lookup.erase(slots.Get(handle)->resource); slots.Remove(handle); });
+
+    TEST_CHECK(nodes.empty() && slots.GetSize() == 0 && lookup.empty());
+
+    printf("churn, %6u live resources: std::map %7.1f ms, slot map + lookup %7.1f ms, %5.2fx\n",
+        liveResources, mapMs, slotMapMs, mapMs / slotMapMs);
+}
+
+static const int VIEW_LOOKUPS = 20000000;
+
+static void Views(uint32_t mipLevels, uint32_t formats)
+{
+    enum { VIEW_SRV = 1, VIEW_UAV = 4 };
+
+    // The same sequence of (type, format, mip) lookups for both, all of them hits as in a steady frame
+    std::mt19937 rng(mipLevels * formats);
+    std::vector<uint32_t> requests(1 << 16);
+    for (auto& request : requests)
+        request = ((rng() & 1) ? VIEW_UAV : VIEW_SRV) << 24 | (rng() % formats) << 8 | (rng() % mipLevels);
+
+    std::map<std::pair<uint32_t, uint32_t>, void*> srvs, uavs;
+    OpenHashTable<void*> table;
+    for (uint32_t request : requests)
+    {
+        uint32_t type = request >> 24, format = (request >> 8) & 0xFF, mip = request & 0xFF;
+        void* view = (void*)uintptr_t(request);
+        (type == VIEW_SRV ? srvs : uavs)[std::make_pair(format, mip)] = view;
+        table[(uint64_t(type) << 60) | (uint64_t(format) << 44) | mip] = view;
+    }
+
+    uintptr_t mapSum = 0;
+    TestTimer mapTimer;
+    for (int i = 0; i < VIEW_LOOKUPS; i++)
+    {
+        uint32_t request = requests[i & 0xFFFF];
+        uint32_t type = request >> 24, format = (request >> 8) & 0xFF, mip = request & 0xFF;
+        mapSum += (uintptr_t)(type == VIEW_SRV ? srvs : uavs)[std::make_pair(format, mip)];
+    }
+    double mapMs = mapTimer.GetMs();
+
+    uintptr_t tableSum = 0;
+    TestTimer tableTimer;
+    for (int i = 0; i < VIEW_LOOKUPS; i++)
+    {
+        uint32_t request = requests[i & 0xFFFF];
+        uint32_t type = request >> 24, format = (request >> 8) & 0xFF, mip = request & 0xFF;
+        tableSum += (uintptr_t)table[(uint64_t(type) << 60) | (uint64_t(format) << 44) | mip];
+    }
+    double tableMs = tableTimer.GetMs();
+
+    TEST_CHECK(mapSum == tableSum);
+
+    printf("views, %2u mips x %u formats x 2 types (%3u views): std::map %6.1f ms, OpenHashTable %6.1f ms, %5.2fx\n",
+        mipLevels, formats, uint32_t(table.GetSize()), mapMs, tableMs, mapMs / tableMs);
+}
+
+int main()
+{
+    Churn(1000);
+    Churn(10000);
+    Churn(100000);
+
+    Views(1, 1);
+    Views(12, 2);
+    Views(12, 8);
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_SlotMap.h"
+#include <string>
+
+using namespace NVRHI;
+
+static void TestSlotMap()
+{
+    typedef SlotMap<int, 4> Map;
+    Map map;
+
+    TEST_CHECK(map.Get(0) == nullptr && !map.IsValid(0) && !map.Remove(0));
+
+    std::vector<Map::Id> ids;
+    std::vector<int*> pointers;
+    for (int i = 0; i < 10; i++)
+    {
+        ids.push_back(map.Insert(i * 10));
+        TEST_CHECK(ids.back() != 0);
+        TEST_CHECK((ids.back() & Map::INDEX_MASK) == Map::Id(i));
+        pointers.push_back(map.Get(ids.back()));
+    }
+    TEST_CHECK(map.GetSize() == 10 && map.GetCapacity() == 10);
+
+    // The objects are not moved when more chunks are added
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_CHECK(map.Get(ids[i]) == pointers[i]);
+        TEST_CHECK(*pointers[i] == i * 10);
+    }
+
+    // A removed id stays invalid after its slot is reused; the new id differs only in the generation
+    TEST_CHECK(map.Remove(ids[3]));
+    TEST_CHECK(!map.Remove(ids[3]));
+    TEST_CHECK(map.Get(ids[3]) == nullptr && !map.IsValid(ids[3]));
+    TEST_CHECK(map.GetSize() == 9);
+
+    Map::Id reused = map.Insert(333);
+    TEST_CHECK(reused != ids[3]);
+    TEST_CHECK((reused & Map::INDEX_MASK) == (ids[3] & Map::INDEX_MASK));
+    TEST_CHECK((reused >> Map::INDEX_BITS) == (ids[3] >> Map::INDEX_BITS) + 1);
+    TEST_CHECK(map.Get(reused) == pointers[3] && *map.Get(reused) == 333);
+    TEST_CHECK(map.Get(ids[3]) == nullptr);
+    TEST_CHECK(map.GetCapacity() == 10);
+
+    // Ids with an index beyond the capacity, or a generation that was never issued, do not resolve
+    TEST_CHECK(map.Get(ids[9] + 1) == nullptr);
+    TEST_CHECK(map.Get(ids[5] + (Map::Id(5) << Map::INDEX_BITS)) == nullptr);
+
+    // Free slots are reused last-in first-out
+    TEST_CHECK(map.Remove(ids[1]) && map.Remove(ids[7]));
+    TEST_CHECK((map.Insert(7) & Map::INDEX_MASK) == 7);
+    TEST_CHECK((map.Insert(1) & Map::INDEX_MASK) == 1);
+    TEST_CHECK((map.Insert(10) & Map::INDEX_MASK) == 10);
+    TEST_CHECK(map.GetSize() == 11 && map.GetCapacity() == 11);
+
+    // ForEach visits the live objects with their current ids, in slot order
+    std::vector<Map::Id> visited;
+    int sum = 0;
+    map.ForEach([&](Map::Id id, int& value)
+    {
+        TEST_CHECK(map.Get(id) == &value);
+        visited.push_back(id);
+        sum += value;
+    });
+    TEST_CHECK(visited.size() == 11);
+    for (size_t i = 1; i < visited.size(); i++)
+        TEST_CHECK((visited[i] & Map::INDEX_MASK) == (visited[i - 1] & Map::INDEX_MASK) + 1);
+    TEST_CHECK(sum == 0 + 1 + 20 + 333 + 40 + 50 + 60 + 7 + 80 + 90 + 10);
+
+    // Clear invalidates every id but keeps the slots
+    map.Clear();
+    TEST_CHECK(map.GetSize() == 0 && map.GetCapacity() == 11);
+    for (Map::Id id : visited)
+        TEST_CHECK(!map.IsValid(id));
+    map.ForEach([](Map::Id, int&) { TEST_CHECK(false); });
+
+    Map::Id afterClear = map.Insert(5);
+    for (Map::Id id : visited)
+        TEST_CHECK(id != afterClear);
+}
+
+static void TestSlotMapValues()
+{
+    // Removing an object destroys its value right away, not when the slot is reused
+    std::shared_ptr<int> object = std::make_shared<int>(1);
+    SlotMap<std::shared_ptr<int>> map;
+
+    SlotMap<std::shared_ptr<int>>::Id id = map.Insert(object);
+    TEST_CHECK(object.use_count() == 2);
+    TEST_CHECK(map.Remove(id));
+    TEST_CHECK(object.use_count() == 1);
+
+    map.Insert(object);
+    map.Insert(object);
+    map.Clear();
+    TEST_CHECK(object.use_count() == 1);
+}
+
+static void TestSlotMapCapacity()
+{
+    // The index bits limit the number of slots; after that Insert fails until a slot is freed
+    typedef SlotMap<uint32_t, 4096> Map;
+    Map map;
+
+    Map::Id first = 0;
+    for (uint32_t i = 0; i <= Map::INDEX_MASK; i++)
+    {
+        Map::Id id = map.Insert(i);
+        TEST_CHECK(id != 0);
+        if (i == 0)
+            first = id;
+    }
+    TEST_CHECK(map.GetCapacity() == Map::INDEX_MASK + 1);
+
+    TEST_CHECK(map.Insert(0) == 0);
+    TEST_CHECK(map.GetSize() == Map::INDEX_MASK + 1);
+
+    TEST_CHECK(map.Remove(first));
+    Map::Id reused = map.Insert(7);
+    TEST_CHECK(reused != 0 && (reused & Map::INDEX_MASK) == 0);
+    TEST_CHECK(*map.Get(Map::INDEX_MASK | (Map::Id(1) << Map::INDEX_BITS)) == Map::INDEX_MASK);
+}
+
+static void TestHashTable()
+{
+    OpenHashTable<std::string> table;
+
+    TEST_CHECK(table.Find(1) == nullptr && table.GetSize() == 0);
+
+    // Key 0 is the empty marker and is never found, even in a table with empty buckets
+    table[1] = "one";
+    TEST_CHECK(table.Find(0) == nullptr);
+    TEST_CHECK(*table.Find(1) == "one");
+
+    // operator[] inserts a default value once and returns the same entry afterwards
+    TEST_CHECK(table[2].empty());
+    table[2] = "two";
+    TEST_CHECK(table[2] == "two" && table.GetSize() == 2);
+
+    // Keys like the D3D11 view keys, which differ only in a few high or low bits, and growth from 8 buckets
+    // to thousands: every entry keeps its value through the rehashes
+    std::vector<uint64_t> keys;
+    for (uint64_t type = 1; type <= 4; type++)
+        for (uint64_t format = 0; format < 16; format++)
+            for (uint64_t mip = 0; mip < 32; mip++)
+                keys.push_back((type << 60) | (format << 44) | mip);
+
+    for (uint64_t key : keys)
+        table[key] = std::to_string(key);
+    TEST_CHECK(table.GetSize() == keys.size() + 2);
+
+    for (uint64_t key : keys)
+    {
+        std::string* value = table.Find(key);
+        TEST_CHECK(value != nullptr && *value == std::to_string(key));
+    }
+    TEST_CHECK(*table.Find(1) == "one" && *table.Find(2) == "two");
+
+    // Keys that were not inserted are not found, including ones that probe past many occupied buckets
+    for (uint64_t key : keys)
+        TEST_CHECK(table.Find(key | (uint64_t(1) << 40)) == nullptr);
+    TEST_CHECK(table.Find(3) == nullptr && table.Find(~uint64_t(0)) == nullptr);
+
+    // Updating existing keys adds no entries, and while the table has room, nothing moves
+    std::string* stable = table.Find(keys[10]);
+    for (uint64_t key : keys)
+        table[key] += "!";
+    TEST_CHECK(table.Find(keys[10]) == stable);
+    TEST_CHECK(*stable == std::to_string(keys[10]) + "!");
+    TEST_CHECK(table.GetSize() == keys.size() + 2);
+
+    table.Clear();
+    TEST_CHECK(table.GetSize() == 0 && table.Find(1) == nullptr && table.Find(keys[0]) == nullptr);
+    table[keys[0]] = "again";
+    TEST_CHECK(*table.Find(keys[0]) == "again" && table.GetSize() == 1);
+}
+
+static void TestHashTableMove()
+{
+    // Growing moves the values, so move-only types work
+    OpenHashTable<std::unique_ptr<int>> table;
+    for (uint64_t key = 1; key <= 100; key++)
+        table[key].reset(new int(int(key)));
+
+    for (uint64_t key = 1; key <= 100; key++)
+        TEST_CHECK(table.Find(key) && **table.Find(key) == int(key));
+}
+
+int main()
+{
+    TestSlotMap();
+    TestSlotMapValues();
+    TestSlotMapCapacity();
+    TestHashTable();
+    TestHashTableMove();
+
+    printf("SlotMapTest passed\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// Lookup cost of StateCache with PodKey, compared to std::unordered_map with the same hash and full-key compare,
+// for keys the size of the D3D11 state descriptors. Also reports the hit rate of a bounded cache.
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_StateCache.h"
+#include <random>
+#include <unordered_map>
+
+using namespace NVRHI;
+
+// Same size as D3D11_RASTERIZER_DESC plus the NVAPI fields that the D3D11 backend adds to its key
+struct RasterKeyDesc
+{
+    uint32_t fields[10];
+    uint32_t nvapiFields[6];
+};
+
+// Same size as D3D11_BLEND_DESC
+struct BlendKeyDesc
+{
+    uint32_t fields[66];
+};
+
+template<typename Desc>
+struct StdHash
+{
+    size_t operator()(const PodKey<Desc>& key) const { return size_t(key.Hash()); }
+};
+
+template<typename Desc>
+static std::vector<PodKey<Desc>> MakeKeys(uint32_t count, std::mt19937& rng)
+{
+    std::vector<PodKey<Desc>> keys(count);
+    for (auto& key : keys)
+    {
+        // Descriptors differ in a few fields only, like real render states
+        uint32_t* fields = (uint32_t*)&key.value;
+        fields[0] = rng() % 4;
+        fields[3] = rng() % 8;
+        fields[sizeof(Desc) / sizeof(uint32_t) - 1] = rng();
+    }
+    return keys;
+}
+
+template<typename Desc>
+static void RunLookups(const char* name, uint32_t numStates, uint32_t numLookups)
+{
+    std::mt19937 rng(1);
+    std::vector<PodKey<Desc>> keys = MakeKeys<Desc>(numStates, rng);
+
+    // A skewed sequence: a few states are used by most draw calls
+    std::vector<uint32_t> sequence(numLookups);
+    for (auto& index : sequence)
+        index = (rng() % 4 == 0) ? rng() % numStates : rng() % std::min(numStates, 8u);
+
+    StateCache<PodKey<Desc>, int> cache;
+    std::unordered_map<PodKey<Desc>, int, StdHash<Desc>> map;
+    std::vector<int> evicted;
+    for (uint32_t i = 0; i < numStates; i++)
+    {
+        if (!cache.Find(keys[i]))
+            cache.Insert(keys[i], int(i), evicted);
+        map[keys[i]] = int(i);
+    }
+
+    int64_t sum = 0;
+    TestTimer cacheTimer;
+    for (uint32_t index : sequence)
+        sum += *cache.Find(keys[index]);
+    double cacheMs = cacheTimer.GetMs();
+
+    TestTimer mapTimer;
+    for (uint32_t index : sequence)
+        sum -= map.find(keys[index])->second;
+    double mapMs = mapTimer.GetMs();
+
+    TEST_CHECK(sum == 0);
+
+    printf("%-26s %5u states: StateCache %5.1f ns, unordered_map %5.1f ns per lookup, %llu collisions\n",
+        name, numStates, cacheMs * 1e6 / numLookups, mapMs * 1e6 / numLookups, (unsigned long long)cache.GetStats().collisions);
+}
+
+static void RunBounded(uint32_t numStates, uint32_t capacity)
+{
+    std::mt19937 rng(2);
+    std::vector<PodKey<RasterKeyDesc>> keys = MakeKeys<RasterKeyDesc>(numStates, rng);
+
+    StateCache<PodKey<RasterKeyDesc>, int> cache(capacity);
+    std::vector<int> evicted;
+
+    // A working set of 64 states that drifts slowly over all states
+    const uint32_t numLookups = 1000000;
+    for (uint32_t i = 0; i < numLookups; i++)
+    {
+        uint32_t index = (i / 2000 + rng() % 64) % numStates;
+        if (!cache.Find(keys[index]))
+            cache.Insert(keys[index], int(index), evicted);
+    }
+
+    StateCacheStats stats = cache.GetStats();
+    printf("bounded, capacity %4u, %5u states: hit rate %5.1f%%, %llu evictions\n",
+        capacity, numStates, 100.0 * double(stats.hits) / double(stats.hits + stats.misses), (unsigned long long)stats.evictions);
+}
+
+int main()
+{
+    for (uint32_t numStates : { 16u, 256u, 4096u })
+    {
+        RunLookups<RasterKeyDesc>("rasterizer-sized keys", numStates, 4000000);
+        RunLookups<BlendKeyDesc>("blend-sized keys", numStates, 4000000);
+    }
+
+    RunBounded(1000, 32);
+    RunBounded(1000, 64);
+    RunBounded(1000, 128);
+    RunBounded(1000, 512);
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_StateCache.h"
+#include <algorithm>
+#include <list>
+#include <new>
+#include <map>
+#include <random>
+
+using namespace NVRHI;
+
+// A key with a deliberately weak hash, so that most lookups walk past entries with the same hash
+struct WeakKey
+{
+    uint32_t value;
+
+    bool operator==(const WeakKey& other) const { return value == other.value; }
+    uint64_t Hash() const { return value % 7; }
+};
+
+static WeakKey MakeKey(uint32_t value)
+{
+    WeakKey key;
+    key.value = value;
+    return key;
+}
+
+static void TestCollisions()
+{
+    StateCache<WeakKey, int> cache;
+    std::vector<int> evicted;
+
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        TEST_CHECK(cache.Find(MakeKey(i)) == nullptr);
+        cache.Insert(MakeKey(i), int(i) * 2, evicted);
+    }
+
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        int* value = cache.Find(MakeKey(i));
+        TEST_CHECK(value && *value == int(i) * 2);
+    }
+
+    StateCacheStats stats = cache.GetStats();
+    TEST_CHECK(evicted.empty());
+    TEST_CHECK(stats.hits == 500 && stats.misses == 500);
+    TEST_CHECK(stats.collisions > 0);
+    TEST_CHECK(stats.size == 500 && stats.capacity == 0);
+
+    std::vector<int> removed;
+    cache.RemoveIf([](const WeakKey& key, int) { return key.value % 2 == 0; }, removed);
+    TEST_CHECK(removed.size() == 250);
+    TEST_CHECK(cache.GetSize() == 250);
+
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        int* value = cache.Find(MakeKey(i));
+        TEST_CHECK((i % 2 == 0) ? value == nullptr : (value && *value == int(i) * 2));
+    }
+}
+
+// Random finds, inserts and erases against a reference LRU list; checks the exact eviction order
+static void TestLRU(uint32_t capacity, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    StateCache<WeakKey, uint32_t> cache(capacity);
+    std::list<uint32_t> reference;  // oldest first
+
+    for (int iteration = 0; iteration < 100000; iteration++)
+    {
+        uint32_t key = rng() % 64;
+        auto it = std::find(reference.begin(), reference.end(), key);
+
+        switch (rng() % 3)
+        {
+        case 0:
+        {
+            uint32_t* value = cache.Find(MakeKey(key));
+            TEST_CHECK((value != nullptr) == (it != reference.end()));
+            if (value)
+            {
+                TEST_CHECK(*value == key);
+                reference.erase(it);
+                reference.push_back(key);
+            }
+            break;
+        }
+        case 1:
+        {
+            if (it != reference.end())
+                break;
+
+            std::vector<uint32_t> evicted;
+            cache.Insert(MakeKey(key), key, evicted);
+            for (uint32_t value : evicted)
+            {
+                TEST_CHECK(value == reference.front());
+                reference.pop_front();
+            }
+            reference.push_back(key);
+            break;
+        }
+        case 2:
+        {
+            bool erased = cache.Erase(MakeKey(key));
+            TEST_CHECK(erased == (it != reference.end()));
+            if (erased)
+                reference.erase(it);
+            break;
+        }
+        }
+
+        TEST_CHECK(cache.GetSize() == reference.size());
+        TEST_CHECK(capacity == 0 || cache.GetSize() <= capacity);
+    }
+
+    // Shrinking the capacity evicts the oldest entries
+    std::vector<uint32_t> evicted;
+    cache.SetCapacity(4, evicted);
+    while (reference.size() > 4)
+    {
+        TEST_CHECK(!evicted.empty() && evicted.front() == reference.front());
+        evicted.erase(evicted.begin());
+        reference.pop_front();
+    }
+    TEST_CHECK(evicted.empty());
+    TEST_CHECK(cache.GetSize() == reference.size());
+}
+
+static void TestEvictOldestWhile()
+{
+    StateCache<WeakKey, uint32_t> cache;
+    std::vector<uint32_t> evicted;
+
+    for (uint32_t i = 0; i < 10; i++)
+        cache.Insert(MakeKey(i), i, evicted);
+
+    // Touching 0 makes it the newest: the order is 1..9, 0
+    TEST_CHECK(cache.Find(MakeKey(0)));
+
+    // Stops at the size limit
+    cache.EvictOldestWhile(7, [](uint32_t) { return true; }, evicted);
+    TEST_CHECK(evicted.size() == 3 && evicted[0] == 1 && evicted[1] == 2 && evicted[2] == 3);
+
+    // Stops at the first entry the predicate keeps, even if newer ones could go
+    evicted.clear();
+    cache.EvictOldestWhile(0, [](uint32_t value) { return value != 6; }, evicted);
+    TEST_CHECK(evicted.size() == 2 && evicted[0] == 4 && evicted[1] == 5);
+    TEST_CHECK(cache.GetSize() == 5);
+    TEST_CHECK(cache.GetStats().evictions == 5);
+}
+
+static bool Equals(const std::vector<uint32_t>& values, std::initializer_list<uint32_t> expected)
+{
+    return values.size() == expected.size() && std::equal(values.begin(), values.end(), expected.begin());
+}
+
+// The bindless handle cache of the OpenGL backend: handles requested in the current frame stay over the limit
+static void TestFramePinned()
+{
+    FramePinnedCache<WeakKey, uint32_t> cache(4);
+    std::vector<uint32_t> evicted;
+
+    // Everything requested in the first frame stays
+    for (uint32_t i = 0; i < 6; i++)
+        cache.Insert(MakeKey(i), i * 10, evicted);
+    TEST_CHECK(evicted.empty() && cache.GetSize() == 6);
+    TEST_CHECK(cache.Find(MakeKey(0)) && *cache.Find(MakeKey(0)) == 0);
+
+    // The next frame trims the excess, least recently used first: the order is 1-5, 0
+    cache.BeginFrame(evicted);
+    TEST_CHECK(Equals(evicted, { 10, 20 }) && cache.GetSize() == 4);
+
+    // Requests pin entries of earlier frames again, and inserts evict only entries that are not pinned
+    evicted.clear();
+    TEST_CHECK(cache.Find(MakeKey(3)));
+    cache.Insert(MakeKey(6), 60, evicted);
+    cache.Insert(MakeKey(7), 70, evicted);
+    cache.Insert(MakeKey(8), 80, evicted);
+    TEST_CHECK(Equals(evicted, { 40, 50, 0 }) && cache.GetSize() == 4);
+
+    // The oldest entry is pinned now, so the cache grows over the limit
+    evicted.clear();
+    cache.Insert(MakeKey(9), 90, evicted);
+    TEST_CHECK(evicted.empty() && cache.GetSize() == 5);
+
+    cache.BeginFrame(evicted);
+    TEST_CHECK(Equals(evicted, { 30 }) && cache.GetSize() == 4);
+    TEST_CHECK(cache.GetFrame() == 2);
+
+    // An evicted key is simply inserted again
+    evicted.clear();
+    TEST_CHECK(cache.Find(MakeKey(1)) == nullptr);
+    cache.Insert(MakeKey(1), 10, evicted);
+    TEST_CHECK(Equals(evicted, { 60 }));
+
+    // Lowering the limit evicts right away, down to the entries of the current frame
+    evicted.clear();
+    cache.SetLimit(1, evicted);
+    TEST_CHECK(Equals(evicted, { 70, 80, 90 }) && cache.GetSize() == 1);
+
+    StateCacheStats stats = cache.GetStats();
+    TEST_CHECK(stats.capacity == 1 && stats.size == 1 && stats.evictions == 10);
+
+    // Removal ignores the pinning
+    std::vector<uint32_t> removed;
+    cache.RemoveIf([](const WeakKey& key, uint32_t) { return key.value == 1; }, removed);
+    TEST_CHECK(Equals(removed, { 10 }) && cache.GetSize() == 0);
+
+    // A limit of 0 never evicts
+    evicted.clear();
+    cache.SetLimit(0, evicted);
+    for (uint32_t i = 0; i < 100; i++)
+        cache.Insert(MakeKey(i), i, evicted);
+    cache.BeginFrame(evicted);
+    TEST_CHECK(evicted.empty() && cache.GetSize() == 100);
+
+    cache.SetLimit(10, evicted);
+    TEST_CHECK(evicted.size() == 90 && evicted[0] == 0 && evicted[89] == 89);
+}
+
+struct PaddedDesc
+{
+    uint8_t a;
+    uint32_t b;
+    uint8_t c;
+    uint64_t d;
+};
+
+static void TestPodKeyPadding()
+{
+    // Fill the stack with garbage first, so that uninitialized padding would differ between the keys
+    PodKey<PaddedDesc> keys[2];
+    for (int i = 0; i < 2; i++)
+    {
+        char garbage[sizeof(PaddedDesc)];
+        memset(garbage, 0x55 + i, sizeof(garbage));
+        memcpy(&keys[i], garbage, sizeof(garbage));
+        new (&keys[i]) PodKey<PaddedDesc>();
+        keys[i].value.a = 1;
+        keys[i].value.b = 2;
+        keys[i].value.c = 3;
+        keys[i].value.d = 4;
+    }
+
+    TEST_CHECK(keys[0] == keys[1]);
+    TEST_CHECK(keys[0].Hash() == keys[1].Hash());
+
+    keys[1].value.d = 5;
+    TEST_CHECK(!(keys[0] == keys[1]));
+
+    StateCache<PodKey<PaddedDesc>, int> cache;
+    std::vector<int> evicted;
+    cache.Insert(keys[0], 1, evicted);
+    TEST_CHECK(cache.Find(keys[0]) && *cache.Find(keys[0]) == 1);
+    TEST_CHECK(cache.Find(keys[1]) == nullptr);
+}
+
+int main()
+{
+    TestCollisions();
+
+    for (uint32_t capacity : { 0u, 1u, 5u, 16u, 50u })
+        TestLRU(capacity, capacity + 1);
+
+    TestEvictOldestWhile();
+    TestFramePinned();
+    TestPodKeyPadding();
+
+    printf("StateCacheTest passed\n");
+    return 0;
+}
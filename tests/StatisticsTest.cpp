@@ -0,0 +1,184 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_Statistics.h"
+
+using namespace NVRHI;
+
+static DrawArguments MakeDraw(uint32_t vertexCount, uint32_t instanceCount)
+{
+    DrawArguments args;
+    args.vertexCount = vertexCount;
+    args.instanceCount = instanceCount;
+    return args;
+}
+
+static void TestBuckets()
+{
+    TEST_CHECK(StatisticsCollector::GetBucket(0) == 0);
+    TEST_CHECK(StatisticsCollector::GetBucket(1) == 1);
+    TEST_CHECK(StatisticsCollector::GetBucket(2) == 2);
+    TEST_CHECK(StatisticsCollector::GetBucket(3) == 2);
+    TEST_CHECK(StatisticsCollector::GetBucket(4) == 3);
+
+    // Bucket i starts at 2^(i-1) and ends right before 2^i
+    for (uint32_t i = 1; i < RendererStatistics::HISTOGRAM_BUCKETS - 1; i++)
+    {
+        TEST_CHECK(StatisticsCollector::GetBucket(uint64_t(1) << (i - 1)) == i);
+        TEST_CHECK(StatisticsCollector::GetBucket((uint64_t(1) << i) - 1) == i);
+    }
+
+    // The last bucket takes everything above
+    const uint32_t last = RendererStatistics::HISTOGRAM_BUCKETS - 1;
+    TEST_CHECK(StatisticsCollector::GetBucket(uint64_t(1) << (last - 1)) == last);
+    TEST_CHECK(StatisticsCollector::GetBucket(uint64_t(1) << 40) == last);
+    TEST_CHECK(StatisticsCollector::GetBucket(~uint64_t(0)) == last);
+}
+
+static void TestHistograms()
+{
+    StatisticsCollector collector;
+    TEST_CHECK(collector.SetEnabled(true));
+
+    DrawArguments draws[] = { MakeDraw(0, 1), MakeDraw(3, 1), MakeDraw(100, 10), MakeDraw(1, 1) };
+    NVRHI_STAT_DRAWS(collector, draws, 4);
+    NVRHI_STAT_UPLOAD(collector, 256);
+    NVRHI_STAT_UPLOAD(collector, 257);
+    NVRHI_STAT_UPLOAD(collector, 0);
+
+    const RendererStatistics& current = collector.Current();
+    TEST_CHECK(current.drawCalls == 4);
+    TEST_CHECK(current.verticesSubmitted == 0 + 3 + 1000 + 1);
+    TEST_CHECK(current.drawVertexHistogram[0] == 1);
+    TEST_CHECK(current.drawVertexHistogram[1] == 1);
+    TEST_CHECK(current.drawVertexHistogram[2] == 1);
+    TEST_CHECK(current.drawVertexHistogram[StatisticsCollector::GetBucket(1000)] == 1);
+    TEST_CHECK(current.bytesUploaded == 513);
+    TEST_CHECK(current.uploadSizeHistogram[0] == 1);
+    TEST_CHECK(current.uploadSizeHistogram[9] == 2);
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < RendererStatistics::HISTOGRAM_BUCKETS; i++)
+        total += current.drawVertexHistogram[i];
+    TEST_CHECK(total == current.drawCalls);
+}
+
+static void TestEndFrame()
+{
+    StatisticsCollector collector;
+    RendererStatistics stats;
+    TEST_CHECK(!collector.GetLastFrame(stats));
+
+    collector.SetEnabled(true);
+    NVRHI_STAT_ADD(collector, dispatches, 3);
+    NVRHI_STAT_UPLOAD(collector, 16);
+    collector.EndFrame();
+
+    TEST_CHECK(collector.GetLastFrame(stats));
+    TEST_CHECK(stats.frameIndex == 0);
+    TEST_CHECK(stats.dispatches == 3);
+    TEST_CHECK(stats.bytesUploaded == 16 && stats.uploadSizeHistogram[5] == 1);
+
+    // The next frame starts from zero
+    TEST_CHECK(collector.Current().dispatches == 0);
+    TEST_CHECK(collector.Current().bytesUploaded == 0);
+    TEST_CHECK(collector.Current().uploadSizeHistogram[5] == 0);
+
+    NVRHI_STAT_ADD(collector, barriers, 7);
+    collector.EndFrame();
+
+    TEST_CHECK(collector.GetLastFrame(stats));
+    TEST_CHECK(stats.frameIndex == 1);
+    TEST_CHECK(stats.barriers == 7 && stats.dispatches == 0);
+
+    // Enabling again discards whatever was collected before
+    collector.Current().drawCalls = 5;
+    collector.SetEnabled(false);
+    collector.SetEnabled(true);
+    TEST_CHECK(collector.Current().drawCalls == 0);
+}
+
+static void TestDisabled()
+{
+    StatisticsCollector collector;
+    TEST_CHECK(!collector.IsEnabled());
+
+    DrawArguments draw = MakeDraw(10, 2);
+    NVRHI_STAT_DRAWS(collector, &draw, 1);
+    NVRHI_STAT_UPLOAD(collector, 64);
+    NVRHI_STAT_ADD(collector, stateChanges, 1);
+
+    RendererStatistics other;
+    other.drawCalls = 9;
+    collector.Merge(other);
+
+    const RendererStatistics& current = collector.Current();
+    TEST_CHECK(current.drawCalls == 0 && current.verticesSubmitted == 0);
+    TEST_CHECK(current.bytesUploaded == 0 && current.stateChanges == 0);
+    TEST_CHECK(current.drawVertexHistogram[StatisticsCollector::GetBucket(20)] == 0);
+
+    // A disabled collector does not complete frames either
+    collector.EndFrame();
+    RendererStatistics stats;
+    TEST_CHECK(!collector.GetLastFrame(stats));
+
+    // Collected frames stay readable after disabling
+    collector.SetEnabled(true);
+    NVRHI_STAT_ADD(collector, stateChanges, 2);
+    collector.EndFrame();
+    collector.SetEnabled(false);
+    collector.EndFrame();
+    TEST_CHECK(collector.GetLastFrame(stats));
+    TEST_CHECK(stats.frameIndex == 0 && stats.stateChanges == 2);
+}
+
+static void TestMerge()
+{
+    StatisticsCollector deferred;
+    deferred.SetEnabled(true);
+    DrawArguments draws[] = { MakeDraw(3, 1), MakeDraw(8, 4) };
+    NVRHI_STAT_DRAWS(deferred, draws, 2);
+    NVRHI_STAT_UPLOAD(deferred, 1024);
+    NVRHI_STAT_ADD(deferred, barriers, 2);
+
+    StatisticsCollector immediate;
+    immediate.SetEnabled(true);
+    NVRHI_STAT_DRAWS(immediate, draws, 1);
+    NVRHI_STAT_ADD(immediate, barriers, 1);
+
+    immediate.Merge(deferred.Current());
+    immediate.Merge(deferred.Current());
+
+    const RendererStatistics& current = immediate.Current();
+    TEST_CHECK(current.drawCalls == 5);
+    TEST_CHECK(current.verticesSubmitted == 3 + 2 * (3 + 32));
+    TEST_CHECK(current.barriers == 5);
+    TEST_CHECK(current.bytesUploaded == 2048 && current.uploadSizeHistogram[11] == 2);
+    TEST_CHECK(current.drawVertexHistogram[2] == 3);
+    TEST_CHECK(current.drawVertexHistogram[6] == 2);
+
+    immediate.EndFrame();
+    RendererStatistics stats;
+    TEST_CHECK(immediate.GetLastFrame(stats));
+    TEST_CHECK(stats.frameIndex == 0 && stats.drawCalls == 5);
+}
+
+int main()
+{
+    TestBuckets();
+    TestHistograms();
+    TestEndFrame();
+    TestDisabled();
+    TestMerge();
+
+    printf("StatisticsTest passed\n");
+    return 0;
+}
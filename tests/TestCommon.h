@@ -0,0 +1,38 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+// Include this first: it lets the VXGI headers compile outside of MSVC
+#ifndef _MSC_VER
+#define __declspec(x)
+#define __cdecl
+#endif
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Unlike assert, the check stays enabled in release builds, which is what the benchmarks use
+#define TEST_CHECK(expr) \
+    do { if (!(expr)) { fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #expr); exit(1); } } while (0)
+
+class TestTimer
+{
+public:
+    TestTimer() : m_Start(std::chrono::steady_clock::now()) { }
+
+    double GetMs() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count(); }
+
+private:
+    std::chrono::steady_clock::time_point m_Start;
+};
@@ -0,0 +1,121 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// CPU side of the OpenGL texture uploads through the upload ring; the GL calls are not run here.
+// First, the time per upload of staging into the 16 MB ring (allocate, copy into the ring memory, fence,
+// retire the fences the GPU has passed) against the bookkeeping of the ring alone.
+// Second, how often the render thread would wait for the GPU when streaming textures every frame,
+// for several ring sizes, with the GPU completing a frame's uploads two frames later.
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_UploadRing.h"
+#include <string.h>
+#include <vector>
+
+using namespace NVRHI;
+
+static const uint32_t RING_SIZE = 16 * 1024 * 1024;
+static const uint64_t GPU_LATENCY = 3;
+static const size_t TOTAL_BYTES = size_t(4) << 30;
+
+// Returns ns per upload
+static double MeasureRing(const std::vector<uint8_t>& source, size_t uploadSize, bool copy)
+{
+    UploadRingAllocator<uint64_t> ring;
+    ring.Init(RING_SIZE);
+    std::vector<uint8_t> memory(RING_SIZE);
+
+    size_t iterations = copy ? TOTAL_BYTES / uploadSize : 10000000;
+    uint64_t fence = 0;
+
+    TestTimer timer;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint32_t offset = 0;
+        while (!ring.TryAllocate(uploadSize, offset))
+            ring.RetireOldest();
+
+        if (copy)
+            memcpy(memory.data() + offset, source.data(), uploadSize);
+
+        // Fenced per upload, and the GPU is a few uploads behind
+        ring.Submit(++fence);
+        while (ring.GetNumFences() > 1 && ring.GetOldestFence() + GPU_LATENCY <= fence)
+            ring.RetireOldest();
+    }
+    double ms = timer.GetMs();
+
+    TEST_CHECK(!copy || memory[0] == source[0]);
+    return ms * 1e6 / double(iterations);
+}
+
+// Returns the number of frames in which an upload had to wait for the GPU, out of 1000
+static uint32_t CountStalledFrames(uint32_t ringSize, uint32_t uploadSize, uint32_t uploadsPerFrame)
+{
+    const uint64_t FRAME_LATENCY = 2;
+
+    UploadRingAllocator<uint64_t> ring;
+    ring.Init(ringSize);
+    uint32_t stalledFrames = 0;
+
+    for (uint64_t frame = 1; frame <= 1000; frame++)
+    {
+        // The fences are frame numbers; the GPU has finished the frames that are FRAME_LATENCY behind
+        while (ring.HasFences() && ring.GetOldestFence() + FRAME_LATENCY <= frame)
+            ring.RetireOldest();
+
+        bool stalled = false;
+        for (uint32_t upload = 0; upload < uploadsPerFrame; upload++)
+        {
+            uint32_t offset = 0;
+            while (!ring.TryAllocate(uploadSize, offset) && ring.HasFences())
+            {
+                ring.RetireOldest();
+                stalled = true;
+            }
+
+            ring.Submit(frame);
+        }
+
+        if (stalled)
+            stalledFrames++;
+    }
+
+    return stalledFrames;
+}
+
+int main()
+{
+    std::vector<uint8_t> source(4 * 1024 * 1024);
+    for (size_t i = 0; i < source.size(); i++)
+        source[i] = uint8_t(i * 131 + 7);
+
+    printf("upload bytes   ring+copy   ring only   (ns per upload)\n");
+    for (size_t size : { 256, 4096, 65536, 1024 * 1024, 4 * 1024 * 1024 })
+    {
+        double ringCopy = MeasureRing(source, size, true);
+        double ringOnly = MeasureRing(source, size, false);
+
+        printf("%12zu %11.1f %11.1f   bookkeeping is %.1f%% of the upload, %.1f GB/s\n",
+            size, ringCopy, ringOnly, 100.0 * ringOnly / ringCopy, double(size) / ringCopy);
+    }
+
+    printf("\nframes out of 1000 that wait for the GPU, 256 KB uploads\n");
+    printf("MB per frame      4 MB ring   8 MB ring  16 MB ring  32 MB ring\n");
+    for (uint32_t uploadsPerFrame : { 4, 16, 32, 48, 64 })
+    {
+        printf("%12.2f", uploadsPerFrame * 0.25);
+        for (uint32_t ringMB : { 4, 8, 16, 32 })
+            printf(" %11u", CountStalledFrames(ringMB << 20, 256 * 1024, uploadsPerFrame));
+        printf("\n");
+    }
+
+    return 0;
+}
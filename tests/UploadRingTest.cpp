@@ -0,0 +1,189 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_NVRHI_UploadRing.h"
+#include <random>
+#include <vector>
+
+using namespace NVRHI;
+
+typedef UploadRingAllocator<uint64_t> Ring;
+
+static void TestAlignment()
+{
+    Ring ring;
+    ring.Init(1024);
+    uint32_t offset = ~0u;
+
+    // Allocations start at multiples of 16, and the padding before them counts as used
+    TEST_CHECK(ring.TryAllocate(10, offset) && offset == 0);
+    TEST_CHECK(ring.TryAllocate(5, offset) && offset == 16);
+    TEST_CHECK(ring.TryAllocate(16, offset) && offset == 32);
+    TEST_CHECK(ring.TryAllocate(1, offset) && offset == 48);
+    TEST_CHECK(ring.GetUsedBytes() == 49);
+
+    // Zero bytes still get an aligned offset
+    TEST_CHECK(ring.TryAllocate(0, offset) && offset == 64);
+    TEST_CHECK(ring.GetUsedBytes() == 64);
+}
+
+static void TestWrap()
+{
+    Ring ring;
+    ring.Init(256);
+    uint32_t offset = 0;
+
+    // Larger than the ring never fits; the whole ring does when it is empty
+    TEST_CHECK(!ring.TryAllocate(257, offset));
+    TEST_CHECK(ring.TryAllocate(256, offset) && offset == 0);
+    TEST_CHECK(!ring.TryAllocate(1, offset));
+    ring.Submit(1);
+    TEST_CHECK(ring.RetireOldest() == 1 && ring.GetUsedBytes() == 0);
+
+    // Fence 2 covers 0-100, fence 3 covers 100-212 with its padding
+    TEST_CHECK(ring.TryAllocate(100, offset) && offset == 0);
+    ring.Submit(2);
+    TEST_CHECK(ring.TryAllocate(100, offset) && offset == 112);
+    ring.Submit(3);
+    TEST_CHECK(ring.GetUsedBytes() == 212 && ring.GetNumFences() == 2);
+
+    // Nothing fits before the end, and the beginning is still in use
+    TEST_CHECK(!ring.TryAllocate(80, offset));
+    TEST_CHECK(ring.GetOldestFence() == 2);
+    TEST_CHECK(ring.RetireOldest() == 2 && ring.GetUsedBytes() == 112);
+
+    // After fence 2, the allocation wraps; the skipped tail 212-256 belongs to it
+    TEST_CHECK(ring.TryAllocate(80, offset) && offset == 0);
+    TEST_CHECK(ring.GetUsedBytes() == 112 + 44 + 80);
+    ring.Submit(4);
+
+    // The space between the two allocations is free, but the accounting does not track holes:
+    // nothing more fits until fence 3 retires
+    TEST_CHECK(!ring.TryAllocate(32, offset));
+    TEST_CHECK(ring.RetireOldest() == 3 && ring.GetUsedBytes() == 124);
+    TEST_CHECK(ring.TryAllocate(32, offset) && offset == 80);
+    TEST_CHECK(!ring.TryAllocate(112, offset));
+    TEST_CHECK(ring.TryAllocate(100, offset) && offset == 112);
+
+    // Retiring the wrap returns the tail with it
+    ring.Submit(5);
+    TEST_CHECK(ring.RetireOldest() == 4 && ring.GetUsedBytes() == 132);
+    TEST_CHECK(ring.RetireOldest() == 5 && ring.GetUsedBytes() == 0 && !ring.HasFences());
+
+    // An empty ring starts over at the beginning instead of wrapping later
+    TEST_CHECK(ring.TryAllocate(200, offset) && offset == 0);
+}
+
+static void TestFences()
+{
+    Ring ring;
+    ring.Init(1024);
+    uint32_t offset = 0;
+
+    TEST_CHECK(!ring.HasPendingAllocations() && !ring.HasFences());
+
+    // One fence covers all allocations since the previous submit
+    TEST_CHECK(ring.TryAllocate(100, offset));
+    TEST_CHECK(ring.TryAllocate(100, offset));
+    TEST_CHECK(ring.HasPendingAllocations());
+    ring.Submit(7);
+    TEST_CHECK(!ring.HasPendingAllocations() && ring.GetNumFences() == 1);
+
+    TEST_CHECK(ring.TryAllocate(300, offset));
+    ring.Submit(8);
+    TEST_CHECK(ring.GetUsedBytes() == 100 + 12 + 100 + 12 + 300);
+
+    // Fences retire in submission order
+    TEST_CHECK(ring.GetOldestFence() == 7 && ring.RetireOldest() == 7);
+    TEST_CHECK(ring.GetUsedBytes() == 312);
+    TEST_CHECK(ring.GetOldestFence() == 8 && ring.RetireOldest() == 8);
+    TEST_CHECK(ring.GetUsedBytes() == 0);
+
+    // Init drops everything
+    TEST_CHECK(ring.TryAllocate(100, offset));
+    ring.Submit(9);
+    ring.Init(512);
+    TEST_CHECK(ring.GetSize() == 512 && ring.GetUsedBytes() == 0 && !ring.HasFences());
+    TEST_CHECK(!ring.HasPendingAllocations());
+}
+
+// Uploads of random sizes with a GPU that completes each fence a few submits later, using the ring like
+// UploadRing::Allocate and Submit do. Every byte of the ring is owned by at most one fence that has not retired,
+// or by the allocations that the next fence will cover.
+static void TestSimulation()
+{
+    const uint32_t size = 64 * 1024;
+    Ring ring;
+    ring.Init(size);
+
+    std::vector<uint64_t> owner(size, 0);
+    std::mt19937 rng(3);
+    uint64_t fenceCounter = 0;
+    uint64_t retiredFence = 0;
+    uint64_t waits = 0;
+    uint64_t direct = 0;
+
+    for (int upload = 0; upload < 20000; upload++)
+    {
+        uint32_t bytes = (rng() % 8 == 0) ? rng() % size : rng() % 4096;
+        uint32_t offset = 0;
+
+        bool staged = true;
+        while (!ring.TryAllocate(bytes, offset))
+        {
+            // The unsubmitted allocations fill the ring: the upload goes from client memory
+            if (!ring.HasFences())
+            {
+                staged = false;
+                direct++;
+                break;
+            }
+
+            retiredFence = ring.RetireOldest();
+            waits++;
+        }
+
+        if (staged)
+        {
+            TEST_CHECK(offset % Ring::ALIGNMENT == 0 && offset + bytes <= size);
+            for (uint32_t i = offset; i < offset + bytes; i++)
+            {
+                TEST_CHECK(owner[i] <= retiredFence);
+                owner[i] = fenceCounter + 1;
+            }
+        }
+
+        // A few uploads per submit, and fences complete three submits later
+        if (rng() % 3 == 0 && ring.HasPendingAllocations())
+        {
+            fenceCounter++;
+            ring.Submit(fenceCounter);
+
+            while (ring.GetNumFences() > 1 && ring.GetOldestFence() + 3 <= fenceCounter)
+                retiredFence = ring.RetireOldest();
+        }
+
+        TEST_CHECK(ring.GetUsedBytes() <= size);
+    }
+
+    TEST_CHECK(waits > 0 && direct > 0);
+}
+
+int main()
+{
+    TestAlignment();
+    TestWrap();
+    TestFences();
+    TestSimulation();
+
+    printf("UploadRingTest passed\n");
+    return 0;
+}
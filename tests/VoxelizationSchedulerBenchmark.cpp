@@ -0,0 +1,260 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// Simulation of the scheduling policy with a scrolling clipmap, driven the way the samples drive it:
+// deferred regions are resubmitted on the next frame, and GPU times reach reportMeasuredTime 3 frames late.
+// 400 meshes, 5 clipmap levels, and walk, sprint and teleport camera paths of 600 frames; the camera stops
+// for the last 100 frames to show how fast the backlog drains. The true cost is 20 ms per million triangles,
+// and the scheduler starts from a model of 10.
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_VoxelizationScheduler.h"
+#include <random>
+
+using namespace VXGI;
+
+static const int NUM_LEVELS = 5;
+static const float FINEST_PAGE = 32.f;      // world size of a page on level 0; each level doubles it
+static const int LEVEL_PAGES = 16;          // pages per axis on every level
+static const int NUM_FRAMES = 600;
+static const int STOP_FRAME = 500;
+static const float TRUE_MS_PER_TRIANGLE = 20e-6f;
+static const int MEASUREMENT_DELAY = 3;
+
+struct SceneMesh
+{
+    Box3f bounds;
+    uint32_t triangles;
+};
+
+static float PageSize(int level) { return FINEST_PAGE * float(1 << level); }
+
+// The page-aligned box that a level covers around the camera
+static Box3f LevelBox(int level, const Vector3f& camera)
+{
+    float page = PageSize(level);
+    float half = page * float(LEVEL_PAGES / 2);
+    Vector3f lower(floorf((camera.x - half) / page) * page, floorf((camera.y - half) / page) * page, floorf((camera.z - half) / page) * page);
+    return Box3f(lower, lower + page * float(LEVEL_PAGES));
+}
+
+// Splits newBox minus oldBox into up to 6 slabs, like the regions VXGI invalidates when a clipmap level scrolls
+static void AddScrolledRegions(const Box3f& oldBox, const Box3f& newBox, int level, std::vector<Box3f>& regions, std::vector<uint32_t>& levels)
+{
+    if (!oldBox.intersectsWith(newBox) || oldBox.intersection(newBox).volume() <= 0.f)
+    {
+        regions.push_back(newBox);
+        levels.push_back(level);
+        return;
+    }
+
+    Box3f remaining = newBox;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float* lower = &remaining.lower.x;
+        float* upper = &remaining.upper.x;
+        const float* oldLower = &oldBox.lower.x;
+        const float* oldUpper = &oldBox.upper.x;
+
+        if (lower[axis] < oldLower[axis])
+        {
+            Box3f slab = remaining;
+            (&slab.upper.x)[axis] = oldLower[axis];
+            regions.push_back(slab);
+            levels.push_back(level);
+            lower[axis] = oldLower[axis];
+        }
+
+        if (upper[axis] > oldUpper[axis])
+        {
+            Box3f slab = remaining;
+            (&slab.lower.x)[axis] = oldUpper[axis];
+            regions.push_back(slab);
+            levels.push_back(level);
+            upper[axis] = oldUpper[axis];
+        }
+    }
+}
+
+static Vector3f CameraAt(int path, int frame)
+{
+    int moving = std::min(frame, STOP_FRAME);
+    float t = float(moving);
+
+    switch (path)
+    {
+    case 0:     // walk, 3 units per frame
+        return Vector3f(t * 3.f - 900.f, 20.f, 200.f * sinf(t * 0.01f));
+    case 1:     // sprint, 12 units per frame
+        return Vector3f(t * 12.f - 3000.f, 40.f, 600.f * sinf(t * 0.01f));
+    default:    // walk with a teleport every 150 frames
+        return Vector3f(t * 3.f - 900.f + float(moving / 150) * 2500.f * ((moving / 150) % 2 ? 1.f : -0.5f), 20.f, float(moving / 150) * 700.f - 1000.f);
+    }
+}
+
+// The GPU cost of a pass: every mesh that intersects any scheduled region is drawn once
+static float TrueCostMs(const std::vector<SceneMesh>& meshes, const std::vector<Box3f>& scheduled, uint64_t& triangles)
+{
+    triangles = 0;
+    for (const SceneMesh& mesh : meshes)
+    {
+        for (const Box3f& box : scheduled)
+        {
+            if (mesh.bounds.intersectsWith(box))
+            {
+                triangles += mesh.triangles;
+                break;
+            }
+        }
+    }
+    return float(triangles) * TRUE_MS_PER_TRIANGLE;
+}
+
+struct PathResult
+{
+    float peakMs;
+    float averageMs;
+    uint32_t framesOverBudget;  // frames whose true cost exceeded the budget by more than 10%
+    uint32_t forcedRegions;
+    uint32_t peakBacklog;
+    uint32_t oldestAge;
+    int drainFrames;            // frames after the camera stopped until the backlog was empty, -1 if it never was
+    float finalModel;
+};
+
+static PathResult Simulate(const std::vector<SceneMesh>& meshes, int path, float budgetMs)
+{
+    VoxelizationScheduler scheduler;
+    for (const SceneMesh& mesh : meshes)
+        scheduler.addMesh(mesh.bounds, mesh.triangles);
+    scheduler.setCostModel(10.f);
+    scheduler.setBudget(budgetMs);
+
+    std::mt19937 rng(path + 1);
+    std::uniform_real_distribution<float> noise(0.95f, 1.05f);
+
+    Box3f levelBoxes[NUM_LEVELS];
+    std::vector<float> measuredMs(NUM_FRAMES, 0.f);
+    std::vector<Box3f> regions, scheduled;
+    std::vector<uint32_t> levels;
+
+    PathResult result;
+    memset(&result, 0, sizeof(result));
+    result.drainFrames = -1;
+    double totalMs = 0.0;
+
+    for (int frame = 0; frame < NUM_FRAMES; frame++)
+    {
+        Vector3f camera = CameraAt(path, frame);
+        regions.clear();
+        levels.clear();
+
+        // The first frame fills the whole clipmap, which is the same with and without a budget, so it is not measured
+        for (int level = 0; level < NUM_LEVELS; level++)
+        {
+            Box3f box = LevelBox(level, camera);
+            if (frame > 0)
+                AddScrolledRegions(levelBoxes[level], box, level, regions, levels);
+            levelBoxes[level] = box;
+        }
+
+        // The resubmitted backlog, as VXGI reports it again: clipped to the finest level that contains its center
+        for (const Box3f& deferred : scheduler.getDeferredRegions())
+        {
+            Vector3f center = (deferred.lower + deferred.upper) * 0.5f;
+            for (int level = 0; level < NUM_LEVELS; level++)
+            {
+                if (levelBoxes[level].contains(center))
+                {
+                    regions.push_back(deferred.intersection(levelBoxes[level]));
+                    levels.push_back(level);
+                    break;
+                }
+            }
+        }
+
+        scheduler.schedule(regions.empty() ? nullptr : &regions[0], levels.empty() ? nullptr : &levels[0], uint32_t(regions.size()),
+            camera, uint64_t(frame), scheduled);
+
+        uint64_t triangles;
+        float costMs = TrueCostMs(meshes, scheduled, triangles) * noise(rng);
+        measuredMs[frame] = costMs;
+
+        if (frame >= MEASUREMENT_DELAY)
+            scheduler.reportMeasuredTime(uint64_t(frame - MEASUREMENT_DELAY), measuredMs[frame - MEASUREMENT_DELAY]);
+
+        const VoxelizationSchedulerStats& stats = scheduler.getStats();
+        if (frame > 0)
+        {
+            result.peakMs = std::max(result.peakMs, costMs);
+            totalMs += costMs;
+            if (budgetMs > 0.f && costMs > budgetMs * 1.1f)
+                result.framesOverBudget++;
+        }
+        result.forcedRegions += stats.forcedRegions;
+        result.oldestAge = std::max(result.oldestAge, stats.oldestDeferredAge);
+        result.peakBacklog = std::max(result.peakBacklog, stats.deferredRegions);
+
+        if (frame >= STOP_FRAME && result.drainFrames < 0 && stats.deferredRegions == 0)
+            result.drainFrames = frame - STOP_FRAME;
+
+        result.finalModel = stats.msPerMillionTriangles;
+    }
+
+    result.averageMs = float(totalMs / (NUM_FRAMES - 1));
+    return result;
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+    // Objects on a 6 km square, most of them small, with up to 40k triangles
+    std::vector<SceneMesh> meshes;
+    for (int i = 0; i < 400; i++)
+    {
+        Vector3f center(uniform(rng) * 6000.f - 3000.f, uniform(rng) * 200.f, uniform(rng) * 6000.f - 3000.f);
+        float halfSize = 5.f + uniform(rng) * uniform(rng) * 150.f;
+        SceneMesh mesh;
+        mesh.bounds = Box3f(center - halfSize, center + halfSize);
+        mesh.triangles = 1000 + uint32_t(uniform(rng) * uniform(rng) * 40000.f);
+        meshes.push_back(mesh);
+    }
+
+    const char* pathNames[] = { "walk", "sprint", "teleport" };
+    const float budgets[] = { 0.f, 2.f, 1.f };
+
+    for (int path = 0; path < 3; path++)
+    {
+        for (float budget : budgets)
+        {
+            PathResult result = Simulate(meshes, path, budget);
+
+            char budgetText[32];
+            if (budget > 0.f)
+                snprintf(budgetText, sizeof(budgetText), "%.0f ms budget", budget);
+            else
+                snprintf(budgetText, sizeof(budgetText), "no budget");
+
+            char drainText[32];
+            if (result.drainFrames >= 0)
+                snprintf(drainText, sizeof(drainText), "%d frames", result.drainFrames);
+            else
+                snprintf(drainText, sizeof(drainText), "never");
+
+            printf("%-8s %-13s peak %5.2f ms, average %4.2f ms, %3u frames over budget, %3u forced, backlog peak %2u oldest %u, drained after %-9s model %4.1f ms/Mtri\n",
+                pathNames[path], budgetText, result.peakMs, result.averageMs, result.framesOverBudget, result.forcedRegions,
+                result.peakBacklog, result.oldestAge, drainText, result.finalModel);
+        }
+    }
+
+    return 0;
+}
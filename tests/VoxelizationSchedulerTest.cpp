@@ -0,0 +1,193 @@
+/*
+* Copyright (c) 2012-2016, NVIDIA CORPORATION. All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto. Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "TestCommon.h"
+#include "GFSDK_VXGI_VoxelizationScheduler.h"
+
+using namespace VXGI;
+
+static Box3f UnitBoxAt(float x)
+{
+    return Box3f(Vector3f(x, 0.f, 0.f), Vector3f(x + 1.f, 1.f, 1.f));
+}
+
+static bool Contains(const std::vector<Box3f>& boxes, const Box3f& box)
+{
+    for (const Box3f& b : boxes)
+        if (b.lower == box.lower && b.upper == box.upper)
+            return true;
+
+    return false;
+}
+
+// One mesh of 100k triangles in each unit box along x; at 10 ms per million triangles each region costs 1 ms
+static void AddMeshes(VoxelizationScheduler& scheduler, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        Box3f bounds(Vector3f(float(i) + 0.25f, 0.25f, 0.25f), Vector3f(float(i) + 0.75f, 0.75f, 0.75f));
+        scheduler.addMesh(bounds, 100000);
+    }
+    scheduler.setCostModel(10.f);
+}
+
+static void TestBudget()
+{
+    VoxelizationScheduler scheduler;
+    AddMeshes(scheduler, 8);
+
+    Box3f regions[8];
+    for (int i = 0; i < 8; i++)
+        regions[i] = UnitBoxAt(float(i));
+
+    std::vector<Box3f> scheduled;
+
+    // No budget: everything on this frame
+    scheduler.setBudget(0.f);
+    scheduler.schedule(regions, nullptr, 8, Vector3f(0.f, 0.f, 0.f), 1, scheduled);
+    TEST_CHECK(scheduled.size() == 8);
+    TEST_CHECK(scheduler.getDeferredRegions().empty());
+
+    // 3 ms: the three regions nearest to the camera
+    scheduler.setBudget(3.f);
+    scheduler.schedule(regions, nullptr, 8, Vector3f(0.f, 0.f, 0.f), 2, scheduled);
+    TEST_CHECK(scheduled.size() == 3);
+    TEST_CHECK(Contains(scheduled, regions[0]) && Contains(scheduled, regions[1]) && Contains(scheduled, regions[2]));
+    TEST_CHECK(scheduler.getDeferredRegions().size() == 5);
+
+    const VoxelizationSchedulerStats& stats = scheduler.getStats();
+    TEST_CHECK(stats.candidateRegions == 8 && stats.scheduledRegions == 3 && stats.deferredRegions == 5);
+    TEST_CHECK(stats.scheduledTriangles == 300000 && stats.deferredTriangles == 500000);
+    TEST_CHECK(fabsf(stats.estimatedMs - 3.f) < 1e-3f);
+    TEST_CHECK(stats.oldestDeferredAge == 1);
+
+    // The highest priority region is taken even if it alone exceeds the budget
+    scheduler.setBudget(0.5f);
+    scheduler.schedule(regions, nullptr, 8, Vector3f(7.5f, 0.f, 0.f), 3, scheduled);
+    TEST_CHECK(scheduled.size() == 1 && Contains(scheduled, regions[7]));
+}
+
+static void TestOrderAndFreeRegions()
+{
+    VoxelizationScheduler scheduler;
+    AddMeshes(scheduler, 4);
+    scheduler.setBudget(1.f);
+
+    // The finest level goes first, even when it is farther from the camera
+    Box3f regions[] = { UnitBoxAt(0.f), UnitBoxAt(3.f), UnitBoxAt(20.f), UnitBoxAt(30.f) };
+    uint32_t levels[] = { 2, 0, 1, 1 };
+
+    std::vector<Box3f> scheduled;
+    scheduler.schedule(regions, levels, 4, Vector3f(0.f, 0.f, 0.f), 1, scheduled);
+
+    // Regions 2 and 3 have no geometry and cost nothing
+    TEST_CHECK(scheduled.size() == 3);
+    TEST_CHECK(scheduled[0].lower == regions[1].lower);
+    TEST_CHECK(Contains(scheduled, regions[2]) && Contains(scheduled, regions[3]));
+    TEST_CHECK(scheduler.getDeferredRegions().size() == 1 && scheduler.getDeferredRegions()[0].lower == regions[0].lower);
+}
+
+static void TestSharedMeshes()
+{
+    // A mesh that spans several regions is counted once, by the first region that draws it
+    VoxelizationScheduler scheduler;
+    scheduler.addMesh(Box3f(Vector3f(0.f, 0.f, 0.f), Vector3f(4.f, 1.f, 1.f)), 100000);
+    scheduler.setCostModel(10.f);
+    scheduler.setBudget(1.f);
+
+    Box3f regions[] = { UnitBoxAt(0.f), UnitBoxAt(1.f), UnitBoxAt(2.f), UnitBoxAt(3.f) };
+    std::vector<Box3f> scheduled;
+    scheduler.schedule(regions, nullptr, 4, Vector3f(0.f, 0.f, 0.f), 1, scheduled);
+
+    TEST_CHECK(scheduled.size() == 4);
+    TEST_CHECK(scheduler.getStats().scheduledTriangles == 100000);
+}
+
+static void TestStarvation()
+{
+    VoxelizationScheduler scheduler;
+    AddMeshes(scheduler, 2);
+    scheduler.setBudget(1.f);
+    scheduler.setMaxDeferredFrames(4);
+
+    // Region 0 is on a finer level, which goes first regardless of age, so region 1 on the coarser level
+    // is only scheduled once it has been deferred for 4 frames
+    Box3f regions[] = { UnitBoxAt(0.f), UnitBoxAt(1.f) };
+    uint32_t levels[] = { 0, 1 };
+    std::vector<Box3f> scheduled;
+
+    scheduler.schedule(regions, levels, 2, Vector3f(0.f, 0.f, 0.f), 1, scheduled);
+    TEST_CHECK(scheduled.size() == 1 && scheduled[0].lower == regions[0].lower);
+
+    for (uint64_t frame = 2; frame <= 4; frame++)
+    {
+        // As in the samples: the deferred region is reported again, together with a new invalidation of region 0.
+        // Resubmitted regions are matched by overlap, so a slightly different box keeps its age.
+        Box3f resubmitted = scheduler.getDeferredRegions()[0];
+        resubmitted.upper.y += 0.5f;
+        Box3f frameRegions[] = { regions[0], resubmitted };
+
+        scheduler.schedule(frameRegions, levels, 2, Vector3f(0.f, 0.f, 0.f), frame, scheduled);
+        TEST_CHECK(scheduled.size() == 1 && scheduled[0].lower == regions[0].lower);
+        TEST_CHECK(scheduler.getStats().oldestDeferredAge == uint32_t(frame));
+    }
+
+    Box3f frameRegions[] = { regions[0], scheduler.getDeferredRegions()[0] };
+    scheduler.schedule(frameRegions, levels, 2, Vector3f(0.f, 0.f, 0.f), 5, scheduled);
+
+    // The forced region goes before the finer level and uses up the budget, so now region 0 waits
+    TEST_CHECK(scheduler.getStats().forcedRegions == 1);
+    TEST_CHECK(scheduled.size() == 1 && scheduled[0].lower == regions[1].lower);
+    TEST_CHECK(scheduler.getDeferredRegions().size() == 1 && scheduler.getDeferredRegions()[0].lower == regions[0].lower);
+}
+
+static void TestCostModel()
+{
+    VoxelizationScheduler scheduler;
+    AddMeshes(scheduler, 4);
+    scheduler.setBudget(0.f);
+
+    Box3f regions[] = { UnitBoxAt(0.f), UnitBoxAt(1.f), UnitBoxAt(2.f), UnitBoxAt(3.f) };
+    std::vector<Box3f> scheduled;
+
+    // Measured 20 ms per million triangles, reported with a delay of 2 frames like GPU timer queries
+    for (uint64_t frame = 1; frame <= 40; frame++)
+    {
+        scheduler.schedule(regions, nullptr, 4, Vector3f(0.f, 0.f, 0.f), frame, scheduled);
+        if (frame > 2)
+            scheduler.reportMeasuredTime(frame - 2, 8.f);
+    }
+
+    // The stats hold the model as of the last schedule call, so schedule a frame without geometry to read it
+    Box3f empty[] = { UnitBoxAt(50.f) };
+    scheduler.schedule(empty, nullptr, 1, Vector3f(0.f, 0.f, 0.f), 41, scheduled);
+    float model = scheduler.getStats().msPerMillionTriangles;
+    TEST_CHECK(fabsf(model - 20.f) < 0.1f);
+
+    // Unknown frames, frames that have left the history and frames with few triangles do not change the model
+    scheduler.reportMeasuredTime(1000, 100.f);
+    scheduler.reportMeasuredTime(40 - VoxelizationScheduler::FRAME_HISTORY, 100.f);
+    scheduler.reportMeasuredTime(41, 100.f);
+
+    scheduler.schedule(empty, nullptr, 1, Vector3f(0.f, 0.f, 0.f), 42, scheduled);
+    TEST_CHECK(scheduler.getStats().msPerMillionTriangles == model);
+}
+
+int main()
+{
+    TestBudget();
+    TestOrderAndFreeRegions();
+    TestSharedMeshes();
+    TestStarvation();
+    TestCostModel();
+
+    printf("VoxelizationSchedulerTest passed\n");
+    return 0;
+}